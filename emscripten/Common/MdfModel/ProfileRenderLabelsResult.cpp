@@ -31,6 +31,8 @@ using namespace MDFMODEL_NAMESPACE;
 ProfileRenderLabelsResult::ProfileRenderLabelsResult()
 {
     this->m_dRenderTime = 0.0;
+    this->m_nLabelsPlaced = 0;
+    this->m_nLabelsRejected = 0;
 }
 
 //-------------------------------------------------------------------------
@@ -60,6 +62,46 @@ void ProfileRenderLabelsResult::SetRenderTime(const double& dRenderTime)
     this->m_dRenderTime = dRenderTime;
 }
 
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the LabelsPlaced property.
+// RETURNS: The number of labels placed in the map.
+//-------------------------------------------------------------------------
+const int ProfileRenderLabelsResult::GetLabelsPlaced() const
+{
+    return this->m_nLabelsPlaced;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the LabelsPlaced property.
+// PARAMETERS:
+//      Input:
+//          nLabelsPlaced - The number of labels placed in the map.
+//-------------------------------------------------------------------------
+void ProfileRenderLabelsResult::SetLabelsPlaced(const int& nLabelsPlaced)
+{
+    this->m_nLabelsPlaced = nLabelsPlaced;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the LabelsRejected property.
+// RETURNS: The number of labels rejected because they overlapped other labels.
+//-------------------------------------------------------------------------
+const int ProfileRenderLabelsResult::GetLabelsRejected() const
+{
+    return this->m_nLabelsRejected;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the LabelsRejected property.
+// PARAMETERS:
+//      Input:
+//          nLabelsRejected - The number of labels rejected because they overlapped other labels.
+//-------------------------------------------------------------------------
+void ProfileRenderLabelsResult::SetLabelsRejected(const int& nLabelsRejected)
+{
+    this->m_nLabelsRejected = nLabelsRejected;
+}
+
 //-------------------------------------------------------------------------
 // PURPOSE: Accessor method for the Error property.
 // RETURNS: The error message which describes labels rendering failure.
@@ -42,6 +42,16 @@ BEGIN_NAMESPACE_MDFMODEL
         const double GetRenderTime() const;
         void SetRenderTime(const double& dRenderTime);
 
+        // Property: LabelsPlaced
+        // The number of labels placed in the map.
+        const int GetLabelsPlaced() const;
+        void SetLabelsPlaced(const int& nLabelsPlaced);
+
+        // Property: LabelsRejected
+        // The number of labels rejected because they overlapped other labels.
+        const int GetLabelsRejected() const;
+        void SetLabelsRejected(const int& nLabelsRejected);
+
         // Property: Error
         // Error message if rendering labels failed.
         const MdfString& GetError() const;
@@ -62,6 +72,8 @@ BEGIN_NAMESPACE_MDFMODEL
         // Data members
         // See corresponding properties for descriptions
         double m_dRenderTime;
+        int m_nLabelsPlaced;
+        int m_nLabelsRejected;
         MdfString m_strError;
     };
 
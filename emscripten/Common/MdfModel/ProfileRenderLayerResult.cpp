@@ -31,6 +31,12 @@ using namespace MDFMODEL_NAMESPACE;
 ProfileRenderLayerResult::ProfileRenderLayerResult()
 {
     this->m_dRenderTime = 0.0;
+    this->m_nFeatureCount = 0;
+    this->m_nFilterEvaluations = 0;
+    this->m_nClipVerticesIn = 0;
+    this->m_nClipVerticesOut = 0;
+    this->m_nOptimizeVerticesIn = 0;
+    this->m_nOptimizeVerticesOut = 0;
     this->m_scaleRange = NULL;
 }
 
@@ -227,6 +233,126 @@ void ProfileRenderLayerResult::SetRenderTime(const double& dRenderTime)
     this->m_dRenderTime = dRenderTime;
 }
 
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the FeatureCount property.
+// RETURNS: The number of features stylized for the layer.
+//-------------------------------------------------------------------------
+const int ProfileRenderLayerResult::GetFeatureCount() const
+{
+    return this->m_nFeatureCount;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the FeatureCount property.
+// PARAMETERS:
+//      Input:
+//          nFeatureCount - The number of features stylized for the layer.
+//-------------------------------------------------------------------------
+void ProfileRenderLayerResult::SetFeatureCount(const int& nFeatureCount)
+{
+    this->m_nFeatureCount = nFeatureCount;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the FilterEvaluations property.
+// RETURNS: The number of rule filters evaluated for the layer.
+//-------------------------------------------------------------------------
+const int ProfileRenderLayerResult::GetFilterEvaluations() const
+{
+    return this->m_nFilterEvaluations;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the FilterEvaluations property.
+// PARAMETERS:
+//      Input:
+//          nFilterEvaluations - The number of rule filters evaluated for the layer.
+//-------------------------------------------------------------------------
+void ProfileRenderLayerResult::SetFilterEvaluations(const int& nFilterEvaluations)
+{
+    this->m_nFilterEvaluations = nFilterEvaluations;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the ClipVerticesIn property.
+// RETURNS: The number of vertices in the geometry passed to clipping.
+//-------------------------------------------------------------------------
+const int ProfileRenderLayerResult::GetClipVerticesIn() const
+{
+    return this->m_nClipVerticesIn;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the ClipVerticesIn property.
+// PARAMETERS:
+//      Input:
+//          nClipVerticesIn - The number of vertices in the geometry passed to clipping.
+//-------------------------------------------------------------------------
+void ProfileRenderLayerResult::SetClipVerticesIn(const int& nClipVerticesIn)
+{
+    this->m_nClipVerticesIn = nClipVerticesIn;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the ClipVerticesOut property.
+// RETURNS: The number of vertices left in the geometry after clipping.
+//-------------------------------------------------------------------------
+const int ProfileRenderLayerResult::GetClipVerticesOut() const
+{
+    return this->m_nClipVerticesOut;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the ClipVerticesOut property.
+// PARAMETERS:
+//      Input:
+//          nClipVerticesOut - The number of vertices left in the geometry after clipping.
+//-------------------------------------------------------------------------
+void ProfileRenderLayerResult::SetClipVerticesOut(const int& nClipVerticesOut)
+{
+    this->m_nClipVerticesOut = nClipVerticesOut;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the OptimizeVerticesIn property.
+// RETURNS: The number of vertices in the geometry passed to optimization.
+//-------------------------------------------------------------------------
+const int ProfileRenderLayerResult::GetOptimizeVerticesIn() const
+{
+    return this->m_nOptimizeVerticesIn;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the OptimizeVerticesIn property.
+// PARAMETERS:
+//      Input:
+//          nOptimizeVerticesIn - The number of vertices in the geometry passed to optimization.
+//-------------------------------------------------------------------------
+void ProfileRenderLayerResult::SetOptimizeVerticesIn(const int& nOptimizeVerticesIn)
+{
+    this->m_nOptimizeVerticesIn = nOptimizeVerticesIn;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method for the OptimizeVerticesOut property.
+// RETURNS: The number of vertices left in the geometry after optimization.
+//-------------------------------------------------------------------------
+const int ProfileRenderLayerResult::GetOptimizeVerticesOut() const
+{
+    return this->m_nOptimizeVerticesOut;
+}
+
+//-------------------------------------------------------------------------
+// PURPOSE: Accessor method to the OptimizeVerticesOut property.
+// PARAMETERS:
+//      Input:
+//          nOptimizeVerticesOut - The number of vertices left in the geometry after optimization.
+//-------------------------------------------------------------------------
+void ProfileRenderLayerResult::SetOptimizeVerticesOut(const int& nOptimizeVerticesOut)
+{
+    this->m_nOptimizeVerticesOut = nOptimizeVerticesOut;
+}
+
 //-------------------------------------------------------------------------
 // PURPOSE: Accessor method for the Error property.
 // RETURNS: The error message which describes layer rendering failure.
@@ -81,6 +81,36 @@ BEGIN_NAMESPACE_MDFMODEL
         const double GetRenderTime() const;
         void SetRenderTime(const double& dRenderTime);
 
+        // Property: FeatureCount
+        // The number of features stylized for the layer.
+        const int GetFeatureCount() const;
+        void SetFeatureCount(const int& nFeatureCount);
+
+        // Property: FilterEvaluations
+        // The number of rule filters evaluated for the layer.
+        const int GetFilterEvaluations() const;
+        void SetFilterEvaluations(const int& nFilterEvaluations);
+
+        // Property: ClipVerticesIn
+        // The number of vertices in the geometry passed to clipping.
+        const int GetClipVerticesIn() const;
+        void SetClipVerticesIn(const int& nClipVerticesIn);
+
+        // Property: ClipVerticesOut
+        // The number of vertices left in the geometry after clipping.
+        const int GetClipVerticesOut() const;
+        void SetClipVerticesOut(const int& nClipVerticesOut);
+
+        // Property: OptimizeVerticesIn
+        // The number of vertices in the geometry passed to optimization.
+        const int GetOptimizeVerticesIn() const;
+        void SetOptimizeVerticesIn(const int& nOptimizeVerticesIn);
+
+        // Property: OptimizeVerticesOut
+        // The number of vertices left in the geometry after optimization.
+        const int GetOptimizeVerticesOut() const;
+        void SetOptimizeVerticesOut(const int& nOptimizeVerticesOut);
+
         // Property: Error
         // Error message if render layer failed.
         const MdfString& GetError() const;
@@ -108,6 +138,12 @@ BEGIN_NAMESPACE_MDFMODEL
         ScaleRange* m_scaleRange;
         MdfString m_strFilter;
         double m_dRenderTime;
+        int m_nFeatureCount;
+        int m_nFilterEvaluations;
+        int m_nClipVerticesIn;
+        int m_nClipVerticesOut;
+        int m_nOptimizeVerticesIn;
+        int m_nOptimizeVerticesOut;
         MdfString m_strError;
     };
 
@@ -166,6 +166,10 @@
 //#include "Stylization/GridTheme.cpp"
 //#include "Stylization/GridThemeParser.cpp"
 //#include "Stylization/KeyEncode.cpp"
+#include "Stylization/LabelPlacementStore.cpp"
+#include "Stylization/FeatureCuller.cpp"
+#include "Stylization/PointClusterer.cpp"
+#include "Stylization/LayerScheduler.cpp"
 #include "Stylization/LabelRenderer.cpp"
 #include "Stylization/LabelRendererBase.cpp"
 #include "Stylization/LabelRendererLocal.cpp"
@@ -182,22 +186,35 @@
 //#include "Stylization/RasterAdapter.cpp"
 #include "Stylization/RichTextEngine.cpp"
 #include "Stylization/RS_FontEngine.cpp"
+#include "Stylization/RS_MemoryFeatureReader.cpp"
 #include "Stylization/RS_TextMetrics.cpp"
 #include "Stylization/SE_AreaPositioning.cpp"
 #include "Stylization/SE_Bounds.cpp"
 #include "Stylization/SE_BufferPool.cpp"
+#include "Stylization/SE_DisplayList.cpp"
+#include "Stylization/SE_DrawBatcher.cpp"
 #include "Stylization/SE_Evaluator.cpp"
 #include "Stylization/SE_ExpressionBase.cpp"
+#include "Stylization/SE_ImageRenderer.cpp"
 #include "Stylization/SE_LineBuffer.cpp"
 #include "Stylization/SE_LineRenderer.cpp"
 #include "Stylization/SE_Matrix.cpp"
+#include "Stylization/SE_MetatileRenderer.cpp"
+#include "Stylization/SE_PathMeasure.cpp"
 #include "Stylization/SE_PositioningAlgorithms.cpp"
+#include "Stylization/SE_Rasterizer.cpp"
+#include "Stylization/SE_RecordingRenderer.cpp"
+#include "Stylization/SE_RenderArena.cpp"
 #include "Stylization/SE_Renderer.cpp"
 #include "Stylization/SE_StyleVisitor.cpp"
 #include "Stylization/SE_SymbolDefProxies.cpp"
 #include "Stylization/SE_SymbolManager.cpp"
+#include "Stylization/SE_VectorTileRenderer.cpp"
 #include "Stylization/SimpleOverpost.cpp"
+#include "Stylization/StylePreviewSheet.cpp"
 #include "Stylization/StylizationEngine.cpp"
+#include "Stylization/StylizationProfiler.cpp"
+#include "Stylization/StylizationTrace.cpp"
 #include "Stylization/StylizationUtil.cpp"
 #include "Stylization/Stylizer.cpp"
 //#include "Stylization/ThemeParameters.cpp"
@@ -0,0 +1,10 @@
+// MgStylizationBenchmark.cpp
+//
+// A single source file that includes the StylizationBenchmark program
+// sources, compiled with emcc alongside MgStylization.cpp
+
+#include "Emscripten/EmCompat.h"
+
+#include "Stylization/RS_WorkloadGenerator.cpp"
+#include "Stylization/StylizationBenchmark.cpp"
+#include "Stylization/StylizationBenchmarkMain.cpp"
@@ -26,14 +26,10 @@
 #pragma warning(disable : 4482)
 
 
-// generate the static mappings at module load time to avoid threading issues
-static bool bInit = BIDIConverter::GenerateMappings();
-
-
 /////////////////// Glyph Mapping support data (shaping and mirroring) ///////////////////
 
 // source glyph, right join, left join, mid join, join type {0 = right join, 1 = dual joining}
-unsigned int glyphShapeMapping[][5] = {
+const unsigned int glyphShapeMapping[][5] = {
         {0x621, 0xFE80, 0xFE80, 0xFE80, 1},     // Hamza
         {0x622, 0xFE82, 0xFE81, 0xFE82, 0},     // Alef With Madda Above
         {0x623, 0xFE84, 0xFE83, 0xFE84, 0},     // Alef With Hamza Above
@@ -74,7 +70,7 @@ unsigned int glyphShapeMapping[][5] = {
         {0x64A, 0xFEF2, 0xFEF3, 0xFEF4, 1}};    // Yeh
 
 // input glyph 1, input glyph 2, replacement glyph
-unsigned int glyphLigatureMapping[][3] = {
+const unsigned int glyphLigatureMapping[][3] = {
         {0xFEDF, 0xFE82, 0xFEF5},   // Lam (initial) + Alef With Madda above (final) => Lam-Alef With Madda above (isolated)
         {0xFEE0, 0xFE82, 0xFEF6},   // Lam ( medial) + Alef With Madda above (final) => Lam-Alef With Madda above (   final)
         {0xFEDF, 0xFE84, 0xFEF7},   // Lam (initial) + Alef With Hamza above (final) => Lam-Alef With Hamza above (isolated)
@@ -95,7 +91,7 @@ enum ELinkageType
 
 
 // this is a list of codepoint pairs that replace each other
-unsigned int glyphMirrorMapping[][2] = {
+const unsigned int glyphMirrorMapping[][2] = {
     {0x0028, 0x0029}, {0x003C, 0x003E}, {0x005B, 0x005D}, {0x007B, 0x007D},
     {0x00AB, 0x00BB}, {0x0F3A, 0x0F3B}, {0x0F3C, 0x0F3D}, {0x169B, 0x169C},
     {0x2039, 0x203A}, {0x2045, 0x2046}, {0x207D, 0x207E}, {0x208D, 0x208E},
@@ -237,19 +233,17 @@ bool BIDIConverter::Mirror()
 // shapes a converted string
 void BIDIConverter::ShapeString()
 {
-    ShapeGlyphs& shapeGlyphs = GetShapeMapping();
+    // the mapping is shared by all threads, so only use const access
+    const ShapeGlyphs& shapeGlyphs = GetShapeMapping();
 
     DisplayStr tempString = m_ConvertedString;
-    std::vector<unsigned int> glyphMappings;
-    std::vector<unsigned int> currentGlyphMappings;
-
-    glyphMappings.resize(4);
     for (size_t i=0; i<tempString.size(); ++i)
     {
         // check if this is a shaped glyph
-        if (shapeGlyphs.find(tempString[i]) != shapeGlyphs.end())
+        ShapeGlyphs::const_iterator current = shapeGlyphs.find(tempString[i]);
+        if (current != shapeGlyphs.end())
         {
-            currentGlyphMappings = shapeGlyphs[tempString[i]];
+            const std::vector<unsigned int>& currentGlyphMappings = current->second;
             int nLinkage = eNoLinkage;
 
             // if it's not at the end of the string and the following character has linkage
@@ -259,10 +253,10 @@ void BIDIConverter::ShapeString()
             }
 
             // if it's not at the beginning of the string and the preceding character has linkage
-            if (i < (tempString.size() - 1) && (shapeGlyphs.find(tempString[i+1]) != shapeGlyphs.end()))
+            if (i < (tempString.size() - 1))
             {
-                glyphMappings = shapeGlyphs[tempString[i+1]];
-                if (glyphMappings[3] == 1)
+                ShapeGlyphs::const_iterator next = shapeGlyphs.find(tempString[i+1]);
+                if (next != shapeGlyphs.end() && next->second[3] == 1)
                 {
                     nLinkage |= eLinkBefore;
                 }
@@ -285,12 +279,12 @@ void BIDIConverter::ShapeString()
     }
 
     // enforce ligature
-    std::vector<DisplayStr>& ligaturePairs = GetLigaturePairs();
+    const std::vector<DisplayStr>& ligaturePairs = GetLigaturePairs();
     size_t numVals = ligaturePairs.size();
     for (size_t i=0; i<numVals;)
     {
-        DisplayStr& key = ligaturePairs[i++];
-        DisplayStr& val = ligaturePairs[i++];
+        const DisplayStr& key = ligaturePairs[i++];
+        const DisplayStr& val = ligaturePairs[i++];
 
         size_t pos = 0;
         size_t findPos;
@@ -1872,24 +1866,25 @@ int BIDIConverter::ParseLevels(std::vector<std::pair<int, DisplayStr> >& stringL
 // quick reverse function to mirror strings
 void BIDIConverter::reverse(DisplayStr& str)
 {
-    MirrorGlyphs& mirrorGlyphs = GetMirrorMapping();
+    const MirrorGlyphs& mirrorGlyphs = GetMirrorMapping();
+    MirrorGlyphs::const_iterator iter;
 
     size_t nLength = str.size();
     wchar_t chTemp;
     for (size_t i=0; i< --nLength; ++i)
     {
-        if (mirrorGlyphs.find(str[i]) != mirrorGlyphs.end())
+        if ((iter = mirrorGlyphs.find(str[i])) != mirrorGlyphs.end())
         {
-            chTemp = (wchar_t)mirrorGlyphs[str[i]];
+            chTemp = (wchar_t)iter->second;
         }
         else
         {
             chTemp = str[i];
         }
 
-        if (mirrorGlyphs.find(str[nLength]) != mirrorGlyphs.end())
+        if ((iter = mirrorGlyphs.find(str[nLength])) != mirrorGlyphs.end())
         {
-            str[i] = (wchar_t)mirrorGlyphs[str[nLength]];
+            str[i] = (wchar_t)iter->second;
         }
         else
         {
@@ -1900,84 +1895,97 @@ void BIDIConverter::reverse(DisplayStr& str)
     }
 
     // if odd length string, check the middle character for reversal
-    if ((str.size() & 1) && (mirrorGlyphs.find(str[nLength]) != mirrorGlyphs.end()))
+    if ((str.size() & 1) && ((iter = mirrorGlyphs.find(str[nLength])) != mirrorGlyphs.end()))
     {
-        str[nLength] = (wchar_t)mirrorGlyphs[str[nLength]];
+        str[nLength] = (wchar_t)iter->second;
     }
 }
 
 
-// returns the static mapping of glyphs to possible shaping code points - built once
-ShapeGlyphs& BIDIConverter::GetShapeMapping()
+// The static mappings are built on first use.  Initialization of a local
+// static is thread-safe, and after that the mappings are only read, so they
+// can be shared by converters on any number of threads.
+
+static ShapeGlyphs BuildShapeMapping()
 {
-    static ShapeGlyphs s_ShapeGlyphMap;
+    ShapeGlyphs shapeGlyphMap;
 
-    // initialize on first use
-    if (0 == s_ShapeGlyphMap.size())
-    {
-        std::vector<unsigned int> glyphMappings;
-        glyphMappings.resize(4);
+    std::vector<unsigned int> glyphMappings;
+    glyphMappings.resize(4);
 
-        size_t nMax = sizeof(glyphShapeMapping) / (sizeof(unsigned int)*5);
-        for (size_t i=0; i<nMax; ++i)
-        {
-            glyphMappings[0] = glyphShapeMapping[i][1];
-            glyphMappings[1] = glyphShapeMapping[i][2];
-            glyphMappings[2] = glyphShapeMapping[i][3];
-            glyphMappings[3] = glyphShapeMapping[i][4];
-            s_ShapeGlyphMap[glyphShapeMapping[i][0]] = glyphMappings;
-        }
+    size_t nMax = sizeof(glyphShapeMapping) / (sizeof(unsigned int)*5);
+    for (size_t i=0; i<nMax; ++i)
+    {
+        glyphMappings[0] = glyphShapeMapping[i][1];
+        glyphMappings[1] = glyphShapeMapping[i][2];
+        glyphMappings[2] = glyphShapeMapping[i][3];
+        glyphMappings[3] = glyphShapeMapping[i][4];
+        shapeGlyphMap[glyphShapeMapping[i][0]] = glyphMappings;
     }
 
-    return s_ShapeGlyphMap;
+    return shapeGlyphMap;
 }
 
 
-// returns the static vector of strings (stored in pairs) used to enforce ligature - built once
-std::vector<DisplayStr>& BIDIConverter::GetLigaturePairs()
+static std::vector<DisplayStr> BuildLigaturePairs()
 {
-    static std::vector<DisplayStr> s_LigaturePairs;
+    std::vector<DisplayStr> ligaturePairs;
 
-    // initialize on first use
-    if (0 == s_LigaturePairs.size())
-    {
-        DisplayStr str0(L"xx"); // allocate 2 characters
-        DisplayStr str1(L"x");  // allocate 1 character
+    DisplayStr str0(L"xx"); // allocate 2 characters
+    DisplayStr str1(L"x");  // allocate 1 character
 
-        size_t nMax = sizeof(glyphLigatureMapping) / (sizeof(unsigned int)*3);
-        for (size_t i=0; i<nMax; ++i)
-        {
-            // reverse character order for the input string
-            str0[0] = (wchar_t)glyphLigatureMapping[i][1];
-            str0[1] = (wchar_t)glyphLigatureMapping[i][0];
-            s_LigaturePairs.push_back(str0);
+    size_t nMax = sizeof(glyphLigatureMapping) / (sizeof(unsigned int)*3);
+    for (size_t i=0; i<nMax; ++i)
+    {
+        // reverse character order for the input string
+        str0[0] = (wchar_t)glyphLigatureMapping[i][1];
+        str0[1] = (wchar_t)glyphLigatureMapping[i][0];
+        ligaturePairs.push_back(str0);
 
-            str1[0] = (wchar_t)glyphLigatureMapping[i][2];
-            s_LigaturePairs.push_back(str1);
-        }
+        str1[0] = (wchar_t)glyphLigatureMapping[i][2];
+        ligaturePairs.push_back(str1);
     }
 
-    return s_LigaturePairs;
+    return ligaturePairs;
 }
 
 
-// returns the static mapping of glyphs with mirror code points - built once
-MirrorGlyphs& BIDIConverter::GetMirrorMapping()
+static MirrorGlyphs BuildMirrorMapping()
 {
-    static MirrorGlyphs s_MirrorGlyphMap;
+    MirrorGlyphs mirrorGlyphMap;
 
-    // initialize on first use
-    if (0 == s_MirrorGlyphMap.size())
+    size_t nMax = sizeof(glyphMirrorMapping) / (sizeof(unsigned int)*2);
+    for (size_t i=0; i<nMax; ++i)
     {
-        size_t nMax = sizeof(glyphMirrorMapping) / (sizeof(unsigned int)*2);
-        for (size_t i=0; i<nMax; ++i)
-        {
-            // map the ints to each other
-            s_MirrorGlyphMap[glyphMirrorMapping[i][0]] = glyphMirrorMapping[i][1];
-            s_MirrorGlyphMap[glyphMirrorMapping[i][1]] = glyphMirrorMapping[i][0];
-        }
+        // map the ints to each other
+        mirrorGlyphMap[glyphMirrorMapping[i][0]] = glyphMirrorMapping[i][1];
+        mirrorGlyphMap[glyphMirrorMapping[i][1]] = glyphMirrorMapping[i][0];
     }
 
+    return mirrorGlyphMap;
+}
+
+
+// returns the static mapping of glyphs to possible shaping code points - built once
+const ShapeGlyphs& BIDIConverter::GetShapeMapping()
+{
+    static const ShapeGlyphs s_ShapeGlyphMap = BuildShapeMapping();
+    return s_ShapeGlyphMap;
+}
+
+
+// returns the static vector of strings (stored in pairs) used to enforce ligature - built once
+const std::vector<DisplayStr>& BIDIConverter::GetLigaturePairs()
+{
+    static const std::vector<DisplayStr> s_LigaturePairs = BuildLigaturePairs();
+    return s_LigaturePairs;
+}
+
+
+// returns the static mapping of glyphs with mirror code points - built once
+const MirrorGlyphs& BIDIConverter::GetMirrorMapping()
+{
+    static const MirrorGlyphs s_MirrorGlyphMap = BuildMirrorMapping();
     return s_MirrorGlyphMap;
 }
 
@@ -106,7 +106,8 @@ public:
 
     STYLIZATION_API static const int _MaxNestedLevel = 61;
 
-    // generates the static mappings
+    // Generates the static mappings.  They are otherwise generated on first
+    // use, which is thread-safe, so calling this is optional.
     STYLIZATION_API static bool GenerateMappings();
 
 private:
@@ -179,13 +180,13 @@ private:
     void reverse(DisplayStr& str);
 
     // returns the static mapping of glyphs to possible shaping code points
-    static ShapeGlyphs& GetShapeMapping();
+    static const ShapeGlyphs& GetShapeMapping();
 
     // returns the static vector of strings (stored in pairs) used to enforce ligature
-    static std::vector<DisplayStr>& GetLigaturePairs();
+    static const std::vector<DisplayStr>& GetLigaturePairs();
 
     // returns the static mapping of glyphs with mirror code points
-    static MirrorGlyphs& GetMirrorMapping();
+    static const MirrorGlyphs& GetMirrorMapping();
 
 private:
     DisplayStr m_OriginalString;
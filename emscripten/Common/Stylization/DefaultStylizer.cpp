@@ -27,6 +27,9 @@
 #include "ElevationSettings.h"
 #include "FeatureTypeStyleVisitor.h"
 #include "StylizationEngine.h"
+#include "StylizationProfiler.h"
+#include "StylizationTrace.h"
+#include "SE_Renderer.h"
 #ifndef EMSCRIPTEN
 #include "FdoEvaluator.h"
 #else
@@ -42,6 +45,7 @@ DefaultStylizer::DefaultStylizer(SE_SymbolManager* sman)
     m_pRasterAdapter = NULL;
     m_symbolmanager = sman;
     m_styleEngine = new StylizationEngine(sman, &m_lbPool);
+    m_styleEngine->SetFeatureCuller(&m_culler);
 }
 
 
@@ -63,6 +67,13 @@ SE_SymbolManager* DefaultStylizer::GetSymbolManager()
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+SE_BufferPool* DefaultStylizer::GetBufferPool()
+{
+    return &m_lbPool;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 void DefaultStylizer::StylizeVectorLayer(MdfModel::VectorLayerDefinition* layer,
                                          Renderer*                        renderer,
@@ -88,19 +99,28 @@ void DefaultStylizer::StylizeVectorLayer(MdfModel::VectorLayerDefinition* layer,
     // set the line buffer pool for the renderer to use
     renderer->SetBufferPool(&m_lbPool);
 
+    // profile the layer if the renderer has a profiler attached - only
+    // SE_Renderers can have one
+    SE_Renderer* serenderer = dynamic_cast<SE_Renderer*>(renderer);
+    StylizationProfiler::Scope profileScope(serenderer? serenderer->GetProfiler() : NULL, layer, scaleRange);
+    StylizationTraceScope traceScope("StylizeVectorLayer", StylizationTrace::Layers, layer->GetFeatureName().c_str());
+
+    // only SE_Renderers can report their pixel size to the culler
+    m_culler.StartLayer(serenderer);
+
+    // stylize the clusters of a point layer rather than its points - their
+    // geometry is already in mapping space
+    RS_FeatureReader* clusters = m_clusterer.Cluster(serenderer, features, xformer, cancel, userData);
+    if (clusters)
+    {
+        features = clusters;
+        xformer = NULL;
+    }
+
     // check if we have any composite type styles - if we find at least
     // one then we'll use it and ignore any other non-composite type styles
     // TODO: confirm this is the behavior we want
-    bool foundComposite = false;
-    for (int i=0; i<ftsc->GetCount(); ++i)
-    {
-        MdfModel::FeatureTypeStyle* fts = ftsc->GetAt(i);
-        if (FeatureTypeStyleVisitor::DetermineFeatureTypeStyle(fts) == FeatureTypeStyleVisitor::ftsComposite)
-        {
-            foundComposite = true;
-            break;
-        }
-    }
+    bool foundComposite = HasCompositeStyle(scaleRange);
 
     // composite type styles are handled by the new style engine
     if (foundComposite)
@@ -228,6 +248,9 @@ void DefaultStylizer::StylizeVectorLayer(MdfModel::VectorLayerDefinition* layer,
         #endif
     }
 
+    // draw the coverage of the culled features
+    m_culler.EndLayer();
+
     // need to get rid of these since they cache per layer theming
     // information which may conflict with the next layer
     ClearAdapters();
@@ -235,19 +258,129 @@ void DefaultStylizer::StylizeVectorLayer(MdfModel::VectorLayerDefinition* layer,
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+void DefaultStylizer::StylizeVectorLayer(MdfModel::VectorLayerDefinition* layer,
+                                         const std::vector<SE_Renderer*>& renderers,
+                                         RS_FeatureReader*                features,
+                                         CSysTransformer*                 xformer,
+                                         CancelStylization                cancel,
+                                         void*                            userData)
+{
+    // find the scale range of each renderer - renderers whose scale is in
+    // no range draw nothing
+    MdfModel::VectorScaleRangeCollection* scaleRanges = layer->GetScaleRanges();
+    std::vector<SE_Renderer*> targets;
+    std::vector<MdfModel::VectorScaleRange*> ranges;
+    bool allComposite = true;
+    for (size_t i=0; i<renderers.size(); ++i)
+    {
+        MdfModel::VectorScaleRange* scaleRange = Stylizer::FindScaleRange(*scaleRanges, renderers[i]->GetMapScale());
+        if (NULL == scaleRange)
+            continue;
+
+        targets.push_back(renderers[i]);
+        ranges.push_back(scaleRange);
+        allComposite &= HasCompositeStyle(scaleRange);
+    }
+
+    if (targets.empty())
+        return;
+
+    // the geometry adapters draw for one renderer at a time, and the culler
+    // and the clusterer work in the pixels of one renderer, so these layers
+    // are stylized for each renderer in turn
+    bool perRenderer = !allComposite || m_culler.GetMinSize() > 0.0 || m_clusterer.GetCellSize() > 0.0;
+    if (perRenderer)
+    {
+        for (size_t i=0; i<targets.size(); ++i)
+        {
+            if (i > 0)
+                features->Reset();
+
+            StylizeVectorLayer(layer, targets[i], features, xformer, targets[i]->GetMapScale(), cancel, userData);
+        }
+
+        return;
+    }
+
+    // set the line buffer pool for the renderers to use
+    for (size_t i=0; i<targets.size(); ++i)
+        targets[i]->SetBufferPool(&m_lbPool);
+
+    // profile the layer if the first renderer has a profiler attached
+    StylizationProfiler::Scope profileScope(targets[0]->GetProfiler(), layer, ranges[0]);
+    StylizationTraceScope traceScope("StylizeVectorLayer", StylizationTrace::Layers, layer->GetFeatureName().c_str());
+
+    m_styleEngine->StylizeVectorLayer(layer, ranges, targets, features, xformer, cancel, userData);
+
+    m_styleEngine->ClearCache();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool DefaultStylizer::HasCompositeStyle(MdfModel::VectorScaleRange* scaleRange)
+{
+    MdfModel::FeatureTypeStyleCollection* ftsc = scaleRange->GetFeatureTypeStyles();
+    for (int i=0; i<ftsc->GetCount(); ++i)
+    {
+        MdfModel::FeatureTypeStyle* fts = ftsc->GetAt(i);
+        if (FeatureTypeStyleVisitor::DetermineFeatureTypeStyle(fts) == FeatureTypeStyleVisitor::ftsComposite)
+            return true;
+    }
+
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void DefaultStylizer::StylizeWatermark(Renderer* renderer,
+                                       MdfModel::WatermarkDefinition* watermark,
+                                       int drawWidth,
+                                       int drawHeight,
+                                       int saveWidth,
+                                       int saveHeight)
+{
+    StylizeWatermark(renderer, MdfString(), watermark, drawWidth, drawHeight, saveWidth, saveHeight);
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 void DefaultStylizer::StylizeWatermark(Renderer* renderer,
+                                       const MdfString& resourceId,
                                        MdfModel::WatermarkDefinition* watermark,
                                        int drawWidth,
                                        int drawHeight,
                                        int saveWidth,
                                        int saveHeight)
 {
-    m_styleEngine->StylizeWatermark((SE_Renderer*)renderer, watermark, drawWidth, drawHeight, saveWidth, saveHeight);
+    m_styleEngine->StylizeWatermark((SE_Renderer*)renderer, watermark, drawWidth, drawHeight, saveWidth, saveHeight, resourceId);
     m_styleEngine->ClearCache();
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+void DefaultStylizer::ClearWatermarkCache()
+{
+    m_styleEngine->ClearWatermarkCache();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void DefaultStylizer::SetFeatureCulling(double minSize, bool aggregate, unsigned int argb)
+{
+    m_culler.SetMinSize(minSize);
+    m_culler.SetAggregate(aggregate, argb);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void DefaultStylizer::SetPointClustering(double cellSize, bool merge)
+{
+    m_clusterer.SetCellSize(cellSize);
+    m_clusterer.SetMerge(merge);
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 int DefaultStylizer::StylizeVLHelper(MdfModel::VectorLayerDefinition* layer,
                                      MdfModel::VectorScaleRange*      scaleRange,
@@ -315,6 +448,9 @@ int DefaultStylizer::StylizeVLHelper(MdfModel::VectorLayerDefinition* layer,
     // ignore Z values if the renderer doesn't need them
     bool ignoreZ = !renderer->SupportsZ();
 
+    SE_Renderer* serenderer = dynamic_cast<SE_Renderer*>(renderer);
+    StylizationProfiler* profiler = serenderer? serenderer->GetProfiler() : NULL;
+
 #ifndef EMSCRIPTEN
     // create an FDO evaluator
     // NOTE: We must create a new evaluator for each call to StylizeVLHelper.  The
@@ -328,12 +464,19 @@ int DefaultStylizer::StylizeVLHelper(MdfModel::VectorLayerDefinition* layer,
 
     // main loop over feature data
     int nFeatures = 0;
-    while (features->ReadNext())
+    StylizationTraceBatch traceBatch(256);
+    while (StylizationTraceReadNext(features))
     {
         #ifdef _DEBUG
         ++nFeatures;
         #endif
 
+        traceBatch.Next();
+
+        // the reader is reset for each line style after the first
+        if (profiler && initialPass)
+            profiler->CountFeature();
+
         LineBuffer* lb = LineBufferPool::NewLineBuffer(&m_lbPool, 8, Dimensionality_Z, ignoreZ);
         if (!lb)
             continue;
@@ -347,7 +490,10 @@ int DefaultStylizer::StylizeVLHelper(MdfModel::VectorLayerDefinition* layer,
         try
         {
             if (!features->IsNull(gpName))
+            {
+                StylizationTraceScope trace("DecodeGeometry", StylizationTrace::Features);
                 features->GetGeometry(gpName, lb, xformer);
+            }
             else
             {
                 // just move on to the next feature
@@ -366,7 +512,10 @@ int DefaultStylizer::StylizeVLHelper(MdfModel::VectorLayerDefinition* layer,
         try
         {
             if (!features->IsNull(gpName))
+            {
+                StylizationTraceScope trace("DecodeGeometry", StylizationTrace::Features);
                 features->GetGeometry(gpName, lb, xformer);
+            }
             else
             {
                 // just move on to the next feature
@@ -382,10 +531,20 @@ int DefaultStylizer::StylizeVLHelper(MdfModel::VectorLayerDefinition* layer,
         }
     #endif
 
+        // skip features too small to see - their coverage is accumulated
+        // only once, though the reader is reset for each line style
+        if (m_culler.Cull(lb, initialPass))
+        {
+            LineBufferPool::FreeLineBuffer(&m_lbPool, spLB.release());
+            continue;
+        }
+
         // if we know how to stylize this type of geometry, then go ahead
         GeometryAdapter* adapter = FindGeomAdapter(lb->geom_type());
         if (adapter)
         {
+            adapter->SetProfiler(profiler);
+
             // we need to stylize once for each FeatureTypeStyle that matches
             // the geometry type (Note: this may have to change to match
             // feature classes)
@@ -436,6 +595,12 @@ void DefaultStylizer::StylizeGridLayer(MdfModel::GridLayerDefinition* layer,
     // set the line buffer pool for the renderer to use
     renderer->SetBufferPool(&m_lbPool);
 
+    // profile the layer if the renderer has a profiler attached
+    SE_Renderer* serenderer = dynamic_cast<SE_Renderer*>(renderer);
+    StylizationProfiler* profiler = serenderer? serenderer->GetProfiler() : NULL;
+    StylizationProfiler::Scope profileScope(profiler, layer, range);
+    StylizationTraceScope traceScope("StylizeGridLayer", StylizationTrace::Layers, layer->GetFeatureName().c_str());
+
 #ifndef EMSCRIPTEN
     // create an expression engine with our custom functions
     FdoEvaluator eval(renderer, features);
@@ -450,6 +615,7 @@ void DefaultStylizer::StylizeGridLayer(MdfModel::GridLayerDefinition* layer,
     // init the raster adapter
     if (!m_pRasterAdapter)
         m_pRasterAdapter = new RasterAdapter(&m_lbPool);
+    m_pRasterAdapter->SetProfiler(profiler);
 
     // main loop over raster data
     while (features->ReadNext())
@@ -458,6 +624,9 @@ void DefaultStylizer::StylizeGridLayer(MdfModel::GridLayerDefinition* layer,
         // data is transformed to the map cs
         RS_Raster* raster = features->GetRaster(rpName);
 
+        if (profiler)
+            profiler->CountFeature();
+
         // at this point raster is in the raster layer's cs
         if (m_pRasterAdapter)
             m_pRasterAdapter->Stylize(renderer, features, true, &eval, raster, gcs, gss, NULL, NULL, NULL, layer2mapxformer);
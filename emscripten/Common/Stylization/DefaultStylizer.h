@@ -20,14 +20,23 @@
 
 #include "Stylizer.h"
 #include "SE_BufferPool.h"
+#include "FeatureCuller.h"
+#include "PointClusterer.h"
 
 class RasterAdapter;
 class StylizationEngine;
 class SE_SymbolManager;
+class SE_Renderer;
 
 //////////////////////////////////////////////////////////////////////////////
 // Stylizer used for all types of layers which do not have special
 // Stylizer implementation, which is currently all of them.
+//
+// A stylizer owns all the mutable state of a render (the engine, geometry
+// adapters and buffer pool), so a stylizer together with its renderer is the
+// context of one render.  Renders may run concurrently on different threads
+// as long as each uses its own stylizer and renderer - layer definitions and
+// the library's shared tables are only read.
 //////////////////////////////////////////////////////////////////////////////
 class DefaultStylizer : public Stylizer
 {
@@ -37,6 +46,10 @@ public:
 
     STYLIZATION_API SE_SymbolManager* GetSymbolManager();
 
+    // The pool of buffers used while stylizing.  Servers should Trim it
+    // between requests.
+    STYLIZATION_API SE_BufferPool* GetBufferPool();
+
     STYLIZATION_API virtual void StylizeVectorLayer(MdfModel::VectorLayerDefinition* layer,
                                                     Renderer*                        renderer,
                                                     RS_FeatureReader*                features,
@@ -45,6 +58,24 @@ public:
                                                     CancelStylization                cancel,
                                                     void*                            userData);
 
+    // Stylizes a layer for several renderers at once, e.g. the tiles of a
+    // block being seeded or a map exported at several resolutions, reading
+    // the features only once.  The renderers' maps and layers must have been
+    // started, and the features should cover the union of their extents.
+    // Each feature is drawn by the renderers whose extent it reaches, and
+    // renderers with the same scale share rule selection and style
+    // evaluation.  Layers which aren't stylized with composite styles, and
+    // all layers while feature culling or point clustering is on, are
+    // stylized for one renderer after another instead, resetting the
+    // features in between, so that each renderer is culled and clustered
+    // in its own pixels.
+    STYLIZATION_API void StylizeVectorLayer(MdfModel::VectorLayerDefinition* layer,
+                                            const std::vector<SE_Renderer*>& renderers,
+                                            RS_FeatureReader*                features,
+                                            CSysTransformer*                 xformer,
+                                            CancelStylization                cancel,
+                                            void*                            userData);
+
     STYLIZATION_API virtual void StylizeGridLayer(MdfModel::GridLayerDefinition* layer,
                                                   Renderer*                      renderer,
                                                   RS_FeatureReader*              features,
@@ -66,11 +97,44 @@ public:
                                                   int saveWidth,
                                                   int saveHeight);
 
+    // Watermarks stylized with their resource id are converted once and
+    // reused across requests while their appearance and the device scale
+    // stay the same.  Call ClearWatermarkCache after a watermark resource
+    // changes.
+    STYLIZATION_API void StylizeWatermark(Renderer* renderer,
+                                          const MdfModel::MdfString& resourceId,
+                                          MdfModel::WatermarkDefinition* watermark,
+                                          int drawWidth,
+                                          int drawHeight,
+                                          int saveWidth,
+                                          int saveHeight);
+    STYLIZATION_API void ClearWatermarkCache();
+
+    // Line and polygon features whose extent on screen is smaller than the
+    // given number of pixels in both directions are skipped right after
+    // their geometry is read.  With aggregate set, the area they cover is
+    // instead drawn once per layer, pixel by pixel in the given color with
+    // the coverage as opacity.  A size of zero, the default, turns culling
+    // off.
+    STYLIZATION_API void SetFeatureCulling(double minSize, bool aggregate = false, unsigned int argb = 0xff808080);
+
+    // The features of point layers are replaced by clusters of the points
+    // within square cells of the given size in pixels, optionally merged
+    // with the clusters of neighbouring cells.  Each cluster has the
+    // attributes of its first point and the number of its points in the
+    // ClusterCount property.  A size of zero, the default, turns clustering
+    // off.
+    STYLIZATION_API void SetPointClustering(double cellSize, bool merge = true);
+
     STYLIZATION_API virtual void SetGeometryAdapter(GeometryType type, GeometryAdapter* stylizer);
 
     STYLIZATION_API virtual bool HasValidScaleRange(MdfModel::VectorLayerDefinition* layer,
                                                     double mapScale);
 
+    // whether the scale range is stylized with composite styles, which
+    // only use the SE_Renderer draw calls
+    STYLIZATION_API static bool HasCompositeStyle(MdfModel::VectorScaleRange* scaleRange);
+
 private:
     int StylizeVLHelper(MdfModel::VectorLayerDefinition* layer,
                         MdfModel::VectorScaleRange*      scaleRange,
@@ -96,6 +160,9 @@ private:
     SE_SymbolManager* m_symbolmanager;
 
     SE_BufferPool m_lbPool;
+
+    FeatureCuller m_culler;
+    PointClusterer m_clusterer;
 };
 
 #endif
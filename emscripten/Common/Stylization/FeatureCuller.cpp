@@ -0,0 +1,270 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "FeatureCuller.h"
+#include "SE_Renderer.h"
+#include "LineBuffer.h"
+#include <math.h>
+#include <limits.h>
+
+// the largest number of cells in the coverage grid - larger maps accumulate
+// the coverage in blocks of pixels
+static const double MAX_COVERAGE_CELLS = 2048.0 * 2048.0;
+
+
+//////////////////////////////////////////////////////////////////////////////
+FeatureCuller::FeatureCuller()
+: m_minSize(0.0),
+  m_aggregate(false),
+  m_argb(0xff808080),
+  m_renderer(NULL),
+  m_px2su(1.0),
+  m_culled(0),
+  m_originX(0.0),
+  m_originY(0.0),
+  m_cellSize(1.0),
+  m_cols(0),
+  m_rows(0),
+  m_minCol(INT_MAX),
+  m_minRow(INT_MAX),
+  m_maxCol(-1),
+  m_maxRow(-1)
+{
+    for (int i=0; i<NumLevels; ++i)
+        m_levels[i] = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+FeatureCuller::~FeatureCuller()
+{
+    for (int i=0; i<NumLevels; ++i)
+        delete m_levels[i];
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void FeatureCuller::StartLayer(SE_Renderer* renderer)
+{
+    m_renderer = NULL;
+    m_culled = 0;
+
+    // nothing is culled without a renderer to measure against
+    if (m_minSize <= 0.0 || !renderer)
+        return;
+
+    m_renderer = renderer;
+    m_px2su = renderer->GetScreenUnitsPerPixel();
+
+    if (!m_aggregate)
+        return;
+
+    // the map in screen units
+    RS_Bounds& extents = renderer->GetBounds();
+    double x0, y0, x1, y1;
+    renderer->WorldToScreenPoint(extents.minx, extents.miny, x0, y0);
+    renderer->WorldToScreenPoint(extents.maxx, extents.maxy, x1, y1);
+
+    m_originX = rs_min(x0, x1);
+    m_originY = rs_min(y0, y1);
+
+    double width = fabs(x1 - x0) / m_px2su;
+    double height = fabs(y1 - y0) / m_px2su;
+
+    // cells are pixels, or square blocks of pixels for very large maps
+    double pixelsPerCell = 1.0;
+    if (width * height > MAX_COVERAGE_CELLS)
+        pixelsPerCell = ceil(sqrt(width * height / MAX_COVERAGE_CELLS));
+
+    m_cellSize = pixelsPerCell * m_px2su;
+    m_cols = (int)ceil(width / pixelsPerCell);
+    m_rows = (int)ceil(height / pixelsPerCell);
+
+    // the touched cells were cleared at the end of the last layer
+    size_t cells = (size_t)m_cols * (size_t)m_rows;
+    if (m_coverage.size() != cells)
+        m_coverage.assign(cells, 0.0f);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void FeatureCuller::EndLayer()
+{
+    if (m_renderer && m_aggregate && m_maxCol >= 0)
+    {
+        DrawCoverage();
+
+        for (int row=m_minRow; row<=m_maxRow; ++row)
+        {
+            float* cell = &m_coverage[(size_t)row * m_cols];
+            for (int col=m_minCol; col<=m_maxCol; ++col)
+                cell[col] = 0.0f;
+        }
+    }
+
+    m_minCol = m_minRow = INT_MAX;
+    m_maxCol = m_maxRow = -1;
+    m_renderer = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool FeatureCuller::Cull(LineBuffer* lb, bool accumulate)
+{
+    if (!m_renderer)
+        return false;
+
+    bool isLine;
+    switch (lb->geom_type())
+    {
+        case GeometryType_LineString:
+        case GeometryType_MultiLineString:
+        case GeometryType_CurveString:
+        case GeometryType_MultiCurveString:
+            isLine = true;
+            break;
+
+        case GeometryType_Polygon:
+        case GeometryType_MultiPolygon:
+        case GeometryType_CurvePolygon:
+        case GeometryType_MultiCurvePolygon:
+            isLine = false;
+            break;
+
+        default:
+            return false;
+    }
+
+    if (lb->point_count() == 0)
+        return false;
+
+    // the extent of the feature in pixels
+    RS_Bounds b = lb->bounds();
+    double x0, y0, x1, y1;
+    m_renderer->WorldToScreenPoint(b.minx, b.miny, x0, y0);
+    m_renderer->WorldToScreenPoint(b.maxx, b.maxy, x1, y1);
+
+    double width = fabs(x1 - x0) / m_px2su;
+    double height = fabs(y1 - y0) / m_px2su;
+    if (width >= m_minSize || height >= m_minSize)
+        return false;
+
+    ++m_culled;
+
+    if (m_aggregate && accumulate)
+    {
+        double coverage = isLine? rs_max(width, height) : width * height;
+        Accumulate(0.5 * (x0 + x1), 0.5 * (y0 + y1), coverage);
+    }
+
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds the coverage, in square pixels, to the cell containing the given
+// screen point.
+void FeatureCuller::Accumulate(double sx, double sy, double coverage)
+{
+    double fcol = (sx - m_originX) / m_cellSize;
+    double frow = (sy - m_originY) / m_cellSize;
+    if (fcol < 0.0 || frow < 0.0 || fcol >= m_cols || frow >= m_rows)
+        return;
+
+    int col = (int)fcol;
+    int row = (int)frow;
+
+    double pixelsPerCell = m_cellSize / m_px2su;
+    m_coverage[(size_t)row * m_cols + col] += (float)(coverage / (pixelsPerCell * pixelsPerCell));
+
+    m_minCol = rs_min(m_minCol, col);
+    m_minRow = rs_min(m_minRow, row);
+    m_maxCol = rs_max(m_maxCol, col);
+    m_maxRow = rs_max(m_maxRow, row);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Gets the opacity level of a cell's coverage - level 0 is the lowest
+// visible opacity, and untouched cells have level -1.
+inline int FeatureCuller::GetLevel(float coverage)
+{
+    if (coverage <= 0.0f)
+        return -1;
+
+    return rs_min((int)NumLevels, rs_max(1, (int)(coverage * NumLevels + 0.5f))) - 1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Draws the touched cells, one polygon per opacity level.  Runs of cells of
+// the same level in a row are drawn as one rectangle.
+void FeatureCuller::DrawCoverage()
+{
+    for (int i=0; i<NumLevels; ++i)
+    {
+        if (m_levels[i])
+            m_levels[i]->Reset();
+        else
+            m_levels[i] = new LineBuffer(64);
+    }
+
+    for (int row=m_minRow; row<=m_maxRow; ++row)
+    {
+        const float* cell = &m_coverage[(size_t)row * m_cols];
+        double y0 = m_originY + row * m_cellSize;
+        double y1 = y0 + m_cellSize;
+
+        int col = m_minCol;
+        while (col <= m_maxCol)
+        {
+            int level = GetLevel(cell[col]);
+            int end = col + 1;
+            while (end <= m_maxCol && GetLevel(cell[end]) == level)
+                ++end;
+
+            if (level >= 0)
+            {
+                double x0 = m_originX + col * m_cellSize;
+                double x1 = m_originX + end * m_cellSize;
+
+                LineBuffer* lb = m_levels[level];
+                lb->MoveTo(x0, y0);
+                lb->LineTo(x1, y0);
+                lb->LineTo(x1, y1);
+                lb->LineTo(x0, y1);
+                lb->Close();
+            }
+
+            col = end;
+        }
+    }
+
+    unsigned int alpha = m_argb >> 24;
+    for (int i=0; i<NumLevels; ++i)
+    {
+        LineBuffer* lb = m_levels[i];
+        if (lb->point_count() == 0)
+            continue;
+
+        lb->SetGeometryType(GeometryType_MultiPolygon);
+
+        unsigned int levelAlpha = alpha * (i + 1) / NumLevels;
+        m_renderer->DrawScreenPolygon(lb, NULL, (m_argb & 0x00ffffff) | (levelAlpha << 24));
+    }
+}
@@ -0,0 +1,103 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef FEATURECULLER_H_
+#define FEATURECULLER_H_
+
+#include "StylizationAPI.h"
+#include <vector>
+
+class SE_Renderer;
+class LineBuffer;
+
+
+//---------------------------------------------
+// Skips the line and polygon features of a layer whose extent on screen is
+// smaller than a given number of pixels in both directions, right after
+// their geometry is read, so that they cost neither rule evaluation nor
+// drawing.  At small scales these are most of the features of dense layers
+// such as building footprints or parcels.
+//
+// With aggregation on, the area each skipped feature covers is added to
+// the pixel under its center, and the pixels are drawn once at the end of
+// the layer in the aggregate color, with their coverage as opacity.  Lines
+// count as one pixel wide.  The coverage is kept in a grid of the map's
+// pixels, or of blocks of pixels for very large maps.
+//
+// Point features are never culled - their size on screen is that of their
+// symbols, not of their geometry.  Nothing is culled for a layer started
+// without a renderer.
+//---------------------------------------------
+
+class FeatureCuller
+{
+public:
+    FeatureCuller();
+    ~FeatureCuller();
+
+    // a size of zero turns culling off
+    inline void SetMinSize(double pixels) { m_minSize = pixels; }
+    inline double GetMinSize() const { return m_minSize; }
+
+    inline void SetAggregate(bool aggregate, unsigned int argb) { m_aggregate = aggregate; m_argb = argb; }
+
+    void StartLayer(SE_Renderer* renderer);
+    void EndLayer();
+
+    // Returns true if the feature whose geometry is given should be skipped.
+    // Its coverage is only accumulated if requested - the features of a layer
+    // may be read more than once.
+    bool Cull(LineBuffer* lb, bool accumulate);
+
+    // the number of features skipped in the current layer
+    inline int GetCulledCount() const { return m_culled; }
+
+private:
+    void Accumulate(double sx, double sy, double coverage);
+    void DrawCoverage();
+    static int GetLevel(float coverage);
+
+    // the number of opacity levels the coverage is drawn with
+    enum { NumLevels = 16 };
+
+    double m_minSize;
+    bool m_aggregate;
+    unsigned int m_argb;
+
+    SE_Renderer* m_renderer;
+    double m_px2su;
+    int m_culled;
+
+    // the coverage grid, whose origin is the top left corner of the map in
+    // screen units - only the cells from m_minCol/m_minRow to m_maxCol/
+    // m_maxRow have been touched since the last layer
+    std::vector<float> m_coverage;
+    double m_originX;
+    double m_originY;
+    double m_cellSize;      // in screen units
+    int m_cols;
+    int m_rows;
+    int m_minCol;
+    int m_minRow;
+    int m_maxCol;
+    int m_maxRow;
+
+    // the cells of each opacity level, as rectangles
+    LineBuffer* m_levels[NumLevels];
+};
+
+#endif
@@ -21,12 +21,14 @@
 #include "SymbolVisitor.h"
 #include "SLDSymbols.h"
 #include "SE_Evaluator.h"
+#include "StylizationProfiler.h"
 
 //////////////////////////////////////////////////////////////////////////////
 GeometryAdapter::GeometryAdapter(LineBufferPool* lbp)
 {
     m_eval = NULL;
     m_lbPool = lbp;
+    m_profiler = NULL;
 }
 
 
@@ -620,6 +622,9 @@ bool GeometryAdapter::ExecFilter(const MdfModel::MdfString* pExprstr)
     // of the inheriting geometry adapter
     _ASSERT(m_eval);
 
+    if (m_profiler)
+        m_profiler->CountFilter();
+
     return m_eval->ExecFilter(pExprstr);
 }
 
@@ -25,6 +25,7 @@
 class LineBuffer;
 class LineBufferPool;
 class SE_Evaluator;
+class StylizationProfiler;
 
 //-----------------------------------------------------------------------------
 // Base class for helper classes which know how to stylize a particular
@@ -81,6 +82,9 @@ public:
 
     STYLIZATION_API bool ExecFilter(const MdfModel::MdfString* pExprstr);
 
+    // the profiler to report to - set by the stylizer, and NULL when not profiling
+    inline void SetProfiler(StylizationProfiler* profiler) { m_profiler = profiler; }
+
 protected:
     STYLIZATION_API bool GetElevationParams(RS_ElevationSettings* elevationSettings,
                                             double& zOffset, double& zExtrusion,
@@ -90,6 +94,7 @@ protected:
 
     SE_Evaluator* m_eval;
     LineBufferPool* m_lbPool;
+    StylizationProfiler* m_profiler;
 };
 
 #endif
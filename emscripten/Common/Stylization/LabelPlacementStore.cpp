@@ -0,0 +1,529 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "LabelPlacementStore.h"
+#include <atomic>
+
+#ifdef _WIN32
+#include <process.h>
+#define LPS_GETPID _getpid
+#else
+#include <unistd.h>
+#define LPS_GETPID getpid
+#endif
+
+// File layout - all values are in native byte order:
+//
+//   header:    magic, byte order, version                  (3 x 4 bytes)
+//              grid key                                    (string)
+//              placement count                             (4 bytes)
+//   for each placement:
+//              type, exclude flag                          (2 x 4 bytes)
+//              text                                        (string)
+//              text definition                             (see WriteTextDef)
+//              insertion point                             (2 x 8 bytes)
+//              character count, positions                  (4 + n x 24 bytes)
+//              point count, points                         (4 + n x 16 bytes)
+//
+// Strings are written as their length followed by 32 bit units.
+
+static const unsigned char RSLP_MAGIC[4] = { 'R', 'S', 'L', 'P' };
+static const unsigned int RSLP_BYTEORDER = 0x01020304;
+static const unsigned int RSLP_VERSION = 1;
+
+
+//////////////////////////////////////////////////////////////////////////////
+static void WriteBytes(std::vector<unsigned char>& data, const void* src, size_t len)
+{
+    const unsigned char* bytes = (const unsigned char*)src;
+    data.insert(data.end(), bytes, bytes + len);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static void WriteUInt(std::vector<unsigned char>& data, unsigned int value)
+{
+    WriteBytes(data, &value, 4);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static void WriteDouble(std::vector<unsigned char>& data, double value)
+{
+    WriteBytes(data, &value, 8);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static void WriteString(std::vector<unsigned char>& data, const RS_String& str)
+{
+    WriteUInt(data, (unsigned int)str.length());
+    for (size_t i=0; i<str.length(); ++i)
+        WriteUInt(data, (unsigned int)str[i]);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static void WriteColor(std::vector<unsigned char>& data, RS_Color& color)
+{
+    WriteUInt(data, (unsigned int)color.argb());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static void WriteTextDef(std::vector<unsigned char>& data, RS_TextDef& tdef)
+{
+    WriteUInt(data, (unsigned int)tdef.halign());
+    WriteUInt(data, (unsigned int)tdef.valign());
+    WriteUInt(data, (unsigned int)tdef.justify());
+    WriteUInt(data, (unsigned int)tdef.textbg());
+    WriteColor(data, tdef.textcolor());
+    WriteColor(data, tdef.ghostcolor());
+    WriteColor(data, tdef.framecolor());
+    WriteColor(data, tdef.opaquecolor());
+    WriteDouble(data, tdef.font().height());
+    WriteString(data, tdef.font().name());
+    WriteUInt(data, (unsigned int)tdef.font().style());
+    WriteUInt(data, (unsigned int)tdef.font().units());
+    WriteUInt(data, (unsigned int)tdef.font().charset());
+    WriteDouble(data, tdef.rotation());
+    WriteDouble(data, tdef.obliqueAngle());
+    WriteDouble(data, tdef.trackSpacing());
+    WriteDouble(data, tdef.linespace());
+    WriteDouble(data, tdef.frameoffsetx());
+    WriteDouble(data, tdef.frameoffsety());
+    WriteString(data, tdef.markup());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Reads the values written above, failing once the data runs out.
+class PlacementReader
+{
+public:
+    PlacementReader(const unsigned char* data, size_t length)
+    : m_pos(data)
+    , m_end(data + length)
+    {
+    }
+
+    bool ReadBytes(void* dst, size_t len)
+    {
+        if ((size_t)(m_end - m_pos) < len)
+            return false;
+        memcpy(dst, m_pos, len);
+        m_pos += len;
+        return true;
+    }
+
+    bool ReadUInt(unsigned int& value)
+    {
+        return ReadBytes(&value, 4);
+    }
+
+    bool ReadInt(int& value)
+    {
+        return ReadBytes(&value, 4);
+    }
+
+    bool ReadDouble(double& value)
+    {
+        return ReadBytes(&value, 8);
+    }
+
+    bool ReadString(RS_String& str)
+    {
+        unsigned int len;
+        if (!ReadUInt(len) || len > (size_t)(m_end - m_pos) / 4)
+            return false;
+
+        str.resize(len);
+        for (unsigned int i=0; i<len; ++i)
+        {
+            unsigned int unit;
+            ReadUInt(unit);
+            str[i] = (wchar_t)unit;
+        }
+        return true;
+    }
+
+    bool ReadColor(RS_Color& color)
+    {
+        unsigned int argb;
+        if (!ReadUInt(argb))
+            return false;
+
+        color = RS_Color((argb >> 16) & 0xFF, (argb >> 8) & 0xFF, argb & 0xFF, (argb >> 24) & 0xFF);
+        return true;
+    }
+
+    bool ReadTextDef(RS_TextDef& tdef)
+    {
+        unsigned int halign, valign, justify, style, units, charset;
+        bool ok = ReadUInt(halign)
+               && ReadUInt(valign)
+               && ReadUInt(justify)
+               && ReadInt(tdef.textbg())
+               && ReadColor(tdef.textcolor())
+               && ReadColor(tdef.ghostcolor())
+               && ReadColor(tdef.framecolor())
+               && ReadColor(tdef.opaquecolor())
+               && ReadDouble(tdef.font().height())
+               && ReadString(tdef.font().name())
+               && ReadUInt(style)
+               && ReadUInt(units)
+               && ReadUInt(charset)
+               && ReadDouble(tdef.rotation())
+               && ReadDouble(tdef.obliqueAngle())
+               && ReadDouble(tdef.trackSpacing())
+               && ReadDouble(tdef.linespace())
+               && ReadDouble(tdef.frameoffsetx())
+               && ReadDouble(tdef.frameoffsety())
+               && ReadString(tdef.markup());
+        if (!ok)
+            return false;
+
+        tdef.halign() = (RS_HAlignment)halign;
+        tdef.valign() = (RS_VAlignment)valign;
+        tdef.justify() = (RS_Justify)justify;
+        tdef.font().style() = (RS_FontStyle_Mask)style;
+        tdef.font().units() = (RS_Units)units;
+        tdef.font().charset() = (RS_CharacterSetType)charset;
+        return true;
+    }
+
+    // checks that a count of items of the given size fits in the data
+    bool ReadCount(unsigned int& count, size_t itemSize)
+    {
+        return ReadUInt(count) && count <= (size_t)(m_end - m_pos) / itemSize;
+    }
+
+private:
+    const unsigned char* m_pos;
+    const unsigned char* m_end;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+LabelPlacementStore::~LabelPlacementStore()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_String LabelPlacementStore::MakeGridKey(const RS_String& mapName, double mapScale,
+                                           double tileWidth, double tileHeight,
+                                           double alignX, double alignY)
+{
+    // the alignment is rounded, so that the small differences between the
+    // origins computed by neighbouring tiles don't matter
+    wchar_t grid[128];
+    swprintf(grid, 128, L"|%.10g|%.10g|%.10g|%.4f|%.4f", mapScale, tileWidth, tileHeight, alignX, alignY);
+    return mapName + grid;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+LabelPlacementMemoryStore::LabelPlacementMemoryStore(size_t maxTiles)
+: m_maxTiles(rs_max(maxTiles, (size_t)1))
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+LabelPlacementMemoryStore::~LabelPlacementMemoryStore()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static RS_String MakeTileKey(const RS_String& grid, int col, int row)
+{
+    wchar_t tile[32];
+    swprintf(tile, 32, L"|%d|%d", col, row);
+    return grid + tile;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool LabelPlacementMemoryStore::Get(const RS_String& grid, int col, int row, std::vector<LabelPlacement>& placements)
+{
+    TileMap::iterator found = m_tiles.find(MakeTileKey(grid, col, row));
+    if (found == m_tiles.end())
+        return false;
+
+    m_uses.splice(m_uses.begin(), m_uses, found->second.use);
+    placements = found->second.placements;
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelPlacementMemoryStore::Put(const RS_String& grid, int col, int row, const std::vector<LabelPlacement>& placements)
+{
+    RS_String key = MakeTileKey(grid, col, row);
+
+    TileMap::iterator found = m_tiles.find(key);
+    if (found != m_tiles.end())
+    {
+        m_uses.splice(m_uses.begin(), m_uses, found->second.use);
+        found->second.placements = placements;
+        return;
+    }
+
+    // make room for the new tile
+    while (m_tiles.size() >= m_maxTiles)
+    {
+        m_tiles.erase(m_uses.back());
+        m_uses.pop_back();
+    }
+
+    m_uses.push_front(key);
+
+    Entry& entry = m_tiles[key];
+    entry.placements = placements;
+    entry.use = m_uses.begin();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelPlacementMemoryStore::Clear()
+{
+    m_tiles.clear();
+    m_uses.clear();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+size_t LabelPlacementMemoryStore::GetCount() const
+{
+    return m_tiles.size();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+LabelPlacementFileStore::LabelPlacementFileStore(const char* directory)
+: m_directory(directory? directory : ".")
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+LabelPlacementFileStore::~LabelPlacementFileStore()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+std::string LabelPlacementFileStore::GetPath(const RS_String& grid, int col, int row)
+{
+    // The grid key can contain any characters, so files are named after a
+    // hash of it.  The key itself is kept in the file to detect collisions.
+    unsigned int hash = 2166136261u;
+    for (size_t i=0; i<grid.length(); ++i)
+    {
+        hash ^= (unsigned int)grid[i];
+        hash *= 16777619u;
+    }
+
+    char name[64];
+    sprintf(name, "/%08x_%d_%d.lpl", hash, col, row);
+    return m_directory + name;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool LabelPlacementFileStore::Get(const RS_String& grid, int col, int row, std::vector<LabelPlacement>& placements)
+{
+    std::string path = GetPath(grid, col, row);
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    std::vector<unsigned char> data;
+    unsigned char buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + len);
+    fclose(file);
+
+    if (data.empty())
+        return false;
+
+    return Read(&data[0], data.size(), grid, placements);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelPlacementFileStore::Put(const RS_String& grid, int col, int row, const std::vector<LabelPlacement>& placements)
+{
+    std::vector<unsigned char> data;
+    Write(grid, placements, data);
+
+    // the temporary name is unique to this write, since other threads and
+    // processes may be putting the same tile
+    static std::atomic<unsigned int> s_writes(0);
+    char suffix[48];
+    sprintf(suffix, ".%d.%u.tmp", (int)LPS_GETPID(), s_writes++);
+
+    std::string path = GetPath(grid, col, row);
+    std::string temp = path + suffix;
+
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (file == NULL)
+        return;
+
+    bool ok = (fwrite(&data[0], 1, data.size(), file) == data.size());
+    if (fclose(file) != 0)
+        ok = false;
+
+    // not every platform replaces an existing file when renaming
+    if (ok && rename(temp.c_str(), path.c_str()) != 0)
+    {
+        remove(path.c_str());
+        ok = (rename(temp.c_str(), path.c_str()) == 0);
+    }
+
+    if (ok)
+        m_written.insert(path);
+    else
+        remove(temp.c_str());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelPlacementFileStore::Clear()
+{
+    for (std::set<std::string>::iterator iter = m_written.begin(); iter != m_written.end(); ++iter)
+        remove(iter->c_str());
+
+    m_written.clear();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelPlacementFileStore::Write(const RS_String& grid, const std::vector<LabelPlacement>& placements,
+                                    std::vector<unsigned char>& data)
+{
+    data.clear();
+
+    WriteBytes(data, RSLP_MAGIC, 4);
+    WriteUInt(data, RSLP_BYTEORDER);
+    WriteUInt(data, RSLP_VERSION);
+    WriteString(data, grid);
+    WriteUInt(data, (unsigned int)placements.size());
+
+    for (size_t i=0; i<placements.size(); ++i)
+    {
+        // the accessors of the text definition aren't const
+        LabelPlacement placement = placements[i];
+
+        WriteUInt(data, (unsigned int)placement.m_type);
+        WriteUInt(data, placement.m_exclude? 1u : 0u);
+        WriteString(data, placement.m_text);
+        WriteTextDef(data, placement.m_tdef);
+        WriteDouble(data, placement.m_x);
+        WriteDouble(data, placement.m_y);
+
+        WriteUInt(data, (unsigned int)placement.m_chars.size());
+        for (size_t j=0; j<placement.m_chars.size(); ++j)
+        {
+            WriteDouble(data, placement.m_chars[j].x);
+            WriteDouble(data, placement.m_chars[j].y);
+            WriteDouble(data, placement.m_chars[j].anglerad);
+        }
+
+        WriteUInt(data, (unsigned int)placement.m_points.size());
+        for (size_t j=0; j<placement.m_points.size(); ++j)
+        {
+            WriteDouble(data, placement.m_points[j].x);
+            WriteDouble(data, placement.m_points[j].y);
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool LabelPlacementFileStore::Read(const unsigned char* data, size_t length, const RS_String& grid,
+                                   std::vector<LabelPlacement>& placements)
+{
+    placements.clear();
+
+    PlacementReader reader(data, length);
+
+    unsigned char magic[4];
+    unsigned int byteOrder, version;
+    RS_String fileGrid;
+    if (!reader.ReadBytes(magic, 4) || memcmp(magic, RSLP_MAGIC, 4) != 0 ||
+        !reader.ReadUInt(byteOrder) || byteOrder != RSLP_BYTEORDER ||
+        !reader.ReadUInt(version) || version != RSLP_VERSION ||
+        !reader.ReadString(fileGrid) || fileGrid != grid)
+        return false;
+
+    unsigned int count;
+    if (!reader.ReadUInt(count))
+        return false;
+
+    for (unsigned int i=0; i<count; ++i)
+    {
+        LabelPlacement placement;
+
+        unsigned int type, exclude, numChars, numPoints;
+        if (!reader.ReadUInt(type) || type > (unsigned int)LabelPlacementType_Symbol ||
+            !reader.ReadUInt(exclude) ||
+            !reader.ReadString(placement.m_text) ||
+            !reader.ReadTextDef(placement.m_tdef) ||
+            !reader.ReadDouble(placement.m_x) ||
+            !reader.ReadDouble(placement.m_y) ||
+            !reader.ReadCount(numChars, 24))
+        {
+            placements.clear();
+            return false;
+        }
+
+        placement.m_type = (LabelPlacementType)type;
+        placement.m_exclude = (exclude != 0);
+
+        placement.m_chars.resize(numChars);
+        for (unsigned int j=0; j<numChars; ++j)
+        {
+            CharPos& pos = placement.m_chars[j];
+            reader.ReadDouble(pos.x);
+            reader.ReadDouble(pos.y);
+            reader.ReadDouble(pos.anglerad);
+        }
+
+        if (!reader.ReadCount(numPoints, 16) || numPoints % 4 != 0)
+        {
+            placements.clear();
+            return false;
+        }
+
+        placement.m_points.resize(numPoints);
+        for (unsigned int j=0; j<numPoints; ++j)
+        {
+            reader.ReadDouble(placement.m_points[j].x);
+            reader.ReadDouble(placement.m_points[j].y);
+        }
+
+        placements.push_back(placement);
+    }
+
+    return true;
+}
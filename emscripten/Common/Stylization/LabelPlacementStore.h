@@ -0,0 +1,174 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef LABELPLACEMENTSTORE_H_
+#define LABELPLACEMENTSTORE_H_
+
+#include "StylizationAPI.h"
+#include "RendererStyles.h"
+#include "RS_TextMetrics.h"
+#include <vector>
+#include <map>
+#include <list>
+#include <set>
+#include <string>
+
+
+//////////////////////////////////////////////////////////////////////////////
+enum LabelPlacementType
+{
+    LabelPlacementType_Exclusion,   // not drawn, only excludes other labels
+    LabelPlacementType_BlockText,
+    LabelPlacementType_PathText,
+    LabelPlacementType_Symbol       // drawn from its feature, not from the record
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+// A label committed by a tile in one of its shared corners or edges.  All
+// positions are in mapping space, so that the label can be drawn again in
+// a neighbouring tile of the same grid.
+struct LabelPlacement
+{
+    LabelPlacement()
+        : m_type(LabelPlacementType_Exclusion),
+          m_exclude(true),
+          m_x(0.0),
+          m_y(0.0)
+    {
+    }
+
+    LabelPlacementType m_type;
+    bool m_exclude;
+
+    // block text uses the text and the insertion point, and path text the
+    // (BIDI converted) text and the character positions - the character
+    // angles are in screen space
+    RS_String m_text;
+    RS_TextDef m_tdef;
+    double m_x;
+    double m_y;
+    std::vector<CharPos> m_chars;
+
+    // the extent of each element of the label, four points per element
+    std::vector<RS_F_Point> m_points;
+};
+
+
+//---------------------------------------------
+// Remembers the labels which tiles of a tiled map placed near their edges,
+// so that a neighbouring tile rendered later can draw them as they are
+// rather than placing them again (see LabelRendererLocal).  The records of
+// a tile are keyed by its grid - which identifies the map, the scale and
+// the tile size and alignment - and its column and row in that grid.
+//
+// Stores aren't synchronized - tiles rendered concurrently should each use
+// their own, or serialize access to a shared one.
+//---------------------------------------------
+
+class LabelPlacementStore
+{
+public:
+    STYLIZATION_API virtual ~LabelPlacementStore();
+
+    // Gets the placements recorded for a tile.  Returns false if there are
+    // none.
+    virtual bool Get(const RS_String& grid, int col, int row, std::vector<LabelPlacement>& placements) = 0;
+
+    // Records the placements of a tile, replacing any previous ones.
+    virtual void Put(const RS_String& grid, int col, int row, const std::vector<LabelPlacement>& placements) = 0;
+
+    virtual void Clear() = 0;
+
+    // Builds the key for a tile grid.  The alignment is the fractional part
+    // of the tile origin divided by the tile size, in each direction.
+    STYLIZATION_API static RS_String MakeGridKey(const RS_String& mapName, double mapScale,
+                                                 double tileWidth, double tileHeight,
+                                                 double alignX, double alignY);
+};
+
+
+//---------------------------------------------
+// Keeps the placements in memory, for the tiles rendered by one process.
+// When the store is full the records of the least recently used tile are
+// dropped.
+//---------------------------------------------
+
+class LabelPlacementMemoryStore : public LabelPlacementStore
+{
+public:
+    STYLIZATION_API LabelPlacementMemoryStore(size_t maxTiles = 4096);
+    STYLIZATION_API virtual ~LabelPlacementMemoryStore();
+
+    STYLIZATION_API virtual bool Get(const RS_String& grid, int col, int row, std::vector<LabelPlacement>& placements);
+    STYLIZATION_API virtual void Put(const RS_String& grid, int col, int row, const std::vector<LabelPlacement>& placements);
+    STYLIZATION_API virtual void Clear();
+
+    STYLIZATION_API size_t GetCount() const;
+
+private:
+    typedef std::list<RS_String> UseList;
+
+    struct Entry
+    {
+        std::vector<LabelPlacement> placements;
+        UseList::iterator use;
+    };
+
+    typedef std::map<RS_String, Entry> TileMap;
+
+    size_t m_maxTiles;
+    TileMap m_tiles;
+    UseList m_uses;     // most recently used first
+};
+
+
+//---------------------------------------------
+// Keeps the placements in a directory, one file per tile, so that they
+// outlive the process - e.g. while a tile cache is seeded by several
+// processes.  Files are written under a temporary name unique to the
+// process and write and then renamed, so a reader never sees a partially
+// written file and concurrent writers never share one.
+//---------------------------------------------
+
+class LabelPlacementFileStore : public LabelPlacementStore
+{
+public:
+    STYLIZATION_API LabelPlacementFileStore(const char* directory);
+    STYLIZATION_API virtual ~LabelPlacementFileStore();
+
+    STYLIZATION_API virtual bool Get(const RS_String& grid, int col, int row, std::vector<LabelPlacement>& placements);
+    STYLIZATION_API virtual void Put(const RS_String& grid, int col, int row, const std::vector<LabelPlacement>& placements);
+
+    // removes the files of the tiles put by this store
+    STYLIZATION_API virtual void Clear();
+
+    // serialization of the records of a tile - exposed for hosts which keep
+    // them elsewhere, e.g. alongside the tile images
+    STYLIZATION_API static void Write(const RS_String& grid, const std::vector<LabelPlacement>& placements,
+                                      std::vector<unsigned char>& data);
+    STYLIZATION_API static bool Read(const unsigned char* data, size_t length, const RS_String& grid,
+                                     std::vector<LabelPlacement>& placements);
+
+private:
+    std::string GetPath(const RS_String& grid, int col, int row);
+
+    std::string m_directory;
+    std::set<std::string> m_written;
+};
+
+#endif
@@ -18,6 +18,8 @@
 #include "stdafx.h"
 #include "LabelRenderer.h"
 #include "SE_Renderer.h"
+#include "StylizationProfiler.h"
+#include "StylizationTrace.h"
 #ifndef EMSCRIPTEN
 #include "FdoEvaluator.h"
 #else
@@ -231,6 +233,13 @@ void LabelRenderer::EndOverpostGroup()
 //////////////////////////////////////////////////////////////////////////////
 void LabelRenderer::BlastLabels()
 {
+    StylizationProfiler* profiler = m_serenderer->GetProfiler();
+    StylizationProfiler::Scope profileScope(profiler);
+    StylizationTraceScope traceScope("BlastLabels", StylizationTrace::Layers);
+
+    // symbols are drawn between text, which isn't batched
+    m_serenderer->SuspendDrawBatching(true);
+
     STYLIZATION_TRY()
 
         //-------------------------------------------------------
@@ -243,6 +252,7 @@ void LabelRenderer::BlastLabels()
 
             if (group.m_algo == laCurve && group.m_labels.size() > 1)
             {
+                StylizationTraceScope trace("StitchLabels", StylizationTrace::Features);
                 std::vector<LabelInfo> stitched = StitchPolylines(group.m_labels);
                 if (stitched.size() > 0)
                 {
@@ -270,6 +280,8 @@ void LabelRenderer::BlastLabels()
         // step 2 - apply overpost algorithm to all accumulated labels
         //-------------------------------------------------------
 
+        StylizationTraceScope trace("OverpostLabels", StylizationTrace::Layers);
+
         for (int i=(int)m_labelGroups.size()-1; i>=0; --i)  // must use int since we're iterating backwards
         {
             OverpostGroup& group = m_labelGroups[i];
@@ -283,6 +295,9 @@ void LabelRenderer::BlastLabels()
                                                 group.m_type != RS_OverpostType_All,
                                                 group.m_scaleLimit);
 
+                if (profiler)
+                    profiler->CountLabel(res);
+
                 // only in the case of a simple label do we check the overpost type
                 if (res && (group.m_type == RS_OverpostType_FirstFit))
                     break;
@@ -296,6 +311,8 @@ void LabelRenderer::BlastLabels()
         Cleanup();
     
     STYLIZATION_CATCH(L"LabelRenderer.BlastLabels")
+
+    m_serenderer->SuspendDrawBatching(false);
 }
 
 
@@ -18,6 +18,8 @@
 #include "stdafx.h"
 #include "LabelRendererLocal.h"
 #include "SE_Renderer.h"
+#include "StylizationProfiler.h"
+#include "StylizationTrace.h"
 #ifndef EMSCRIPTEN
 #include "FdoEvaluator.h"
 #else
@@ -26,10 +28,38 @@
 
 //#define DEBUG_LABELS
 
+//////////////////////////////////////////////////////////////////////////////
+LabelInfoLocal::LabelInfoLocal(LabelInfoLocal&& other)
+    : m_x(other.m_x),
+      m_y(other.m_y),
+      m_text(std::move(other.m_text)),
+      m_tdef(std::move(other.m_tdef)),
+      m_pts(other.m_pts),
+      m_numpts(other.m_numpts),
+      m_ins_point(other.m_ins_point),
+      m_numelems(other.m_numelems),
+      m_rotated_points(other.m_rotated_points),
+      m_sestyle(other.m_sestyle),
+      m_group(other.m_group)
+{
+    m_tm.Swap(other.m_tm);
+    other.m_sestyle = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+LabelInfoLocal::~LabelInfoLocal()
+{
+    // the style was cloned when it was passed to the LabelRenderer
+    delete m_sestyle;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 LabelRendererLocal::LabelRendererLocal(SE_Renderer* se_renderer, double tileExtentOffset)
 : LabelRendererBase(se_renderer)
 , m_tileExtentOffset(tileExtentOffset)
+, m_placementStore(NULL)
 {
 }
 
@@ -50,30 +80,13 @@ LabelRendererLocal::~LabelRendererLocal()
 //////////////////////////////////////////////////////////////////////////////
 void LabelRendererLocal::Cleanup()
 {
-    for (size_t i=0; i<m_labelGroups.size(); ++i)
-    {
-        OverpostGroupLocal& group = m_labelGroups[i];
-
-        for (size_t j=0; j<group.m_labels.size(); ++j)
-        {
-            LabelInfoLocal& info = group.m_labels[j];
-
-            delete [] info.m_rotated_points;
-            info.m_rotated_points = NULL;
-
-            delete [] info.m_pts;
-            info.m_pts = NULL;
-            info.m_numpts = 0;
-
-            // the style was cloned when it was passed to the LabelRenderer
-            delete info.m_sestyle;
-            info.m_sestyle = NULL;
-        }
-    }
-
+    // the labels' points all live in the arena, so they go in one step
+    m_labels.clear();
+    m_labelOrder.clear();
     m_labelGroups.clear();
     m_hStitchTable.clear();
     m_overpost.Clear();
+    m_arena.Reset();
 }
 
 
@@ -148,7 +161,7 @@ void LabelRendererLocal::ProcessLabelGroup(RS_LabelInfo*    labels,
         {
             // now transform the points of the current contour to screen space
             lblpathpts = path->cntr_size(i);
-            lblpath = new RS_F_Point[lblpathpts];
+            lblpath = AllocPoints(lblpathpts);
 
             for (int b=0; b<lblpathpts; ++b)
                 m_serenderer->WorldToScreenPoint(path->x_coord(offset+b), path->y_coord(offset+b), lblpath[b].x, lblpath[b].y);
@@ -165,12 +178,12 @@ void LabelRendererLocal::ProcessLabelGroup(RS_LabelInfo*    labels,
             if (group_index)
             {
                 // found one - add it to that group
-                m_labelGroups[group_index-1].m_labels.push_back(lrinfo);    // offset index by 1 since 0 is invalid std::map entry
+                AddLabel(group_index-1, std::move(lrinfo));     // offset index by 1 since 0 is invalid std::map entry
             }
             else
             {
                 // none found - add it to the current group
-                m_labelGroups.back().m_labels.push_back(lrinfo);
+                AddLabel(m_labelGroups.size()-1, std::move(lrinfo));
 
                 // add a new entry in the stitch table
                 m_hStitchTable[stitch_key] = (m_labelGroups.size()-1) + 1;  // offset index by 1 since 0 is invalid std::map entry
@@ -199,7 +212,7 @@ void LabelRendererLocal::ProcessLabelGroup(RS_LabelInfo*    labels,
 
             LabelInfoLocal lrinfo(info->x() + offx, info->y() + offy, text, info->tdef());
 
-            m_labelGroups.back().m_labels.push_back(lrinfo);
+            AddLabel(m_labelGroups.size()-1, std::move(lrinfo));
         }
 
         // for polygons that span several tiles, we will generate a list of labels,
@@ -279,7 +292,7 @@ void LabelRendererLocal::ProcessLabelGroup(RS_LabelInfo*    labels,
                         RS_LabelInfo* info = &labels[0]; // assumes one label info passed in
 
                         LabelInfoLocal lrinfo(posx, posy, text, info->tdef());
-                        m_labelGroups.back().m_labels.push_back(lrinfo);
+                        AddLabel(m_labelGroups.size()-1, std::move(lrinfo));
                     }
 
                     xpos += xinc;
@@ -305,7 +318,7 @@ void LabelRendererLocal::ProcessLabelGroup(RS_LabelInfo*    labels,
             double offy = MeterToMapSize(info->dunits(), info->dy());
 
             LabelInfoLocal lrinfo(info->x() + offx, info->y() + offy, text, info->tdef());
-            m_labelGroups.back().m_labels.push_back(lrinfo);
+            AddLabel(m_labelGroups.size()-1, std::move(lrinfo));
         }
     }
 
@@ -343,13 +356,13 @@ void LabelRendererLocal::ProcessLabelGroup(SE_LabelInfo*    labels,
         // label is in device space
         LabelInfoLocal lrinfo(info->x, info->y, info->style);
 
+        // label renderer now owns the cloned render style
+        info->style = NULL;
+
         // TODO: HACK -- well somewhat of a hack -- store the angle in the tdef
         lrinfo.m_tdef.rotation() = info->anglerad * M_180PI;
 
-        m_labelGroups.back().m_labels.push_back(lrinfo);
-
-        // label renderer now owns the cloned render style
-        info->style = NULL;
+        AddLabel(m_labelGroups.size()-1, std::move(lrinfo));
     }
 
     // remember the feature bounds for the label group
@@ -372,48 +385,152 @@ void LabelRendererLocal::BeginOverpostGroup(RS_OverpostType type, bool render, b
 void LabelRendererLocal::EndOverpostGroup()
 {
     // don't add empty groups
-    if (m_labelGroups.back().m_labels.size() == 0)
+    if (m_labelGroups.back().m_count == 0)
         m_labelGroups.pop_back();
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// Moves a label into the label array, as part of the given overpost group.
+void LabelRendererLocal::AddLabel(size_t group, LabelInfoLocal&& info)
+{
+    info.m_group = group;
+    m_labels.push_back(std::move(info));
+    ++m_labelGroups[group].m_count;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Gets room for label points, which is released after the labels are drawn.
+RS_F_Point* LabelRendererLocal::AllocPoints(int npts)
+{
+    return (RS_F_Point*)m_arena.Alloc(npts * sizeof(RS_F_Point));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// The part of a tile a label is in, based on which tile edges it crosses.
+enum SharedZone
+{
+    szNone,
+    szC00,  // bottom left shared corner
+    szC10,  // bottom right shared corner
+    szC01,  // top left shared corner
+    szC11,  // top right shared corner
+    szEx0,  // left shared edge
+    szEx1,  // right shared edge
+    szEy0,  // bottom shared edge
+    szEy1,  // top shared edge
+    szCtr   // completely inside
+};
+
+
+static SharedZone GetSharedZone(double minX, double minY, double maxX, double maxY, RS_Bounds& tileBounds)
+{
+    double tileMinX = tileBounds.minx;
+    double tileMaxX = tileBounds.maxx;
+    double tileMinY = tileBounds.miny;
+    double tileMaxY = tileBounds.maxy;
+
+    if (minX <= tileMinX && maxX < tileMaxX)    // intersecting the left edge
+    {
+        if (minY <= tileMinY && maxY < tileMaxY)    // intersecting the bottom edge
+            return szC00;
+
+        if (maxY >= tileMaxY && minY > tileMinY)    // intersecting the top edge
+            return szC01;
+
+        if (minY > tileMinY && maxY < tileMaxY)     // inside both the bottom and top edges
+            return szEx0;
+    }
+
+    if (maxX >= tileMaxX && minX > tileMinX)    // intersecting the right edge
+    {
+        if (minY <= tileMinY && maxY < tileMaxY)    // intersecting the bottom edge
+            return szC10;
+
+        if (maxY >= tileMaxY && minY > tileMinY)    // intersecting the top edge
+            return szC11;
+
+        if (minY > tileMinY && maxY < tileMaxY)     // inside both the bottom and top edges
+            return szEx1;
+    }
+
+    if (minX > tileMinX && maxX < tileMaxX)     // inside both the left and right edges
+    {
+        if (minY <= tileMinY && maxY < tileMaxY)    // intersecting the bottom edge
+            return szEy0;
+
+        if (maxY >= tileMaxY && minY > tileMinY)    // intersecting the top edge
+            return szEy1;
+
+        if (minY > tileMinY && maxY < tileMaxY)     // inside both the bottom and top edges
+            return szCtr;
+    }
+
+    return szNone;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds the exclusion regions of the preplaced labels in a zone to its
+// overpost manager.
+static void AddPlacementRegions(SimpleOverpost* pMgr, std::vector<LabelPlacement>& placements,
+                                std::vector<SharedZone>& zones, SharedZone zone)
+{
+    for (size_t i=0; i<placements.size(); ++i)
+    {
+        LabelPlacement& placement = placements[i];
+        if (zones[i] != zone || !placement.m_exclude)
+            continue;
+
+        for (size_t j=0; j<placement.m_points.size(); j+=4)
+            pMgr->AddRegion(&placement.m_points[j], 4);
+    }
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 void LabelRendererLocal::BlastLabels()
 {
+    StylizationProfiler::Scope profileScope(m_serenderer->GetProfiler());
+    StylizationTraceScope traceScope("BlastLabels", StylizationTrace::Layers);
+
+    // symbols are drawn between text, which isn't batched
+    m_serenderer->SuspendDrawBatching(true);
+
     STYLIZATION_TRY()
         //-------------------------------------------------------
         // step 1 - perform stitching
         //-------------------------------------------------------
 
+        // lay out the indices of each group's labels one after the other,
+        // in the order they were added
+        size_t first = 0;
         for (size_t i=0; i<m_labelGroups.size(); ++i)
         {
             OverpostGroupLocal& group = m_labelGroups[i];
+            group.m_first = first;
+            first += group.m_count;
+            group.m_count = 0;
+        }
 
-            if (group.m_algo == laCurve && group.m_labels.size() > 1)
-            {
-                std::vector<LabelInfoLocal> stitched = StitchPolylines(group.m_labels);
-                if (stitched.size() > 0)
-                {
-                    // replace the existing vector of labels with the stitched one
-                    for (size_t j=0; j<group.m_labels.size(); ++j)
-                    {
-                        LabelInfoLocal& info = group.m_labels[j];
-
-                        // at this point there shouldn't yet be any rotated points
-                        _ASSERT(info.m_rotated_points == NULL);
-
-                        delete [] info.m_pts;
-                        info.m_pts = NULL;
-                        info.m_numpts = 0;
+        m_labelOrder.resize(m_labels.size());
+        for (size_t i=0; i<m_labels.size(); ++i)
+        {
+            OverpostGroupLocal& group = m_labelGroups[m_labels[i].m_group];
+            m_labelOrder[group.m_first + group.m_count++] = i;
+        }
 
-                        // the style was cloned when it was passed to the LabelRenderer
-                        delete info.m_sestyle;
-                        info.m_sestyle = NULL;
-                    }
+        for (size_t i=0; i<m_labelGroups.size(); ++i)
+        {
+            OverpostGroupLocal& group = m_labelGroups[i];
 
-                    group.m_labels.clear();
-                    group.m_labels.insert(group.m_labels.end(), stitched.begin(), stitched.end());
-                }
+            if (group.m_algo == laCurve && group.m_count > 1)
+            {
+                // the group keeps the labels the others were stitched to
+                StylizationTraceScope trace("StitchLabels", StylizationTrace::Features);
+                group.m_count = StitchPolylines(&m_labelOrder[group.m_first], group.m_count);
             }
         }
 
@@ -421,15 +538,18 @@ void LabelRendererLocal::BlastLabels()
         // step 2 - compute bounds for all the labels
         //-------------------------------------------------------
 
+        m_nextOrder.clear();
         for (size_t i=0; i<m_labelGroups.size(); ++i)
         {
             OverpostGroupLocal& group = m_labelGroups[i];
 
-            std::vector<LabelInfoLocal> repeated_infos;
+            StylizationTraceScope trace("ComputeLabelBounds", StylizationTrace::Features);
+            size_t first = m_nextOrder.size();
 
-            for (size_t j=0; j<group.m_labels.size(); ++j)
+            for (size_t j=0; j<group.m_count; ++j)
             {
-                LabelInfoLocal& info = group.m_labels[j];
+                size_t index = m_labelOrder[group.m_first + j];
+                LabelInfoLocal& info = m_labels[index];
 
                 bool success = false;
 
@@ -437,7 +557,7 @@ void LabelRendererLocal::BlastLabels()
                 {
                     // several possible positions along the path may be
                     // returned in the case of repeated labels
-                    success = ComputePathLabelBounds(info, repeated_infos, group.m_scaleLimit);
+                    success = ComputePathLabelBounds(index, m_nextOrder, group.m_scaleLimit);
                 }
                 else
                 {
@@ -448,27 +568,7 @@ void LabelRendererLocal::BlastLabels()
                     else
                         success = ComputeSimpleLabelBounds(info);
 
-                    // in this case we will simply add a copy of the label info to
-                    // the repeated infos collection
-                    LabelInfoLocal copy = info;
-
-                    // The code above copies any SE style pointer.  Rather than
-                    // clone the style and have the original deleted below, just
-                    // clear the pointer on the original label info and make the new
-                    // one own the SE style.
-                    info.m_sestyle = NULL;
-
-                    // also clear the rotated points pointer on the original - the
-                    // new label info owns this object
-                    info.m_rotated_points = NULL;
-
-                    // this is the non-path-label case, so there shouldn't be any
-                    // path data
-                    _ASSERT(copy.m_pts == NULL);
-
-                    // add the label info copy to the collection now that pointers
-                    // are cleaned up
-                    repeated_infos.push_back(copy);
+                    m_nextOrder.push_back(index);
                 }
 
                 if (!success)
@@ -480,29 +580,14 @@ void LabelRendererLocal::BlastLabels()
                 }
             }
 
-            // now replace the group's label infos by the new repeated
-            // infos collection -- also free the polyline data stored
-            // in the m_pts members of the original infos, since we will
-            // no longer need the geometry data
-            for (size_t j=0; j<group.m_labels.size(); ++j)
-            {
-                LabelInfoLocal& info = group.m_labels[j];
-
-                // the original label infos should still not have any rotated points
-                _ASSERT(info.m_rotated_points == NULL);
-
-                delete [] info.m_pts;
-                info.m_pts = NULL;
-                info.m_numpts = 0;
-
-                // the style was cloned when it was passed to the LabelRenderer
-                delete info.m_sestyle;
-                info.m_sestyle = NULL;
-            }
-
-            group.m_labels = repeated_infos;
+            // the group now refers to the labels placed along its paths
+            // rather than to the paths themselves
+            group.m_first = first;
+            group.m_count = m_nextOrder.size() - first;
         }
 
+        m_labelOrder.swap(m_nextOrder);
+
         //-------------------------------------------------------
         // step 3 - flatten group list
         //-------------------------------------------------------
@@ -516,14 +601,15 @@ void LabelRendererLocal::BlastLabels()
             // the sorting code below treats each label independently
             if (group.m_algo == laCurve || group.m_algo == laPeriodicPolygon)
             {
-                for (size_t j=0; j<group.m_labels.size(); ++j)
+                for (size_t j=0; j<group.m_count; ++j)
                 {
                     // create a new group with just one label
                     OverpostGroupLocal newGroup(group.m_render, group.m_exclude, group.m_type);
                     newGroup.m_algo           = group.m_algo;
                     newGroup.m_scaleLimit     = group.m_scaleLimit;
                     newGroup.m_feature_bounds = group.m_feature_bounds;
-                    newGroup.m_labels.push_back(group.m_labels[j]);
+                    newGroup.m_first          = group.m_first + j;
+                    newGroup.m_count          = 1;
                     finalGroups.push_back(newGroup);
                 }
             }
@@ -560,6 +646,45 @@ void LabelRendererLocal::BlastLabels()
 
         std::vector<OverpostGroupLocal*> groupsCtr;  // completely inside
 
+        // the labels which the neighbouring tiles placed across our edges
+        RS_String grid;
+        int col = 0;
+        int row = 0;
+        std::vector<LabelPlacement> preplaced;
+        std::vector<SharedZone> preplacedZones;
+
+        if (m_placementStore)
+        {
+            StylizationTraceScope trace("LoadLabelPlacements", StylizationTrace::Layers);
+
+            double alignX = tileMinX / tileWid;
+            double alignY = tileMinY / tileHgt;
+            col = (int)floor(alignX + 0.5);
+            row = (int)floor(alignY + 0.5);
+
+            RS_MapUIInfo* mapInfo = m_serenderer->GetMapInfo();
+            grid = LabelPlacementStore::MakeGridKey(mapInfo? mapInfo->name() : RS_String(),
+                                                    m_serenderer->GetMapScale(), tileWid, tileHgt,
+                                                    alignX - col, alignY - row);
+
+            LoadPlacements(grid, col, row, preplaced);
+
+            // Draw them first.  Their exclusion regions go to the overpost
+            // managers of the corners and edges they are in, as if this tile
+            // had placed them there.
+            for (size_t i=0; i<preplaced.size(); ++i)
+            {
+                LabelPlacement& placement = preplaced[i];
+                DrawPlacement(placement);
+
+                RS_Bounds bounds(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+                for (size_t j=0; j<placement.m_points.size(); ++j)
+                    bounds.add_point(placement.m_points[j]);
+
+                preplacedZones.push_back(GetSharedZone(bounds.minx, bounds.miny, bounds.maxx, bounds.maxy, tileBounds));
+            }
+        }
+
         for (size_t i=0; i<finalGroups.size(); ++i)
         {
             OverpostGroupLocal& group = finalGroups[i];
@@ -574,9 +699,9 @@ void LabelRendererLocal::BlastLabels()
             double maxX = -DBL_MAX;
             double minY = +DBL_MAX;
             double maxY = -DBL_MAX;
-            for (size_t j=0; j<group.m_labels.size(); ++j)
+            for (size_t j=0; j<group.m_count; ++j)
             {
-                LabelInfoLocal& info = group.m_labels[j];
+                LabelInfoLocal& info = GetLabel(group, j);
 
                 // just iterate over the rotated points for each element
                 for (size_t k=0; k<info.m_numelems*4; ++k)
@@ -653,105 +778,71 @@ void LabelRendererLocal::BlastLabels()
             // check more involved cases
             //-------------------------------------------------------
 
-            if (minX <= tileMinX && maxX < tileMaxX)    // intersecting the left edge
-            {
-                if (minY <= tileMinY && maxY < tileMaxY)    // intersecting the bottom edge
-                {
-                    // bottom left shared corner
-                    groupsC00.push_back(&group);
-                    continue;
-                }
+            SharedZone zone = GetSharedZone(minX, minY, maxX, maxY, tileBounds);
 
-                if (maxY >= tileMaxY && minY > tileMinY)    // intersecting the top edge
-                {
-                    // top left shared corner
-                    groupsC01.push_back(&group);
-                    continue;
-                }
-
-                if (minY > tileMinY && maxY < tileMaxY)     // inside both the bottom and top edges
-                {
-                    // left shared edge
-                    groupsEx0.push_back(&group);
-                    continue;
-                }
-            }
-
-            if (maxX >= tileMaxX && minX > tileMinX)    // intersecting the right edge
+            // skip labels which a neighbouring tile already placed
+            if (zone != szCtr && !preplaced.empty())
             {
-                if (minY <= tileMinY && maxY < tileMaxY)    // intersecting the bottom edge
+                int index = FindPlacement(group, preplaced);
+                if (index >= 0)
                 {
-                    // bottom right shared corner
-                    groupsC10.push_back(&group);
-                    continue;
-                }
-
-                if (maxY >= tileMaxY && minY > tileMinY)    // intersecting the top edge
-                {
-                    // top right shared corner
-                    groupsC11.push_back(&group);
-                    continue;
-                }
-
-                if (minY > tileMinY && maxY < tileMaxY)     // inside both the bottom and top edges
-                {
-                    // right shared edge
-                    groupsEx1.push_back(&group);
+                    // text was drawn from the record, but symbols need their
+                    // feature - their space is already excluded
+                    LabelInfoLocal& info = GetLabel(group, index);
+                    if (info.m_sestyle && group.m_render)
+                        ProcessLabelInternal(NULL, info, true, false, false);
                     continue;
                 }
             }
 
-            if (minX > tileMinX && maxX < tileMaxX)     // inside both the left and right edges
+            switch (zone)
             {
-                if (minY <= tileMinY && maxY < tileMaxY)    // intersecting the bottom edge
-                {
-                    // bottom shared edge
-                    groupsEy0.push_back(&group);
-                    continue;
-                }
-
-                if (maxY >= tileMaxY && minY > tileMinY)    // intersecting the top edge
-                {
-                    // top shared edge
-                    groupsEy1.push_back(&group);
-                    continue;
-                }
-
-                if (minY > tileMinY && maxY < tileMaxY)     // inside both the bottom and top edges
-                {
-                    // completely inside
-                    groupsCtr.push_back(&group);
-                    continue;
-                }
+                case szC00: groupsC00.push_back(&group); break;     // bottom left shared corner
+                case szC10: groupsC10.push_back(&group); break;     // bottom right shared corner
+                case szC01: groupsC01.push_back(&group); break;     // top left shared corner
+                case szC11: groupsC11.push_back(&group); break;     // top right shared corner
+                case szEx0: groupsEx0.push_back(&group); break;     // left shared edge
+                case szEx1: groupsEx1.push_back(&group); break;     // right shared edge
+                case szEy0: groupsEy0.push_back(&group); break;     // bottom shared edge
+                case szEy1: groupsEy1.push_back(&group); break;     // top shared edge
+                case szCtr: groupsCtr.push_back(&group); break;     // completely inside
+
+                // we missed a case if we hit this assert
+                default: _ASSERT(false); break;
             }
-
-            // we missed a case if we hit this assert
-            _ASSERT(false);
         }
 
         //-------------------------------------------------------
         // step 5 - apply overpost algorithm to each shared corner
         //-------------------------------------------------------
 
+        // the labels placed in the shared corners and edges, for the store
+        std::vector<LabelPlacement> placements;
+        std::vector<LabelPlacement>* pPlacements = m_placementStore? &placements : NULL;
+
         // bottom left shared corner
         SimpleOverpost mgrC00;
         mgrC00.AddRegions(m_overpost);
-        ProcessLabelGroupsInternal(&mgrC00, groupsC00);
+        AddPlacementRegions(&mgrC00, preplaced, preplacedZones, szC00);
+        ProcessLabelGroupsInternal(&mgrC00, groupsC00, pPlacements);
 
         // bottom right shared corner
         SimpleOverpost mgrC10;
         mgrC10.AddRegions(m_overpost);
-        ProcessLabelGroupsInternal(&mgrC10, groupsC10);
+        AddPlacementRegions(&mgrC10, preplaced, preplacedZones, szC10);
+        ProcessLabelGroupsInternal(&mgrC10, groupsC10, pPlacements);
 
         // top left shared corner
         SimpleOverpost mgrC01;
         mgrC01.AddRegions(m_overpost);
-        ProcessLabelGroupsInternal(&mgrC01, groupsC01);
+        AddPlacementRegions(&mgrC01, preplaced, preplacedZones, szC01);
+        ProcessLabelGroupsInternal(&mgrC01, groupsC01, pPlacements);
 
         // top right shared corner
         SimpleOverpost mgrC11;
         mgrC11.AddRegions(m_overpost);
-        ProcessLabelGroupsInternal(&mgrC11, groupsC11);
+        AddPlacementRegions(&mgrC11, preplaced, preplacedZones, szC11);
+        ProcessLabelGroupsInternal(&mgrC11, groupsC11, pPlacements);
 
         //-------------------------------------------------------
         // step 6 - apply overpost algorithm to each shared edge
@@ -761,25 +852,32 @@ void LabelRendererLocal::BlastLabels()
         SimpleOverpost mgrEx0;
         mgrEx0.AddRegions(mgrC00);
         mgrEx0.AddRegions(mgrC01);
-        ProcessLabelGroupsInternal(&mgrEx0, groupsEx0);
+        AddPlacementRegions(&mgrEx0, preplaced, preplacedZones, szEx0);
+        ProcessLabelGroupsInternal(&mgrEx0, groupsEx0, pPlacements);
 
         // right shared edge
         SimpleOverpost mgrEx1;
         mgrEx1.AddRegions(mgrC10);
         mgrEx1.AddRegions(mgrC11);
-        ProcessLabelGroupsInternal(&mgrEx1, groupsEx1);
+        AddPlacementRegions(&mgrEx1, preplaced, preplacedZones, szEx1);
+        ProcessLabelGroupsInternal(&mgrEx1, groupsEx1, pPlacements);
 
         // bottom shared edge
         SimpleOverpost mgrEy0;
         mgrEy0.AddRegions(mgrC00);
         mgrEy0.AddRegions(mgrC10);
-        ProcessLabelGroupsInternal(&mgrEy0, groupsEy0);
+        AddPlacementRegions(&mgrEy0, preplaced, preplacedZones, szEy0);
+        ProcessLabelGroupsInternal(&mgrEy0, groupsEy0, pPlacements);
 
         // top shared edge
         SimpleOverpost mgrEy1;
         mgrEy1.AddRegions(mgrC01);
         mgrEy1.AddRegions(mgrC11);
-        ProcessLabelGroupsInternal(&mgrEy1, groupsEy1);
+        AddPlacementRegions(&mgrEy1, preplaced, preplacedZones, szEy1);
+        ProcessLabelGroupsInternal(&mgrEy1, groupsEy1, pPlacements);
+
+        if (m_placementStore)
+            m_placementStore->Put(grid, col, row, placements);
 
         //-------------------------------------------------------
         // step 7 - apply overpost algorithm to center
@@ -797,33 +895,12 @@ void LabelRendererLocal::BlastLabels()
         // step 8 - clean up label info
         //-------------------------------------------------------
 
-        for (size_t i=0; i<finalGroups.size(); ++i)
-        {
-            OverpostGroupLocal& group = finalGroups[i];
-            for (size_t j=0; j<group.m_labels.size(); ++j)
-            {
-                LabelInfoLocal& info = group.m_labels[j];
-
-                delete [] info.m_rotated_points;
-                info.m_rotated_points = NULL;
-
-                info.m_numpts = 0;
-                info.m_numelems = 0;
-
-                // label infos in finalGroups should no longer have polyline data
-                _ASSERT(info.m_pts == NULL);
-
-                // the style was cloned when it was passed to the LabelRenderer
-                delete info.m_sestyle;
-                info.m_sestyle = NULL;
-            }
-        }
-
         finalGroups.clear();
-        m_hStitchTable.clear();
-        m_overpost.Clear();
+        Cleanup();
     
     STYLIZATION_CATCH(L"LabelRendererLocal.BlastLabels")
+
+    m_serenderer->SuspendDrawBatching(false);
 }
 
 
@@ -852,7 +929,7 @@ bool LabelRendererLocal::ComputeSimpleLabelBounds(LabelInfoLocal& info)
 
     // allocate the data we need
     info.m_numelems = numLines;
-    info.m_rotated_points = new RS_F_Point[4*numLines];
+    info.m_rotated_points = AllocPoints(4*numLines);
 
     // store the rotated points with the label
     GetRotatedTextPoints(info.m_tm, info.m_ins_point.x, info.m_ins_point.y, angleRad, info.m_rotated_points);
@@ -903,8 +980,12 @@ bool LabelRendererLocal::ComputeSimpleLabelBounds(LabelInfoLocal& info)
 
 
 //////////////////////////////////////////////////////////////////////////////
-bool LabelRendererLocal::ComputePathLabelBounds(LabelInfoLocal& info, std::vector<LabelInfoLocal>& repeated_infos, double scaleLimit)
+// Lays out a path label at one or more positions along its path, adding the
+// indices of the labels placed to the supplied list.
+bool LabelRendererLocal::ComputePathLabelBounds(size_t index, std::vector<size_t>& repeated, double scaleLimit)
 {
+    LabelInfoLocal& info = m_labels[index];
+
     // set a limit on the number of path segments
     _ASSERT(info.m_numpts < MAX_PATH_SEGMENTS);
     if (info.m_numpts >= MAX_PATH_SEGMENTS)
@@ -944,15 +1025,34 @@ bool LabelRendererLocal::ComputePathLabelBounds(LabelInfoLocal& info, std::vecto
     // allocate the data we need
     info.m_numelems = sConv.length();
 
+    // the path isn't needed once the label is laid out along it
+    RS_F_Point* pts = info.m_pts;
+    int numpts = info.m_numpts;
+    RS_VAlignment valign = info.m_tdef.valign();
+    info.m_pts = NULL;
+    info.m_numpts = 0;
+
     for (int irep=0; irep<numreps; ++irep)
     {
-        // make a copy of the modified label data for the current label period
-        LabelInfoLocal copy_info = info;
+        // The last repetition is laid out in the label itself, and the others
+        // in new labels which start out with its measured text.
+        size_t repIndex = index;
+        if (irep < numreps-1)
+        {
+            repIndex = m_labels.size();
+            m_labels.push_back(LabelInfoLocal(0.0, 0.0, (SE_RenderStyle*)NULL));
+
+            LabelInfoLocal& src = m_labels[index];
+            LabelInfoLocal& rep = m_labels.back();
+            rep.m_x        = src.m_x;
+            rep.m_y        = src.m_y;
+            rep.m_tdef     = src.m_tdef;
+            rep.m_tm       = src.m_tm;
+            rep.m_numelems = src.m_numelems;
+            rep.m_group    = src.m_group;
+        }
 
-        // clear the path data on the copy - the original label info retains
-        // ownership of this
-        copy_info.m_pts = NULL;
-        copy_info.m_numpts = 0;
+        LabelInfoLocal& copy_info = m_labels[repIndex];
 
         // parametric position for current repeated label
         // positions are spaced in such a way that each label has
@@ -960,12 +1060,12 @@ bool LabelRendererLocal::ComputePathLabelBounds(LabelInfoLocal& info, std::vecto
         double param_position = ((double)irep + 0.5) / (double)numreps;
 
         // compute position and angle along the path for each character
-        if (!fe->LayoutPathText(copy_info.m_tm, info.m_pts, info.m_numpts, segpos, param_position, info.m_tdef.valign(), scaleLimit))
+        if (!fe->LayoutPathText(copy_info.m_tm, pts, numpts, segpos, param_position, valign, scaleLimit))
             continue;
 
         // once we have position and angle for each character
         // compute rotated corner points for each character
-        copy_info.m_rotated_points = new RS_F_Point[4*copy_info.m_numelems];
+        copy_info.m_rotated_points = AllocPoints(4*(int)copy_info.m_numelems);
 
         for (size_t i=0; i<copy_info.m_numelems; ++i)
         {
@@ -1001,7 +1101,7 @@ bool LabelRendererLocal::ComputePathLabelBounds(LabelInfoLocal& info, std::vecto
         }
 
         // add current periodic label to the return list
-        repeated_infos.push_back(copy_info);
+        repeated.push_back(repIndex);
     }
 
     return true;
@@ -1013,7 +1113,7 @@ bool LabelRendererLocal::ComputeSELabelBounds(LabelInfoLocal& info)
 {
     // allocate the data we need
     info.m_numelems = 1;
-    info.m_rotated_points = new RS_F_Point[4];
+    info.m_rotated_points = AllocPoints(4);
 
     // get native symbol bounds (in screen units - the render style is already
     // scaled to screen units)
@@ -1071,21 +1171,31 @@ bool LabelRendererLocal::ComputeSELabelBounds(LabelInfoLocal& info)
 
 
 //////////////////////////////////////////////////////////////////////////////
-void LabelRendererLocal::ProcessLabelGroupsInternal(SimpleOverpost* pMgr, std::vector<OverpostGroupLocal*>& groups)
+void LabelRendererLocal::ProcessLabelGroupsInternal(SimpleOverpost* pMgr, std::vector<OverpostGroupLocal*>& groups,
+                                                    std::vector<LabelPlacement>* placements)
 {
+    StylizationProfiler* profiler = m_serenderer->GetProfiler();
+    StylizationTraceScope trace("OverpostLabels", StylizationTrace::Layers);
+
     for (size_t i=0; i<groups.size(); ++i)
     {
         OverpostGroupLocal* pGroup = groups[i];
 
-        for (size_t j=0; j<pGroup->m_labels.size(); ++j)
+        for (size_t j=0; j<pGroup->m_count; ++j)
         {
-            LabelInfoLocal& info = pGroup->m_labels[j];
+            LabelInfoLocal& info = GetLabel(*pGroup, j);
             bool res = ProcessLabelInternal(pMgr,
                                             info,
                                             pGroup->m_render,
                                             pGroup->m_exclude,
                                             pGroup->m_type != RS_OverpostType_All);
 
+            if (profiler)
+                profiler->CountLabel(res);
+
+            if (res && placements)
+                RecordPlacement(info, pGroup->m_render, pGroup->m_exclude, *placements);
+
             // only in the case of a simple label do we check the overpost type
             if (pGroup->m_algo == laSimple)
             {
@@ -1207,57 +1317,242 @@ bool LabelRendererLocal::OverlapsStuff(SimpleOverpost* pMgr, RS_F_Point* pts, in
 
 
 //////////////////////////////////////////////////////////////////////////////
-std::vector<LabelInfoLocal> LabelRendererLocal::StitchPolylines(std::vector<LabelInfoLocal>& labels)
+void LabelRendererLocal::SetPlacementStore(LabelPlacementStore* store)
+{
+    m_placementStore = store;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Gets the placements recorded by the eight neighbours of a tile, keeping
+// those which reach into it.
+void LabelRendererLocal::LoadPlacements(const RS_String& grid, int col, int row, std::vector<LabelPlacement>& placements)
+{
+    RS_Bounds& tileBounds = m_serenderer->GetBounds();
+
+    std::vector<LabelPlacement> neighbour;
+    for (int dy=-1; dy<=1; ++dy)
+    {
+        for (int dx=-1; dx<=1; ++dx)
+        {
+            if (dx == 0 && dy == 0)
+                continue;
+
+            if (!m_placementStore->Get(grid, col + dx, row + dy, neighbour))
+                continue;
+
+            for (size_t i=0; i<neighbour.size(); ++i)
+            {
+                LabelPlacement& placement = neighbour[i];
+
+                RS_Bounds bounds(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+                for (size_t j=0; j<placement.m_points.size(); ++j)
+                    bounds.add_point(placement.m_points[j]);
+
+                if (bounds.minx <= tileBounds.maxx && bounds.maxx >= tileBounds.minx &&
+                    bounds.miny <= tileBounds.maxy && bounds.maxy >= tileBounds.miny)
+                    placements.push_back(placement);
+            }
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelRendererLocal::DrawPlacement(LabelPlacement& placement)
+{
+    RS_FontEngine* fe = m_serenderer->GetRSFontEngine();
+
+    if (placement.m_type == LabelPlacementType_BlockText)
+    {
+        RS_TextMetrics tm;
+        if (!fe->GetTextMetrics(placement.m_text, placement.m_tdef, tm, false))
+            return;
+
+        double insx, insy;
+        m_serenderer->WorldToScreenPoint(placement.m_x, placement.m_y, insx, insy);
+        fe->DrawBlockText(tm, placement.m_tdef, insx, insy);
+    }
+    else if (placement.m_type == LabelPlacementType_PathText)
+    {
+        // the text is already BIDI converted
+        RS_TextMetrics tm;
+        if (!fe->GetTextMetrics(placement.m_text, placement.m_tdef, tm, true))
+            return;
+
+        if (tm.char_advances.size() != placement.m_chars.size())
+            return;
+
+        tm.char_pos.resize(placement.m_chars.size());
+        for (size_t i=0; i<placement.m_chars.size(); ++i)
+        {
+            CharPos& pos = placement.m_chars[i];
+            m_serenderer->WorldToScreenPoint(pos.x, pos.y, tm.char_pos[i].x, tm.char_pos[i].y);
+            tm.char_pos[i].anglerad = pos.anglerad;
+        }
+
+        fe->DrawPathText(tm, placement.m_tdef);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelRendererLocal::RecordPlacement(LabelInfoLocal& info, bool render, bool exclude, std::vector<LabelPlacement>& placements)
+{
+    placements.push_back(LabelPlacement());
+    LabelPlacement& placement = placements.back();
+
+    placement.m_exclude = exclude;
+    placement.m_tdef = info.m_tdef;
+
+    if (!render)
+    {
+        placement.m_type = LabelPlacementType_Exclusion;
+    }
+    else if (info.m_sestyle)
+    {
+        placement.m_type = LabelPlacementType_Symbol;
+    }
+    else if (info.m_tm.char_pos.size() > 0)
+    {
+        placement.m_type = LabelPlacementType_PathText;
+        placement.m_text = info.m_tm.text;
+
+        placement.m_chars.resize(info.m_tm.char_pos.size());
+        for (size_t i=0; i<info.m_tm.char_pos.size(); ++i)
+        {
+            CharPos& pos = info.m_tm.char_pos[i];
+            m_serenderer->ScreenToWorldPoint(pos.x, pos.y, placement.m_chars[i].x, placement.m_chars[i].y);
+            placement.m_chars[i].anglerad = pos.anglerad;
+        }
+    }
+    else
+    {
+        placement.m_type = LabelPlacementType_BlockText;
+        placement.m_text = info.m_text;
+        placement.m_x = info.m_x;
+        placement.m_y = info.m_y;
+    }
+
+    placement.m_points.resize(info.m_numelems*4);
+    for (size_t i=0; i<info.m_numelems*4; ++i)
+        m_serenderer->ScreenToWorldPoint(info.m_rotated_points[i].x, info.m_rotated_points[i].y, placement.m_points[i].x, placement.m_points[i].y);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Returns the index of the label in the group which was already placed by
+// a neighbouring tile, or -1 if there's none.  Labels match if they are the
+// same kind and text, and their extents are the same up to rounding.
+int LabelRendererLocal::FindPlacement(OverpostGroupLocal& group, std::vector<LabelPlacement>& placements)
 {
-    size_t numLabels = labels.size();
+    double tolerance = 1.0e-6 * m_serenderer->GetBounds().width();
+
+    for (size_t i=0; i<group.m_count; ++i)
+    {
+        LabelInfoLocal& info = GetLabel(group, i);
+
+        LabelPlacementType type;
+        const RS_String* text = NULL;
+        if (!group.m_render)
+            type = LabelPlacementType_Exclusion;
+        else if (info.m_sestyle)
+            type = LabelPlacementType_Symbol;
+        else if (info.m_tm.char_pos.size() > 0)
+        {
+            type = LabelPlacementType_PathText;
+            text = &info.m_tm.text;
+        }
+        else
+        {
+            type = LabelPlacementType_BlockText;
+            text = &info.m_text;
+        }
 
-    // no batching required if we're below the batch size
-    if (numLabels <= STITCH_BATCH_SIZE)
-        return StitchPolylinesHelper(labels);
+        RS_Bounds bounds;
+        GetLabelBounds(info, bounds);
+
+        for (size_t j=0; j<placements.size(); ++j)
+        {
+            LabelPlacement& placement = placements[j];
+            if (placement.m_type != type || placement.m_points.size() != info.m_numelems*4)
+                continue;
+            if (text && placement.m_text != *text)
+                continue;
 
-    // store overall results here
-    std::vector<LabelInfoLocal> ret;
-    std::vector<LabelInfoLocal> input;
+            RS_Bounds placed(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+            for (size_t k=0; k<placement.m_points.size(); ++k)
+                placed.add_point(placement.m_points[k]);
 
-    size_t numProcessed = 0;
-    while (numProcessed < numLabels)
+            if (fabs(placed.minx - bounds.minx) <= tolerance &&
+                fabs(placed.miny - bounds.miny) <= tolerance &&
+                fabs(placed.maxx - bounds.maxx) <= tolerance &&
+                fabs(placed.maxy - bounds.maxy) <= tolerance)
+                return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LabelRendererLocal::GetLabelBounds(LabelInfoLocal& info, RS_Bounds& bounds)
+{
+    bounds = RS_Bounds(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+    for (size_t i=0; i<info.m_numelems*4; ++i)
     {
-        // create the input vector for the batch
-        input.clear();
-        for (size_t i=0; i<STITCH_BATCH_SIZE && numProcessed<numLabels; ++i)
-            input.push_back(labels[numProcessed++]);
+        RS_F_Point pt;
+        m_serenderer->ScreenToWorldPoint(info.m_rotated_points[i].x, info.m_rotated_points[i].y, pt.x, pt.y);
+        bounds.add_point(pt);
+    }
+}
 
-        // process the batch
-        std::vector<LabelInfoLocal> output = StitchPolylinesHelper(input);
 
-        // add to the overall result
-        for (size_t i=0; i<output.size(); ++i)
-            ret.push_back(output[i]);
+//////////////////////////////////////////////////////////////////////////////
+// Stitches the path labels with the given indices, in batches, and writes
+// the indices of the stitched labels to the front of the array.  Returns
+// how many there are.
+size_t LabelRendererLocal::StitchPolylines(size_t* labels, size_t numLabels)
+{
+    size_t numStitched = 0;
+    for (size_t start=0; start<numLabels; start+=STITCH_BATCH_SIZE)
+    {
+        size_t count = rs_min(numLabels - start, (size_t)STITCH_BATCH_SIZE);
+
+        // a batch never yields more labels than it has, so it can't
+        // overwrite the batches after it
+        numStitched += StitchPolylinesHelper(labels + start, count, labels + numStitched);
     }
 
-    return ret;
+    return numStitched;
 }
 
 
 //////////////////////////////////////////////////////////////////////////////
-std::vector<LabelInfoLocal> LabelRendererLocal::StitchPolylinesHelper(std::vector<LabelInfoLocal>& labels)
+// The labels stitched to others are dropped, and the paths of the others
+// are replaced by the stitched paths.
+size_t LabelRendererLocal::StitchPolylinesHelper(size_t* labels, size_t numLabels, size_t* stitched)
 {
-    std::vector<LabelInfoLocal> src = labels; // make a copy
-    std::vector<LabelInfoLocal> ret; // store results here
+    std::vector<size_t>& src = m_stitchSource;
+    src.assign(labels, labels + numLabels);
+
+    size_t* ret = stitched; // store results here
+    size_t numRet = 0;
 
     // while there are unprocessed items
     while (src.size() > 0)
     {
         // try to stitch a source item to items in return list
         size_t i;
-        for (i=0; i<ret.size(); ++i)
+        for (i=0; i<numRet; ++i)
         {
-            LabelInfoLocal& retinfo = ret[i];
+            LabelInfoLocal& retinfo = m_labels[ret[i]];
 
             size_t j;
             for (j=0; j<src.size(); ++j)
             {
-                LabelInfoLocal& srcinfo = src[j];
+                LabelInfoLocal& srcinfo = m_labels[src[j]];
 
                 bool start_with_src = false; // start stitch with source poly?
                 bool startfwd = false; // go forward on start poly?
@@ -1299,21 +1594,22 @@ std::vector<LabelInfoLocal> LabelRendererLocal::StitchPolylinesHelper(std::vecto
                 {
                     if (count == 1)
                     {
-                        // alloc new stitched polyline
+                        // alloc new stitched polyline - the old ones stay in
+                        // the arena until the labels are drawn
                         int num_stitched_pts = retinfo.m_numpts + srcinfo.m_numpts - 1;
-                        RS_F_Point* stitched = new RS_F_Point[num_stitched_pts];
+                        RS_F_Point* stitched_pts = AllocPoints(num_stitched_pts);
 
                         RS_F_Point* start = start_with_src? srcinfo.m_pts : retinfo.m_pts;
                         int nstart = start_with_src? srcinfo.m_numpts : retinfo.m_numpts;
 
                         if (startfwd)
                         {
-                            memcpy(stitched, start, sizeof(RS_F_Point) * nstart-1);
+                            memcpy(stitched_pts, start, sizeof(RS_F_Point) * (nstart-1));
                         }
                         else
                         {
                             for (int p=0; p<nstart-1; ++p)
-                                stitched[p] = start[nstart - p - 1];
+                                stitched_pts[p] = start[nstart - p - 1];
                         }
 
                         RS_F_Point* end = start_with_src? retinfo.m_pts : srcinfo.m_pts;
@@ -1321,16 +1617,15 @@ std::vector<LabelInfoLocal> LabelRendererLocal::StitchPolylinesHelper(std::vecto
 
                         if (endfwd)
                         {
-                            memcpy(stitched + nstart-1, end, sizeof(RS_F_Point) * nend);
+                            memcpy(stitched_pts + nstart-1, end, sizeof(RS_F_Point) * nend);
                         }
                         else
                         {
                             for (int p=0; p<nend; ++p)
-                                stitched[p + nstart - 1] = end[nend - p - 1];
+                                stitched_pts[p + nstart - 1] = end[nend - p - 1];
                         }
 
-                        delete [] retinfo.m_pts;
-                        retinfo.m_pts = stitched;
+                        retinfo.m_pts = stitched_pts;
                         retinfo.m_numpts = num_stitched_pts;
                     }
                     else
@@ -1355,23 +1650,17 @@ std::vector<LabelInfoLocal> LabelRendererLocal::StitchPolylinesHelper(std::vecto
 
         // if we did not stitch any source polyline to a polyline
         // in the return list, move a polyline to the return list and go again
-        if (i == ret.size())
+        if (i == numRet)
         {
-            LabelInfoLocal& srcinfo = src.back();
-            LabelInfoLocal retinfo = srcinfo;
-
             // we don't yet support symbol-based path labels
-            _ASSERT(retinfo.m_sestyle == NULL);
-
-            // need to allocate a copy of the polyline since it will be
-            // deleted and reallocated by the stitching loop
-            retinfo.m_pts = new RS_F_Point[srcinfo.m_numpts];
-            memcpy(retinfo.m_pts, srcinfo.m_pts, sizeof(RS_F_Point) * srcinfo.m_numpts);
+            _ASSERT(m_labels[src.back()].m_sestyle == NULL);
 
-            ret.push_back(retinfo);
+            // the stitching loop replaces the polyline rather than change
+            // it, so the label can keep its own
+            ret[numRet++] = src.back();
             src.pop_back();
         }
     }
 
-    return ret;
+    return numRet;
 }
@@ -22,12 +22,16 @@
 #include "SimpleOverpost.h"
 #include "RS_FontEngine.h"
 #include "BIDIConverter.h"
+#include "LabelPlacementStore.h"
+#include "SE_RenderArena.h"
 
 struct SE_RenderStyle;
 
 //////////////////////////////////////////////////////////////////////////////
 // Used to accumulate labels so that we can draw all
-// of them on top of geometry in the end.
+// of them on top of geometry in the end.  The labels are kept in one array
+// by the label renderer and referred to by their index in it, so they are
+// only ever moved, never copied.
 struct LabelInfoLocal
 {
     LabelInfoLocal(double x, double y, const RS_String& text, const RS_TextDef& tdef)
@@ -39,7 +43,8 @@ struct LabelInfoLocal
           m_numpts(0),
           m_numelems(0),
           m_rotated_points(NULL),
-          m_sestyle(NULL)
+          m_sestyle(NULL),
+          m_group(0)
     {
     }
 
@@ -50,16 +55,21 @@ struct LabelInfoLocal
           m_numpts(0),
           m_numelems(0),
           m_rotated_points(NULL),
-          m_sestyle(style)
+          m_sestyle(style),
+          m_group(0)
     {
     }
 
+    LabelInfoLocal(LabelInfoLocal&& other);
+    ~LabelInfoLocal();
+
     double m_x;
     double m_y;
     RS_String m_text;
     RS_TextDef m_tdef;
 
-    // if set, defines the path which the label will follow
+    // if set, defines the path which the label will follow - the points
+    // belong to the label renderer's arena
     RS_F_Point* m_pts;
     int m_numpts;
 
@@ -70,7 +80,7 @@ struct LabelInfoLocal
     // - a path label has one element per character
     size_t m_numelems;
 
-    // the rotated points associated with this label
+    // the rotated points associated with this label, in the arena
     // - each group of four points defines one rotated extent
     // - there's one extent per element
     RS_F_Point* m_rotated_points;
@@ -79,8 +89,16 @@ struct LabelInfoLocal
     // layout character positions
     RS_TextMetrics m_tm;
 
-    // new SE labels keep the symbol here rather than in the m_tdef/m_text combo
+    // new SE labels keep the symbol here rather than in the m_tdef/m_text combo,
+    // and the label owns it
     SE_RenderStyle* m_sestyle;
+
+    // the overpost group the label was added to
+    size_t m_group;
+
+private:
+    LabelInfoLocal(const LabelInfoLocal&);
+    LabelInfoLocal& operator=(const LabelInfoLocal&);
 };
 
 
@@ -92,7 +110,9 @@ struct OverpostGroupLocal
           m_exclude(exclude),
           m_algo(laSimple),
           m_type(type),
-          m_scaleLimit(0.0)
+          m_scaleLimit(0.0),
+          m_first(0),
+          m_count(0)
     {
     }
 
@@ -102,7 +122,11 @@ struct OverpostGroupLocal
     RS_OverpostType m_type;
     double m_scaleLimit;
     RS_Bounds m_feature_bounds;
-    std::vector<LabelInfoLocal> m_labels;
+
+    // the group's labels are m_count consecutive entries of the label
+    // renderer's label order, starting at m_first
+    size_t m_first;
+    size_t m_count;
 };
 
 
@@ -111,40 +135,54 @@ class LabelRendererLocal : public LabelRendererBase
 {
 public:
     STYLIZATION_API LabelRendererLocal(SE_Renderer* se_renderer, double tileExtentOffset);
-    virtual ~LabelRendererLocal();
+    STYLIZATION_API virtual ~LabelRendererLocal();
 
-    virtual void StartLabels();
+    STYLIZATION_API virtual void StartLabels();
 
     // RS labels
-    virtual void ProcessLabelGroup(RS_LabelInfo*    labels,
-                                   int              nlabels,
-                                   const RS_String& text,
-                                   RS_OverpostType  type,
-                                   bool             exclude,
-                                   LineBuffer*      path,
-                                   double           scaleLimit);
+    STYLIZATION_API virtual void ProcessLabelGroup(RS_LabelInfo*    labels,
+                                                   int              nlabels,
+                                                   const RS_String& text,
+                                                   RS_OverpostType  type,
+                                                   bool             exclude,
+                                                   LineBuffer*      path,
+                                                   double           scaleLimit);
 
     // SE labels
-    virtual void ProcessLabelGroup(SE_LabelInfo*    labels,
-                                   int              nlabels,
-                                   RS_OverpostType  type,
-                                   bool             exclude,
-                                   LineBuffer*      path);
+    STYLIZATION_API virtual void ProcessLabelGroup(SE_LabelInfo*    labels,
+                                                   int              nlabels,
+                                                   RS_OverpostType  type,
+                                                   bool             exclude,
+                                                   LineBuffer*      path);
 
-    virtual void BlastLabels();
+    STYLIZATION_API virtual void BlastLabels();
 
-    virtual void AddExclusionRegion(RS_F_Point* pts, int npts);
+    STYLIZATION_API virtual void AddExclusionRegion(RS_F_Point* pts, int npts);
+
+    // Sets the store which remembers the labels placed near the tile edges.
+    // The labels which neighbouring tiles recorded are then drawn as they
+    // were placed, and excluded, while labels of this tile which match them
+    // are skipped.  The store isn't owned, and can be NULL.
+    STYLIZATION_API void SetPlacementStore(LabelPlacementStore* store);
 
 private:
     void Cleanup();
     void BeginOverpostGroup(RS_OverpostType type, bool render, bool exclude);
     void EndOverpostGroup();
 
+    void AddLabel(size_t group, LabelInfoLocal&& info);
+    RS_F_Point* AllocPoints(int npts);
+    inline LabelInfoLocal& GetLabel(const OverpostGroupLocal& group, size_t i)
+    {
+        return m_labels[m_labelOrder[group.m_first + i]];
+    }
+
     bool ComputeSimpleLabelBounds(LabelInfoLocal& info);
-    bool ComputePathLabelBounds(LabelInfoLocal& info, std::vector<LabelInfoLocal>& repeated_infos, double scaleLimit);
+    bool ComputePathLabelBounds(size_t index, std::vector<size_t>& repeated, double scaleLimit);
     bool ComputeSELabelBounds(LabelInfoLocal& info);
 
-    void ProcessLabelGroupsInternal(SimpleOverpost* pMgr, std::vector<OverpostGroupLocal*>& groups);
+    void ProcessLabelGroupsInternal(SimpleOverpost* pMgr, std::vector<OverpostGroupLocal*>& groups,
+                                    std::vector<LabelPlacement>* placements = NULL);
     bool ProcessLabelInternal(SimpleOverpost* pMgr,
                               LabelInfoLocal& info,
                               bool render,
@@ -155,14 +193,26 @@ private:
 
     bool OverlapsStuff(SimpleOverpost* pMgr, RS_F_Point* pts, int npts);
 
-    std::vector<LabelInfoLocal> StitchPolylines(std::vector<LabelInfoLocal>& labels);
-    std::vector<LabelInfoLocal> StitchPolylinesHelper(std::vector<LabelInfoLocal>& labels);
+    void LoadPlacements(const RS_String& grid, int col, int row, std::vector<LabelPlacement>& placements);
+    void DrawPlacement(LabelPlacement& placement);
+    void RecordPlacement(LabelInfoLocal& info, bool render, bool exclude, std::vector<LabelPlacement>& placements);
+    int FindPlacement(OverpostGroupLocal& group, std::vector<LabelPlacement>& placements);
+    void GetLabelBounds(LabelInfoLocal& info, RS_Bounds& bounds);
+
+    size_t StitchPolylines(size_t* labels, size_t numLabels);
+    size_t StitchPolylinesHelper(size_t* labels, size_t numLabels, size_t* stitched);
 
     // member data
     std::vector<OverpostGroupLocal>  m_labelGroups;
+    std::vector<LabelInfoLocal>      m_labels;
+    std::vector<size_t>              m_labelOrder;
+    std::vector<size_t>              m_nextOrder;
+    std::vector<size_t>              m_stitchSource;
+    SE_RenderArena                   m_arena;        // label paths and extents
     std::map<RS_String, size_t>      m_hStitchTable;
     SimpleOverpost                   m_overpost;
     double                           m_tileExtentOffset;
+    LabelPlacementStore*             m_placementStore;
     BIDIConverter                    m_bidiConverter;
 };
 
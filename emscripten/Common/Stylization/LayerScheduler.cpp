@@ -0,0 +1,324 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "LayerScheduler.h"
+#include "SE_RecordingRenderer.h"
+#include "SE_ImageRenderer.h"
+#include <math.h>
+#include <memory>
+#include <exception>
+
+// threads are only available in Emscripten builds with pthread support
+#if !defined(EMSCRIPTEN) || defined(__EMSCRIPTEN_PTHREADS__)
+#define LAYERSCHEDULER_THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// the size, in pixels, of the grid the recorded coordinates are snapped to
+static const double RECORDING_QUANTUM = 1.0 / 16777216.0;
+
+
+//---------------------------------------------
+// The state shared by the calling thread and the workers during a run.
+//---------------------------------------------
+struct LayerScheduler::RunState
+{
+    // a layer being recorded on a worker thread - the display list holds
+    // buffers from the stylizer's pool, so the recorder is destroyed first
+    struct Recording
+    {
+        Recording(SE_SymbolManager* sman) : stylizer(sman), done(false) {}
+
+        SE_ImageFontEngine fontEngine;
+        DefaultStylizer stylizer;
+        std::auto_ptr<SE_RecordingRenderer> recorder;
+        std::exception_ptr error;
+        bool done;
+    };
+
+    const std::vector<LayerJob>* jobs;
+
+    // the recording of each layer, or NULL for the layers drawn in place
+    std::vector<Recording*> recordings;
+    size_t next;
+    bool abort;
+
+    // the map the layers are recorded for
+    SE_SymbolManager* symbolManager;
+    RS_MapUIInfo* mapInfo;
+    RS_Bounds extents;
+    double mapScale;
+    double dpi;
+    double metersPerUnit;
+    int width;
+    int height;
+
+    CancelStylization cancel;
+    void* userData;
+
+#ifdef LAYERSCHEDULER_THREADS
+    std::mutex mutex;
+    std::condition_variable recorded;
+#endif
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+LayerScheduler::LayerScheduler(SE_SymbolManager* sman)
+: m_symbolManager(sman),
+  m_numThreads(0),
+  m_recorded(0),
+  m_stylizer(sman)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+LayerScheduler::~LayerScheduler()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LayerScheduler::AddVectorLayer(MdfModel::VectorLayerDefinition* layer,
+                                    RS_FeatureReader*                features,
+                                    CSysTransformer*                 xformer,
+                                    RS_LayerUIInfo*                  layerInfo,
+                                    RS_FeatureClassInfo*             classInfo)
+{
+    LayerJob job;
+    job.layer = layer;
+    job.features = features;
+    job.xformer = xformer;
+    job.layerInfo = layerInfo;
+    job.classInfo = classInfo;
+    m_jobs.push_back(job);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LayerScheduler::Run(SE_Renderer* target, CancelStylization cancel, void* userData)
+{
+    m_recorded = 0;
+
+    RunState state;
+    state.jobs = &m_jobs;
+    state.next = 0;
+    state.abort = false;
+    state.symbolManager = m_symbolManager;
+    state.mapInfo = target->GetMapInfo();
+    state.extents = target->GetBounds();
+    state.mapScale = target->GetMapScale();
+    state.dpi = target->GetDpi();
+    state.metersPerUnit = target->GetMetersPerUnit();
+    state.cancel = cancel;
+    state.userData = userData;
+    state.recordings.assign(m_jobs.size(), (RunState::Recording*)NULL);
+
+    int numThreads = 1;
+#ifdef LAYERSCHEDULER_THREADS
+    numThreads = (m_numThreads > 0)? m_numThreads : (int)std::thread::hardware_concurrency();
+#endif
+
+    // only composite styles are recorded faithfully
+    if (numThreads > 1 && CanRecord(target, state.width, state.height))
+    {
+        for (size_t i=0; i<m_jobs.size(); ++i)
+        {
+            MdfModel::VectorScaleRange* scaleRange = Stylizer::FindScaleRange(*m_jobs[i].layer->GetScaleRanges(), state.mapScale);
+            if (scaleRange && DefaultStylizer::HasCompositeStyle(scaleRange))
+            {
+                state.recordings[i] = new RunState::Recording(m_symbolManager);
+                ++m_recorded;
+            }
+        }
+    }
+
+#ifdef LAYERSCHEDULER_THREADS
+    // the calling thread draws into the target, and the others record
+    std::vector<std::thread> threads;
+    int numWorkers = rs_min(numThreads - 1, m_recorded);
+    for (int i=0; i<numWorkers; ++i)
+        threads.push_back(std::thread(RecordLayers, &state));
+#endif
+
+    try
+    {
+        for (size_t i=0; i<m_jobs.size(); ++i)
+        {
+            const LayerJob& job = m_jobs[i];
+            RunState::Recording* recording = state.recordings[i];
+            if (!recording)
+            {
+                StylizeLayer(job, target, cancel, userData);
+                continue;
+            }
+
+#ifdef LAYERSCHEDULER_THREADS
+            {
+                std::unique_lock<std::mutex> lock(state.mutex);
+                while (!recording->done)
+                    state.recorded.wait(lock);
+            }
+#endif
+
+            if (recording->error)
+                std::rethrow_exception(recording->error);
+
+            // replay the layer, with its label groups going to the target's
+            // label renderer after those of the layers below it
+            target->SetBufferPool(m_stylizer.GetBufferPool());
+            target->StartLayer(job.layerInfo, job.classInfo);
+            recording->recorder->GetDisplayList().Replay(target);
+            target->EndLayer();
+
+#ifdef LAYERSCHEDULER_THREADS
+            std::lock_guard<std::mutex> lock(state.mutex);
+#endif
+            state.recordings[i] = NULL;
+            delete recording;
+        }
+    }
+    catch (...)
+    {
+#ifdef LAYERSCHEDULER_THREADS
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.abort = true;
+        }
+        for (size_t i=0; i<threads.size(); ++i)
+            threads[i].join();
+#endif
+
+        for (size_t i=0; i<state.recordings.size(); ++i)
+            delete state.recordings[i];
+
+        m_jobs.clear();
+        throw;
+    }
+
+#ifdef LAYERSCHEDULER_THREADS
+    for (size_t i=0; i<threads.size(); ++i)
+        threads[i].join();
+#endif
+
+    m_jobs.clear();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Checks whether the recording renderer maps the target's extents to the
+// same screen space as the target, and gets the size of that space.
+bool LayerScheduler::CanRecord(SE_Renderer* target, int& width, int& height)
+{
+    if (target->YPointsUp() || target->GetScreenUnitsPerPixel() != 1.0)
+        return false;
+
+    // text is measured while stylizing, so it must measure the same
+    if (!dynamic_cast<SE_ImageFontEngine*>(target->GetRSFontEngine()))
+        return false;
+
+    RS_Bounds extents = target->GetBounds();
+    SE_Matrix w2s;
+    target->GetWorldToScreenTransform(w2s);
+
+    width = (int)floor(w2s.x0 * extents.width() + 0.5);
+    height = (int)floor(w2s.y2 + w2s.y1 * extents.miny + 0.5);
+    if (width <= 0 || height <= 0)
+        return false;
+
+    SE_RecordingRenderer recorder(width, height, NULL);
+    recorder.StartMap(NULL, extents, target->GetMapScale(), target->GetDpi(), target->GetMetersPerUnit(), NULL);
+
+    SE_Matrix r2s;
+    recorder.GetWorldToScreenTransform(r2s);
+
+    const double* a = &w2s.x0;
+    const double* b = &r2s.x0;
+    for (int i=0; i<6; ++i)
+    {
+        if (fabs(a[i] - b[i]) > 1.0e-9 * rs_max(1.0, fabs(a[i])))
+            return false;
+    }
+
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void LayerScheduler::StylizeLayer(const LayerJob& job, SE_Renderer* target, CancelStylization cancel, void* userData)
+{
+    target->StartLayer(job.layerInfo, job.classInfo);
+    m_stylizer.StylizeVectorLayer(job.layer, target, job.features, job.xformer, target->GetMapScale(), cancel, userData);
+    target->EndLayer();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// The worker loop - records the layers in order until there are none left.
+void LayerScheduler::RecordLayers(RunState* state)
+{
+#ifdef LAYERSCHEDULER_THREADS
+    for (;;)
+    {
+        size_t index;
+        RunState::Recording* recording = NULL;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            while (!state->abort && state->next < state->recordings.size() && !state->recordings[state->next])
+                ++state->next;
+
+            if (state->abort || state->next == state->recordings.size())
+                return;
+
+            index = state->next++;
+            recording = state->recordings[index];
+        }
+
+        const LayerJob& job = (*state->jobs)[index];
+        try
+        {
+            SE_RecordingRenderer* recorder = new SE_RecordingRenderer(state->width, state->height, &recording->fontEngine);
+            recording->recorder.reset(recorder);
+
+            // the recording is only replayed once, so keep the coordinates
+            // to well below the precision the target draws with
+            recorder->GetDisplayList().SetQuantum(RECORDING_QUANTUM);
+
+            recorder->StartMap(state->mapInfo, state->extents, state->mapScale, state->dpi, state->metersPerUnit, NULL);
+            recorder->StartLayer(job.layerInfo, job.classInfo);
+            recording->stylizer.StylizeVectorLayer(job.layer, recorder, job.features, job.xformer,
+                                                   state->mapScale, state->cancel, state->userData);
+            recorder->EndLayer();
+            recorder->EndMap();
+        }
+        catch (...)
+        {
+            recording->error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        recording->done = true;
+        state->recorded.notify_all();
+    }
+#else
+    (void)state;
+#endif
+}
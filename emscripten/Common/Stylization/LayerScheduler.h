@@ -0,0 +1,113 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef LAYERSCHEDULER_H_
+#define LAYERSCHEDULER_H_
+
+#include "StylizationAPI.h"
+#include "Stylizer.h"
+#include "DefaultStylizer.h"
+#include <vector>
+
+class SE_Renderer;
+class SE_SymbolManager;
+class RS_LayerUIInfo;
+class RS_FeatureClassInfo;
+
+
+//---------------------------------------------
+// Stylizes the vector layers of a map on several threads and draws them
+// into the map's renderer in the order they were added, as if they had
+// been stylized one after another.
+//
+// Each layer styled with composite styles is stylized on a worker thread
+// into a display list of its own (see SE_RecordingRenderer), with its own
+// stylizer and font engine.  Meanwhile the calling thread replays the
+// display lists into the target renderer in layer order, as soon as each
+// is complete, so that the target - including its label renderer, which
+// receives the label groups of each layer in turn - is only ever used from
+// the calling thread.  Layers with other styles are stylized directly into
+// the target when their turn comes.
+//
+// Recording requires a target whose screen space is in pixels with y
+// pointing down, like the recording renderer's, and which measures text
+// with SE_ImageFontEngine.  For any other target, or when there is only
+// one thread, all the layers are stylized directly into the target.
+//
+// Only vector layers are scheduled.  Grid and drawing layers are left to
+// the caller: to keep the map's layer order, Run the layers added so far,
+// stylize the grid or drawing layer into the target, then add the layers
+// above it and Run again.
+//
+// Each layer must have its own feature reader.  The symbol manager is
+// shared by the threads, so it must be safe to use concurrently, and so
+// must the cancel callback.
+//---------------------------------------------
+
+class LayerScheduler
+{
+public:
+    STYLIZATION_API LayerScheduler(SE_SymbolManager* sman);
+    STYLIZATION_API ~LayerScheduler();
+
+    // the number of threads, including the calling one - zero, the default,
+    // uses one per core
+    inline void SetNumThreads(int numThreads) { m_numThreads = numThreads; }
+
+    // Adds a layer, to be drawn above those added before it.  The reader
+    // and transformer are used by one thread only.
+    STYLIZATION_API void AddVectorLayer(MdfModel::VectorLayerDefinition* layer,
+                                        RS_FeatureReader*                features,
+                                        CSysTransformer*                 xformer,
+                                        RS_LayerUIInfo*                  layerInfo,
+                                        RS_FeatureClassInfo*             classInfo);
+
+    // Stylizes the layers into the target, whose map must have been started,
+    // and removes them.  Each layer is drawn between a StartLayer and an
+    // EndLayer call on the target.
+    STYLIZATION_API void Run(SE_Renderer* target, CancelStylization cancel, void* userData);
+
+    // the number of layers the last run stylized on worker threads
+    inline int GetRecordedCount() const { return m_recorded; }
+
+private:
+    struct LayerJob
+    {
+        MdfModel::VectorLayerDefinition* layer;
+        RS_FeatureReader* features;
+        CSysTransformer* xformer;
+        RS_LayerUIInfo* layerInfo;
+        RS_FeatureClassInfo* classInfo;
+    };
+
+    struct RunState;
+
+    bool CanRecord(SE_Renderer* target, int& width, int& height);
+    void StylizeLayer(const LayerJob& job, SE_Renderer* target, CancelStylization cancel, void* userData);
+    static void RecordLayers(RunState* state);
+
+    SE_SymbolManager* m_symbolManager;
+    int m_numThreads;
+    int m_recorded;
+
+    std::vector<LayerJob> m_jobs;
+
+    // stylizes the layers which aren't recorded
+    DefaultStylizer m_stylizer;
+};
+
+#endif
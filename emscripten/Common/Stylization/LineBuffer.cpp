@@ -43,22 +43,24 @@ const int MIN_RING_SIZE_TO_OPTIMIZE = 6;
 LineBuffer::LineBuffer(int size, int dimensionality, bool bIgnoreZ) :
     m_bounds(DBL_MAX, DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX, -DBL_MAX),
     m_types(NULL),
-    m_types_len(0),
-    m_cur_types(0),
     m_pts(NULL),
     m_cntrs(NULL),
     m_csp(NULL),
-    m_cntrs_len(0),
+    m_cur_types(0),
     m_cur_cntr(-1), // will increment with first MoveTo segment
+    m_types_len(0),
+    m_cntrs_len(0),
+    m_geom_type(0),
     m_cur_geom(-1),
+    m_drawingScale(0.0),
+    m_bStoreCurves(false),
+    m_bHasCurves(false),
     m_arcs_sp_len(0),
-    m_arcs_sp(NULL),
     m_cur_arcs_sp(-1),
+    m_arcs_sp(NULL),
     m_closeseg_len(0),
-    m_closeseg(NULL),
     m_cur_closeseg(-1),
-    m_geom_type(0),
-    m_drawingScale(0.0)
+    m_closeseg(NULL)
 {
     ResizePoints(rs_max(size, 2));
     ResizeContours(4);
@@ -77,28 +79,30 @@ LineBuffer::LineBuffer(int size, int dimensionality, bool bIgnoreZ) :
 LineBuffer::LineBuffer() :
     m_bounds(DBL_MAX, DBL_MAX, DBL_MAX, -DBL_MAX, 0.0, 0.0),
     m_types(NULL),
-    m_types_len(0),
-    m_cur_types(0),
     m_pts(NULL),
     m_cntrs(NULL),
     m_csp(NULL),
-    m_cntrs_len(0),
+    m_cur_types(0),
     m_cur_cntr(-1),
-    m_cur_geom(-1),
+    m_types_len(0),
+    m_cntrs_len(0),
     m_geom_type(0),
+    m_bTransform2DPoints(false),
+    m_num_geomcntrs(NULL),
+    m_num_geomcntrs_len(0),
+    m_cur_geom(-1),
+    m_bIgnoreZ(true),
+    m_bProcessZ(false),
+    m_dimensionality(Dimensionality_XY),
+    m_drawingScale(0.0),
+    m_bStoreCurves(false),
+    m_bHasCurves(false),
     m_arcs_sp_len(0),
-    m_arcs_sp(NULL),
     m_cur_arcs_sp(-1),
+    m_arcs_sp(NULL),
     m_closeseg_len(0),
-    m_closeseg(NULL),
     m_cur_closeseg(-1),
-    m_drawingScale(0.0),
-    m_dimensionality(Dimensionality_XY),
-    m_bIgnoreZ(true),
-    m_bProcessZ(false),
-    m_bTransform2DPoints(false),
-    m_num_geomcntrs_len(0),
-    m_num_geomcntrs(NULL)
+    m_closeseg(NULL)
 {
 }
 
@@ -127,6 +131,8 @@ void LineBuffer::Reset(int dimensionality, bool bIgnoreZ)
     m_cur_geom = -1;
     m_num_geomcntrs[0] = 0;
     m_drawingScale = 0.0;
+    m_bStoreCurves = false;
+    m_bHasCurves = false;
 
     m_cur_arcs_sp = -1;
     m_cur_closeseg = -1;
@@ -156,6 +162,8 @@ LineBuffer& LineBuffer::operator=(const LineBuffer& src)
     m_T = *(const_cast<Matrix3D*>(&src.m_T));   // Matrix3D assignment operator takes non-const src
     m_bounds = src.m_bounds;
     m_drawingScale = src.m_drawingScale;
+    m_bStoreCurves = src.m_bStoreCurves;
+    m_bHasCurves = src.m_bHasCurves;
 
     // types, points
     if (m_types_len < src.m_cur_types)
@@ -530,6 +538,9 @@ LineBuffer& LineBuffer::operator+=(LineBuffer& other)
     m_bounds.add_point(RS_F_Point(other.m_bounds.minx, other.m_bounds.miny));
     m_bounds.add_point(RS_F_Point(other.m_bounds.maxx, other.m_bounds.maxy));
 
+    if (other.m_bHasCurves)
+        m_bHasCurves = true;
+
     return *this;
 }
 
@@ -568,7 +579,10 @@ void LineBuffer::CircularArcTo(double x1, double y1, double x2, double y2)
         // get the start point
         double x0, y0, z0;
         last_point(x0, y0, z0);
-        CircularArcTo2D(x0, y0, x1, y1, x2, y2);
+        if (m_bStoreCurves)
+            StoreCircularArc(x0, y0, x1, y1, x2, y2);
+        else
+            CircularArcTo2D(x0, y0, x1, y1, x2, y2);
     }
 }
 
@@ -582,6 +596,8 @@ void LineBuffer::CircularArcTo(double x1, double y1, double z1, double x2, doubl
     last_point(x0, y0, z0);
     if (m_bProcessZ)
         CircularArcTo3D(x0, y0, z0, x1, y1, z1, x2, y2, z2);
+    else if (m_bStoreCurves)
+        StoreCircularArc(x0, y0, x1, y1, x2, y2);
     else
         CircularArcTo2D(x0, y0, x1, y1, x2, y2);
 }
@@ -675,6 +691,35 @@ void LineBuffer::CircularArcTo3D(double x0, double y0, double z0, double x1, dou
 
 
 void LineBuffer::CircularArcTo2D(double x0, double y0, double x1, double y1, double x2, double y2)
+{
+    double cx, cy, r, startAngle, endAngle;
+    if (!GetCircularArc(x0, y0, x1, y1, x2, y2, cx, cy, r, startAngle, endAngle))
+    {
+        // store off arc start point index
+        EnsureArcsSpArray(2);
+        m_arcs_sp[++m_cur_arcs_sp] = m_cur_types - 1;
+
+        LineTo(x1, y1);
+        LineTo(x2, y2);
+
+        // store off arc end point index (want index of start point of last seg)
+        m_arcs_sp[++m_cur_arcs_sp] = m_cur_types - 2;
+
+        return;
+    }
+
+    ArcTo(cx, cy, r, r, startAngle, endAngle);
+
+    // ensure the final generated point exactly matches the input
+    AdjustArcEndPoint(x2, y2);
+}
+
+
+// Computes the circle through the start, mid and end points of an arc, and
+// the start and end angles which track the arc in the correct direction.
+// Returns false if the arc is almost a straight line.
+bool LineBuffer::GetCircularArc(double x0, double y0, double x1, double y1, double x2, double y2,
+                                double& cx, double& cy, double& r, double& startAngle, double& endAngle)
 {
     // now we can compute the circle that those 3 points describe
     double dx1 = x1 - x0;
@@ -700,19 +745,7 @@ void LineBuffer::CircularArcTo2D(double x0, double y0, double x1, double y1, dou
         double areaRatio = fabs(area) / boxArea;
 
         if (areaRatio < 1.0e-10)
-        {
-            // store off arc start point index
-            EnsureArcsSpArray(2);
-            m_arcs_sp[++m_cur_arcs_sp] = m_cur_types - 1;
-
-            LineTo(x1, y1);
-            LineTo(x2, y2);
-
-            // store off arc end point index (want index of start point of last seg)
-            m_arcs_sp[++m_cur_arcs_sp] = m_cur_types - 2;
-
-            return;
-        }
+            return false;
     }
 
     double sqLen10 = dx1 * dx1 + dy1 * dy1;
@@ -721,17 +754,17 @@ void LineBuffer::CircularArcTo2D(double x0, double y0, double x1, double y1, dou
 
     // find center point and radius of circumscribing circle using
     // formulas from Geometric Tools (Schneider & Eberly)
-    double cx = x0 + 0.25 * invArea * (dy2 * sqLen10 - dy1 * sqLen20);
-    double cy = y0 + 0.25 * invArea * (dx1 * sqLen20 - dx2 * sqLen10);
+    cx = x0 + 0.25 * invArea * (dy2 * sqLen10 - dy1 * sqLen20);
+    cy = y0 + 0.25 * invArea * (dx1 * sqLen20 - dx2 * sqLen10);
 
     double rdx = cx - x0;
     double rdy = cy - y0;
 
-    double r = sqrt(rdx*rdx + rdy*rdy);
+    r = sqrt(rdx*rdx + rdy*rdy);
 
     // start and end angles of circular arc, in radians
-    double startAngle = atan2(y0 - cy, x0 - cx);
-    double endAngle = atan2(y2 - cy, x2 - cx);
+    startAngle = atan2(y0 - cy, x0 - cx);
+    endAngle = atan2(y2 - cy, x2 - cx);
 
     // now fix the start and end angles so that they track the arc
     // in the correct direction
@@ -747,10 +780,67 @@ void LineBuffer::CircularArcTo2D(double x0, double y0, double x1, double y1, dou
 
     }
 
-    ArcTo(cx, cy, r, r, startAngle, endAngle);
+    return true;
+}
 
-    // ensure the final generated point exactly matches the input
-    AdjustArcEndPoint(x2, y2);
+
+// Computes the bounds of a circular arc - its end points plus any of the
+// circle's extreme points which it passes through.
+void LineBuffer::GetCircularArcBounds(double x0, double y0, double x1, double y1, double x2, double y2, RS_Bounds& bounds)
+{
+    bounds.minx = rs_min(x0, x2);
+    bounds.maxx = rs_max(x0, x2);
+    bounds.miny = rs_min(y0, y2);
+    bounds.maxy = rs_max(y0, y2);
+
+    double cx, cy, r, startAngle, endAngle;
+    if (!GetCircularArc(x0, y0, x1, y1, x2, y2, cx, cy, r, startAngle, endAngle) || !(r < DBL_MAX))
+    {
+        // the arc is drawn as two lines through the mid point
+        bounds.add_point(RS_F_Point(x1, y1));
+        return;
+    }
+
+    double lo = rs_min(startAngle, endAngle);
+    double hi = rs_max(startAngle, endAngle);
+    for (int k = (int)ceil(lo / (0.5*M_PI)); k * (0.5*M_PI) <= hi; ++k)
+    {
+        switch (k & 3)
+        {
+            case 0: bounds.maxx = rs_max(bounds.maxx, cx + r); break;
+            case 1: bounds.maxy = rs_max(bounds.maxy, cy + r); break;
+            case 2: bounds.minx = rs_min(bounds.minx, cx - r); break;
+            case 3: bounds.miny = rs_min(bounds.miny, cy - r); break;
+        }
+    }
+}
+
+
+// Stores a circular arc as a curve - its mid and end points - for it to
+// be tessellated later by Tessellate.
+void LineBuffer::StoreCircularArc(double x0, double y0, double x1, double y1, double x2, double y2)
+{
+    EnsurePoints(2);
+
+    // store off arc start point index
+    EnsureArcsSpArray(2);
+    m_arcs_sp[++m_cur_arcs_sp] = m_cur_types - 1;
+
+    append_segment(stArcTo, x1, y1, 0.0);
+    increment_contour_pts();
+    append_segment(stArcTo, x2, y2, 0.0);
+    increment_contour_pts();
+
+    // store off arc mid point index, consistent with the start point of
+    // the last segment of a tessellated arc
+    m_arcs_sp[++m_cur_arcs_sp] = m_cur_types - 2;
+
+    RS_Bounds arcBounds;
+    GetCircularArcBounds(x0, y0, x1, y1, x2, y2, arcBounds);
+    AddToBounds(arcBounds.minx, arcBounds.miny);
+    AddToBounds(arcBounds.maxx, arcBounds.maxy);
+
+    m_bHasCurves = true;
 }
 
 
@@ -1447,6 +1537,17 @@ LineBuffer* LineBuffer::Optimize(double drawingScale, LineBufferPool* lbp)
 // if return pointer is NULL, geometry was fully outside the clip box
 LineBuffer* LineBuffer::Clip(RS_Bounds& b, GeomOperationType clipType, LineBufferPool* lbp)
 {
+    // stored arcs are tessellated first - those wholly outside the box are
+    // replaced by their chords, which clip away the same
+    if (m_bHasCurves)
+    {
+        LineBuffer* lbt = Tessellate(lbp, &b);
+        LineBuffer* lbc = lbt->Clip(b, clipType, lbp);
+        if (lbc != lbt)
+            LineBufferPool::FreeLineBuffer(lbp, lbt);
+        return lbc;
+    }
+
     // We don't handle 3D clipping correctly yet
     // TODO: Implement 3D clipping if necessary
     if (hasZ())
@@ -1520,6 +1621,75 @@ LineBuffer* LineBuffer::Clip(RS_Bounds& b, GeomOperationType clipType, LineBuffe
 }
 
 
+// Returns a copy of the buffer with its stored arcs tessellated at the
+// drawing scale, or the buffer itself if it has none.  Arcs which don't
+// reach into the cull bounds, if supplied, are replaced by their chords.
+LineBuffer* LineBuffer::Tessellate(LineBufferPool* lbp, const RS_Bounds* cull)
+{
+    if (!m_bHasCurves)
+        return this;
+
+    LineBuffer* dst = LineBufferPool::NewLineBuffer(lbp, m_cur_types, m_dimensionality, m_bIgnoreZ);
+    dst->m_geom_type = m_geom_type;
+    dst->m_drawingScale = m_drawingScale;
+
+    int cntr = 0;
+    for (int g=0; g<=m_cur_geom; ++g)
+    {
+        dst->NewGeometry();
+
+        for (int j=0; j<m_num_geomcntrs[g]; ++j, ++cntr)
+        {
+            int start = m_csp[cntr];
+            int end = start + m_cntrs[cntr] - 1;
+            for (int i=start; i<=end; ++i)
+            {
+                double* pt = m_pts[i];
+                switch (m_types[i])
+                {
+                    case stMoveTo:
+                        dst->MoveTo(pt[0], pt[1], pt[2]);
+                        break;
+
+                    case stLineTo:
+                        dst->LineTo(pt[0], pt[1], pt[2]);
+                        break;
+
+                    case stArcTo:
+                    {
+                        double* ept = m_pts[i+1];
+                        double x0, y0, z0;
+                        dst->last_point(x0, y0, z0);
+
+                        bool culled = false;
+                        if (cull)
+                        {
+                            RS_Bounds arcBounds;
+                            GetCircularArcBounds(x0, y0, pt[0], pt[1], ept[0], ept[1], arcBounds);
+                            culled = (   arcBounds.minx > cull->maxx
+                                      || arcBounds.miny > cull->maxy
+                                      || arcBounds.maxx < cull->minx
+                                      || arcBounds.maxy < cull->miny);
+                        }
+
+                        if (culled)
+                            dst->LineTo(ept[0], ept[1]);
+                        else
+                            dst->CircularArcTo2D(x0, y0, pt[0], pt[1], ept[0], ept[1]);
+
+                        // skip the end point
+                        ++i;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return dst;
+}
+
+
 void LineBuffer::ClipPoints(RS_Bounds& b, LineBuffer* dst)
 {
     dst->m_geom_type = m_geom_type;
@@ -2553,6 +2723,17 @@ int LineBuffer::dimensionality() const
 }
 
 
+size_t LineBuffer::memory_size() const
+{
+    return sizeof(LineBuffer)
+         + m_types_len * (sizeof(double) * 3 + sizeof(unsigned char))
+         + m_cntrs_len * sizeof(int) * 2
+         + m_num_geomcntrs_len * sizeof(int)
+         + m_arcs_sp_len * sizeof(int)
+         + m_closeseg_len * sizeof(int);
+}
+
+
 void LineBuffer::ComputeBounds(RS_Bounds& bounds)
 {
     // update the bounds, if they're not already set
@@ -2585,6 +2766,12 @@ void LineBuffer::SetDrawingScale(double drawingScale)
 }
 
 
+void LineBuffer::SetStoreCurves(bool storeCurves)
+{
+    m_bStoreCurves = storeCurves;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ////
@@ -2595,28 +2782,36 @@ void LineBuffer::SetDrawingScale(double drawingScale)
 
 
 //--------------------------------------------------------
-// Pooling -- it's very basic
+// Pooling
 //--------------------------------------------------------
 
 LineBufferPool::LineBufferPool()
 {
+    memset(&m_stats, 0, sizeof(Stats));
 }
 
 
 LineBufferPool::~LineBufferPool()
 {
     while (!m_pool.empty())
-        delete m_pool.pop();
+        delete m_pool.pop_largest();
 }
 
 
 LineBuffer* LineBufferPool::NewLineBuffer(LineBufferPool* pool, int requestSize, int dimensionality, bool bIgnoreZ)
 {
-    if (pool && !pool->m_pool.empty())
+    if (pool)
     {
-        LineBuffer* lb = pool->m_pool.pop();
-        lb->Reset(dimensionality, bIgnoreZ);
-        return lb;
+        ++pool->m_stats.requests;
+
+        LineBuffer* lb = pool->m_pool.pop(requestSize);
+        if (lb)
+        {
+            ++pool->m_stats.reuses;
+            pool->RemovePooled(lb->memory_size());
+            lb->Reset(dimensionality, bIgnoreZ);
+            return lb;
+        }
     }
 
     return new LineBuffer(requestSize, dimensionality, bIgnoreZ);
@@ -2626,7 +2821,55 @@ LineBuffer* LineBufferPool::NewLineBuffer(LineBufferPool* pool, int requestSize,
 void LineBufferPool::FreeLineBuffer(LineBufferPool* pool, LineBuffer* lb)
 {
     if (pool)
-        pool->m_pool.push(lb);
+    {
+        pool->m_pool.push(lb, lb->point_capacity());
+        pool->AddPooled(lb->memory_size());
+    }
     else
         delete lb;
 }
+
+
+void LineBufferPool::Trim(size_t maxBytes)
+{
+    while (m_stats.bytes > maxBytes && FreeLargest())
+    {
+    }
+}
+
+
+void LineBufferPool::ResetStats()
+{
+    m_stats.highWaterBuffers = m_stats.buffers;
+    m_stats.highWaterBytes = m_stats.bytes;
+    m_stats.requests = 0;
+    m_stats.reuses = 0;
+}
+
+
+bool LineBufferPool::FreeLargest()
+{
+    LineBuffer* lb = m_pool.pop_largest();
+    if (!lb)
+        return false;
+
+    RemovePooled(lb->memory_size());
+    delete lb;
+    return true;
+}
+
+
+void LineBufferPool::AddPooled(size_t bytes)
+{
+    ++m_stats.buffers;
+    m_stats.bytes += bytes;
+    m_stats.highWaterBuffers = rs_max(m_stats.highWaterBuffers, m_stats.buffers);
+    m_stats.highWaterBytes = rs_max(m_stats.highWaterBytes, m_stats.bytes);
+}
+
+
+void LineBufferPool::RemovePooled(size_t bytes)
+{
+    --m_stats.buffers;
+    m_stats.bytes -= bytes;
+}
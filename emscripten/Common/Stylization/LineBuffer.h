@@ -22,7 +22,7 @@
 #include "StylizationAPI.h"
 #include "StylizationDefs.h"
 #include "Bounds.h"
-#include "DataValueStack.h"
+#include "SizeClassStack.h"
 #include "Matrix3D.h"
 
 #ifndef RESTRICT
@@ -59,6 +59,12 @@ class RS_OutputStream;
 // arc segment.  The pair contains the vertex indices (into the
 // m_pts array) of the start and end segments of the tessellated arc.
 //
+// A buffer which stores curves (see SetStoreCurves) keeps circular
+// arcs as their mid and end points, with segment type stArcTo, and
+// the m_arcs_sp pair of such an arc holds the indices of its start
+// and mid points.  These buffers must be tessellated, by Tessellate
+// or Clip, before anything else reads their points.
+//
 // If arcs are present in a curve polygon or curve multi-polygon, and
 // an extra line segment was added from the end-point of the last arc
 // segment of a contour to the first vertex of the contour in order to
@@ -68,14 +74,16 @@ class RS_OutputStream;
 class LineBuffer
 {
 public:
-    // LineBuffer segment types.  Some day we might actually store
-    // curve segments instead of tessellating them
+    // LineBuffer segment types.  Circular arcs are only stored as
+    // curves when the buffer is set to, and are otherwise tessellated
+    // as they're added.
     enum SegType
     {
         stMoveTo  = 0,
-        stLineTo  = 1
-//      stQuadTo  = 2,
-//      stCubicTo = 3
+        stLineTo  = 1,
+        stArcTo   = 2   // the mid and end points of a circular arc
+//      stQuadTo  = 3,
+//      stCubicTo = 4
     };
 
     enum GeomOperationType
@@ -114,6 +122,7 @@ public:
     // the cool stuff
     STYLIZATION_API LineBuffer* Optimize(double drawingScale, LineBufferPool* lbp);
     STYLIZATION_API LineBuffer* Clip(RS_Bounds& b, GeomOperationType clipType, LineBufferPool* lbp);
+    STYLIZATION_API LineBuffer* Tessellate(LineBufferPool* lbp, const RS_Bounds* cull = NULL);
     STYLIZATION_API void Centroid(GeomOperationType type, double* x, double * y, double* slope) const;
 
     // clears the buffer for reuse
@@ -138,6 +147,10 @@ public:
     // sets the drawing scale (used for arc tessellation)
     STYLIZATION_API void SetDrawingScale(double drawingScale);
 
+    // sets whether 2D circular arcs are stored as curves, to be tessellated
+    // later at the drawing scale - Reset turns this off
+    STYLIZATION_API void SetStoreCurves(bool storeCurves);
+
     STYLIZATION_API double PolygonArea(int cntr) const;
     STYLIZATION_API double PolygonSignedArea(int cntr) const;
     STYLIZATION_API double PolylineLength(int cntr) const;
@@ -147,7 +160,9 @@ public:
     inline unsigned char point_type(int n) const;
     inline int point_count() const;         // number of points in buffer
     inline int point_capacity() const;      // max number of points buffer could hold
+    STYLIZATION_API size_t memory_size() const; // bytes allocated for the buffer
     inline int geom_type() const;
+    inline bool has_curves() const;         // whether there are stored arcs
     inline int* cntrs() const;
     inline int cntr_size(int cntr) const;
     inline int cntr_count() const;
@@ -211,6 +226,8 @@ protected:
     bool m_bProcessZ;
     int m_dimensionality;
     double m_drawingScale;
+    bool m_bStoreCurves;
+    bool m_bHasCurves;
     int m_arcs_sp_len;          // length of m_arcs_sp array
     int m_cur_arcs_sp;          // current index into m_arcs_sp
     int* m_arcs_sp;             // arc start point indices array
@@ -229,6 +246,10 @@ protected:
     void CircularArcTo2D(double startx, double starty, double midx, double midy, double endx, double endy);
     void CircularArcTo3D(double startx, double starty, double startz, double midx, double midy, double midz, double endx, double endy, double endz);
     void AdjustArcEndPoint(double x, double y, double z = 0.0);
+    void StoreCircularArc(double startx, double starty, double midx, double midy, double endx, double endy);
+    static bool GetCircularArc(double x0, double y0, double x1, double y1, double x2, double y2,
+                               double& cx, double& cy, double& r, double& startAngle, double& endAngle);
+    static void GetCircularArcBounds(double x0, double y0, double x1, double y1, double x2, double y2, RS_Bounds& bounds);
     void ClipPolygon(RS_Bounds& b, LineBuffer* dst);
     void ClipPolyline(RS_Bounds& b, LineBuffer* dst);
     void ClipPoints(RS_Bounds& b, LineBuffer* dst);
@@ -256,19 +277,49 @@ protected:
 
 //---------------------------------------------
 // Object pool for line buffers
+//
+// Freed buffers are kept by capacity class, and a request gets the
+// best-fitting one.  The pool never releases buffers on its own - call
+// Trim between requests to bound the memory it holds.
 //---------------------------------------------
 
 class LineBufferPool
 {
 public:
+    struct Stats
+    {
+        int buffers;                // buffers held by the pool
+        size_t bytes;               // memory held by those buffers
+        int highWaterBuffers;       // the most buffers held at once
+        size_t highWaterBytes;      // the most memory held at once
+        int requests;               // buffers requested from the pool
+        int reuses;                 // requests given a pooled buffer
+    };
+
     STYLIZATION_API LineBufferPool();
     STYLIZATION_API virtual ~LineBufferPool();
 
     STYLIZATION_API static LineBuffer* NewLineBuffer(LineBufferPool* pool, int requestSize, int dimensionality = Dimensionality_XY, bool bIgnoreZ = true);
     STYLIZATION_API static void FreeLineBuffer(LineBufferPool* pool, LineBuffer* lb);
 
-private:
-    DataValueStack<LineBuffer> m_pool;
+    // Releases pooled buffers, largest first, until the pool holds no
+    // more than maxBytes.
+    STYLIZATION_API void Trim(size_t maxBytes);
+
+    inline const Stats& GetStats() const { return m_stats; }
+
+    // starts the high water marks over from the current amounts
+    STYLIZATION_API void ResetStats();
+
+protected:
+    // releases the largest pooled buffer - returns false if there is none
+    virtual bool FreeLargest();
+
+    void AddPooled(size_t bytes);
+    void RemovePooled(size_t bytes);
+
+    SizeClassStack<LineBuffer> m_pool;
+    Stats m_stats;
 };
 
 
@@ -301,6 +352,12 @@ int LineBuffer::geom_type() const
 }
 
 
+bool LineBuffer::has_curves() const
+{
+    return m_bHasCurves;
+}
+
+
 int* LineBuffer::cntrs() const
 {
     return m_cntrs;
@@ -617,6 +617,7 @@ LineStyleDef::LineStyleDef()
     m_nRuns = 0;
     m_pixelRuns = NULL;
     m_decorDefs = NULL;
+    m_lastIndex = -1;
 }
 
 
@@ -689,17 +690,16 @@ void LineStyleDef::SetStyle(const wchar_t* lineStyle, double drawingScale, doubl
     const int len = sizeof(s_styleDefs) / sizeof(StyleDefinition);
 
     // we generally reuse the same style repeatedly, so optimize for this
-    static int lastIndex = -1;
-    if (lastIndex >= 0 && lastIndex < len)
+    if (m_lastIndex >= 0 && m_lastIndex < len)
     {
         // last style used was a standard style
-        if (::wcscmp(lineStyle, s_styleDefs[lastIndex].m_styleName) == 0)
+        if (::wcscmp(lineStyle, s_styleDefs[m_lastIndex].m_styleName) == 0)
         {
-            SetStyleDef(s_styleDefs[lastIndex], drawingScale, dpi, lineWeight);
+            SetStyleDef(s_styleDefs[m_lastIndex], drawingScale, dpi, lineWeight);
             return;
         }
     }
-    else if (lastIndex == len)
+    else if (m_lastIndex == len)
     {
         // last style used was a custom style
         CUSTOMSTYLES::iterator iter = s_customStyles.find(lineStyle);
@@ -717,7 +717,7 @@ void LineStyleDef::SetStyle(const wchar_t* lineStyle, double drawingScale, doubl
     {
         // a standard style
         styleDef = &s_styleDefs[i];
-        lastIndex = i;
+        m_lastIndex = i;
     }
     else
     {
@@ -726,11 +726,11 @@ void LineStyleDef::SetStyle(const wchar_t* lineStyle, double drawingScale, doubl
         if (iter != s_customStyles.end())
         {
             styleDef = iter->second;
-            lastIndex = len;
+            m_lastIndex = len;
         }
         else
         {
-            lastIndex = -1;
+            m_lastIndex = -1;
         }
     }
 
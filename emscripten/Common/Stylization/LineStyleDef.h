@@ -90,7 +90,7 @@ public:
     STYLIZATION_API LineStyle FindLineStyle(const wchar_t* name);
     STYLIZATION_API void SetStyle(LineStyle lineStyle, double drawingScale, double dpi, double lineWeight);
 
-    // this method is not thread-safe
+    // custom line styles and decorations must be registered before rendering starts
     STYLIZATION_API void SetStyle(const wchar_t* lineStyle, double drawingScale, double dpi, double lineWeight);
 
     // ****************************************************************************
@@ -135,6 +135,9 @@ public:
 
 private:
     void SetStyleDef(StyleDefinition& styleDef, double drawingScale, double dpi, double lineWeight);
+
+    // the index of the last style set by name (see SetStyle)
+    int m_lastIndex;
 };
 
 #endif
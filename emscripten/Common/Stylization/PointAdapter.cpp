@@ -19,6 +19,7 @@
 #include "Renderer.h"
 #include "PointAdapter.h"
 #include "LineBuffer.h"
+#include "StylizationProfiler.h"
 #include "FeatureTypeStyleVisitor.h"
 
 
@@ -106,6 +107,8 @@ void PointAdapter::Stylize(Renderer*                   renderer,
         // clip geometry to given extents
         // NOTE: point styles do not require a clip offset
         LineBuffer* lbc = lb->Clip(renderer->GetBounds(), LineBuffer::ctAGF, m_lbPool);
+        if (m_profiler)
+            m_profiler->CountClip(lb, lbc);
         if (lbc != lb)
         {
             // if the clipped buffer is NULL (completely clipped) just move on to
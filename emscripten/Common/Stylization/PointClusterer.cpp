@@ -0,0 +1,423 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "PointClusterer.h"
+#include "SE_Renderer.h"
+#include "RS_MemoryFeatureReader.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+const wchar_t* PointClusterer::CountPropertyName = L"ClusterCount";
+
+
+// orders clusters by decreasing number of points, then by creation
+struct ClusterOrder
+{
+    ClusterOrder(const std::vector<int>& counts) : m_counts(counts) {}
+
+    bool operator()(int a, int b) const
+    {
+        if (m_counts[a] != m_counts[b])
+            return m_counts[a] > m_counts[b];
+        return a < b;
+    }
+
+    const std::vector<int>& m_counts;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+PointClusterer::PointClusterer()
+: m_cellSize(0.0),
+  m_merge(true),
+  m_geomIndex(-1),
+  m_countIndex(-1),
+  m_lb(8)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+PointClusterer::~PointClusterer()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_FeatureReader* PointClusterer::Cluster(SE_Renderer* renderer, RS_FeatureReader* features,
+                                          CSysTransformer* xformer, CancelStylization cancel, void* userData)
+{
+    if (m_cellSize <= 0.0 || renderer == NULL || features == NULL)
+        return NULL;
+
+    const wchar_t* gpName = features->GetGeomPropName();
+    if (NULL == gpName)
+        return NULL;
+
+    m_clusters.clear();
+    m_cells.clear();
+    InitProperties(features);
+
+    double px2su = renderer->GetScreenUnitsPerPixel();
+    double cellSize = m_cellSize * px2su;
+
+    while (features->ReadNext())
+    {
+    #ifndef EMSCRIPTEN
+        try
+        {
+            if (features->IsNull(gpName))
+                continue;
+
+            m_lb.Reset();
+            features->GetGeometry(gpName, &m_lb, xformer);
+        }
+        catch (FdoException* e)
+        {
+            // just move on to the next feature
+            e->Release();
+            continue;
+        }
+    #else
+        try
+        {
+            if (features->IsNull(gpName))
+                continue;
+
+            m_lb.Reset();
+            features->GetGeometry(gpName, &m_lb, xformer);
+        }
+        catch (...)
+        {
+            // just move on to the next feature
+            continue;
+        }
+    #endif
+
+        if (m_lb.point_count() == 0)
+            continue;
+
+        // multipoints are clustered by the center of their points
+        double x, y;
+        if (m_lb.geom_type() == GeometryType_Point)
+        {
+            x = m_lb.x_coord(0);
+            y = m_lb.y_coord(0);
+        }
+        else if (m_lb.geom_type() == GeometryType_MultiPoint)
+        {
+            const RS_Bounds& b = m_lb.bounds();
+            x = 0.5 * (b.minx + b.maxx);
+            y = 0.5 * (b.miny + b.maxy);
+        }
+        else
+        {
+            // not a point layer - leave it to be stylized as it is
+            features->Reset();
+            m_clusters.clear();
+            m_cells.clear();
+            m_firsts.reset();
+            m_result.reset();
+            return NULL;
+        }
+
+        double sx, sy;
+        renderer->WorldToScreenPoint(x, y, sx, sy);
+
+        int col = (int)floor(sx / cellSize);
+        int row = (int)floor(sy / cellSize);
+        unsigned long long key = ((unsigned long long)(unsigned int)row << 32) | (unsigned int)col;
+
+        std::pair<CellMap::iterator, bool> res = m_cells.insert(CellMap::value_type(key, (int)m_clusters.size()));
+        if (res.second)
+        {
+            PointCluster c;
+            c.sumx = c.sumy = 0.0;
+            c.sumsx = c.sumsy = 0.0;
+            c.count = 0;
+            c.col = col;
+            c.row = row;
+            c.merged = -1;
+            c.visited = false;
+            m_clusters.push_back(c);
+
+            // keep the attributes of the first point of the cluster
+            m_firsts->AddFeature();
+            CopyProperties(features, m_firsts.get(), m_srcTypes);
+        }
+
+        PointCluster& c = m_clusters[res.first->second];
+        c.sumx += x;
+        c.sumy += y;
+        c.sumsx += sx / px2su;
+        c.sumsy += sy / px2su;
+        ++c.count;
+
+        if (cancel && cancel(userData))
+            break;
+    }
+
+    if (m_merge)
+        Merge();
+
+    Build();
+
+    return m_result.get();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Sets up the properties of the readers of the first points and of the
+// clusters.  The features' properties are copied except for the geometry
+// and raster, decimals are stored as doubles and dates as strings, and
+// LOBs are left out.
+void PointClusterer::InitProperties(RS_FeatureReader* features)
+{
+    m_firsts.reset(new RS_MemoryFeatureReader());
+    m_result.reset(new RS_MemoryFeatureReader());
+
+    m_propNames.clear();
+    m_srcTypes.clear();
+    m_propTypes.clear();
+    m_propIndex.clear();
+
+    const wchar_t* gpName = features->GetGeomPropName();
+    const wchar_t* rpName = features->GetRasterPropName();
+
+    int identCount = 0;
+    const wchar_t* const* identNames = features->GetIdentPropNames(identCount);
+
+    int propCount = 0;
+    const wchar_t* const* propNames = features->GetPropNames(propCount);
+    for (int i=0; i<propCount; ++i)
+    {
+        const wchar_t* name = propNames[i];
+        if (wcscmp(name, gpName) == 0 || (rpName && wcscmp(name, rpName) == 0))
+            continue;
+
+        // the count replaces a property of the same name
+        if (wcscmp(name, CountPropertyName) == 0)
+            continue;
+
+        int srcType = features->GetPropertyType(name);
+        RS_MemoryFeatureReader::PropertyType type;
+        switch (srcType)
+        {
+            case RS_MemoryFeatureReader::PropertyType_Boolean:
+            case RS_MemoryFeatureReader::PropertyType_Byte:
+            case RS_MemoryFeatureReader::PropertyType_Double:
+            case RS_MemoryFeatureReader::PropertyType_Int16:
+            case RS_MemoryFeatureReader::PropertyType_Int32:
+            case RS_MemoryFeatureReader::PropertyType_Int64:
+            case RS_MemoryFeatureReader::PropertyType_Single:
+            case RS_MemoryFeatureReader::PropertyType_String:
+                type = (RS_MemoryFeatureReader::PropertyType)srcType;
+                break;
+
+            case FdoDataType_Decimal:
+                type = RS_MemoryFeatureReader::PropertyType_Double;
+                break;
+
+            case FdoDataType_DateTime:
+                type = RS_MemoryFeatureReader::PropertyType_String;
+                break;
+
+            default:
+                continue;
+        }
+
+        bool isIdentity = false;
+        for (int j=0; j<identCount; ++j)
+        {
+            if (wcscmp(name, identNames[j]) == 0)
+            {
+                isIdentity = true;
+                break;
+            }
+        }
+
+        m_propNames.push_back(name);
+        m_srcTypes.push_back(srcType);
+        m_propTypes.push_back(type);
+        m_propIndex.push_back(m_firsts->AddProperty(name, type, isIdentity));
+        m_result->AddProperty(name, type, isIdentity);
+    }
+
+    m_geomIndex = m_result->AddProperty(gpName, RS_MemoryFeatureReader::PropertyType_Geometry);
+    m_countIndex = m_result->AddProperty(CountPropertyName, RS_MemoryFeatureReader::PropertyType_Int32);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Copies the properties of the current feature of the source to the last
+// feature of the target.
+void PointClusterer::CopyProperties(RS_FeatureReader* source, RS_MemoryFeatureReader* target,
+                                    const std::vector<int>& types)
+{
+    for (size_t i=0; i<m_propNames.size(); ++i)
+    {
+        const wchar_t* name = m_propNames[i].c_str();
+        if (source->IsNull(name))
+            continue;
+
+        int prop = m_propIndex[i];
+        switch (types[i])
+        {
+            case RS_MemoryFeatureReader::PropertyType_Boolean:
+                target->SetBoolean(prop, source->GetBoolean(name));
+                break;
+
+            case RS_MemoryFeatureReader::PropertyType_Byte:
+                target->SetByte(prop, source->GetByte(name));
+                break;
+
+            case RS_MemoryFeatureReader::PropertyType_Int16:
+                target->SetInt16(prop, source->GetInt16(name));
+                break;
+
+            case RS_MemoryFeatureReader::PropertyType_Int32:
+                target->SetInt32(prop, source->GetInt32(name));
+                break;
+
+            case RS_MemoryFeatureReader::PropertyType_Int64:
+                target->SetInt64(prop, source->GetInt64(name));
+                break;
+
+            case RS_MemoryFeatureReader::PropertyType_Single:
+                target->SetSingle(prop, source->GetSingle(name));
+                break;
+
+            case RS_MemoryFeatureReader::PropertyType_Double:
+            case FdoDataType_Decimal:
+                target->SetDouble(prop, source->GetDouble(name));
+                break;
+
+            case RS_MemoryFeatureReader::PropertyType_String:
+                target->SetString(prop, source->GetString(name));
+                break;
+
+            case FdoDataType_DateTime:
+                target->SetString(prop, source->GetAsString(name));
+                break;
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int PointClusterer::FindCluster(int col, int row)
+{
+    unsigned long long key = ((unsigned long long)(unsigned int)row << 32) | (unsigned int)col;
+    CellMap::iterator iter = m_cells.find(key);
+    return (iter == m_cells.end())? -1 : iter->second;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Visits the clusters from the largest down, and merges into each the
+// clusters of the eight neighbouring cells which haven't been visited yet
+// and whose center is within a cell of its center.
+void PointClusterer::Merge()
+{
+    size_t count = m_clusters.size();
+    if (count < 2)
+        return;
+
+    std::vector<int> counts(count);
+    std::vector<int> order(count);
+    for (size_t i=0; i<count; ++i)
+    {
+        counts[i] = m_clusters[i].count;
+        order[i] = (int)i;
+    }
+
+    std::sort(order.begin(), order.end(), ClusterOrder(counts));
+
+    double maxDist2 = m_cellSize * m_cellSize;
+
+    for (size_t k=0; k<count; ++k)
+    {
+        PointCluster& c = m_clusters[order[k]];
+        c.visited = true;
+        if (c.merged >= 0)
+            continue;
+
+        for (int dr=-1; dr<=1; ++dr)
+        {
+            for (int dc=-1; dc<=1; ++dc)
+            {
+                if (dr == 0 && dc == 0)
+                    continue;
+
+                int j = FindCluster(c.col + dc, c.row + dr);
+                if (j < 0)
+                    continue;
+
+                PointCluster& n = m_clusters[j];
+                if (n.visited)
+                    continue;
+
+                double dx = c.sumsx / c.count - n.sumsx / n.count;
+                double dy = c.sumsy / c.count - n.sumsy / n.count;
+                if (dx*dx + dy*dy >= maxDist2)
+                    continue;
+
+                c.sumx += n.sumx;
+                c.sumy += n.sumy;
+                c.sumsx += n.sumsx;
+                c.sumsy += n.sumsy;
+                c.count += n.count;
+
+                n.merged = order[k];
+                n.visited = true;
+            }
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds a feature to the result for each cluster which wasn't merged.
+void PointClusterer::Build()
+{
+    // AGF point - the type and dimensionality followed by the coordinates
+    double agf[3];
+    int* ihdr = (int*)agf;
+    ihdr[0] = GeometryType_Point;
+    ihdr[1] = Dimensionality_XY;
+    double* coords = agf + 1;
+
+    m_firsts->Reset();
+    for (size_t i=0; i<m_clusters.size() && m_firsts->ReadNext(); ++i)
+    {
+        const PointCluster& c = m_clusters[i];
+        if (c.merged >= 0)
+            continue;
+
+        m_result->AddFeature();
+        CopyProperties(m_firsts.get(), m_result.get(), m_propTypes);
+
+        coords[0] = c.sumx / c.count;
+        coords[1] = c.sumy / c.count;
+        m_result->SetGeometryAgf(m_geomIndex, (unsigned char*)agf, sizeof(agf));
+        m_result->SetInt32(m_countIndex, c.count);
+    }
+
+    m_result->Reset();
+}
@@ -0,0 +1,119 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef POINTCLUSTERER_H_
+#define POINTCLUSTERER_H_
+
+#include "StylizationAPI.h"
+#include "Stylizer.h"
+#include "LineBuffer.h"
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+
+class SE_Renderer;
+class RS_FeatureReader;
+class RS_MemoryFeatureReader;
+
+
+//---------------------------------------------
+// Replaces the features of a dense point layer by clusters before they are
+// stylized, so that the cost of styling, drawing and labeling depends on
+// the number of clusters rather than the number of points.
+//
+// Points are binned into a grid of square screen cells.  A merge pass then
+// visits the clusters from the largest down, absorbing the clusters of the
+// neighbouring cells whose centers are closer than a cell, so that points
+// on either side of a cell boundary aren't split into two clusters.
+//
+// Each cluster is a feature with the attributes of its first point, a
+// point geometry at the center of its points and the number of its points
+// in the ClusterCount property, which styles and labels can use like any
+// other property.  The geometry is in mapping space.
+//---------------------------------------------
+
+class PointClusterer
+{
+public:
+    PointClusterer();
+    ~PointClusterer();
+
+    // the name of the property holding the number of points of a cluster
+    static const wchar_t* CountPropertyName;
+
+    // the size of the cells in pixels - a size of zero turns clustering off
+    inline void SetCellSize(double pixels) { m_cellSize = pixels; }
+    inline double GetCellSize() const { return m_cellSize; }
+
+    // whether clusters of neighbouring cells are merged - the default is true
+    inline void SetMerge(bool merge) { m_merge = merge; }
+
+    // Reads the features and returns a reader over their clusters, which is
+    // valid until the next call.  Returns NULL if clustering is off, there's
+    // no renderer to size the cells with, or the layer has features other
+    // than points, in which case the features are reset to be read again.
+    RS_FeatureReader* Cluster(SE_Renderer* renderer, RS_FeatureReader* features, CSysTransformer* xformer,
+                              CancelStylization cancel, void* userData);
+
+private:
+    struct PointCluster
+    {
+        double sumx;        // sum of the point positions, in mapping space
+        double sumy;
+        double sumsx;       // and in pixels
+        double sumsy;
+        int count;
+        int col;
+        int row;
+        int merged;         // the cluster this one was merged into, or -1
+        bool visited;
+    };
+
+    typedef std::map<unsigned long long, int> CellMap;
+
+    void InitProperties(RS_FeatureReader* features);
+    void Merge();
+    void Build();
+    void CopyProperties(RS_FeatureReader* source, RS_MemoryFeatureReader* target, const std::vector<int>& types);
+    int FindCluster(int col, int row);
+
+    double m_cellSize;
+    bool m_merge;
+
+    // the clusters, and the cluster of each cell
+    std::vector<PointCluster> m_clusters;
+    CellMap m_cells;
+
+    // the first point of each cluster, in the order the clusters were
+    // created, and the clusters which are the result
+    std::auto_ptr<RS_MemoryFeatureReader> m_firsts;
+    std::auto_ptr<RS_MemoryFeatureReader> m_result;
+
+    // the copied properties - their names, their types in the features and
+    // in the readers above, and their indexes in those readers
+    std::vector<std::wstring> m_propNames;
+    std::vector<int> m_srcTypes;
+    std::vector<int> m_propTypes;
+    std::vector<int> m_propIndex;
+    int m_geomIndex;
+    int m_countIndex;
+
+    LineBuffer m_lb;
+};
+
+#endif
@@ -19,6 +19,7 @@
 #include "Renderer.h"
 #include "PolygonAdapter.h"
 #include "LineBuffer.h"
+#include "StylizationProfiler.h"
 #include "FeatureTypeStyleVisitor.h"
 
 
@@ -147,6 +148,8 @@ void PolygonAdapter::Stylize(Renderer*                   renderer,
 
         // clip geometry to given extents
         LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_lbPool);
+        if (m_profiler)
+            m_profiler->CountClip(lb, lbc);
         if (lbc != lb)
         {
             // if the clipped buffer is NULL (completely clipped) just move on to
@@ -211,6 +214,8 @@ void PolygonAdapter::Stylize(Renderer*                   renderer,
             clip.maxy += clipOffsetWU;
 
             LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_lbPool);
+            if (m_profiler)
+                m_profiler->CountClip(lb, lbc);
             if (lbc != lb)
             {
                 // if the clipped buffer is NULL (completely clipped) just move on to
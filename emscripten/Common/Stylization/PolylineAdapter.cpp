@@ -19,6 +19,7 @@
 #include "Renderer.h"
 #include "PolylineAdapter.h"
 #include "LineBuffer.h"
+#include "StylizationProfiler.h"
 #include "FeatureTypeStyleVisitor.h"
 
 
@@ -199,6 +200,8 @@ void PolylineAdapter::Stylize(Renderer*                   renderer,
 
         // clip geometry to given extents
         LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_lbPool);
+        if (m_profiler)
+            m_profiler->CountClip(lb, lbc);
         if (lbc != lb)
         {
             // if the clipped buffer is NULL (completely clipped) just move on to
@@ -267,6 +270,8 @@ void PolylineAdapter::Stylize(Renderer*                   renderer,
             clip.maxy += clipOffsetWU;
 
             LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_lbPool);
+            if (m_profiler)
+                m_profiler->CountClip(lb, lbc);
             if (lbc != lb)
             {
                 // if the clipped buffer is NULL (completely clipped) just move on to
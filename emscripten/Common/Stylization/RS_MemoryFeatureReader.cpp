@@ -0,0 +1,973 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "RS_MemoryFeatureReader.h"
+#include "RS_BufferOutputStream.h"
+
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// The file layout is a header followed by each property in turn.  All
+// values are in the byte order of the writer, and every section starts on
+// an 8 byte boundary so that the value arrays can be used in place.
+//
+//   header:    "RSMF", byte order mark, version, feature count,
+//              property count, geometry property index     (6 x 4 bytes)
+//   property:  type, identity flag, name length            (3 x 4 bytes)
+//              name                                        (32 bit units)
+//              null bitmap                                 (1 bit / feature)
+//   fixed size types:
+//              values                                      (n x value size)
+//   strings and geometry:
+//              offsets                                     ((n+1) x 8 bytes)
+//              string units or AGF bytes
+//
+// String offsets count 32 bit units, and geometry offsets count bytes.
+
+static const unsigned char RSMF_MAGIC[4] = { 'R', 'S', 'M', 'F' };
+static const unsigned int RSMF_BYTEORDER = 0x01020304;
+static const unsigned int RSMF_VERSION = 1;
+
+static inline size_t Align8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MemoryFeatureReader::RS_MemoryFeatureReader()
+: m_geomProp(-1)
+, m_featureCount(0)
+, m_row(-1)
+, m_lastIndex(-1)
+, m_mapped(NULL)
+, m_mappedLength(0)
+{
+    m_asString[0] = 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MemoryFeatureReader::~RS_MemoryFeatureReader()
+{
+    Clear();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::Clear()
+{
+    for (size_t i=0; i<m_props.size(); ++i)
+        delete m_props[i];
+    m_props.clear();
+    m_propNames.clear();
+    m_identNames.clear();
+
+    m_geomProp = -1;
+    m_featureCount = 0;
+    m_row = -1;
+    m_lastIndex = -1;
+
+    UnmapFile();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+size_t RS_MemoryFeatureReader::ValueSize(PropertyType type)
+{
+    switch (type)
+    {
+        case PropertyType_Boolean:
+        case PropertyType_Byte:
+            return 1;
+        case PropertyType_Int16:
+            return 2;
+        case PropertyType_Int32:
+        case PropertyType_Single:
+            return 4;
+        case PropertyType_Int64:
+        case PropertyType_Double:
+            return 8;
+        default:
+            // variable length
+            return 0;
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::UpdateNames()
+{
+    m_propNames.clear();
+    m_identNames.clear();
+
+    for (size_t i=0; i<m_props.size(); ++i)
+    {
+        m_propNames.push_back(m_props[i]->name.c_str());
+        if (m_props[i]->isIdentity)
+            m_identNames.push_back(m_props[i]->name.c_str());
+    }
+
+    m_lastIndex = -1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Points the column at its storage, which may have been reallocated.
+void RS_MemoryFeatureReader::UpdatePointers(Property* prop)
+{
+    prop->nulls = prop->nullStore.empty()? NULL : &prop->nullStore[0];
+    prop->values = prop->valueStore.empty()? NULL : &prop->valueStore[0];
+    prop->offsets = prop->offsetStore.empty()? NULL : &prop->offsetStore[0];
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int RS_MemoryFeatureReader::AddProperty(const wchar_t* name, PropertyType type, bool isIdentity)
+{
+    // loaded feature sets are read only
+    _ASSERT(m_mapped == NULL);
+    if (m_mapped || name == NULL)
+        return -1;
+
+    Property* prop = new Property();
+    prop->name = name;
+    prop->type = type;
+    prop->isIdentity = isIdentity;
+
+    // the existing features are null
+    prop->nullStore.resize((m_featureCount + 7) / 8, 0xff);
+
+    size_t size = ValueSize(type);
+    if (size > 0)
+        prop->valueStore.resize(m_featureCount * size, 0);
+    else
+        prop->offsetStore.resize(m_featureCount + 1, 0);
+
+    UpdatePointers(prop);
+    m_props.push_back(prop);
+
+    int index = (int)m_props.size() - 1;
+    if (type == PropertyType_Geometry && m_geomProp < 0)
+        m_geomProp = index;
+
+    UpdateNames();
+    return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int RS_MemoryFeatureReader::AddFeature()
+{
+    _ASSERT(m_mapped == NULL);
+    if (m_mapped)
+        return -1;
+
+    int row = m_featureCount++;
+
+    for (size_t i=0; i<m_props.size(); ++i)
+    {
+        Property* prop = m_props[i];
+
+        if ((row & 7) == 0)
+            prop->nullStore.push_back(0);
+        prop->nullStore[row >> 3] |= (unsigned char)(1 << (row & 7));
+
+        size_t size = ValueSize(prop->type);
+        if (size > 0)
+        {
+            prop->valueStore.resize(prop->valueStore.size() + size, 0);
+        }
+        else
+        {
+            unsigned long long end = prop->offsetStore.back();
+            prop->offsetStore.push_back(end);
+        }
+
+        UpdatePointers(prop);
+    }
+
+    return row;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Marks the value of the last feature as set, and returns the property.
+RS_MemoryFeatureReader::Property* RS_MemoryFeatureReader::SetValue(int prop, PropertyType type)
+{
+    if (prop < 0 || prop >= (int)m_props.size() || m_featureCount == 0 || m_mapped)
+    {
+        _ASSERT(false);
+        return NULL;
+    }
+
+    Property* p = m_props[prop];
+    _ASSERT(p->type == type);
+    if (p->type != type)
+        return NULL;
+
+    int row = m_featureCount - 1;
+    p->nullStore[row >> 3] &= (unsigned char)~(1 << (row & 7));
+    return p;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetFixed(int prop, PropertyType type, const void* value)
+{
+    Property* p = SetValue(prop, type);
+    if (p)
+    {
+        size_t size = ValueSize(type);
+        memcpy(&p->valueStore[(m_featureCount - 1) * size], value, size);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetBoolean(int prop, bool value)
+{
+    unsigned char b = value? 1 : 0;
+    SetFixed(prop, PropertyType_Boolean, &b);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetByte(int prop, unsigned char value)
+{
+    SetFixed(prop, PropertyType_Byte, &value);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetInt16(int prop, short value)
+{
+    SetFixed(prop, PropertyType_Int16, &value);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetInt32(int prop, int value)
+{
+    SetFixed(prop, PropertyType_Int32, &value);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetInt64(int prop, long long value)
+{
+    SetFixed(prop, PropertyType_Int64, &value);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetSingle(int prop, float value)
+{
+    SetFixed(prop, PropertyType_Single, &value);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetDouble(int prop, double value)
+{
+    SetFixed(prop, PropertyType_Double, &value);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetString(int prop, const wchar_t* value)
+{
+    if (value == NULL)
+        return;
+
+    Property* p = SetValue(prop, PropertyType_String);
+    if (p == NULL)
+        return;
+
+    // replace any value already set for the last feature
+    p->chars.resize((size_t)p->offsetStore[m_featureCount - 1]);
+    p->chars.insert(p->chars.end(), value, value + wcslen(value) + 1);
+    p->offsetStore[m_featureCount] = p->chars.size();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetPacked(Property* p, const void* data, size_t length)
+{
+    // replace any value already set for the last feature
+    p->valueStore.resize((size_t)p->offsetStore[m_featureCount - 1]);
+    p->valueStore.insert(p->valueStore.end(), (const unsigned char*)data, (const unsigned char*)data + length);
+    p->offsetStore[m_featureCount] = p->valueStore.size();
+    UpdatePointers(p);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetGeometryAgf(int prop, const unsigned char* agf, size_t length)
+{
+    if (agf == NULL)
+        return;
+
+    Property* p = SetValue(prop, PropertyType_Geometry);
+    if (p)
+        SetPacked(p, agf, length);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::SetGeometry(int prop, LineBuffer* geometry)
+{
+    if (geometry == NULL)
+        return;
+
+    RS_BufferOutputStream agf(256);
+    geometry->ToAgf(&agf);
+    SetGeometryAgf(prop, agf.data(), agf.length());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int RS_MemoryFeatureReader::GetPropertyIndex(const wchar_t* name)
+{
+    if (name == NULL)
+        return -1;
+
+    // the stylizers tend to ask for the same property repeatedly
+    if (m_lastIndex >= 0 && wcscmp(m_props[m_lastIndex]->name.c_str(), name) == 0)
+        return m_lastIndex;
+
+    for (size_t i=0; i<m_props.size(); ++i)
+    {
+        if (wcscmp(m_props[i]->name.c_str(), name) == 0)
+        {
+            m_lastIndex = (int)i;
+            return m_lastIndex;
+        }
+    }
+
+    return -1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool RS_MemoryFeatureReader::Save(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+
+    static const unsigned char zeros[8] = { 0 };
+    bool ok = true;
+
+    #define WRITE(data, len) ok = ok && (fwrite((data), 1, (len), file) == (size_t)(len))
+    #define PAD(len) WRITE(zeros, Align8(len) - (len))
+
+    unsigned int header[6];
+    memcpy(&header[0], RSMF_MAGIC, 4);
+    header[1] = RSMF_BYTEORDER;
+    header[2] = RSMF_VERSION;
+    header[3] = (unsigned int)m_featureCount;
+    header[4] = (unsigned int)m_props.size();
+    header[5] = (unsigned int)m_geomProp;
+    WRITE(header, sizeof(header));
+
+    std::vector<unsigned int> units;
+    std::vector<unsigned long long> offsets;
+
+    for (size_t i=0; i<m_props.size() && ok; ++i)
+    {
+        Property* prop = m_props[i];
+
+        units.assign(prop->name.begin(), prop->name.end());
+        unsigned int info[3] = { (unsigned int)prop->type, prop->isIdentity? 1u : 0u, (unsigned int)units.size() };
+        WRITE(info, sizeof(info));
+        if (!units.empty())
+            WRITE(&units[0], units.size() * 4);
+        PAD(sizeof(info) + units.size() * 4);
+
+        size_t nullBytes = (m_featureCount + 7) / 8;
+        if (nullBytes > 0)
+            WRITE(prop->nulls, nullBytes);
+        PAD(nullBytes);
+
+        size_t size = ValueSize(prop->type);
+        if (size > 0)
+        {
+            size_t len = m_featureCount * size;
+            if (len > 0)
+                WRITE(prop->values, len);
+            PAD(len);
+        }
+        else if (prop->type == PropertyType_String)
+        {
+            // wide characters are written as 32 bit units, without the
+            // terminators
+            units.clear();
+            offsets.resize(m_featureCount + 1);
+            offsets[0] = 0;
+            for (int j=0; j<m_featureCount; ++j)
+            {
+                unsigned long long start = prop->offsets[j];
+                unsigned long long end = prop->offsets[j+1];
+                if (end > start)
+                    units.insert(units.end(), prop->chars.begin() + (size_t)start, prop->chars.begin() + (size_t)end - 1);
+                offsets[j+1] = units.size();
+            }
+
+            WRITE(&offsets[0], offsets.size() * 8);
+            if (!units.empty())
+                WRITE(&units[0], units.size() * 4);
+            PAD(units.size() * 4);
+        }
+        else
+        {
+            size_t len = (size_t)prop->offsets[m_featureCount];
+            WRITE(prop->offsets, (m_featureCount + 1) * 8);
+            if (len > 0)
+                WRITE(prop->values, len);
+            PAD(len);
+        }
+    }
+
+    #undef PAD
+    #undef WRITE
+
+    if (fclose(file) != 0)
+        ok = false;
+
+    return ok;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool RS_MemoryFeatureReader::Load(const char* path)
+{
+    Clear();
+
+    if (!MapFile(path))
+        return false;
+
+    if (!LoadMapped())
+    {
+        Clear();
+        return false;
+    }
+
+    UpdateNames();
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Returns the next section of the mapped file, or NULL if the file is too
+// short.  Sections are padded to a multiple of 8 bytes.
+static const unsigned char* TakeSection(const unsigned char*& pos, const unsigned char* end, size_t len)
+{
+    if ((size_t)(end - pos) < len)
+        return NULL;
+
+    const unsigned char* section = pos;
+    pos += rs_min(Align8(len), (size_t)(end - pos));
+    return section;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool RS_MemoryFeatureReader::LoadMapped()
+{
+    const unsigned char* pos = m_mapped;
+    const unsigned char* end = m_mapped + m_mappedLength;
+
+    const unsigned int* header = (const unsigned int*)TakeSection(pos, end, 24);
+    if (header == NULL || memcmp(header, RSMF_MAGIC, 4) != 0 ||
+        header[1] != RSMF_BYTEORDER || header[2] != RSMF_VERSION)
+        return false;
+
+    m_featureCount = (int)header[3];
+    int propCount = (int)header[4];
+    m_geomProp = (int)header[5];
+    if (m_featureCount < 0 || propCount < 0 || m_geomProp >= propCount)
+        return false;
+
+    size_t n = (size_t)m_featureCount;
+
+    for (int i=0; i<propCount; ++i)
+    {
+        Property* prop = new Property();
+        m_props.push_back(prop);
+
+        // the type, identity flag and name length, followed by the name
+        if (end - pos < 12)
+            return false;
+        const unsigned int* info = (const unsigned int*)pos;
+        if (info[2] > (size_t)(end - pos) / 4 || TakeSection(pos, end, 12 + (size_t)info[2] * 4) == NULL)
+            return false;
+
+        prop->type = (PropertyType)(int)info[0];
+        prop->isIdentity = (info[1] != 0);
+        prop->name.assign(info + 3, info + 3 + info[2]);
+
+        prop->nulls = TakeSection(pos, end, (n + 7) / 8);
+        if (prop->nulls == NULL)
+            return false;
+
+        size_t size = ValueSize(prop->type);
+        if (size > 0)
+        {
+            prop->values = TakeSection(pos, end, n * size);
+            if (prop->values == NULL)
+                return false;
+        }
+        else if (prop->type == PropertyType_String || prop->type == PropertyType_Geometry)
+        {
+            const unsigned long long* offsets = (const unsigned long long*)TakeSection(pos, end, (n + 1) * 8);
+            if (offsets == NULL)
+                return false;
+
+            // the offsets must increase, and fit in the file
+            unsigned long long total = offsets[n];
+            for (size_t j=0; j<n; ++j)
+            {
+                if (offsets[j] > offsets[j+1])
+                    return false;
+            }
+
+            size_t unitSize = (prop->type == PropertyType_String)? 4 : 1;
+            if (total > (unsigned long long)(end - pos) / unitSize)
+                return false;
+
+            const unsigned char* data = TakeSection(pos, end, (size_t)total * unitSize);
+            if (data == NULL)
+                return false;
+
+            if (prop->type == PropertyType_String)
+            {
+                // convert to null terminated wide characters
+                const unsigned int* units = (const unsigned int*)data;
+                prop->chars.reserve((size_t)total + n);
+                prop->offsetStore.resize(n + 1);
+                prop->offsetStore[0] = 0;
+                for (size_t j=0; j<n; ++j)
+                {
+                    prop->chars.insert(prop->chars.end(), units + offsets[j], units + offsets[j+1]);
+                    prop->chars.push_back(0);
+                    prop->offsetStore[j+1] = prop->chars.size();
+                }
+                prop->offsets = &prop->offsetStore[0];
+            }
+            else
+            {
+                prop->offsets = offsets;
+                prop->values = data;
+            }
+        }
+        else
+        {
+            // unknown property type
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool RS_MemoryFeatureReader::MapFile(const char* path)
+{
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE hMapping = NULL;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0)
+        hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (hMapping == NULL)
+        return false;
+
+    // the view keeps the mapping open
+    void* view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (view == NULL)
+        return false;
+
+    m_mapped = (const unsigned char*)view;
+    m_mappedLength = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    m_mapped = (const unsigned char*)view;
+    m_mappedLength = (size_t)st.st_size;
+#endif
+
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::UnmapFile()
+{
+    if (m_mapped == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_mapped);
+#else
+    munmap((void*)m_mapped, m_mappedLength);
+#endif
+
+    m_mapped = NULL;
+    m_mappedLength = 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool RS_MemoryFeatureReader::ReadNext()
+{
+    if (m_row >= m_featureCount - 1)
+    {
+        m_row = m_featureCount;
+        return false;
+    }
+
+    ++m_row;
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::Close()
+{
+    m_row = m_featureCount;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_MemoryFeatureReader::Reset()
+{
+    m_row = -1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Returns the named property if the current feature has a value for it.
+RS_MemoryFeatureReader::Property* RS_MemoryFeatureReader::GetCurrentValue(const wchar_t* propertyName)
+{
+    if (m_row < 0 || m_row >= m_featureCount)
+        return NULL;
+
+    int index = GetPropertyIndex(propertyName);
+    if (index < 0)
+        return NULL;
+
+    Property* prop = m_props[index];
+    if (prop->nulls[m_row >> 3] & (1 << (m_row & 7)))
+        return NULL;
+
+    return prop;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double RS_MemoryFeatureReader::GetNumber(Property* prop)
+{
+    if (prop == NULL)
+        return 0.0;
+
+    const unsigned char* src = prop->values + m_row * ValueSize(prop->type);
+    switch (prop->type)
+    {
+        case PropertyType_Single:
+        {
+            float f;
+            memcpy(&f, src, sizeof(f));
+            return f;
+        }
+
+        case PropertyType_Double:
+        {
+            double d;
+            memcpy(&d, src, sizeof(d));
+            return d;
+        }
+
+        case PropertyType_String:
+            return wcstod(&prop->chars[(size_t)prop->offsets[m_row]], NULL);
+
+        default:
+            return (double)GetInteger(prop);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+long long RS_MemoryFeatureReader::GetInteger(Property* prop)
+{
+    if (prop == NULL)
+        return 0;
+
+    const unsigned char* src = prop->values + m_row * ValueSize(prop->type);
+    switch (prop->type)
+    {
+        case PropertyType_Boolean:
+        case PropertyType_Byte:
+            return *src;
+
+        case PropertyType_Int16:
+        {
+            short s;
+            memcpy(&s, src, sizeof(s));
+            return s;
+        }
+
+        case PropertyType_Int32:
+        {
+            int i;
+            memcpy(&i, src, sizeof(i));
+            return i;
+        }
+
+        case PropertyType_Int64:
+        {
+            long long ll;
+            memcpy(&ll, src, sizeof(ll));
+            return ll;
+        }
+
+        case PropertyType_Single:
+        case PropertyType_Double:
+        case PropertyType_String:
+            return (long long)GetNumber(prop);
+
+        default:
+            return 0;
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool RS_MemoryFeatureReader::IsNull(const wchar_t* propertyName)
+{
+    return GetCurrentValue(propertyName) == NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool RS_MemoryFeatureReader::GetBoolean(const wchar_t* propertyName)
+{
+    return GetInteger(GetCurrentValue(propertyName)) != 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+unsigned char RS_MemoryFeatureReader::GetByte(const wchar_t* propertyName)
+{
+    return (unsigned char)GetInteger(GetCurrentValue(propertyName));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+FdoDateTime RS_MemoryFeatureReader::GetDateTime(const wchar_t* /*propertyName*/)
+{
+    return FdoDateTime();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+float RS_MemoryFeatureReader::GetSingle(const wchar_t* propertyName)
+{
+    return (float)GetNumber(GetCurrentValue(propertyName));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double RS_MemoryFeatureReader::GetDouble(const wchar_t* propertyName)
+{
+    return GetNumber(GetCurrentValue(propertyName));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+short RS_MemoryFeatureReader::GetInt16(const wchar_t* propertyName)
+{
+    return (short)GetInteger(GetCurrentValue(propertyName));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int RS_MemoryFeatureReader::GetInt32(const wchar_t* propertyName)
+{
+    return (int)GetInteger(GetCurrentValue(propertyName));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+long long RS_MemoryFeatureReader::GetInt64(const wchar_t* propertyName)
+{
+    return GetInteger(GetCurrentValue(propertyName));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+const wchar_t* RS_MemoryFeatureReader::GetString(const wchar_t* propertyName)
+{
+    Property* prop = GetCurrentValue(propertyName);
+    if (prop == NULL)
+        return NULL;
+
+    if (prop->type != PropertyType_String)
+        return GetAsString(propertyName);
+
+    return &prop->chars[(size_t)prop->offsets[m_row]];
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+LineBuffer* RS_MemoryFeatureReader::GetGeometry(const wchar_t* propertyName, LineBuffer* lb, CSysTransformer* xformer)
+{
+    Property* prop = GetCurrentValue(propertyName);
+    if (prop == NULL || prop->type != PropertyType_Geometry || lb == NULL)
+        return NULL;
+
+    // the AGF is read in place
+    unsigned long long start = prop->offsets[m_row];
+    unsigned long long end = prop->offsets[m_row+1];
+    lb->LoadFromAgf(const_cast<unsigned char*>(prop->values + start), (int)(end - start), xformer);
+
+    return lb;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_Raster* RS_MemoryFeatureReader::GetRaster(const wchar_t* /*propertyName*/)
+{
+    return NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+const wchar_t* RS_MemoryFeatureReader::GetAsString(const wchar_t* propertyName)
+{
+    Property* prop = GetCurrentValue(propertyName);
+    if (prop == NULL)
+        return L"";
+
+    switch (prop->type)
+    {
+        case PropertyType_String:
+            return &prop->chars[(size_t)prop->offsets[m_row]];
+
+        case PropertyType_Boolean:
+            return GetInteger(prop)? L"true" : L"false";
+
+        case PropertyType_Single:
+        case PropertyType_Double:
+            swprintf(m_asString, 64, L"%.15g", GetNumber(prop));
+            break;
+
+        case PropertyType_Geometry:
+            return L"";
+
+        default:
+            swprintf(m_asString, 64, L"%lld", GetInteger(prop));
+            break;
+    }
+
+    return m_asString;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_InputStream* RS_MemoryFeatureReader::GetBLOB(const wchar_t* /*propertyName*/)
+{
+    return NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_InputStream* RS_MemoryFeatureReader::GetCLOB(const wchar_t* /*propertyName*/)
+{
+    return NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int RS_MemoryFeatureReader::GetPropertyType(const wchar_t* propertyName)
+{
+    int index = GetPropertyIndex(propertyName);
+    return (index < 0)? -1 : (int)m_props[index]->type;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+const wchar_t* RS_MemoryFeatureReader::GetGeomPropName()
+{
+    return (m_geomProp < 0)? NULL : m_props[m_geomProp]->name.c_str();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+const wchar_t* RS_MemoryFeatureReader::GetRasterPropName()
+{
+    return NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+const wchar_t* const* RS_MemoryFeatureReader::GetIdentPropNames(int& count)
+{
+    count = (int)m_identNames.size();
+    return m_identNames.empty()? NULL : &m_identNames[0];
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+const wchar_t* const* RS_MemoryFeatureReader::GetPropNames(int& count)
+{
+    count = (int)m_propNames.size();
+    return m_propNames.empty()? NULL : &m_propNames[0];
+}
+
+
+#ifndef EMSCRIPTEN
+//////////////////////////////////////////////////////////////////////////////
+FdoIFeatureReader* RS_MemoryFeatureReader::GetInternalReader()
+{
+    return NULL;
+}
+#endif
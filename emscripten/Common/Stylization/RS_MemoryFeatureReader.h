@@ -0,0 +1,187 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef RS_MEMORYFEATUREREADER_H_
+#define RS_MEMORYFEATUREREADER_H_
+
+#include "StylizationAPI.h"
+#include "RS_FeatureReader.h"
+#include <vector>
+#include <string>
+
+
+//---------------------------------------------
+// Feature reader over an in-memory feature set, for driving the stylizers
+// without a feature source.  Each property is stored as a column: a null
+// bitmap plus a typed value array, with strings and AGF geometry packed
+// into a single buffer per column.
+//
+// A feature set is either built in memory using AddProperty / AddFeature
+// and the Set methods, or loaded from a file written by Save.  Loaded files
+// are memory mapped, and the value arrays and geometry are read in place.
+//
+// Property types are reported using the FdoDataType values.  Supported
+// types are Boolean, Byte, Int16, Int32, Int64, Single, Double, String
+// and geometry.
+//---------------------------------------------
+
+class RS_MemoryFeatureReader : public RS_FeatureReader
+{
+public:
+    enum PropertyType
+    {
+        PropertyType_Geometry = -1,
+        PropertyType_Boolean  = 0,
+        PropertyType_Byte     = 1,
+        PropertyType_Double   = 4,
+        PropertyType_Int16    = 5,
+        PropertyType_Int32    = 6,
+        PropertyType_Int64    = 7,
+        PropertyType_Single   = 8,
+        PropertyType_String   = 9
+    };
+
+    STYLIZATION_API RS_MemoryFeatureReader();
+    STYLIZATION_API virtual ~RS_MemoryFeatureReader();
+
+    ///////////////////////////////////
+    // building
+
+    // Adds a property and returns its index.  Features which already
+    // exist have a null value for the new property.
+    STYLIZATION_API int AddProperty(const wchar_t* name, PropertyType type, bool isIdentity = false);
+
+    // Adds a feature with all its properties null, and returns its index.
+    // The Set methods apply to the last feature added.
+    STYLIZATION_API int AddFeature();
+
+    STYLIZATION_API void SetBoolean(int prop, bool value);
+    STYLIZATION_API void SetByte(int prop, unsigned char value);
+    STYLIZATION_API void SetInt16(int prop, short value);
+    STYLIZATION_API void SetInt32(int prop, int value);
+    STYLIZATION_API void SetInt64(int prop, long long value);
+    STYLIZATION_API void SetSingle(int prop, float value);
+    STYLIZATION_API void SetDouble(int prop, double value);
+    STYLIZATION_API void SetString(int prop, const wchar_t* value);
+    STYLIZATION_API void SetGeometry(int prop, LineBuffer* geometry);
+    STYLIZATION_API void SetGeometryAgf(int prop, const unsigned char* agf, size_t length);
+
+    inline int GetFeatureCount() const { return m_featureCount; }
+    inline int GetPropertyCount() const { return (int)m_props.size(); }
+
+    // returns the index of the named property, or -1 if there isn't one
+    STYLIZATION_API int GetPropertyIndex(const wchar_t* name);
+
+    ///////////////////////////////////
+    // persistence
+
+    // Writes the feature set to a file, returning false on failure.
+    STYLIZATION_API bool Save(const char* path);
+
+    // Replaces the feature set with the one in the supplied file.  Returns
+    // false if the file can't be read or isn't a feature set file.
+    STYLIZATION_API bool Load(const char* path);
+
+    ///////////////////////////////////
+    // RS_FeatureReader implementation
+
+    STYLIZATION_API virtual bool ReadNext();
+    STYLIZATION_API virtual void Close();
+    STYLIZATION_API virtual void Reset();
+
+    STYLIZATION_API virtual bool            IsNull         (const wchar_t* propertyName);
+    STYLIZATION_API virtual bool            GetBoolean     (const wchar_t* propertyName);
+    STYLIZATION_API virtual unsigned char   GetByte        (const wchar_t* propertyName);
+    STYLIZATION_API virtual FdoDateTime     GetDateTime    (const wchar_t* propertyName);
+    STYLIZATION_API virtual float           GetSingle      (const wchar_t* propertyName);
+    STYLIZATION_API virtual double          GetDouble      (const wchar_t* propertyName);
+    STYLIZATION_API virtual short           GetInt16       (const wchar_t* propertyName);
+    STYLIZATION_API virtual int             GetInt32       (const wchar_t* propertyName);
+    STYLIZATION_API virtual long long       GetInt64       (const wchar_t* propertyName);
+    STYLIZATION_API virtual const wchar_t*  GetString      (const wchar_t* propertyName);
+    STYLIZATION_API virtual LineBuffer*     GetGeometry    (const wchar_t* propertyName, LineBuffer* lb, CSysTransformer* xformer);
+    STYLIZATION_API virtual RS_Raster*      GetRaster      (const wchar_t* propertyName);
+    STYLIZATION_API virtual const wchar_t*  GetAsString    (const wchar_t* propertyName);
+    STYLIZATION_API virtual RS_InputStream* GetBLOB        (const wchar_t* propertyName);
+    STYLIZATION_API virtual RS_InputStream* GetCLOB        (const wchar_t* propertyName);
+    STYLIZATION_API virtual int             GetPropertyType(const wchar_t* propertyName);
+
+    STYLIZATION_API virtual const wchar_t*        GetGeomPropName  ();
+    STYLIZATION_API virtual const wchar_t*        GetRasterPropName();
+    STYLIZATION_API virtual const wchar_t* const* GetIdentPropNames(int& count);
+    STYLIZATION_API virtual const wchar_t* const* GetPropNames     (int& count);
+
+#ifndef EMSCRIPTEN
+    STYLIZATION_API virtual FdoIFeatureReader* GetInternalReader();
+#endif
+
+private:
+    struct Property
+    {
+        std::wstring name;
+        PropertyType type;
+        bool isIdentity;
+
+        // the column data - these point either into the storage below or
+        // into the mapped file
+        const unsigned char* nulls;
+        const unsigned char* values;
+        const unsigned long long* offsets;
+
+        // storage for columns built in memory
+        std::vector<unsigned char> nullStore;
+        std::vector<unsigned char> valueStore;
+        std::vector<unsigned long long> offsetStore;
+
+        // strings are always held as null terminated wide character
+        // strings, indexed by the offsets
+        std::vector<wchar_t> chars;
+    };
+
+    void Clear();
+    void UpdateNames();
+    void UpdatePointers(Property* prop);
+    Property* GetCurrentValue(const wchar_t* propertyName);
+    double GetNumber(Property* prop);
+    long long GetInteger(Property* prop);
+    Property* SetValue(int prop, PropertyType type);
+    void SetFixed(int prop, PropertyType type, const void* value);
+    void SetPacked(Property* prop, const void* data, size_t length);
+    bool LoadMapped();
+    bool MapFile(const char* path);
+    void UnmapFile();
+
+    static size_t ValueSize(PropertyType type);
+
+    std::vector<Property*> m_props;
+    std::vector<const wchar_t*> m_propNames;
+    std::vector<const wchar_t*> m_identNames;
+    int m_geomProp;
+    int m_featureCount;
+    int m_row;
+
+    // the last property looked up by name
+    int m_lastIndex;
+
+    // the mapped file, if the features were loaded
+    const unsigned char* m_mapped;
+    size_t m_mappedLength;
+
+    wchar_t m_asString[64];
+};
+
+#endif
@@ -53,3 +53,19 @@ RS_TextMetrics::~RS_TextMetrics()
 
 
 
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_TextMetrics::Swap(RS_TextMetrics& other)
+{
+    std::swap(font, other.font);
+    std::swap(font_height, other.font_height);
+    std::swap(text_width, other.text_width);
+    std::swap(text_height, other.text_height);
+    text.swap(other.text);
+    char_advances.swap(other.char_advances);
+    char_pos.swap(other.char_pos);
+    line_pos.swap(other.line_pos);
+    line_breaks.swap(other.line_breaks);
+    format_changes.swap(other.format_changes);
+}
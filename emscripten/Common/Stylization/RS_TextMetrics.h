@@ -49,6 +49,10 @@ public:
     STYLIZATION_API RS_TextMetrics();
     STYLIZATION_API ~RS_TextMetrics();
 
+    // exchanges the metrics with another - this also passes on the ownership
+    // of the format changes, which the metrics delete
+    STYLIZATION_API void Swap(RS_TextMetrics& other);
+
     // note that this value is NULL if RS_TextMetrics is uninitialized or invalid
     const RS_Font* font;
 
@@ -0,0 +1,423 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "RS_WorkloadGenerator.h"
+
+static const wchar_t* ROAD_CLASSES[] = { L"residential", L"secondary", L"primary", L"highway" };
+static const int ROAD_LANES[] = { 1, 2, 4, 6 };
+static const double ROAD_SPEEDS[] = { 30.0, 50.0, 70.0, 110.0 };
+static const double ROAD_LENGTHS[] = { 0.02, 0.05, 0.15, 0.4 };   // fraction of the extents
+
+static const wchar_t* ZONES[] = { L"R1", L"R2", L"C1", L"R3", L"C2", L"I1", L"P", L"A" };
+static const wchar_t* CATEGORIES[] = { L"restaurant", L"shop", L"school", L"bank", L"fuel", L"hotel",
+                                       L"pharmacy", L"museum", L"hospital", L"library", L"stadium", L"airport" };
+
+#define COUNTOF(a) ((int)(sizeof(a) / sizeof(a[0])))
+
+
+//////////////////////////////////////////////////////////////////////////////
+// AGF writing
+static void PutInt(std::vector<unsigned char>& agf, int value)
+{
+    const unsigned char* src = (const unsigned char*)&value;
+    agf.insert(agf.end(), src, src + sizeof(value));
+}
+
+
+static void PutDouble(std::vector<unsigned char>& agf, double value)
+{
+    const unsigned char* src = (const unsigned char*)&value;
+    agf.insert(agf.end(), src, src + sizeof(value));
+}
+
+
+static void PutPoints(std::vector<unsigned char>& agf, const std::vector<RS_F_Point>& pts)
+{
+    PutInt(agf, (int)pts.size());
+    for (size_t i=0; i<pts.size(); ++i)
+    {
+        PutDouble(agf, pts[i].x);
+        PutDouble(agf, pts[i].y);
+    }
+}
+
+
+// the area of a closed ring, positive if counterclockwise
+static double RingArea(const std::vector<RS_F_Point>& pts)
+{
+    double area = 0.0;
+    for (size_t i=0, j=pts.size()-1; i<pts.size(); j=i++)
+        area += pts[j].x * pts[i].y - pts[i].x * pts[j].y;
+    return 0.5 * area;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_WorkloadGenerator::RS_WorkloadGenerator(const RS_Bounds& extents, unsigned int seed)
+: m_extents(extents)
+{
+    // avoid the all zero state
+    m_state = 0x9e3779b97f4a7c15ULL ^ seed;
+
+    // a few towns, kept away from the edges
+    int numTowns = 4 + (int)(NextUInt() % 5);
+    for (int i=0; i<numTowns; ++i)
+    {
+        double x = m_extents.minx + (0.1 + 0.8 * NextDouble()) * m_extents.width();
+        double y = m_extents.miny + (0.1 + 0.8 * NextDouble()) * m_extents.height();
+        m_towns.push_back(RS_F_Point(x, y));
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_WorkloadGenerator::~RS_WorkloadGenerator()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// xorshift64*
+unsigned int RS_WorkloadGenerator::NextUInt()
+{
+    m_state ^= m_state >> 12;
+    m_state ^= m_state << 25;
+    m_state ^= m_state >> 27;
+    return (unsigned int)((m_state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// uniform in [0, 1)
+double RS_WorkloadGenerator::NextDouble()
+{
+    return NextUInt() * (1.0 / 4294967296.0);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// standard normal, using the Box-Muller transform
+double RS_WorkloadGenerator::NextGaussian()
+{
+    double u = 1.0 - NextDouble();
+    double v = NextDouble();
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// index in [0, n) with probability proportional to 1 / (index+1)^s
+int RS_WorkloadGenerator::NextZipf(int n, double s)
+{
+    double total = 0.0;
+    for (int i=0; i<n; ++i)
+        total += pow(i + 1.0, -s);
+
+    double r = NextDouble() * total;
+    for (int i=0; i<n-1; ++i)
+    {
+        r -= pow(i + 1.0, -s);
+        if (r < 0.0)
+            return i;
+    }
+
+    return n - 1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// a normally distributed position around a random town, with the standard
+// deviation given as a fraction of the extents
+void RS_WorkloadGenerator::NearTown(double spread, double& x, double& y)
+{
+    const RS_F_Point& town = m_towns[NextUInt() % m_towns.size()];
+    double size = rs_min(m_extents.width(), m_extents.height());
+
+    x = town.x + NextGaussian() * spread * size;
+    y = town.y + NextGaussian() * spread * size;
+    ClampToExtents(x, y);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void RS_WorkloadGenerator::ClampToExtents(double& x, double& y)
+{
+    x = rs_max(m_extents.minx, rs_min(m_extents.maxx, x));
+    y = rs_max(m_extents.miny, rs_min(m_extents.maxy, y));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MemoryFeatureReader* RS_WorkloadGenerator::CreateRoads(int count, int verticesPerRoad)
+{
+    RS_MemoryFeatureReader* reader = new RS_MemoryFeatureReader();
+    int idProp    = reader->AddProperty(L"ID", RS_MemoryFeatureReader::PropertyType_Int32, true);
+    int geomProp  = reader->AddProperty(L"Geometry", RS_MemoryFeatureReader::PropertyType_Geometry);
+    int nameProp  = reader->AddProperty(L"NAME", RS_MemoryFeatureReader::PropertyType_String);
+    int classProp = reader->AddProperty(L"CLASS", RS_MemoryFeatureReader::PropertyType_String);
+    int lanesProp = reader->AddProperty(L"LANES", RS_MemoryFeatureReader::PropertyType_Int32);
+    int speedProp = reader->AddProperty(L"SPEED", RS_MemoryFeatureReader::PropertyType_Double);
+
+    int npts = rs_max(2, verticesPerRoad);
+    double size = rs_min(m_extents.width(), m_extents.height());
+    std::vector<RS_F_Point> pts(npts);
+    wchar_t name[64];
+
+    for (int i=0; i<count; ++i)
+    {
+        // most roads are minor ones in the towns
+        int roadClass = NextZipf(COUNTOF(ROAD_CLASSES), 1.2);
+
+        double x, y;
+        NearTown(0.05 * (roadClass + 1), x, y);
+
+        // roads mostly follow a grid, and wander a little
+        double heading = 0.5 * M_PI * (NextUInt() % 4) + 0.2 * NextGaussian();
+        double step = ROAD_LENGTHS[roadClass] * size * (0.5 + NextDouble()) / (npts - 1);
+
+        for (int j=0; j<npts; ++j)
+        {
+            pts[j].x = x;
+            pts[j].y = y;
+
+            heading += 0.15 * NextGaussian();
+            x += step * cos(heading);
+            y += step * sin(heading);
+            ClampToExtents(x, y);
+        }
+
+        m_agf.clear();
+        PutInt(m_agf, GeometryType_LineString);
+        PutInt(m_agf, Dimensionality_XY);
+        PutPoints(m_agf, pts);
+
+        swprintf(name, 64, L"%ls %d", ROAD_CLASSES[roadClass], i + 1);
+
+        reader->AddFeature();
+        reader->SetInt32(idProp, i + 1);
+        reader->SetGeometryAgf(geomProp, &m_agf[0], m_agf.size());
+        reader->SetString(nameProp, name);
+        reader->SetString(classProp, ROAD_CLASSES[roadClass]);
+        reader->SetInt32(lanesProp, ROAD_LANES[roadClass]);
+        reader->SetDouble(speedProp, ROAD_SPEEDS[roadClass]);
+    }
+
+    return reader;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MemoryFeatureReader* RS_WorkloadGenerator::CreateParcels(int count)
+{
+    RS_MemoryFeatureReader* reader = new RS_MemoryFeatureReader();
+    int idProp    = reader->AddProperty(L"ID", RS_MemoryFeatureReader::PropertyType_Int32, true);
+    int geomProp  = reader->AddProperty(L"Geometry", RS_MemoryFeatureReader::PropertyType_Geometry);
+    int zoneProp  = reader->AddProperty(L"ZONE", RS_MemoryFeatureReader::PropertyType_String);
+    int areaProp  = reader->AddProperty(L"AREA", RS_MemoryFeatureReader::PropertyType_Double);
+    int valueProp = reader->AddProperty(L"VALUE", RS_MemoryFeatureReader::PropertyType_Double);
+    int yearProp  = reader->AddProperty(L"YEAR", RS_MemoryFeatureReader::PropertyType_Int16);
+
+    // each town gets a block of parcels on a jittered grid, where the
+    // corners are shared between neighboring parcels
+    int numTowns = (int)m_towns.size();
+    double size = rs_min(m_extents.width(), m_extents.height());
+    std::vector<RS_F_Point> corners;
+    std::vector<RS_F_Point> ring(5);
+    int id = 0;
+
+    for (int t=0; t<numTowns && id<count; ++t)
+    {
+        int townCount = (count - id) / (numTowns - t);
+        int cols = rs_max(1, (int)ceil(sqrt((double)townCount)));
+        int rows = rs_max(1, (townCount + cols - 1) / cols);
+
+        double cell = 0.15 * size / rs_max(cols, rows);
+        double x0 = m_towns[t].x - 0.5 * cols * cell;
+        double y0 = m_towns[t].y - 0.5 * rows * cell;
+
+        corners.resize((rows + 1) * (cols + 1));
+        for (int r=0; r<=rows; ++r)
+        {
+            for (int c=0; c<=cols; ++c)
+            {
+                RS_F_Point& pt = corners[r * (cols + 1) + c];
+                pt.x = x0 + (c + 0.3 * (NextDouble() - 0.5)) * cell;
+                pt.y = y0 + (r + 0.3 * (NextDouble() - 0.5)) * cell;
+            }
+        }
+
+        for (int k=0; k<townCount && id<count; ++k)
+        {
+            int r = k / cols;
+            int c = k % cols;
+
+            // a closed counterclockwise ring
+            ring[0] = corners[ r      * (cols + 1) + c    ];
+            ring[1] = corners[ r      * (cols + 1) + c + 1];
+            ring[2] = corners[(r + 1) * (cols + 1) + c + 1];
+            ring[3] = corners[(r + 1) * (cols + 1) + c    ];
+            ring[4] = ring[0];
+
+            m_agf.clear();
+            PutInt(m_agf, GeometryType_Polygon);
+            PutInt(m_agf, Dimensionality_XY);
+            PutInt(m_agf, 1);
+            PutPoints(m_agf, ring);
+
+            int zone = NextZipf(COUNTOF(ZONES), 1.0);
+
+            reader->AddFeature();
+            reader->SetInt32(idProp, ++id);
+            reader->SetGeometryAgf(geomProp, &m_agf[0], m_agf.size());
+            reader->SetString(zoneProp, ZONES[zone]);
+            reader->SetDouble(areaProp, fabs(RingArea(ring)));
+            reader->SetDouble(valueProp, floor(exp(12.0 + 0.8 * NextGaussian())));
+            reader->SetInt16(yearProp, (short)(1900 + NextUInt() % 121));
+        }
+    }
+
+    return reader;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MemoryFeatureReader* RS_WorkloadGenerator::CreatePoints(int count)
+{
+    RS_MemoryFeatureReader* reader = new RS_MemoryFeatureReader();
+    int idProp    = reader->AddProperty(L"ID", RS_MemoryFeatureReader::PropertyType_Int32, true);
+    int geomProp  = reader->AddProperty(L"Geometry", RS_MemoryFeatureReader::PropertyType_Geometry);
+    int nameProp  = reader->AddProperty(L"NAME", RS_MemoryFeatureReader::PropertyType_String);
+    int catProp   = reader->AddProperty(L"CATEGORY", RS_MemoryFeatureReader::PropertyType_String);
+    int rankProp  = reader->AddProperty(L"RANK", RS_MemoryFeatureReader::PropertyType_Int32);
+    int popProp   = reader->AddProperty(L"POPULARITY", RS_MemoryFeatureReader::PropertyType_Double);
+
+    wchar_t name[64];
+
+    for (int i=0; i<count; ++i)
+    {
+        double x, y;
+        if (NextDouble() < 0.1)
+        {
+            // the background
+            x = m_extents.minx + NextDouble() * m_extents.width();
+            y = m_extents.miny + NextDouble() * m_extents.height();
+        }
+        else
+        {
+            NearTown(0.03, x, y);
+        }
+
+        m_agf.clear();
+        PutInt(m_agf, GeometryType_Point);
+        PutInt(m_agf, Dimensionality_XY);
+        PutDouble(m_agf, x);
+        PutDouble(m_agf, y);
+
+        int category = NextZipf(COUNTOF(CATEGORIES), 1.1);
+        swprintf(name, 64, L"%ls %d", CATEGORIES[category], i + 1);
+
+        reader->AddFeature();
+        reader->SetInt32(idProp, i + 1);
+        reader->SetGeometryAgf(geomProp, &m_agf[0], m_agf.size());
+        reader->SetString(nameProp, name);
+        reader->SetString(catProp, CATEGORIES[category]);
+        reader->SetInt32(rankProp, 1 + NextZipf(5, 1.5));
+        reader->SetDouble(popProp, -100.0 * log(1.0 - NextDouble()));
+    }
+
+    return reader;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MemoryFeatureReader* RS_WorkloadGenerator::CreateCoastline(int count, int verticesPerFeature)
+{
+    RS_MemoryFeatureReader* reader = new RS_MemoryFeatureReader();
+    int idProp    = reader->AddProperty(L"ID", RS_MemoryFeatureReader::PropertyType_Int32, true);
+    int geomProp  = reader->AddProperty(L"Geometry", RS_MemoryFeatureReader::PropertyType_Geometry);
+    int nameProp  = reader->AddProperty(L"NAME", RS_MemoryFeatureReader::PropertyType_String);
+    int areaProp  = reader->AddProperty(L"AREA", RS_MemoryFeatureReader::PropertyType_Double);
+
+    int target = rs_max(8, verticesPerFeature);
+    double size = rs_min(m_extents.width(), m_extents.height());
+    std::vector<RS_F_Point> ring;
+    std::vector<RS_F_Point> next;
+    wchar_t name[64];
+
+    for (int i=0; i<count; ++i)
+    {
+        // island sizes follow a power law
+        double radius = 0.2 * size * pow(1.0 - NextDouble(), 2.0) + 0.005 * size;
+        double cx = m_extents.minx + NextDouble() * m_extents.width();
+        double cy = m_extents.miny + NextDouble() * m_extents.height();
+
+        // a rough octagon ...
+        ring.clear();
+        for (int j=0; j<8; ++j)
+        {
+            double angle = j * M_PI / 4.0;
+            double r = radius * (0.7 + 0.6 * NextDouble());
+            ring.push_back(RS_F_Point(cx + r * cos(angle), cy + r * sin(angle)));
+        }
+
+        // ... refined by midpoint displacement, keeping the roughness
+        // proportional to the segment length
+        while ((int)ring.size() < target)
+        {
+            int n = (int)ring.size();
+            int splits = rs_min(n, target - n);
+
+            next.clear();
+            for (int j=0; j<n; ++j)
+            {
+                const RS_F_Point& a = ring[j];
+                const RS_F_Point& b = ring[(j + 1) % n];
+                next.push_back(a);
+
+                if (j < splits)
+                {
+                    double dx = b.x - a.x;
+                    double dy = b.y - a.y;
+                    double d = 0.25 * NextGaussian();
+                    next.push_back(RS_F_Point(0.5 * (a.x + b.x) - d * dy, 0.5 * (a.y + b.y) + d * dx));
+                }
+            }
+            ring.swap(next);
+        }
+
+        for (size_t j=0; j<ring.size(); ++j)
+            ClampToExtents(ring[j].x, ring[j].y);
+        ring.push_back(ring[0]);
+
+        m_agf.clear();
+        PutInt(m_agf, GeometryType_Polygon);
+        PutInt(m_agf, Dimensionality_XY);
+        PutInt(m_agf, 1);
+        PutPoints(m_agf, ring);
+
+        swprintf(name, 64, L"Island %d", i + 1);
+
+        reader->AddFeature();
+        reader->SetInt32(idProp, i + 1);
+        reader->SetGeometryAgf(geomProp, &m_agf[0], m_agf.size());
+        reader->SetString(nameProp, name);
+        reader->SetDouble(areaProp, fabs(RingArea(ring)));
+    }
+
+    return reader;
+}
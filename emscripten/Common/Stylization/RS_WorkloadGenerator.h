@@ -0,0 +1,81 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef RS_WORKLOADGENERATOR_H_
+#define RS_WORKLOADGENERATOR_H_
+
+#include "RS_MemoryFeatureReader.h"
+#include "Bounds.h"
+#include <vector>
+
+
+//---------------------------------------------
+// Generates synthetic feature sets for exercising the stylizers.  The
+// output only depends on the extents and the seed, on every platform, so a
+// workload can be reproduced anywhere from its parameters.
+//
+// Features are concentrated around a handful of "towns" placed within the
+// extents, and the theming attributes (road class, zoning, category) follow
+// skewed distributions, so that rules and themes see realistic hit rates.
+//
+// The Create methods return a new feature reader owned by the caller.
+// Every feature set has an Int32 identity property named ID and a geometry
+// property named Geometry.
+//---------------------------------------------
+
+class RS_WorkloadGenerator
+{
+public:
+    RS_WorkloadGenerator(const RS_Bounds& extents, unsigned int seed);
+    ~RS_WorkloadGenerator();
+
+    // Line strings following a road network.  Properties: NAME (string),
+    // CLASS (string: residential, secondary, primary or highway), LANES
+    // (Int32) and SPEED (double).
+    RS_MemoryFeatureReader* CreateRoads(int count, int verticesPerRoad);
+
+    // Quadrilateral polygons tiling blocks around the towns, sharing their
+    // edges with their neighbors.  Properties: ZONE (string), AREA (double),
+    // VALUE (double, log-normal) and YEAR (Int16).
+    RS_MemoryFeatureReader* CreateParcels(int count);
+
+    // Points in clusters around the towns, plus a uniform background.
+    // Properties: NAME (string), CATEGORY (string), RANK (Int32) and
+    // POPULARITY (double).
+    RS_MemoryFeatureReader* CreatePoints(int count);
+
+    // Irregular polygons with fractal outlines, like islands.  Properties:
+    // NAME (string) and AREA (double).
+    RS_MemoryFeatureReader* CreateCoastline(int count, int verticesPerFeature);
+
+private:
+    // random numbers - the same sequence on every platform
+    unsigned int NextUInt();
+    double NextDouble();
+    double NextGaussian();
+    int NextZipf(int n, double s);
+
+    void NearTown(double spread, double& x, double& y);
+    void ClampToExtents(double& x, double& y);
+
+    RS_Bounds m_extents;
+    unsigned long long m_state;
+    std::vector<RS_F_Point> m_towns;
+    std::vector<unsigned char> m_agf;
+};
+
+#endif
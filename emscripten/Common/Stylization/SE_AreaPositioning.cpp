@@ -41,6 +41,8 @@ SE_AreaPositioning::SE_AreaPositioning(LineBuffer* geom, SE_RenderAreaStyle* sty
         m_v_cur_pos = 0;
 
         m_angle_rad = 0.0;
+        m_base_pt.x = 0.0;
+        m_base_pt.y = 0.0;
 
         return;
     }
@@ -193,6 +195,20 @@ SE_AreaPositioning::SE_AreaPositioning(LineBuffer* geom, SE_RenderAreaStyle* sty
     // the required number of columns in the grid
     m_h_pts = m_h_max - m_h_min + 1;
 
+    // a small polygon can fall between two columns, in which case there are
+    // no points - configure a single empty column
+    if (m_h_pts <= 0)
+    {
+        m_h_pts = 1;
+        m_v_min = m_v_buf;
+        m_v_max = m_v_buf + m_h_pts;
+        m_v_min[0] = 0;
+        m_v_max[0] = -1;
+        m_h_cur_pos = m_h_min;
+        m_v_cur_pos = 0;
+        return;
+    }
+
     // For each column we'll compute the required vertical range of cells
     // and store that in the m_v_min and m_v_max arrays.
 
@@ -285,6 +301,14 @@ const double& SE_AreaPositioning::PatternRotation()
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Returns the origin of the symbol grid, in screen units.
+const Point2D& SE_AreaPositioning::PatternOrigin()
+{
+    return m_base_pt;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Returns the next point in the symbol grid at which a symbol must be
 // rendered for the current feature.
@@ -30,11 +30,12 @@
 class SE_AreaPositioning
 {
 public:
-    SE_AreaPositioning(LineBuffer* geom, SE_RenderAreaStyle* style, double w2sAngleRad);
-    ~SE_AreaPositioning();
+    STYLIZATION_API SE_AreaPositioning(LineBuffer* geom, SE_RenderAreaStyle* style, double w2sAngleRad);
+    STYLIZATION_API ~SE_AreaPositioning();
 
-    const double& PatternRotation();
-    const Point2D* NextLocation();
+    STYLIZATION_API const double& PatternRotation();
+    STYLIZATION_API const Point2D& PatternOrigin();
+    STYLIZATION_API const Point2D* NextLocation();
 
 private:
     static int ClipLine(double xMin, double xMax, const Point2D& p0, const Point2D& p1, double* ret);
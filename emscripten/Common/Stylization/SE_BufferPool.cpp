@@ -26,20 +26,29 @@ SE_BufferPool::SE_BufferPool()
 
 SE_BufferPool::~SE_BufferPool()
 {
+    // deleting an SE line buffer frees its transformed buffer and bounds
+    // back to this pool, so do these first
     while (!m_selb_pool.empty())
-        delete m_selb_pool.pop();
+        delete m_selb_pool.pop_largest();
     while (!m_bnd_pool.empty())
-        free(m_bnd_pool.pop());
+        free(m_bnd_pool.pop_largest());
 }
 
 
 SE_LineBuffer* SE_BufferPool::NewSELineBuffer(SE_BufferPool* pool, int requestSize)
 {
-    if (pool && !pool->m_selb_pool.empty())
+    if (pool)
     {
-        SE_LineBuffer* lb = pool->m_selb_pool.pop();
-        lb->Reset();
-        return lb;
+        ++pool->m_stats.requests;
+
+        SE_LineBuffer* lb = pool->m_selb_pool.pop(requestSize);
+        if (lb)
+        {
+            ++pool->m_stats.reuses;
+            pool->RemovePooled(MemorySize(lb));
+            lb->Reset();
+            return lb;
+        }
     }
 
     return new SE_LineBuffer(requestSize, pool);
@@ -48,17 +57,24 @@ SE_LineBuffer* SE_BufferPool::NewSELineBuffer(SE_BufferPool* pool, int requestSi
 
 SE_Bounds* SE_BufferPool::NewBounds(SE_BufferPool* pool, int size)
 {
-    if (pool && !pool->m_bnd_pool.empty())
+    if (pool)
     {
-        SE_Bounds* bounds = pool->m_bnd_pool.pop();
-        if (bounds->capacity >= size)
+        ++pool->m_stats.requests;
+
+        SE_Bounds* bounds = pool->m_bnd_pool.pop(size);
+        if (bounds)
         {
-            bounds->size = 0;
-            bounds->min[0] = bounds->min[1] = +DBL_MAX;
-            bounds->max[0] = bounds->max[1] = -DBL_MAX;
-            return bounds;
+            pool->RemovePooled(MemorySize(bounds));
+            if (bounds->capacity >= size)
+            {
+                ++pool->m_stats.reuses;
+                bounds->size = 0;
+                bounds->min[0] = bounds->min[1] = +DBL_MAX;
+                bounds->max[0] = bounds->max[1] = -DBL_MAX;
+                return bounds;
+            }
+            free(bounds);
         }
-        free(bounds);
     }
 
     SE_Bounds* bounds = (SE_Bounds*)malloc(sizeof(SE_Bounds) + 2*size*sizeof(double));
@@ -75,7 +91,10 @@ SE_Bounds* SE_BufferPool::NewBounds(SE_BufferPool* pool, int size)
 void SE_BufferPool::FreeSELineBuffer(SE_BufferPool* pool, SE_LineBuffer* lb)
 {
     if (pool)
-        pool->m_selb_pool.push(lb);
+    {
+        pool->m_selb_pool.push(lb, lb->m_max_segs);
+        pool->AddPooled(MemorySize(lb));
+    }
     else
         delete lb;
 }
@@ -84,7 +103,58 @@ void SE_BufferPool::FreeSELineBuffer(SE_BufferPool* pool, SE_LineBuffer* lb)
 void SE_BufferPool::FreeBounds(SE_BufferPool* pool, SE_Bounds* bounds)
 {
     if (pool)
-        pool->m_bnd_pool.push(bounds);
+    {
+        pool->m_bnd_pool.push(bounds, bounds->capacity);
+        pool->AddPooled(MemorySize(bounds));
+    }
     else
         free(bounds);
 }
+
+
+bool SE_BufferPool::FreeLargest()
+{
+    // release whichever of the largest buffers of each kind is biggest
+    SE_LineBuffer* lb = m_selb_pool.top_largest();
+    SE_Bounds* bounds = m_bnd_pool.top_largest();
+    LineBuffer* xfb = m_pool.top_largest();
+
+    size_t lbBytes = lb? MemorySize(lb) : 0;
+    size_t boundsBytes = bounds? MemorySize(bounds) : 0;
+    size_t xfbBytes = xfb? xfb->memory_size() : 0;
+
+    if (lb && lbBytes >= boundsBytes && lbBytes >= xfbBytes)
+    {
+        // this frees the buffer's transformed buffer back to the pool
+        m_selb_pool.pop_largest();
+        RemovePooled(lbBytes);
+        delete lb;
+        return true;
+    }
+
+    if (bounds && boundsBytes >= xfbBytes)
+    {
+        m_bnd_pool.pop_largest();
+        RemovePooled(boundsBytes);
+        free(bounds);
+        return true;
+    }
+
+    return LineBufferPool::FreeLargest();
+}
+
+
+size_t SE_BufferPool::MemorySize(SE_Bounds* bounds)
+{
+    return sizeof(SE_Bounds) + 2*bounds->capacity*sizeof(double);
+}
+
+
+size_t SE_BufferPool::MemorySize(SE_LineBuffer* lb)
+{
+    // the transformed buffer goes back to the pool with the SE line buffer
+    return sizeof(SE_LineBuffer)
+         + lb->m_max_pts*sizeof(double)
+         + lb->m_max_segs*sizeof(SE_LineBuffer::SE_LB_SegType)
+         + lb->m_xf_buf->memory_size();
+}
@@ -24,6 +24,9 @@
 
 //---------------------------------------------
 // Object pool for buffers
+//
+// The bounds and SE line buffers are pooled by capacity class the same
+// way as the line buffers, and count towards the same stats and Trim.
 //---------------------------------------------
 
 class SE_BufferPool : public LineBufferPool
@@ -37,9 +40,15 @@ public:
     STYLIZATION_API static void FreeBounds(SE_BufferPool* pool, SE_Bounds* bounds);
     STYLIZATION_API static void FreeSELineBuffer(SE_BufferPool* pool, SE_LineBuffer* lb);
 
+protected:
+    virtual bool FreeLargest();
+
 private:
-    DataValueStack<SE_Bounds> m_bnd_pool;
-    DataValueStack<SE_LineBuffer> m_selb_pool;
+    static size_t MemorySize(SE_Bounds* bounds);
+    static size_t MemorySize(SE_LineBuffer* lb);
+
+    SizeClassStack<SE_Bounds> m_bnd_pool;
+    SizeClassStack<SE_LineBuffer> m_selb_pool;
 };
 
 #endif
@@ -0,0 +1,826 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_DisplayList.h"
+#include "SE_Renderer.h"
+#include "SE_AreaPositioning.h"
+#include "RS_FontEngine.h"
+
+
+// display list commands
+enum SE_DisplayListOp
+{
+    SE_DisplayListOp_Polyline = 1,
+    SE_DisplayListOp_Polygon,
+    SE_DisplayListOp_Raster,
+    SE_DisplayListOp_RasterAlpha,
+    SE_DisplayListOp_Text,
+    SE_DisplayListOp_ExclusionRegion,
+    SE_DisplayListOp_LabelGroup,
+    SE_DisplayListOp_PatternFill
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Decodes the command stream.  Mirrors the delta state of the writer.
+class SE_DisplayList::Reader
+{
+public:
+    Reader(const SE_DisplayList& list) :
+        m_pos(&list.m_stream[0]),
+        m_end(&list.m_stream[0] + list.m_stream.size()),
+        m_quantum(list.m_quantum),
+        m_lastX(0),
+        m_lastY(0)
+    {
+    }
+
+    inline bool AtEnd() const
+    {
+        return m_pos >= m_end;
+    }
+
+    inline unsigned char ReadOp()
+    {
+        return *m_pos++;
+    }
+
+    unsigned long long ReadUInt()
+    {
+        unsigned long long value = 0;
+        int shift = 0;
+        unsigned char b;
+        do
+        {
+            b = *m_pos++;
+            value |= (unsigned long long)(b & 0x7F) << shift;
+            shift += 7;
+        }
+        while (b & 0x80);
+
+        return value;
+    }
+
+    inline long long ReadInt()
+    {
+        unsigned long long zz = ReadUInt();
+        return (long long)(zz >> 1) ^ -(long long)(zz & 1);
+    }
+
+    inline double ReadDouble()
+    {
+        double value;
+        memcpy(&value, m_pos, sizeof(double));
+        m_pos += sizeof(double);
+        return value;
+    }
+
+    inline void ReadPoint(double& x, double& y)
+    {
+        m_lastX += ReadInt();
+        m_lastY += ReadInt();
+        x = (double)m_lastX * m_quantum;
+        y = (double)m_lastY * m_quantum;
+    }
+
+    // reads a quantized geometry into a new buffer from the pool
+    LineBuffer* ReadGeometry(LineBufferPool* pool)
+    {
+        int geomType = (int)ReadUInt();
+        int npts = (int)ReadUInt();
+        int ngeoms = (int)ReadUInt();
+
+        LineBuffer* lb = LineBufferPool::NewLineBuffer(pool, npts);
+        lb->SetGeometryType(geomType);
+
+        double x, y;
+        for (int i=0; i<ngeoms; ++i)
+        {
+            lb->NewGeometry();
+            int ncntrs = (int)ReadUInt();
+            for (int j=0; j<ncntrs; ++j)
+            {
+                int cntrPts = (int)ReadUInt();
+                ReadPoint(x, y);
+                lb->MoveTo(x, y);
+                for (int k=1; k<cntrPts; ++k)
+                {
+                    ReadPoint(x, y);
+                    lb->LineTo(x, y);
+                }
+            }
+        }
+
+        return lb;
+    }
+
+    // reads an unquantized geometry into a new buffer from the pool
+    LineBuffer* ReadRawGeometry(LineBufferPool* pool)
+    {
+        int geomType = (int)ReadUInt();
+        int ncntrs = (int)ReadUInt();
+
+        LineBuffer* lb = LineBufferPool::NewLineBuffer(pool, 8);
+        lb->SetGeometryType(geomType);
+
+        for (int j=0; j<ncntrs; ++j)
+        {
+            int cntrPts = (int)ReadUInt();
+            for (int k=0; k<cntrPts; ++k)
+            {
+                double x = ReadDouble();
+                double y = ReadDouble();
+                if (k == 0)
+                    lb->MoveTo(x, y);
+                else
+                    lb->LineTo(x, y);
+            }
+        }
+
+        return lb;
+    }
+
+private:
+    const unsigned char* m_pos;
+    const unsigned char* m_end;
+    double m_quantum;
+    long long m_lastX;
+    long long m_lastY;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_DisplayList::StrokeLess::operator()(const SE_LineStroke& a, const SE_LineStroke& b) const
+{
+    if (a.color != b.color)
+        return a.color < b.color;
+    if (a.weight != b.weight)
+        return a.weight < b.weight;
+    if (a.cap != b.cap)
+        return a.cap < b.cap;
+    if (a.join != b.join)
+        return a.join < b.join;
+    return a.miterLimit < b.miterLimit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_DisplayList::SE_DisplayList(double quantum) :
+    m_quantum(quantum),
+    m_invQuantum(1.0 / quantum),
+    m_numCommands(0),
+    m_lastX(0),
+    m_lastY(0),
+    m_lastTextDef(-1)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_DisplayList::~SE_DisplayList()
+{
+    Clear();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::Clear()
+{
+    for (size_t i=0; i<m_labelStyles.size(); ++i)
+        delete m_labelStyles[i];
+
+    for (size_t i=0; i<m_patternCells.size(); ++i)
+        delete m_patternCells[i];
+
+    m_stream.clear();
+    m_numCommands = 0;
+    m_lastX = 0;
+    m_lastY = 0;
+
+    m_strokes.clear();
+    m_fills.clear();
+    m_textDefs.clear();
+    m_strings.clear();
+    m_rasters.clear();
+    m_labelStyles.clear();
+    m_patternCells.clear();
+
+    m_strokeMap.clear();
+    m_fillMap.clear();
+    m_stringMap.clear();
+    m_rasterMap.clear();
+    m_patternCellMap.clear();
+    m_lastTextDef = -1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::SetQuantum(double quantum)
+{
+    _ASSERT(m_numCommands == 0);
+    if (m_numCommands > 0 || quantum <= 0.0)
+        return;
+
+    m_quantum = quantum;
+    m_invQuantum = 1.0 / quantum;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::WriteOp(unsigned char op)
+{
+    m_stream.push_back(op);
+    ++m_numCommands;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::WriteUInt(unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        m_stream.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    m_stream.push_back((unsigned char)value);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::WriteInt(long long value)
+{
+    // zigzag encoding keeps small negative deltas small
+    WriteUInt(((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::WriteDouble(double value)
+{
+    unsigned char bytes[sizeof(double)];
+    memcpy(bytes, &value, sizeof(double));
+    m_stream.insert(m_stream.end(), bytes, bytes + sizeof(double));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::WritePoint(double x, double y)
+{
+    long long qx = (long long)floor(x * m_invQuantum + 0.5);
+    long long qy = (long long)floor(y * m_invQuantum + 0.5);
+    WriteInt(qx - m_lastX);
+    WriteInt(qy - m_lastY);
+    m_lastX = qx;
+    m_lastY = qy;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::WriteGeometry(LineBuffer* geometry, const SE_Matrix* xform)
+{
+    WriteUInt(geometry->geom_type());
+    WriteUInt(geometry->point_count());
+    WriteUInt(geometry->geom_count());
+
+    int cntr = 0;
+    for (int i=0; i<geometry->geom_count(); ++i)
+    {
+        int ncntrs = geometry->geom_size(i);
+        WriteUInt(ncntrs);
+
+        for (int j=0; j<ncntrs; ++j, ++cntr)
+        {
+            int start = geometry->contour_start_point(cntr);
+            int end = geometry->contour_end_point(cntr);
+            WriteUInt(end - start + 1);
+
+            for (int k=start; k<=end; ++k)
+            {
+                double x = geometry->x_coord(k);
+                double y = geometry->y_coord(k);
+                if (xform)
+                    xform->transform(x, y);
+                WritePoint(x, y);
+            }
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::WriteRawGeometry(LineBuffer* geometry)
+{
+    WriteUInt(geometry->geom_type());
+    WriteUInt(geometry->cntr_count());
+
+    for (int j=0; j<geometry->cntr_count(); ++j)
+    {
+        int start = geometry->contour_start_point(j);
+        int end = geometry->contour_end_point(j);
+        WriteUInt(end - start + 1);
+
+        for (int k=start; k<=end; ++k)
+        {
+            WriteDouble(geometry->x_coord(k));
+            WriteDouble(geometry->y_coord(k));
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int SE_DisplayList::InternStroke(const SE_LineStroke& lineStroke)
+{
+    std::map<SE_LineStroke, int, StrokeLess>::iterator iter = m_strokeMap.find(lineStroke);
+    if (iter != m_strokeMap.end())
+        return iter->second;
+
+    int index = (int)m_strokes.size();
+    m_strokes.push_back(lineStroke);
+    m_strokeMap[lineStroke] = index;
+    return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int SE_DisplayList::InternFill(unsigned int fill)
+{
+    std::map<unsigned int, int>::iterator iter = m_fillMap.find(fill);
+    if (iter != m_fillMap.end())
+        return iter->second;
+
+    int index = (int)m_fills.size();
+    m_fills.push_back(fill);
+    m_fillMap[fill] = index;
+    return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static bool SameTextDef(RS_TextDef& a, RS_TextDef& b)
+{
+    return a.halign()              == b.halign()
+        && a.valign()              == b.valign()
+        && a.justify()             == b.justify()
+        && a.textbg()              == b.textbg()
+        && a.textcolor().argb()    == b.textcolor().argb()
+        && a.ghostcolor().argb()   == b.ghostcolor().argb()
+        && a.framecolor().argb()   == b.framecolor().argb()
+        && a.opaquecolor().argb()  == b.opaquecolor().argb()
+        && a.font().height()       == b.font().height()
+        && a.font().style()        == b.font().style()
+        && a.font().units()        == b.font().units()
+        && a.font().charset()      == b.font().charset()
+        && a.rotation()            == b.rotation()
+        && a.obliqueAngle()        == b.obliqueAngle()
+        && a.trackSpacing()        == b.trackSpacing()
+        && a.linespace()           == b.linespace()
+        && a.frameoffsetx()        == b.frameoffsetx()
+        && a.frameoffsety()        == b.frameoffsety()
+        && a.font().name()         == b.font().name()
+        && a.markup()              == b.markup();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int SE_DisplayList::InternTextDef(RS_TextDef& tdef)
+{
+    // consecutive text usually shares its definition
+    if (m_lastTextDef >= 0 && SameTextDef(m_textDefs[m_lastTextDef], tdef))
+        return m_lastTextDef;
+
+    // there are only ever a handful of distinct text definitions
+    for (size_t i=0; i<m_textDefs.size(); ++i)
+    {
+        if (SameTextDef(m_textDefs[i], tdef))
+        {
+            m_lastTextDef = (int)i;
+            return m_lastTextDef;
+        }
+    }
+
+    m_lastTextDef = (int)m_textDefs.size();
+    m_textDefs.push_back(tdef);
+    return m_lastTextDef;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int SE_DisplayList::InternString(const RS_String& str)
+{
+    std::map<RS_String, int>::iterator iter = m_stringMap.find(str);
+    if (iter != m_stringMap.end())
+        return iter->second;
+
+    int index = (int)m_strings.size();
+    m_strings.push_back(str);
+    m_stringMap[str] = index;
+    return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int SE_DisplayList::InternRaster(unsigned char* data, int length, RS_ImageFormat format, int width, int height)
+{
+    // image data normally comes from the symbol manager's cache, so the
+    // same pointer usually means the same image - but check the contents
+    // in case the memory was reused
+    typedef std::multimap<const unsigned char*, int>::iterator RasterIter;
+    std::pair<RasterIter, RasterIter> range = m_rasterMap.equal_range(data);
+    for (RasterIter iter = range.first; iter != range.second; ++iter)
+    {
+        RasterEntry& entry = m_rasters[iter->second];
+        if (entry.format == format && entry.width == width && entry.height == height &&
+            entry.data.size() == (size_t)length &&
+            (length == 0 || memcmp(&entry.data[0], data, length) == 0))
+            return iter->second;
+    }
+
+    int index = (int)m_rasters.size();
+    m_rasters.push_back(RasterEntry());
+    RasterEntry& entry = m_rasters.back();
+    entry.data.assign(data, data + length);
+    entry.format = format;
+    entry.width = width;
+    entry.height = height;
+
+    m_rasterMap.insert(std::make_pair((const unsigned char*)data, index));
+    return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::AddPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke)
+{
+    WriteOp(SE_DisplayListOp_Polyline);
+    WriteUInt(InternStroke(lineStroke));
+    WriteGeometry(polyline, xform);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::AddPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill)
+{
+    WriteOp(SE_DisplayListOp_Polygon);
+    WriteUInt(InternFill(fill));
+    WriteGeometry(polygon, xform);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::AddRaster(unsigned char* data, int length,
+                               RS_ImageFormat format, int native_width, int native_height,
+                               double x, double y, double w, double h, double angleDeg, double alpha)
+{
+    // the alpha is only stored when the raster isn't opaque
+    WriteOp((alpha < 1.0)? SE_DisplayListOp_RasterAlpha : SE_DisplayListOp_Raster);
+    WriteUInt(InternRaster(data, length, format, native_width, native_height));
+    WritePoint(x, y);
+    WriteDouble(w);
+    WriteDouble(h);
+    WriteDouble(angleDeg);
+    if (alpha < 1.0)
+        WriteDouble(alpha);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::AddText(const RS_TextMetrics& tm, RS_TextDef& tdef, double insx, double insy,
+                             RS_F_Point* path, int npts, double param_position)
+{
+    // only the text is kept - the metrics depend on the font engine and
+    // are computed again on replay
+    WriteOp(SE_DisplayListOp_Text);
+    WriteUInt(InternTextDef(tdef));
+    WriteUInt(InternString(tm.text));
+    WritePoint(insx, insy);
+
+    WriteUInt(path? npts : 0);
+    if (path)
+    {
+        for (int i=0; i<npts; ++i)
+            WritePoint(path[i].x, path[i].y);
+        WriteDouble(param_position);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::AddExclusionRegion(RS_F_Point* fpts, int npts)
+{
+    WriteOp(SE_DisplayListOp_ExclusionRegion);
+    WriteUInt(npts);
+    for (int i=0; i<npts; ++i)
+        WritePoint(fpts[i].x, fpts[i].y);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::AddLabelGroup(SE_LabelInfo* labels, int nlabels, RS_OverpostType type,
+                                   bool exclude, LineBuffer* path)
+{
+    WriteOp(SE_DisplayListOp_LabelGroup);
+    WriteUInt(type);
+    WriteUInt(exclude? 1 : 0);
+    WriteUInt(nlabels);
+
+    for (int i=0; i<nlabels; ++i)
+    {
+        SE_LabelInfo* info = &labels[i];
+
+        // label positions aren't necessarily in screen units, so don't
+        // quantize them
+        WriteDouble(info->x);
+        WriteDouble(info->y);
+        WriteDouble(info->anglerad);
+        WriteUInt(info->dunits);
+        WriteUInt(m_labelStyles.size());
+
+        // the display list now owns the cloned render style
+        m_labelStyles.push_back(info->style);
+        info->style = NULL;
+    }
+
+    WriteUInt(path? 1 : 0);
+    if (path)
+        WriteRawGeometry(path);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::AddPatternFill(LineBuffer* polygon, SE_RenderPrimitiveList& cell, const SE_Matrix& cellXform,
+                                    double cellAngleRad, double repeatX, double repeatY, double angleRad,
+                                    unsigned int cellId, SE_Renderer* recorder)
+{
+    int index = -1;
+    std::map<unsigned int, int>::iterator iter = m_patternCellMap.find(cellId);
+    if (cellId != 0 && iter != m_patternCellMap.end())
+    {
+        index = iter->second;
+    }
+    else
+    {
+        // clone the primitives through a style which only borrows them
+        SE_RenderPointStyle holder;
+        holder.symbol = cell;
+        index = (int)m_patternCells.size();
+        m_patternCells.push_back((SE_RenderPointStyle*)recorder->CloneRenderStyle(&holder));
+        holder.symbol.clear();
+
+        if (cellId != 0)
+            m_patternCellMap[cellId] = index;
+    }
+
+    WriteOp(SE_DisplayListOp_PatternFill);
+    WriteUInt(index);
+    WriteGeometry(polygon, NULL);
+
+    // the cell transform isn't quantized, so that copies of the cell line up
+    WriteDouble(cellXform.x0);
+    WriteDouble(cellXform.x1);
+    WriteDouble(cellXform.x2);
+    WriteDouble(cellXform.y0);
+    WriteDouble(cellXform.y1);
+    WriteDouble(cellXform.y2);
+    WriteDouble(cellAngleRad);
+    WriteDouble(repeatX);
+    WriteDouble(repeatY);
+    WriteDouble(angleRad);
+    WriteUInt(cellId);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Draws a pattern cell at each grid location where it may overlap the
+// polygon, for targets which can't fill with a pattern.  The locations are
+// those SE_Renderer::ProcessArea draws at, and like there the copies aren't
+// clipped.
+static void DrawPatternLocations(SE_Renderer* target, LineBuffer* polygon, SE_PreparedSymbol& cell,
+                                 const SE_Matrix& cellXform, double cellAngleRad,
+                                 double repeatX, double repeatY, double angleRad)
+{
+    const RS_Bounds& extents = cell.extents;
+    if (extents.minx > extents.maxx || extents.miny > extents.maxy)
+        return;
+
+    // the grid has the copy in cell (0, 0) at its origin
+    double ox = cellXform.x2;
+    double oy = cellXform.y2;
+
+    // the style bounds the positioning works with include the line weights
+    double margin = 0.0;
+    for (size_t i=0; i<cell.symbol->size(); ++i)
+    {
+        SE_RenderPrimitive* primitive = (*cell.symbol)[i];
+        if (primitive->type == SE_RenderPrimitive_Polygon || primitive->type == SE_RenderPrimitive_Polyline)
+            margin = rs_max(margin, 0.5 * ((SE_RenderPolyline*)primitive)->lineStroke.weight);
+    }
+
+    // the positioning works with them in unrotated grid space
+    SE_Matrix cellToGrid = cellXform;
+    cellToGrid.translate(-ox, -oy);
+    cellToGrid.rotate(-angleRad);
+
+    SE_RenderAreaStyle style;
+    style.angleControl = SE_AngleControl_FromAngle;
+    style.originControl = SE_OriginControl_Global;
+    style.clippingControl = SE_ClippingControl_Clip;
+    style.angleRad = angleRad;
+    style.origin[0] = ox;
+    style.origin[1] = oy;
+    style.repeat[0] = repeatX;
+    style.repeat[1] = repeatY;
+    style.bufferWidth = 0.0;
+    style.solidFill = false;
+
+    RS_Bounds gridExtents(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+    for (int i=0; i<4; ++i)
+    {
+        RS_F_Point pt;
+        cellToGrid.transform((i == 1 || i == 2)? extents.maxx : extents.minx,
+                             (i >= 2)? extents.maxy : extents.miny, pt.x, pt.y);
+        gridExtents.add_point(pt);
+    }
+
+    style.bounds[0].x = style.bounds[3].x = gridExtents.minx - margin;
+    style.bounds[1].x = style.bounds[2].x = gridExtents.maxx + margin;
+    style.bounds[0].y = style.bounds[1].y = gridExtents.miny - margin;
+    style.bounds[2].y = style.bounds[3].y = gridExtents.maxy + margin;
+
+    // the positioning needs the polygon's bounds to be set
+    RS_Bounds bounds;
+    polygon->ComputeBounds(bounds);
+
+    SE_AreaPositioning ap(polygon, &style, 0.0);
+    for (const Point2D* pos = ap.NextLocation(); pos != NULL; pos = ap.NextLocation())
+    {
+        SE_Matrix xform = cellXform;
+        xform.translate(pos->x - ox, pos->y - oy);
+        target->DrawPreparedSymbol(cell, xform, cellAngleRad);
+    }
+
+    // the next command may draw directly
+    target->FlushDrawBatch();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DisplayList::Replay(SE_Renderer* target) const
+{
+    if (m_stream.empty())
+        return;
+
+    LineBufferPool* pool = target->GetBufferPool();
+    std::vector<RS_F_Point> pts;
+
+    Reader reader(*this);
+    while (!reader.AtEnd())
+    {
+        unsigned char op = reader.ReadOp();
+        switch (op)
+        {
+            case SE_DisplayListOp_Polyline:
+            {
+                const SE_LineStroke& lineStroke = m_strokes[(size_t)reader.ReadUInt()];
+                LineBuffer* lb = reader.ReadGeometry(pool);
+                target->DrawScreenPolyline(lb, NULL, lineStroke);
+                LineBufferPool::FreeLineBuffer(pool, lb);
+                break;
+            }
+
+            case SE_DisplayListOp_Polygon:
+            {
+                unsigned int fill = m_fills[(size_t)reader.ReadUInt()];
+                LineBuffer* lb = reader.ReadGeometry(pool);
+                target->DrawScreenPolygon(lb, NULL, fill);
+                LineBufferPool::FreeLineBuffer(pool, lb);
+                break;
+            }
+
+            case SE_DisplayListOp_Raster:
+            case SE_DisplayListOp_RasterAlpha:
+            {
+                const RasterEntry& entry = m_rasters[(size_t)reader.ReadUInt()];
+                double x, y;
+                reader.ReadPoint(x, y);
+                double w = reader.ReadDouble();
+                double h = reader.ReadDouble();
+                double angleDeg = reader.ReadDouble();
+                double alpha = (op == SE_DisplayListOp_RasterAlpha)? reader.ReadDouble() : 1.0;
+
+                unsigned char* data = entry.data.empty()? NULL : const_cast<unsigned char*>(&entry.data[0]);
+                target->DrawScreenRaster(data, (int)entry.data.size(), entry.format, entry.width, entry.height,
+                                         x, y, w, h, angleDeg, alpha);
+                break;
+            }
+
+            case SE_DisplayListOp_Text:
+            {
+                RS_TextDef tdef = m_textDefs[(size_t)reader.ReadUInt()];
+                const RS_String& text = m_strings[(size_t)reader.ReadUInt()];
+                double insx, insy;
+                reader.ReadPoint(insx, insy);
+
+                int npts = (int)reader.ReadUInt();
+                double param_position = 0.0;
+                pts.resize(npts);
+                for (int i=0; i<npts; ++i)
+                    reader.ReadPoint(pts[i].x, pts[i].y);
+                if (npts > 0)
+                    param_position = reader.ReadDouble();
+
+                RS_TextMetrics tm;
+                if (target->GetRSFontEngine()->GetTextMetrics(text, tdef, tm, npts > 0))
+                    target->DrawScreenText(tm, tdef, insx, insy, (npts > 0)? &pts[0] : NULL, npts, param_position);
+                break;
+            }
+
+            case SE_DisplayListOp_ExclusionRegion:
+            {
+                int npts = (int)reader.ReadUInt();
+                pts.resize(npts);
+                for (int i=0; i<npts; ++i)
+                    reader.ReadPoint(pts[i].x, pts[i].y);
+                if (npts > 0)
+                    target->AddExclusionRegion(&pts[0], npts);
+                break;
+            }
+
+            case SE_DisplayListOp_LabelGroup:
+            {
+                RS_OverpostType type = (RS_OverpostType)reader.ReadUInt();
+                bool exclude = reader.ReadUInt() != 0;
+                int nlabels = (int)reader.ReadUInt();
+
+                // the label renderer takes ownership of the styles, so hand
+                // it copies of the recorded ones
+                SE_LabelInfo* labels = new SE_LabelInfo[nlabels];
+                for (int i=0; i<nlabels; ++i)
+                {
+                    double x = reader.ReadDouble();
+                    double y = reader.ReadDouble();
+                    double anglerad = reader.ReadDouble();
+                    RS_Units dunits = (RS_Units)reader.ReadUInt();
+                    SE_RenderStyle* style = m_labelStyles[(size_t)reader.ReadUInt()];
+                    labels[i].Set(x, y, dunits, anglerad, target->CloneRenderStyle(style));
+                }
+
+                LineBuffer* path = (reader.ReadUInt() != 0)? reader.ReadRawGeometry(pool) : NULL;
+                target->ProcessSELabelGroup(labels, nlabels, type, exclude, path);
+
+                // deletes any styles the target didn't take
+                delete [] labels;
+                if (path)
+                    LineBufferPool::FreeLineBuffer(pool, path);
+                break;
+            }
+
+            case SE_DisplayListOp_PatternFill:
+            {
+                SE_RenderPointStyle* cellStyle = m_patternCells[(size_t)reader.ReadUInt()];
+                LineBuffer* lb = reader.ReadGeometry(pool);
+
+                SE_Matrix cellXform;
+                cellXform.x0 = reader.ReadDouble();
+                cellXform.x1 = reader.ReadDouble();
+                cellXform.x2 = reader.ReadDouble();
+                cellXform.y0 = reader.ReadDouble();
+                cellXform.y1 = reader.ReadDouble();
+                cellXform.y2 = reader.ReadDouble();
+                double cellAngleRad = reader.ReadDouble();
+                double repeatX = reader.ReadDouble();
+                double repeatY = reader.ReadDouble();
+                double angleRad = reader.ReadDouble();
+                unsigned int cellId = (unsigned int)reader.ReadUInt();
+
+                SE_PreparedSymbol cell;
+                target->PrepareSymbol(cellStyle->symbol, cell);
+                if (!target->DrawScreenPatternFill(lb, cell, cellXform, cellAngleRad, repeatX, repeatY, angleRad, cellId))
+                    DrawPatternLocations(target, lb, cell, cellXform, cellAngleRad, repeatX, repeatY, angleRad);
+
+                LineBufferPool::FreeLineBuffer(pool, lb);
+                break;
+            }
+
+            default:
+                // corrupt stream - nothing more can be decoded
+                _ASSERT(false);
+                return;
+        }
+    }
+}
@@ -0,0 +1,146 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_DISPLAYLIST_H_
+#define SE_DISPLAYLIST_H_
+
+#include "SE_RenderProxies.h"
+#include <map>
+
+class SE_Renderer;
+class LineBuffer;
+
+
+//---------------------------------------------
+// A compact record of the screen space draw calls made while stylizing,
+// which can be replayed into any SE_Renderer (see SE_RecordingRenderer).
+//
+// The draw commands are stored in a byte stream.  Screen coordinates are
+// quantized to a fraction of a screen unit and written as zigzag encoded
+// deltas from the previous point.  Line strokes, fill colors, text
+// definitions, strings and raster images are interned into tables and
+// referenced by index.
+//
+// Label groups keep ownership of their cloned render styles.  Since these
+// hold buffers from the recording renderer's buffer pool, the display list
+// must be cleared before that pool is destroyed.
+//
+// Pattern fills keep a clone of their cell, shared by all the fills of the
+// same constant style, and draw it again on replay.  Targets which can't
+// fill with a pattern draw the cell at each grid location instead.
+//---------------------------------------------
+
+class SE_DisplayList
+{
+public:
+    // the quantum is the size, in screen units, of the coordinate grid
+    STYLIZATION_API SE_DisplayList(double quantum = 1.0/16.0);
+    STYLIZATION_API ~SE_DisplayList();
+
+    // Removes all commands and tables.  The quantum can only be changed
+    // while the display list is empty.
+    STYLIZATION_API void Clear();
+    STYLIZATION_API void SetQuantum(double quantum);
+
+    inline double GetQuantum() const { return m_quantum; }
+    inline int GetCommandCount() const { return m_numCommands; }
+    inline size_t GetStreamSize() const { return m_stream.size(); }
+
+    // recording - the geometry is in screen units, optionally under the
+    // supplied transform
+    STYLIZATION_API void AddPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke);
+    STYLIZATION_API void AddPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill);
+    STYLIZATION_API void AddRaster(unsigned char* data, int length,
+                                   RS_ImageFormat format, int native_width, int native_height,
+                                   double x, double y, double w, double h, double angleDeg, double alpha);
+    STYLIZATION_API void AddText(const RS_TextMetrics& tm, RS_TextDef& tdef, double insx, double insy,
+                                 RS_F_Point* path, int npts, double param_position);
+    STYLIZATION_API void AddExclusionRegion(RS_F_Point* fpts, int npts);
+
+    // The arguments are those of SE_Renderer::DrawScreenPatternFill, with
+    // the cell's primitives in place of the prepared symbol.  The recorder
+    // clones the cell, unless a cell with the same nonzero id is held.
+    STYLIZATION_API void AddPatternFill(LineBuffer* polygon, SE_RenderPrimitiveList& cell, const SE_Matrix& cellXform,
+                                        double cellAngleRad, double repeatX, double repeatY, double angleRad,
+                                        unsigned int cellId, SE_Renderer* recorder);
+
+    // Takes ownership of the label styles, like a label renderer does.  The
+    // path is stored in the units it is supplied in.
+    STYLIZATION_API void AddLabelGroup(SE_LabelInfo* labels, int nlabels, RS_OverpostType type,
+                                       bool exclude, LineBuffer* path);
+
+    // Feeds the recorded draw calls, in order, to the target renderer.  Text
+    // is measured again using the target's font engine, and label styles are
+    // cloned so that the display list can be replayed any number of times.
+    STYLIZATION_API void Replay(SE_Renderer* target) const;
+
+private:
+    struct RasterEntry
+    {
+        std::vector<unsigned char> data;
+        RS_ImageFormat format;
+        int width;
+        int height;
+    };
+
+    struct StrokeLess
+    {
+        bool operator()(const SE_LineStroke& a, const SE_LineStroke& b) const;
+    };
+
+    class Reader;
+
+    void WriteOp(unsigned char op);
+    void WriteUInt(unsigned long long value);
+    void WriteInt(long long value);
+    void WriteDouble(double value);
+    void WritePoint(double x, double y);
+    void WriteGeometry(LineBuffer* geometry, const SE_Matrix* xform);
+    void WriteRawGeometry(LineBuffer* geometry);
+
+    int InternStroke(const SE_LineStroke& lineStroke);
+    int InternFill(unsigned int fill);
+    int InternTextDef(RS_TextDef& tdef);
+    int InternString(const RS_String& str);
+    int InternRaster(unsigned char* data, int length, RS_ImageFormat format, int width, int height);
+
+    double m_quantum;
+    double m_invQuantum;
+    int m_numCommands;
+
+    std::vector<unsigned char> m_stream;
+    long long m_lastX;
+    long long m_lastY;
+
+    // interned tables
+    std::vector<SE_LineStroke> m_strokes;
+    std::vector<unsigned int> m_fills;
+    std::vector<RS_TextDef> m_textDefs;
+    std::vector<RS_String> m_strings;
+    std::vector<RasterEntry> m_rasters;
+    std::vector<SE_RenderStyle*> m_labelStyles;
+    std::vector<SE_RenderPointStyle*> m_patternCells;
+
+    std::map<SE_LineStroke, int, StrokeLess> m_strokeMap;
+    std::map<unsigned int, int> m_fillMap;
+    std::map<RS_String, int> m_stringMap;
+    std::multimap<const unsigned char*, int> m_rasterMap;
+    std::map<unsigned int, int> m_patternCellMap;
+    int m_lastTextDef;
+};
+
+#endif
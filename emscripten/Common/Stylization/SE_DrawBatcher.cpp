@@ -0,0 +1,265 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_DrawBatcher.h"
+#include "SE_Renderer.h"
+#include "LineBuffer.h"
+
+// the most primitives in one batch
+static const int MAX_BATCH_PRIMITIVES = 256;
+
+// the most batches open at once in reorder mode
+static const int MAX_OPEN_BATCHES = 8;
+
+//////////////////////////////////////////////////////////////////////////////
+SE_DrawBatcher::SE_DrawBatcher(SE_Renderer* renderer, SE_DrawBatchMode mode, double maxSpread)
+: m_renderer(renderer),
+  m_mode(mode),
+  m_maxSpread(maxSpread)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_DrawBatcher::~SE_DrawBatcher()
+{
+    // the renderer may be gone, so open batches are discarded
+    m_free.insert(m_free.end(), m_open.begin(), m_open.end());
+    for (size_t i=0; i<m_free.size(); ++i)
+    {
+        delete m_free[i]->geometry;
+        delete m_free[i];
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DrawBatcher::AddPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke)
+{
+    // the renderer draws thin lines a pixel wide, and joins and caps reach
+    // further than half the width
+    double px2su = m_renderer->GetScreenUnitsPerPixel();
+    double halfWeight = 0.5 * rs_max(lineStroke.weight, px2su);
+    double reach = halfWeight * ((lineStroke.join == SE_LineJoin_Miter)? rs_max(lineStroke.miterLimit, 1.5) : 1.5);
+
+    Add(false, polyline, xform, lineStroke, 0, reach + px2su);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DrawBatcher::AddPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill)
+{
+    static const SE_LineStroke noStroke;
+    Add(true, polygon, xform, noStroke, fill, m_renderer->GetScreenUnitsPerPixel());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DrawBatcher::Flush()
+{
+    for (size_t i=0; i<m_open.size(); ++i)
+        DrawBatch(m_open[i]);
+
+    m_free.insert(m_free.end(), m_open.begin(), m_open.end());
+    m_open.clear();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DrawBatcher::Add(bool polygon, LineBuffer* lb, const SE_Matrix* xform, const SE_LineStroke& lineStroke,
+                         unsigned int fill, double reach)
+{
+    ++m_stats.callsIn;
+
+    int npts = lb->point_count();
+    if (npts == 0)
+        return;
+
+    // the footprint - the bounds of geometry built while warping symbols
+    // along lines aren't kept up to date, so they're computed here
+    RS_Bounds footprint(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+    for (int i=0; i<npts; ++i)
+    {
+        double x = lb->x_coord(i);
+        double y = lb->y_coord(i);
+        if (xform)
+            xform->transform(x, y);
+
+        footprint.minx = rs_min(footprint.minx, x);
+        footprint.miny = rs_min(footprint.miny, y);
+        footprint.maxx = rs_max(footprint.maxx, x);
+        footprint.maxy = rs_max(footprint.maxy, y);
+    }
+
+    footprint.minx -= reach;
+    footprint.miny -= reach;
+    footprint.maxx += reach;
+    footprint.maxy += reach;
+
+    double area = (footprint.maxx - footprint.minx) * (footprint.maxy - footprint.miny);
+
+    // find a batch with the same state which the primitive can join without
+    // passing any overlapping primitive drawn after it
+    Batch* batch = NULL;
+    for (size_t i=m_open.size(); i-- > 0; )
+    {
+        Batch* open = m_open[i];
+        if (SameState(open, polygon, lineStroke, fill))
+        {
+            if (CanJoin(open, footprint, area))
+                batch = open;
+            break;
+        }
+
+        if (m_mode != SE_DrawBatchMode_Reorder || Overlaps(open, footprint))
+            break;
+    }
+
+    if (!batch)
+        batch = OpenBatch(polygon, lineStroke, fill);
+
+    LineBuffer* geometry = batch->geometry;
+    for (int j=0; j<lb->cntr_count(); ++j)
+    {
+        int start = lb->contour_start_point(j);
+        int end = lb->contour_end_point(j);
+        for (int i=start; i<=end; ++i)
+        {
+            double x = lb->x_coord(i);
+            double y = lb->y_coord(i);
+            if (xform)
+                xform->transform(x, y);
+
+            if (i == start)
+                geometry->MoveTo(x, y);
+            else
+                geometry->LineTo(x, y);
+        }
+    }
+
+    batch->bounds.add_bounds(footprint);
+    batch->area += area;
+    batch->footprints.push_back(footprint);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_DrawBatcher::SameState(const Batch* batch, bool polygon, const SE_LineStroke& lineStroke, unsigned int fill) const
+{
+    if (batch->polygon != polygon)
+        return false;
+
+    if (polygon)
+        return batch->fill == fill;
+
+    const SE_LineStroke& s = batch->lineStroke;
+    return s.color == lineStroke.color
+        && s.weight == lineStroke.weight
+        && s.cap == lineStroke.cap
+        && s.join == lineStroke.join
+        && s.miterLimit == lineStroke.miterLimit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_DrawBatcher::CanJoin(const Batch* batch, const RS_Bounds& footprint, double area) const
+{
+    if ((int)batch->footprints.size() >= MAX_BATCH_PRIMITIVES)
+        return false;
+
+    if (m_maxSpread <= 0.0)
+        return !Overlaps(batch, footprint);
+
+    // keep the batch compact
+    double minx = rs_min(batch->bounds.minx, footprint.minx);
+    double miny = rs_min(batch->bounds.miny, footprint.miny);
+    double maxx = rs_max(batch->bounds.maxx, footprint.maxx);
+    double maxy = rs_max(batch->bounds.maxy, footprint.maxy);
+    if ((maxx - minx) * (maxy - miny) > m_maxSpread * (batch->area + area))
+        return false;
+
+    return !Overlaps(batch, footprint);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_DrawBatcher::Overlaps(const Batch* batch, const RS_Bounds& footprint)
+{
+    const RS_Bounds& b = batch->bounds;
+    if (footprint.minx >= b.maxx || footprint.maxx <= b.minx || footprint.miny >= b.maxy || footprint.maxy <= b.miny)
+        return false;
+
+    for (size_t i=0; i<batch->footprints.size(); ++i)
+    {
+        const RS_Bounds& f = batch->footprints[i];
+        if (footprint.minx < f.maxx && footprint.maxx > f.minx && footprint.miny < f.maxy && footprint.maxy > f.miny)
+            return true;
+    }
+
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_DrawBatcher::Batch* SE_DrawBatcher::OpenBatch(bool polygon, const SE_LineStroke& lineStroke, unsigned int fill)
+{
+    // the oldest batch is drawn first anyway, so it can be drawn now
+    int maxOpen = (m_mode == SE_DrawBatchMode_Reorder)? MAX_OPEN_BATCHES : 1;
+    if ((int)m_open.size() >= maxOpen)
+    {
+        DrawBatch(m_open.front());
+        m_free.push_back(m_open.front());
+        m_open.erase(m_open.begin());
+    }
+
+    Batch* batch;
+    if (m_free.empty())
+    {
+        batch = new Batch();
+        batch->geometry = new LineBuffer(64);
+    }
+    else
+    {
+        batch = m_free.back();
+        m_free.pop_back();
+    }
+
+    batch->polygon = polygon;
+    batch->lineStroke = lineStroke;
+    batch->fill = fill;
+    batch->geometry->Reset();
+    batch->geometry->SetGeometryType(polygon? GeometryType_MultiPolygon : GeometryType_MultiLineString);
+    batch->bounds = RS_Bounds(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+    batch->area = 0.0;
+    batch->footprints.clear();
+
+    m_open.push_back(batch);
+    return batch;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_DrawBatcher::DrawBatch(Batch* batch)
+{
+    ++m_stats.callsOut;
+
+    if (batch->polygon)
+        m_renderer->DrawScreenPolygon(batch->geometry, NULL, batch->fill);
+    else
+        m_renderer->DrawScreenPolyline(batch->geometry, NULL, batch->lineStroke);
+}
@@ -0,0 +1,120 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_DRAWBATCHER_H_
+#define SE_DRAWBATCHER_H_
+
+#include "SE_RendererStyles.h"
+#include "SE_Matrix.h"
+#include "Bounds.h"
+#include <vector>
+
+class SE_Renderer;
+class LineBuffer;
+
+
+// how the polylines and polygons drawn by the styles are batched
+enum SE_DrawBatchMode
+{
+    SE_DrawBatchMode_None,          // each is drawn as it comes
+    SE_DrawBatchMode_Consecutive,   // consecutive draws are merged
+    SE_DrawBatchMode_Reorder        // draws may also join earlier batches
+};
+
+
+// the polyline and polygon draws requested by the styles, and those passed
+// on to the renderer
+struct SE_DrawBatchStats
+{
+    SE_DrawBatchStats() : callsIn(0), callsOut(0) {}
+
+    int callsIn;
+    int callsOut;
+};
+
+
+//---------------------------------------------
+// Merges the screen space polylines and polygons drawn by the styles into
+// fewer, multi-contour draw calls, so that renderers pay their per-call
+// cost once for many primitives with the same stroke or fill.
+//
+// A primitive only joins a batch if its footprint on screen - its bounds,
+// grown by the stroke's reach and a pixel for antialiasing - overlaps none
+// of the batch's primitives.  Drawing the batch is then pixel for pixel
+// the same as drawing its primitives one by one, whatever the fill rule.
+// Batches can also be kept compact, for renderers which work over the
+// bounds of each draw: the bounds of a batch may then only grow to a given
+// multiple of the total area of its primitives' footprints.
+//
+// Consecutive mode only extends the last batch, so the draw order is that
+// of the styles.  Reorder mode keeps several batches open and lets a
+// primitive join an earlier one with the same state, as long as it doesn't
+// overlap anything drawn since - moving it back then changes no pixel.
+// Either way, batches never span rendering passes: the stylizer flushes
+// them at the end of each pass, and the renderer before each draw that
+// isn't batched.
+//---------------------------------------------
+
+class SE_DrawBatcher
+{
+public:
+    // a spread of zero doesn't limit the bounds of the batches
+    SE_DrawBatcher(SE_Renderer* renderer, SE_DrawBatchMode mode, double maxSpread);
+    ~SE_DrawBatcher();
+
+    // the geometry is in screen units, optionally under the supplied transform
+    void AddPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke);
+    void AddPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill);
+
+    // draws the open batches, in order
+    void Flush();
+
+    inline const SE_DrawBatchStats& GetStats() const { return m_stats; }
+    inline void ResetStats() { m_stats = SE_DrawBatchStats(); }
+
+private:
+    struct Batch
+    {
+        bool polygon;
+        SE_LineStroke lineStroke;
+        unsigned int fill;
+        LineBuffer* geometry;
+        RS_Bounds bounds;                   // the union of the footprints
+        double area;                        // the sum of their areas
+        std::vector<RS_Bounds> footprints;
+    };
+
+    void Add(bool polygon, LineBuffer* lb, const SE_Matrix* xform, const SE_LineStroke& lineStroke,
+             unsigned int fill, double reach);
+    bool SameState(const Batch* batch, bool polygon, const SE_LineStroke& lineStroke, unsigned int fill) const;
+    bool CanJoin(const Batch* batch, const RS_Bounds& footprint, double area) const;
+    static bool Overlaps(const Batch* batch, const RS_Bounds& footprint);
+    Batch* OpenBatch(bool polygon, const SE_LineStroke& lineStroke, unsigned int fill);
+    void DrawBatch(Batch* batch);
+
+    SE_Renderer* m_renderer;
+    SE_DrawBatchMode m_mode;
+    double m_maxSpread;
+
+    // the open batches, in draw order, and those free for reuse
+    std::vector<Batch*> m_open;
+    std::vector<Batch*> m_free;
+
+    SE_DrawBatchStats m_stats;
+};
+
+#endif
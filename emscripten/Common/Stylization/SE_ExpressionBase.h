@@ -190,9 +190,10 @@ struct SE_String
 {
     wchar_t* defValue;
     wchar_t* value;
+    size_t valueCapacity; // allocated length of value, in characters
     MdfModel::MdfString expression;
 
-    SE_INLINE SE_String() : defValue(NULL), value(NULL) { }
+    SE_INLINE SE_String() : defValue(NULL), value(NULL), valueCapacity(0) { }
     ~SE_String()
     {
         delete[] value;
@@ -213,11 +214,10 @@ struct SE_String
     {
         delete[] value;
         value = newValue;
+        valueCapacity = value? wcslen(value) + 1 : 0;
     }
     const wchar_t* getValue()
     {
-        static const wchar_t* sEmpty = L"";
-
         // value has highest priority
         if (value)
             return value;
@@ -227,26 +227,35 @@ struct SE_String
             return defValue;
 
         // otherwise an empty string
-        return sEmpty;
+        return L"";
     }
 
     SE_INLINE const wchar_t* evaluate(SE_Evaluator* eval)
     {
         if (!expression.empty())
         {
-            delete[] value;
-            value = NULL;
-
             RS_String str;
             eval->EvalString(expression, str);
             if (!str.empty())
             {
-                // the expression was successfully evaluated - update the value
+                // the expression was successfully evaluated - update the value,
+                // reusing the buffer from the previous feature if it's big enough
                 size_t len = str.length() + 1;
-                value = new wchar_t[len];
+                if (len > valueCapacity)
+                {
+                    delete[] value;
+                    value = new wchar_t[len];
+                    valueCapacity = len;
+                }
                 const wchar_t* src = str.c_str();
                 wcscpy(value, src);
             }
+            else
+            {
+                delete[] value;
+                value = NULL;
+                valueCapacity = 0;
+            }
         }
 
         // return the value
@@ -262,9 +271,13 @@ struct SE_String
             size_t len = wcslen(s) + 1;
             wchar_t* copy = new wchar_t[len];
             value = wcscpy(copy, s);
+            valueCapacity = len;
         }
         else
+        {
             value = NULL;
+            valueCapacity = 0;
+        }
     }
 
     SE_INLINE void operator=(SE_String& s)
@@ -287,15 +300,48 @@ struct SE_String
             size_t len = wcslen(s.value) + 1;
             wchar_t* copy = new wchar_t[len];
             value = wcscpy(copy, s.value);
+            valueCapacity = len;
         }
         else
+        {
             value = NULL;
+            valueCapacity = 0;
+        }
 
         expression = s.expression;
     }
 };
 
 
+//////////////////////////////////////////////////////////////////////////////
+// A string property which can only take one of a fixed set of values (e.g.
+// a line cap or a text alignment).  Constant values are converted into the
+// enumerated type once, when the symbol definition is parsed.  Only values
+// which are driven by expressions need to be evaluated and converted again
+// for each feature.
+template <class T, T (*Convert)(const wchar_t*)>
+struct SE_Enum : public SE_String
+{
+    T constValue;
+
+    SE_INLINE SE_Enum() : constValue(Convert(L"")) { }
+
+    // converts the current constant value into the enumerated type
+    SE_INLINE void fold()
+    {
+        constValue = Convert(getValue());
+    }
+
+    SE_INLINE T evaluateEnum(SE_Evaluator* eval)
+    {
+        if (expression.empty())
+            return constValue;
+
+        return Convert(evaluate(eval));
+    }
+};
+
+
 //////////////////////////////////////////////////////////////////////////////
 typedef std::pair<const wchar_t*, const wchar_t*> ParamId;
 
@@ -336,6 +382,13 @@ public:
     void ParseStringExpression(const MdfModel::MdfString& exprstr, SE_String& val, const wchar_t* defaultValue, const wchar_t* allowedValues = NULL);
     void ParseColorExpression(const MdfModel::MdfString& exprstr, SE_Color& val, const unsigned int defaultValue);
 
+    template <class T, T (*Convert)(const wchar_t*)>
+    void ParseEnumExpression(const MdfModel::MdfString& exprstr, SE_Enum<T, Convert>& val, const wchar_t* defaultValue, const wchar_t* allowedValues)
+    {
+        ParseStringExpression(exprstr, val, defaultValue, allowedValues);
+        val.fold();
+    }
+
     void SetParameterValues(MdfModel::OverrideCollection* overrides);
     void SetDefaultValues(MdfModel::SimpleSymbolDefinition* definition);
 
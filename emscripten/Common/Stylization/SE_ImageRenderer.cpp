@@ -0,0 +1,960 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_ImageRenderer.h"
+#include "LabelRenderer.h"
+#include "LabelRendererLocal.h"
+
+#include <wctype.h>
+
+
+//////////////////////////////////////////////////////////////////////////////
+// approximate advance of a character, as a fraction of the font height
+static double GlyphAdvance(wchar_t c)
+{
+    if (c == L' ' || c == L'\t')
+        return 0.3;
+
+    // CJK and other full width characters
+    if (c >= 0x1100 && ((c <= 0x115f) || (c >= 0x2e80 && c <= 0xa4cf) || (c >= 0xac00 && c <= 0xd7a3) ||
+                        (c >= 0xf900 && c <= 0xfaff) || (c >= 0xff00 && c <= 0xff60)))
+        return 1.0;
+
+    return 0.6;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_ImageFontEngine::SE_ImageFontEngine() :
+    m_glyphs(32)
+{
+    // generic metrics, in font units
+    m_font.m_units_per_EM = 1000;
+    m_font.m_ascender = 800;
+    m_font.m_descender = -200;
+    m_font.m_height = 1150;
+    m_font.m_capheight = 700;
+    m_font.m_underline_position = -100;
+    m_font.m_underline_thickness = 50;
+    m_font.m_fullname = L"Generic";
+    m_font.m_familyname = L"Generic";
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_ImageFontEngine::~SE_ImageFontEngine()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageFontEngine::MeasureString(const RS_String& s,
+                                       double           height,
+                                       const RS_Font*   font,
+                                       double           angleRad,
+                                       RS_F_Point*      res,
+                                       float*           offsets)
+{
+    double width = 0.0;
+    for (size_t i=0; i<s.length(); ++i)
+    {
+        double adv = GlyphAdvance(s[i]) * height;
+        if (offsets)
+            offsets[i] = (float)adv;
+        width += adv;
+    }
+
+    double asc  = font->m_ascender  * height / font->m_units_per_EM;
+    double desc = font->m_descender * height / font->m_units_per_EM;
+    if (!m_pSERenderer->YPointsUp())
+    {
+        asc = -asc;
+        desc = -desc;
+    }
+
+    res[0].x = 0.0;   res[0].y = desc;
+    res[1].x = width; res[1].y = desc;
+    res[2].x = width; res[2].y = asc;
+    res[3].x = 0.0;   res[3].y = asc;
+
+    if (angleRad != 0.0)
+    {
+        double cos_a = cos(angleRad);
+        double sin_a = m_pSERenderer->YPointsUp()? sin(angleRad) : -sin(angleRad);
+        for (int i=0; i<4; ++i)
+        {
+            double x = res[i].x;
+            double y = res[i].y;
+            res[i].x = x * cos_a - y * sin_a;
+            res[i].y = x * sin_a + y * cos_a;
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageFontEngine::DrawString(const RS_String& s,
+                                    double           x,
+                                    double           y,
+                                    double           width,
+                                    double           height,
+                                    const RS_Font*   /*font*/,
+                                    RS_Color&        color,
+                                    double           angleRad)
+{
+    // distribute the requested width between the characters
+    double total = 0.0;
+    for (size_t i=0; i<s.length(); ++i)
+        total += GlyphAdvance(s[i]);
+    if (total <= 0.0)
+        return;
+    double scale = width / total;
+
+    // baseline direction and up vector in screen space
+    double cos_a = cos(angleRad);
+    double sin_a = sin(angleRad);
+    double bx = cos_a, by = sin_a;
+    double ux = -sin_a, uy = cos_a;
+    if (!m_pSERenderer->YPointsUp())
+    {
+        by = -by;
+        uy = -uy;
+    }
+
+    m_glyphs.Reset();
+
+    double pos = 0.0;
+    for (size_t i=0; i<s.length(); ++i)
+    {
+        wchar_t c = s[i];
+        double adv = GlyphAdvance(c) * scale;
+
+        if (!iswspace(c))
+        {
+            // a block covering the x-height, or the cap height for capitals
+            // and digits
+            double top = (iswupper(c) || iswdigit(c) || adv > 0.6 * scale)? 0.7 * height : 0.5 * height;
+            double x0 = pos + 0.1 * adv;
+            double x1 = pos + 0.9 * adv;
+
+            m_glyphs.MoveTo(x + x0*bx,          y + x0*by);
+            m_glyphs.LineTo(x + x1*bx,          y + x1*by);
+            m_glyphs.LineTo(x + x1*bx + top*ux, y + x1*by + top*uy);
+            m_glyphs.LineTo(x + x0*bx + top*ux, y + x0*by + top*uy);
+            m_glyphs.Close();
+        }
+
+        pos += adv;
+    }
+
+    if (m_glyphs.point_count() > 0)
+        m_pSERenderer->DrawScreenPolygon(&m_glyphs, NULL, color.argb());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+const RS_Font* SE_ImageFontEngine::FindFont(RS_FontDef& /*def*/)
+{
+    return &m_font;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_ImageRenderer::SE_ImageRenderer(int width, int height, RS_Color& bgColor,
+                                   bool localOverposting, double tileExtentOffset)
+: m_target(&m_rasterizer)
+, m_labeler(NULL)
+, m_localLabeler(NULL)
+, m_width(width)
+, m_height(height)
+, m_bgColor(bgColor)
+, m_numThreads(0)
+, m_mapInfo(NULL)
+, m_layerInfo(NULL)
+, m_fcInfo(NULL)
+, m_mapScale(1.0)
+, m_dpi(96.0)
+, m_metersPerUnit(1.0)
+, m_scale(1.0)
+{
+    m_fontEngine.InitFontEngine(this);
+    if (localOverposting)
+        m_labeler = m_localLabeler = new LabelRendererLocal(this, tileExtentOffset);
+    else
+        m_labeler = new LabelRenderer(this);
+    m_rasterizer.Reset(m_width, m_height, m_bgColor.argb());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_ImageRenderer::~SE_ImageRenderer()
+{
+    delete m_labeler;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::SetLabelPlacementStore(LabelPlacementStore* store)
+{
+    if (m_localLabeler)
+        m_localLabeler->SetPlacementStore(store);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::GetImageRGBA(std::vector<unsigned char>& rgba)
+{
+    GetImageRGBA(0, 0, m_width, m_height, rgba);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::GetImageRGBA(int x, int y, int width, int height, std::vector<unsigned char>& rgba)
+{
+    // clamp the rectangle to the image
+    int x0 = rs_max(x, 0);
+    int y0 = rs_max(y, 0);
+    int x1 = rs_min(x + width, m_width);
+    int y1 = rs_min(y + height, m_height);
+    if (x1 <= x0 || y1 <= y0)
+    {
+        rgba.clear();
+        return;
+    }
+
+    const unsigned int* pixels = m_rasterizer.GetPixels();
+    rgba.resize(4 * (size_t)(x1 - x0) * (y1 - y0));
+    unsigned char* dst = &rgba[0];
+
+    for (int j=y0; j<y1; ++j)
+    {
+        const unsigned int* src = pixels + (size_t)j * m_width;
+        for (int i=x0; i<x1; ++i, dst+=4)
+        {
+            unsigned int p = src[i];
+            unsigned int a = p >> 24;
+
+            if (a == 0)
+            {
+                dst[0] = dst[1] = dst[2] = dst[3] = 0;
+                continue;
+            }
+
+            // undo the premultiplication
+            dst[0] = (unsigned char)((((p >> 16) & 0xff) * 255 + a/2) / a);
+            dst[1] = (unsigned char)((((p >>  8) & 0xff) * 255 + a/2) / a);
+            dst[2] = (unsigned char)((( p        & 0xff) * 255 + a/2) / a);
+            dst[3] = (unsigned char)a;
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::StartMap(RS_MapUIInfo*    mapInfo,
+                                RS_Bounds&       extents,
+                                double           mapScale,
+                                double           dpi,
+                                double           metersPerUnit,
+                                CSysTransformer* /*xformToLL*/)
+{
+    m_mapInfo = mapInfo;
+    m_extents = extents;
+    m_mapScale = mapScale;
+    m_dpi = dpi;
+    m_metersPerUnit = metersPerUnit;
+
+    m_scale = (m_extents.width() > 0.0)? (double)m_width / m_extents.width() : 1.0;
+
+    m_rasterizer.Reset(m_width, m_height, m_bgColor.argb());
+    m_rasterImages.clear();
+    m_patternTiles.clear();
+
+    m_labeler->StartLabels();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::EndMap()
+{
+    // labels are drawn after all the features
+    m_labeler->BlastLabels();
+
+    // anything still batched must reach the rasterizer
+    FlushDrawBatch();
+
+    m_rasterizer.Render(m_numThreads);
+
+    m_mapInfo = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::StartLayer(RS_LayerUIInfo* layerInfo, RS_FeatureClassInfo* classInfo)
+{
+    m_layerInfo = layerInfo;
+    m_fcInfo = classInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::EndLayer()
+{
+    m_layerInfo = NULL;
+    m_fcInfo = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::StartFeature(RS_FeatureReader* /*feature*/,
+                                    bool              /*initialPass*/,
+                                    const RS_String*  /*tooltip*/,
+                                    const RS_String*  /*url*/,
+                                    const RS_String*  /*theme*/,
+                                    double            /*zOffset*/,
+                                    double            /*zExtrusion*/,
+                                    RS_ElevationType  /*zOffsetType*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::ProcessPolygon(LineBuffer* lb, RS_FillStyle& fill)
+{
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+
+    // only the solid fill and outline are drawn
+    if (fill.color().alpha() != 0)
+        DrawScreenPolygon(lb, &w2s, fill.color().argb());
+
+    RS_LineStroke& outline = fill.outline();
+    if (outline.color().alpha() != 0)
+        ProcessPolyline(lb, outline);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::ProcessPolyline(LineBuffer* lb, RS_LineStroke& lsym)
+{
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+
+    // the width is in meters - line patterns aren't drawn
+    double mm2su = (lsym.units() == RS_Units_Device)? GetScreenUnitsPerMillimeterDevice() : GetScreenUnitsPerMillimeterWorld();
+    SE_LineStroke lineStroke(lsym.color().argb(), lsym.width() * 1000.0 * mm2su);
+
+    DrawScreenPolyline(lb, &w2s, lineStroke);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::ProcessRaster(unsigned char*   data,
+                                     int              length,
+                                     RS_ImageFormat   format,
+                                     int              width,
+                                     int              height,
+                                     RS_Bounds&       extents,
+                                     TransformMesh*   /*xformMesh*/)
+{
+    double x0, y0, x1, y1;
+    WorldToScreenPoint(extents.minx, extents.miny, x0, y0);
+    WorldToScreenPoint(extents.maxx, extents.maxy, x1, y1);
+
+    DrawScreenRaster(data, length, format, width, height,
+                     0.5*(x0 + x1), 0.5*(y0 + y1), fabs(x1 - x0), fabs(y1 - y0), 0.0);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::ProcessMarker(LineBuffer*   /*lb*/,
+                                     RS_MarkerDef& /*mdef*/,
+                                     bool          /*allowOverpost*/,
+                                     RS_Bounds*    /*bounds*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::ProcessLabelGroup(RS_LabelInfo*    labels,
+                                         int              nlabels,
+                                         const RS_String& text,
+                                         RS_OverpostType  type,
+                                         bool             exclude,
+                                         LineBuffer*      path,
+                                         double           scaleLimit)
+{
+    m_labeler->ProcessLabelGroup(labels, nlabels, text, type, exclude, path, scaleLimit);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::AddDWFContent(RS_InputStream*  /*in*/,
+                                     CSysTransformer* /*xformer*/,
+                                     const RS_String& /*section*/,
+                                     const RS_String& /*passwd*/,
+                                     const RS_String& /*w2dfilter*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::SetSymbolManager(RS_SymbolManager* /*manager*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MapUIInfo* SE_ImageRenderer::GetMapInfo()
+{
+    return m_mapInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_LayerUIInfo* SE_ImageRenderer::GetLayerInfo()
+{
+    return m_layerInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_FeatureClassInfo* SE_ImageRenderer::GetFeatureClassInfo()
+{
+    return m_fcInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_ImageRenderer::GetMapScale()
+{
+    return m_mapScale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_ImageRenderer::GetDrawingScale()
+{
+    // mapping units per pixel
+    return 1.0 / m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_ImageRenderer::GetMetersPerUnit()
+{
+    return m_metersPerUnit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_ImageRenderer::GetDpi()
+{
+    return m_dpi;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_Bounds& SE_ImageRenderer::GetBounds()
+{
+    return m_extents;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_ImageRenderer::RequiresClipping()
+{
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_ImageRenderer::RequiresLabelClipping()
+{
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_ImageRenderer::SupportsZ()
+{
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::DrawScreenPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke)
+{
+    const SE_LineStroke& stroke = m_bSelectionMode? m_selLineStroke : lineStroke;
+
+    // thin lines are drawn one pixel wide
+    double weight = rs_max(stroke.weight, GetScreenUnitsPerPixel());
+
+    for (int j=0; j<polyline->cntr_count(); ++j)
+    {
+        int start = polyline->contour_start_point(j);
+        int end = polyline->contour_end_point(j);
+
+        m_pts.resize(2 * (end - start + 1));
+        for (int i=start, k=0; i<=end; ++i, k+=2)
+        {
+            m_pts[k  ] = polyline->x_coord(i);
+            m_pts[k+1] = polyline->y_coord(i);
+            if (xform)
+                xform->transform(m_pts[k], m_pts[k+1]);
+        }
+
+        m_target->AddStroke(&m_pts[0], end - start + 1, weight, stroke.cap, stroke.join, stroke.miterLimit);
+    }
+
+    m_target->FillPath(stroke.color, SE_Rasterizer::FillRule_NonZero);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::DrawScreenPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill)
+{
+    AddPath(polygon, xform);
+
+    // holes are contours inside other contours
+    m_target->FillPath(m_bSelectionMode? m_selFillColor : fill, SE_Rasterizer::FillRule_EvenOdd);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds the contours of a line buffer to the current path.
+void SE_ImageRenderer::AddPath(LineBuffer* lb, const SE_Matrix* xform)
+{
+    for (int j=0; j<lb->cntr_count(); ++j)
+    {
+        int start = lb->contour_start_point(j);
+        int end = lb->contour_end_point(j);
+
+        for (int i=start; i<=end; ++i)
+        {
+            double x = lb->x_coord(i);
+            double y = lb->y_coord(i);
+            if (xform)
+                xform->transform(x, y);
+
+            if (i == start)
+                m_target->MoveTo(x, y);
+            else
+                m_target->LineTo(x, y);
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::DrawScreenRaster(unsigned char* data, int length,
+                                        RS_ImageFormat format, int native_width, int native_height,
+                                        double x, double y, double w, double h, double angleDeg)
+{
+    DrawScreenRaster(data, length, format, native_width, native_height, x, y, w, h, angleDeg, 1.0);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::DrawScreenRaster(unsigned char* data, int length,
+                                        RS_ImageFormat format, int native_width, int native_height,
+                                        double x, double y, double w, double h, double angleDeg,
+                                        double alpha)
+{
+    if (w == 0.0 || h == 0.0 || native_width <= 0 || native_height <= 0)
+        return;
+
+    int image = GetRasterImage(data, length, format, native_width, native_height);
+    if (image < 0)
+        return;
+
+    // the angle is CCW, while y points down
+    double angleRad = -angleDeg * M_PI180;
+    double cos_a = cos(angleRad);
+    double sin_a = sin(angleRad);
+
+    double hw = 0.5 * fabs(w);
+    double hh = 0.5 * fabs(h);
+    double ax = hw * cos_a, ay = hw * sin_a;
+    double bx = -hh * sin_a, by = hh * cos_a;
+
+    m_target->MoveTo(x - ax - bx, y - ay - by);
+    m_target->LineTo(x + ax - bx, y + ay - by);
+    m_target->LineTo(x + ax + bx, y + ay + by);
+    m_target->LineTo(x - ax + bx, y - ay + by);
+
+    // maps screen coordinates to image coordinates, with the first image
+    // row at the top
+    double su = native_width / fabs(w);
+    double sv = native_height / fabs(h);
+    double xform[6];
+    xform[0] =  cos_a * su;
+    xform[1] =  sin_a * su;
+    xform[2] = (hw - (cos_a * x + sin_a * y)) * su;
+    xform[3] = -sin_a * sv;
+    xform[4] =  cos_a * sv;
+    xform[5] = (hh - (cos_a * y - sin_a * x)) * sv;
+
+    m_target->FillPathImage(image, xform, alpha, SE_Rasterizer::FillRule_NonZero);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Returns the rasterizer image for the supplied image data, decoding it if
+// it hasn't been seen yet, or -1 if the format isn't supported.  Image data
+// comes from the symbol manager's cache, so it doesn't change while a map
+// is being drawn.  Images drawn into a pattern tile belong to the tile, so
+// they're decoded again for each tile.
+int SE_ImageRenderer::GetRasterImage(unsigned char* data, int length, RS_ImageFormat format, int width, int height)
+{
+    bool cached = (m_target == &m_rasterizer);
+    if (cached)
+    {
+        std::map<const unsigned char*, int>::iterator iter = m_rasterImages.find(data);
+        if (iter != m_rasterImages.end())
+            return iter->second;
+    }
+
+    int bpp;
+    switch (format)
+    {
+        case RS_ImageFormat_ARGB:
+        case RS_ImageFormat_ABGR:
+            bpp = 4;
+            break;
+
+        case RS_ImageFormat_RGB:
+            bpp = 3;
+            break;
+
+        default:
+            // compressed formats would need an image codec
+            return -1;
+    }
+
+    size_t count = (size_t)width * height;
+    if (data == NULL || (size_t)length < count * bpp)
+        return -1;
+
+    m_decoded.resize(count);
+    for (size_t i=0; i<count; ++i)
+    {
+        const unsigned char* p = data + i * bpp;
+        unsigned int r, g, b, a;
+        switch (format)
+        {
+            case RS_ImageFormat_ARGB:   // BGRA byte order
+                b = p[0]; g = p[1]; r = p[2]; a = p[3];
+                break;
+
+            case RS_ImageFormat_ABGR:   // RGBA byte order
+                r = p[0]; g = p[1]; b = p[2]; a = p[3];
+                break;
+
+            default:                    // BGR byte order
+                b = p[0]; g = p[1]; r = p[2]; a = 255;
+                break;
+        }
+
+        // premultiply
+        m_decoded[i] = (a << 24) | (((r * a + 127) / 255) << 16) | (((g * a + 127) / 255) << 8) | ((b * a + 127) / 255);
+    }
+
+    int image = m_target->AddImage(&m_decoded[0], width, height);
+    if (cached)
+        m_rasterImages[data] = image;
+    return image;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::DrawScreenText(const RS_TextMetrics& tm, RS_TextDef& tdef, double insx, double insy,
+                                      RS_F_Point* path, int npts, double param_position)
+{
+    if (path)
+    {
+        // path text only needs its character positions updated, so lay it
+        // out in place rather than copying the metrics
+        RS_TextMetrics& ptm = const_cast<RS_TextMetrics&>(tm);
+        if (m_fontEngine.LayoutPathText(ptm, path, npts, NULL, param_position, tdef.valign(), 0.5))
+            m_fontEngine.DrawPathText(ptm, tdef);
+    }
+    else
+    {
+        m_fontEngine.DrawBlockText(tm, tdef, insx, insy);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// the largest pattern tile, in pixels, and the most copies of the cell
+// drawn into one
+static const double MAX_PATTERN_TILE_PIXELS = 1024.0 * 1024.0;
+static const int MAX_PATTERN_CELL_COPIES = 64;
+
+
+//////////////////////////////////////////////////////////////////////////////
+// rounds a pattern tile key value, so that transforms which only differ by
+// rounding error share the tile
+static long long PatternKeyValue(double value)
+{
+    return (long long)floor(value * 1.0e6 + 0.5);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_ImageRenderer::PatternTileKey::operator<(const PatternTileKey& other) const
+{
+    if (cellId != other.cellId)
+        return cellId < other.cellId;
+
+    for (int i=0; i<7; ++i)
+    {
+        if (values[i] != other.values[i])
+            return values[i] < other.values[i];
+    }
+
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// The cell is rendered once into a tile covering one grid cell, with the
+// grid unrotated and its origin at the tile origin, and the polygon is then
+// filled with the repeated tile.  The tile is stretched to whole pixels,
+// which the fill transform undoes.
+bool SE_ImageRenderer::DrawScreenPatternFill(LineBuffer* polygon, SE_PreparedSymbol& cell, const SE_Matrix& cellXform,
+                                             double cellAngleRad, double repeatX, double repeatY, double angleRad,
+                                             unsigned int cellId)
+{
+    // selected symbols are drawn one by one in the selection colors
+    if (m_bSelectionMode || polygon->point_count() == 0 || cell.symbol == NULL || cell.symbol->empty())
+        return false;
+
+    // allow for rounding error in repeats which are whole pixels
+    int tileWidth = (int)ceil(repeatX - 1.0e-6);
+    int tileHeight = (int)ceil(repeatY - 1.0e-6);
+    if (tileWidth < 1 || tileHeight < 1 || (double)tileWidth * tileHeight > MAX_PATTERN_TILE_PIXELS)
+        return false;
+
+    double sx = tileWidth / repeatX;
+    double sy = tileHeight / repeatY;
+
+    // grid cell (0, 0) is drawn at the grid origin
+    double ox = cellXform.x2;
+    double oy = cellXform.y2;
+
+    // the cell transform in tile pixels
+    SE_Matrix tileXform = cellXform;
+    tileXform.translate(-ox, -oy);
+    tileXform.rotate(-angleRad);
+    tileXform.scale(sx, sy);
+
+    // y points down, so turning the grid back turns text the other way
+    double tileAngleRad = cellAngleRad + angleRad;
+
+    int image = -1;
+    PatternTileKey key;
+    if (cellId != 0)
+    {
+        key.cellId = cellId;
+        key.values[0] = PatternKeyValue(tileXform.x0);
+        key.values[1] = PatternKeyValue(tileXform.x1);
+        key.values[2] = PatternKeyValue(tileXform.y0);
+        key.values[3] = PatternKeyValue(tileXform.y1);
+        key.values[4] = PatternKeyValue(tileAngleRad);
+        key.values[5] = tileWidth;
+        key.values[6] = tileHeight;
+
+        std::map<PatternTileKey, int>::iterator iter = m_patternTiles.find(key);
+        if (iter != m_patternTiles.end())
+            image = iter->second;
+    }
+
+    if (image < 0)
+    {
+        image = RenderPatternTile(cell, tileXform, tileAngleRad, tileWidth, tileHeight, rs_max(sx, sy));
+        if (image < 0)
+            return false;
+
+        if (cellId != 0)
+            m_patternTiles[key] = image;
+    }
+
+    AddPath(polygon, NULL);
+
+    // maps screen coordinates to tile coordinates
+    double cos_a = cos(angleRad);
+    double sin_a = sin(angleRad);
+    double xform[6];
+    xform[0] =  sx * cos_a;
+    xform[1] =  sx * sin_a;
+    xform[2] = -sx * (cos_a * ox + sin_a * oy);
+    xform[3] = -sy * sin_a;
+    xform[4] =  sy * cos_a;
+    xform[5] =  sy * (sin_a * ox - cos_a * oy);
+
+    // holes are contours inside other contours
+    m_rasterizer.FillPathImage(image, xform, 1.0, SE_Rasterizer::FillRule_EvenOdd, true);
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Renders a pattern tile, and returns its rasterizer image or -1 if the cell
+// is too large for one.  The tile scale is the most tile pixels there are
+// to a screen unit.  The copies of the cell in the neighbouring grid
+// cells are drawn too, so the parts of the cell which spill over them show.
+int SE_ImageRenderer::RenderPatternTile(SE_PreparedSymbol& cell, const SE_Matrix& tileXform, double tileAngleRad,
+                                        int tileWidth, int tileHeight, double tileScale)
+{
+    const RS_Bounds& extents = cell.extents;
+    if (extents.minx > extents.maxx || extents.miny > extents.maxy)
+        return -1;
+
+    // the extents don't include the line weights, or the anti-aliasing
+    double weight = 0.0;
+    for (unsigned int i=0; i<cell.symbol->size(); ++i)
+    {
+        SE_RenderPrimitive* primitive = (*cell.symbol)[i];
+        if (primitive->type == SE_RenderPrimitive_Polygon || primitive->type == SE_RenderPrimitive_Polyline)
+            weight = rs_max(weight, ((SE_RenderPolyline*)primitive)->lineStroke.weight);
+    }
+    double margin = 0.5 * weight * tileScale + 1.0;
+
+    // the cell extents in tile pixels
+    RS_Bounds bounds(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+    double corners[8] = { extents.minx, extents.miny, extents.maxx, extents.miny,
+                          extents.maxx, extents.maxy, extents.minx, extents.maxy };
+    for (int i=0; i<8; i+=2)
+    {
+        RS_F_Point pt;
+        tileXform.transform(corners[i], corners[i+1], pt.x, pt.y);
+        bounds.add_point(pt);
+    }
+
+    // the grid cells whose copies reach into the tile
+    int i0 = (int)floor((-bounds.maxx - margin) / tileWidth) + 1;
+    int i1 = (int)ceil((tileWidth - bounds.minx + margin) / tileWidth) - 1;
+    int j0 = (int)floor((-bounds.maxy - margin) / tileHeight) + 1;
+    int j1 = (int)ceil((tileHeight - bounds.miny + margin) / tileHeight) - 1;
+    if ((double)(i1 - i0 + 1) * (j1 - j0 + 1) > MAX_PATTERN_CELL_COPIES)
+        return -1;
+
+    // batched draws go to the rasterizer which was current when they were made
+    FlushDrawBatch();
+    m_tileRasterizer.Reset(tileWidth, tileHeight, 0);
+    m_target = &m_tileRasterizer;
+
+    for (int j=j0; j<=j1; ++j)
+    {
+        for (int i=i0; i<=i1; ++i)
+        {
+            SE_Matrix xform = tileXform;
+            xform.translate(i * tileWidth, j * tileHeight);
+            DrawPreparedSymbol(cell, xform, tileAngleRad);
+        }
+    }
+
+    FlushDrawBatch();
+    m_target = &m_rasterizer;
+
+    m_tileRasterizer.Render(1);
+    return m_rasterizer.AddImage(m_tileRasterizer.GetPixels(), tileWidth, tileHeight);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_ImageRenderer::YPointsUp()
+{
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::GetWorldToScreenTransform(SE_Matrix& xform)
+{
+    xform.x0 = m_scale;
+    xform.x1 = 0.0;
+    xform.x2 = -m_extents.minx * m_scale;
+    xform.y0 = 0.0;
+    xform.y1 = -m_scale;
+    xform.y2 = m_height + m_extents.miny * m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::WorldToScreenPoint(double& inx, double& iny, double& ox, double& oy)
+{
+    ox = (inx - m_extents.minx) * m_scale;
+    oy = m_height - (iny - m_extents.miny) * m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::ScreenToWorldPoint(double& inx, double& iny, double& ox, double& oy)
+{
+    ox = inx / m_scale + m_extents.minx;
+    oy = (m_height - iny) / m_scale + m_extents.miny;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_ImageRenderer::GetScreenUnitsPerMillimeterDevice()
+{
+    return m_dpi / MILLIMETERS_PER_INCH;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_ImageRenderer::GetScreenUnitsPerMillimeterWorld()
+{
+    return m_scale * 0.001 / m_metersPerUnit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_ImageRenderer::GetScreenUnitsPerPixel()
+{
+    return 1.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_FontEngine* SE_ImageRenderer::GetRSFontEngine()
+{
+    return &m_fontEngine;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::ProcessSELabelGroup(SE_LabelInfo*   labels,
+                                           int             nlabels,
+                                           RS_OverpostType type,
+                                           bool            exclude,
+                                           LineBuffer*     path)
+{
+    m_labeler->ProcessLabelGroup(labels, nlabels, type, exclude, path);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_ImageRenderer::AddExclusionRegion(RS_F_Point* fpts, int npts)
+{
+    m_labeler->AddExclusionRegion(fpts, npts);
+}
@@ -0,0 +1,242 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_IMAGERENDERER_H_
+#define SE_IMAGERENDERER_H_
+
+#include "SE_Renderer.h"
+#include "SE_Rasterizer.h"
+#include "RS_FontEngine.h"
+#include "RS_Font.h"
+#include <map>
+
+class LabelRendererBase;
+class LabelRendererLocal;
+class LabelPlacementStore;
+
+
+//---------------------------------------------
+// Font engine used by SE_ImageRenderer.  There are no font files to load,
+// so text is measured using generic advance widths and drawn "greeked":
+// each character is drawn as a block of its approximate ink extent.
+//---------------------------------------------
+
+class SE_ImageFontEngine : public RS_FontEngine
+{
+public:
+    STYLIZATION_API SE_ImageFontEngine();
+    STYLIZATION_API virtual ~SE_ImageFontEngine();
+
+    STYLIZATION_API virtual void MeasureString(const RS_String& s,
+                                               double           height,
+                                               const RS_Font*   font,
+                                               double           angleRad,
+                                               RS_F_Point*      res,
+                                               float*           offsets);
+
+    STYLIZATION_API virtual void DrawString(const RS_String& s,
+                                            double           x,
+                                            double           y,
+                                            double           width,
+                                            double           height,
+                                            const RS_Font*   font,
+                                            RS_Color&        color,
+                                            double           angleRad);
+
+    STYLIZATION_API virtual const RS_Font* FindFont(RS_FontDef& def);
+
+private:
+    RS_Font m_font;
+    LineBuffer m_glyphs;
+};
+
+
+//---------------------------------------------
+// Self-contained renderer which rasterizes the SE_Renderer draw calls into
+// an anti-aliased 32 bit image using SE_Rasterizer.  Drawing is deferred
+// until EndMap, when labels are placed and the image is rendered in bands
+// on multiple threads.
+//
+// Labels are placed over the whole image by LabelRenderer, or when local
+// overposting is requested by LabelRendererLocal, which keeps labels near
+// the map edges consistent with the neighbouring tiles of a tiled map.
+//
+// Pattern fills are drawn by rendering the pattern cell once into a tile,
+// which is kept for the rest of the map when the style is constant, and
+// filling the polygon with the repeated tile.
+//
+// The map extents are mapped to the image with y pointing down.  Raster
+// symbols are drawn if their data is uncompressed (ARGB, ABGR or RGB);
+// there are no image codecs.  Legacy polygons and polylines are drawn with
+// their solid fill and outline, while legacy markers and DWF content are
+// ignored.
+//---------------------------------------------
+
+class SE_ImageRenderer : public SE_Renderer
+{
+public:
+    STYLIZATION_API SE_ImageRenderer(int width, int height, RS_Color& bgColor,
+                                     bool localOverposting = false, double tileExtentOffset = 0.0);
+    STYLIZATION_API virtual ~SE_ImageRenderer();
+
+    // premultiplied ARGB pixels, top row first - valid after EndMap
+    inline const unsigned int* GetImage() const { return m_rasterizer.GetPixels(); }
+    inline int GetImageWidth() const { return m_width; }
+    inline int GetImageHeight() const { return m_height; }
+
+    // copies the image, or a rectangle of it, into non-premultiplied RGBA bytes
+    STYLIZATION_API void GetImageRGBA(std::vector<unsigned char>& rgba);
+    STYLIZATION_API void GetImageRGBA(int x, int y, int width, int height, std::vector<unsigned char>& rgba);
+
+    // the number of threads used to rasterize (zero means one per core)
+    inline void SetNumThreads(int numThreads) { m_numThreads = numThreads; }
+
+    // With local overposting, sets the store used to keep the labels near
+    // the tile edges consistent with neighbouring tiles rendered later (see
+    // LabelRendererLocal::SetPlacementStore).  Ignored otherwise.
+    STYLIZATION_API void SetLabelPlacementStore(LabelPlacementStore* store);
+
+    ///////////////////////////////////
+    // Renderer implementation
+
+    STYLIZATION_API virtual void StartMap(RS_MapUIInfo* mapInfo, RS_Bounds& extents, double mapScale,
+                                          double dpi, double metersPerUnit, CSysTransformer* xformToLL);
+    STYLIZATION_API virtual void EndMap();
+
+    STYLIZATION_API virtual void StartLayer(RS_LayerUIInfo* layerInfo, RS_FeatureClassInfo* classInfo);
+    STYLIZATION_API virtual void EndLayer();
+
+    STYLIZATION_API virtual void StartFeature(RS_FeatureReader* feature, bool initialPass,
+                                              const RS_String* tooltip = NULL, const RS_String* url = NULL,
+                                              const RS_String* theme = NULL, double zOffset = 0.0,
+                                              double zExtrusion = 0.0,
+                                              RS_ElevationType zOffsetType = RS_ElevationType_RelativeToGround);
+
+    STYLIZATION_API virtual void ProcessPolygon(LineBuffer* lb, RS_FillStyle& fill);
+    STYLIZATION_API virtual void ProcessPolyline(LineBuffer* lb, RS_LineStroke& lsym);
+    STYLIZATION_API virtual void ProcessRaster(unsigned char* data, int length, RS_ImageFormat format,
+                                               int width, int height, RS_Bounds& extents,
+                                               TransformMesh* xformMesh = NULL);
+    STYLIZATION_API virtual void ProcessMarker(LineBuffer* lb, RS_MarkerDef& mdef, bool allowOverpost,
+                                               RS_Bounds* bounds = NULL);
+    STYLIZATION_API virtual void ProcessLabelGroup(RS_LabelInfo* labels, int nlabels, const RS_String& text,
+                                                   RS_OverpostType type, bool exclude, LineBuffer* path,
+                                                   double scaleLimit);
+    STYLIZATION_API virtual void AddDWFContent(RS_InputStream* in, CSysTransformer* xformer,
+                                               const RS_String& section, const RS_String& passwd,
+                                               const RS_String& w2dfilter);
+
+    STYLIZATION_API virtual void SetSymbolManager(RS_SymbolManager* manager);
+
+    STYLIZATION_API virtual RS_MapUIInfo* GetMapInfo();
+    STYLIZATION_API virtual RS_LayerUIInfo* GetLayerInfo();
+    STYLIZATION_API virtual RS_FeatureClassInfo* GetFeatureClassInfo();
+
+    STYLIZATION_API virtual double GetMapScale();
+    STYLIZATION_API virtual double GetDrawingScale();
+    STYLIZATION_API virtual double GetMetersPerUnit();
+    STYLIZATION_API virtual double GetDpi();
+    STYLIZATION_API virtual RS_Bounds& GetBounds();
+
+    STYLIZATION_API virtual bool RequiresClipping();
+    STYLIZATION_API virtual bool RequiresLabelClipping();
+    STYLIZATION_API virtual bool SupportsZ();
+
+    ///////////////////////////////////
+    // SE_Renderer implementation
+
+    STYLIZATION_API virtual void DrawScreenPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke);
+    STYLIZATION_API virtual void DrawScreenPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill);
+    STYLIZATION_API virtual void DrawScreenRaster(unsigned char* data, int length,
+                                                  RS_ImageFormat format, int native_width, int native_height,
+                                                  double x, double y, double w, double h, double angleDeg);
+    STYLIZATION_API virtual void DrawScreenRaster(unsigned char* data, int length,
+                                                  RS_ImageFormat format, int native_width, int native_height,
+                                                  double x, double y, double w, double h, double angleDeg,
+                                                  double alpha);
+    STYLIZATION_API virtual void DrawScreenText(const RS_TextMetrics& tm, RS_TextDef& tdef, double insx, double insy,
+                                                RS_F_Point* path, int npts, double param_position);
+    STYLIZATION_API virtual bool DrawScreenPatternFill(LineBuffer* polygon, SE_PreparedSymbol& cell, const SE_Matrix& cellXform,
+                                                       double cellAngleRad, double repeatX, double repeatY, double angleRad,
+                                                       unsigned int cellId);
+
+    STYLIZATION_API virtual bool YPointsUp();
+    STYLIZATION_API virtual void GetWorldToScreenTransform(SE_Matrix& xform);
+    STYLIZATION_API virtual void WorldToScreenPoint(double& inx, double& iny, double& ox, double& oy);
+    STYLIZATION_API virtual void ScreenToWorldPoint(double& inx, double& iny, double& ox, double& oy);
+
+    STYLIZATION_API virtual double GetScreenUnitsPerMillimeterDevice();
+    STYLIZATION_API virtual double GetScreenUnitsPerMillimeterWorld();
+    STYLIZATION_API virtual double GetScreenUnitsPerPixel();
+
+    STYLIZATION_API virtual RS_FontEngine* GetRSFontEngine();
+
+    STYLIZATION_API virtual void ProcessSELabelGroup(SE_LabelInfo* labels, int nlabels, RS_OverpostType type,
+                                                     bool exclude, LineBuffer* path = NULL);
+
+    STYLIZATION_API virtual void AddExclusionRegion(RS_F_Point* fpts, int npts);
+
+private:
+    // identifies a pattern tile - the cell id, the tile size and the cell
+    // transform and angle in the tile, with the doubles rounded
+    struct PatternTileKey
+    {
+        unsigned int cellId;
+        long long values[7];
+
+        bool operator<(const PatternTileKey& other) const;
+    };
+
+    int GetRasterImage(unsigned char* data, int length, RS_ImageFormat format, int width, int height);
+    int RenderPatternTile(SE_PreparedSymbol& cell, const SE_Matrix& tileXform, double tileAngleRad,
+                          int tileWidth, int tileHeight, double tileScale);
+    void AddPath(LineBuffer* lb, const SE_Matrix* xform);
+
+    SE_Rasterizer m_rasterizer;
+    SE_Rasterizer m_tileRasterizer;
+    SE_Rasterizer* m_target;                // where the screen draw calls go
+    SE_ImageFontEngine m_fontEngine;
+    LabelRendererBase* m_labeler;
+    LabelRendererLocal* m_localLabeler;     // m_labeler, with local overposting
+
+    int m_width;
+    int m_height;
+    RS_Color m_bgColor;
+    int m_numThreads;
+
+    RS_MapUIInfo* m_mapInfo;
+    RS_LayerUIInfo* m_layerInfo;
+    RS_FeatureClassInfo* m_fcInfo;
+
+    RS_Bounds m_extents;
+    double m_mapScale;
+    double m_dpi;
+    double m_metersPerUnit;
+
+    // world to screen scale, in pixels per mapping unit
+    double m_scale;
+
+    // rasterizer images for the symbol image data drawn so far
+    std::map<const unsigned char*, int> m_rasterImages;
+    std::vector<unsigned int> m_decoded;
+    std::vector<double> m_pts;
+
+    // rasterizer images for the pattern tiles of constant styles
+    std::map<PatternTileKey, int> m_patternTiles;
+};
+
+#endif
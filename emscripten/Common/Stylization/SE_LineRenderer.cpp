@@ -20,6 +20,8 @@
 #include "SE_BufferPool.h"
 #include "RS_FontEngine.h"
 
+// contours with more points than this allocate their hotspots on the heap
+const int MAX_STACK_HOTSPOTS = 512;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Used with ProcessLineOverlapWrap
@@ -210,8 +212,10 @@ const double OPTIMIZE_DISTANCE_SQ = 1.96;
 //
 // ============================================================================
 
-void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyle* style)
+void SE_Renderer::ProcessLineOverlapWrap(SE_PathMeasure& measure, SE_RenderLineStyle* style)
 {
+    LineBuffer* geometry = measure.GetGeometry();
+
     _ASSERT(style->repeat > 0.0);
 
     // the style needs to contain at least one primitive
@@ -219,6 +223,10 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
     if (prims.size() == 0)
         return;
 
+    // the symbol is drawn many times along the line - prepare it once
+    SE_PreparedSymbol prepared;
+    PrepareSymbol(prims, prepared);
+
     SE_BufferPool* lbp = GetBufferPool();
 
     RS_FontEngine* fe = GetRSFontEngine();
@@ -246,13 +254,24 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
     }
 
     LineBuffer** choppedBuffers = NULL;
+    std::vector<HotSpot> heapHotspots;
 
     // this try-catch is used to catch possible out-of-memory exceptions with the
     // chopped buffers
     try
     {
-        // allocate the hotspot array on the stack for performance
-        HotSpot* hotspots = (HotSpot*)alloca(maxPoints * sizeof(HotSpot));
+        // allocate the hotspot array on the stack for performance, unless
+        // the geometry is too large
+        HotSpot* hotspots;
+        if (maxPoints <= MAX_STACK_HOTSPOTS)
+        {
+            hotspots = (HotSpot*)alloca(maxPoints * sizeof(HotSpot));
+        }
+        else
+        {
+            heapHotspots.resize(maxPoints);
+            hotspots = &heapHotspots[0];
+        }
 
         // Create a "chopped up" LineBuffer for each polyline / polygon primitive
         // in the symbol.  We need this because straight lines become curved when
@@ -335,7 +354,7 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
 
             // make a list of hotspots where we go from one join to another
             // or from join to straight line or from straight line to join
-            int ptCount = ConfigureHotSpots(geometry, cur_contour, style, styleBounds, hotspots);
+            int ptCount = ConfigureHotSpots(measure, cur_contour, style, styleBounds, hotspots);
             double total_length = hotspots[ptCount-1].mid;
 
             // get the distribution for the current contour
@@ -437,7 +456,7 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
                 {
                     // We're not yet in danger of a corner (or the start/end of the distribution).
                     // Just put the pedal to the metal and draw an unwarped symbol.
-                    DrawSymbol(prims, xformStart, next_hotspot->angle_start);
+                    DrawPreparedSymbol(prepared, xformStart, next_hotspot->angle_start);
 
                     drawpos += repeat;
                     sym_minx = drawpos + styleBounds.minx;
@@ -876,7 +895,7 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
 
                                     if (geomToDraw)
                                     {
-                                        DrawScreenPolygon(geomToDraw, NULL, pl->fill);
+                                        DrawStylePolygon(geomToDraw, NULL, pl->fill);
                                         if (spLB.get())
                                             LineBufferPool::FreeLineBuffer(lbp, spLB.release());
                                     }
@@ -910,7 +929,7 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
 
                                     if (geomToDraw)
                                     {
-                                        DrawScreenPolyline(geomToDraw, NULL, pl->lineStroke);
+                                        DrawStylePolyline(geomToDraw, NULL, pl->lineStroke);
                                         if (spLB.get())
                                             LineBufferPool::FreeLineBuffer(lbp, spLB.release());
                                     }
@@ -937,7 +956,10 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
                                     // We must recalculate the text metrics with the new tdef before we can call DrawScreenText.
                                     RS_TextMetrics tm;
                                     if (fe->GetTextMetrics(tp->content, tdef, tm, false))
+                                    {
+                                        FlushDrawBatch();
                                         DrawScreenText(tm, tdef, x, y, NULL, 0, 0.0);
+                                    }
                                 }
                             }
                             break;
@@ -959,6 +981,7 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
                                         geom.get_point(0, x, y);
                                         double angleDeg = (rp->angleRad + last_angleRad) * M_180PI;
 
+                                        FlushDrawBatch();
                                         DrawScreenRaster(imgData.data, imgData.size, imgData.format, imgData.width, imgData.height, x, y, rp->extent[0], rp->extent[1], angleDeg);
                                     }
                                 }
@@ -1002,9 +1025,11 @@ void SE_Renderer::ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyl
 // This method configures hotspots for the supplied feature geometry.
 // Hotspots contain all the information needed to render the warped
 // symbol distribution for the polyline.
-int SE_Renderer::ConfigureHotSpots(LineBuffer* geometry, int cur_contour, SE_RenderLineStyle* style,
+int SE_Renderer::ConfigureHotSpots(SE_PathMeasure& measure, int cur_contour, SE_RenderLineStyle* style,
                                    RS_Bounds& styleBounds, HotSpot* hotspots)
 {
+    LineBuffer* geometry = measure.GetGeometry();
+
     // This value is used when computing the miter warping.  The maximum
     // warp occurs at + or - affected_height from the centerline and all
     // intermediate warp values are just a fraction of that maximum warp.
@@ -1013,7 +1038,7 @@ int SE_Renderer::ConfigureHotSpots(LineBuffer* geometry, int cur_contour, SE_Ren
     bool is_closed = geometry->contour_closed(cur_contour);
 
     // initialize hotspot vertices to the set of reduced points
-    int ptCount = ComputePoints(geometry, cur_contour, hotspots);
+    int ptCount = ComputePoints(measure, cur_contour, hotspots);
     _ASSERT(ptCount >= 2);
 
     // compute the parametric positions and entry/exit angles for the hotspots
@@ -1461,8 +1486,10 @@ int SE_Renderer::ConfigureHotSpots(LineBuffer* geometry, int cur_contour, SE_Ren
 // the hotspot vertices to the reduced set of points.
 // TODO: WCW - enhance the point reduction to replace each blob of
 //             closely spaced points with its average position
-int SE_Renderer::ComputePoints(LineBuffer* geometry, int cur_contour, HotSpot* hotspots)
+int SE_Renderer::ComputePoints(SE_PathMeasure& measure, int cur_contour, HotSpot* hotspots)
 {
+    LineBuffer* geometry = measure.GetGeometry();
+
     double ds = GetDrawingScale();
     double d2min = ds*ds*OPTIMIZE_DISTANCE_SQ;
 
@@ -1493,7 +1520,7 @@ int SE_Renderer::ComputePoints(LineBuffer* geometry, int cur_contour, HotSpot* h
 
         skipped = false;
 
-        WorldToScreenPoint(x, y, hotspots[ptCount].x, hotspots[ptCount].y);
+        measure.GetScreenPoint(start_index+i, hotspots[ptCount].x, hotspots[ptCount].y);
         ++ptCount;
 
         lastx = x;
@@ -1539,8 +1566,8 @@ int SE_Renderer::ComputePoints(LineBuffer* geometry, int cur_contour, HotSpot* h
     // last point, then simply reset the final hotspot position to the last point.
     if (skipped)
     {
-        // the last point is still stored in x,y
-        WorldToScreenPoint(x, y, hotspots[ptCount-1].x, hotspots[ptCount-1].y);
+        // the last point is the final point of the contour
+        measure.GetScreenPoint(start_index+numPoints-1, hotspots[ptCount-1].x, hotspots[ptCount-1].y);
     }
 
     return ptCount;
@@ -1862,8 +1889,10 @@ int SE_Renderer::ClipCode(double zMin, double zMax, double z)
 
 ///////////////////////////////////////////////////////////////////////////////
 // Distributes symbols along a polyline using the OverlapNone vertex control option.
-void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyle* style)
+void SE_Renderer::ProcessLineOverlapNone(SE_PathMeasure& measure, SE_RenderLineStyle* style)
 {
+    LineBuffer* geometry = measure.GetGeometry();
+
     _ASSERT(style->repeat > 0.0);
 
     // the style needs to contain at least one primitive
@@ -1871,6 +1900,10 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
     if (prims.size() == 0)
         return;
 
+    // the symbol is drawn many times along the line - prepare it once
+    SE_PreparedSymbol prepared;
+    PrepareSymbol(prims, prepared);
+
     SE_Matrix symxf;
     bool yUp = YPointsUp();
     double px2su = GetScreenUnitsPerPixel();
@@ -1906,12 +1939,7 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
     double rightEdge = style->bounds[1].x;
 
     // get segment lengths
-    double* segLens = (double*)alloca(sizeof(double)*geometry->point_count());
-    ComputeSegmentLengths(geometry, segLens);
-
-    // used for segment group calculations
-    int* segGroups = (int*)alloca(2*sizeof(int)*geometry->point_count());
-    double* groupLens = (double*)alloca(sizeof(double)*geometry->point_count());
+    const double* segLens = measure.SegmentLengths();
 
     // configure the default path line stroke to use
     SE_LineStroke dpLineStroke = style->dpLineStroke;
@@ -1967,12 +1995,11 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
             continue;
 
         // compute the segment groups for this contour based on the vertex angle limit
-        int numGroups = ComputeSegmentGroups(geometry, j, style->vertexAngleLimit, segLens, segGroups);
+        int numGroups = measure.ComputeSegmentGroups(j, style->vertexAngleLimit);
         if (numGroups == 0)
             continue;
 
-        // compute the group lengths
-        ComputeGroupLengths(segLens, numGroups, segGroups, groupLens);
+        const int* segGroups = measure.SegmentGroups();
 
         // for this vertex control option we set the offsets to zero if they're unspecified
         startOffset = rs_max(startOffset, 0.0);
@@ -1984,14 +2011,14 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
         {
             for (int k=0; k<numGroups; ++k)
             {
-                if (startOffset < groupLens[k])
+                if (startOffset < measure.GroupLength(k))
                 {
                     start_group = k;
                     break;
                 }
 
                 // adjust the start offset so it's relative to the starting group
-                startOffset -= groupLens[k];
+                startOffset -= measure.GroupLength(k);
             }
         }
 
@@ -2001,14 +2028,14 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
         {
             for (int k=numGroups-1; k>=0; --k)
             {
-                if (endOffset < groupLens[k])
+                if (endOffset < measure.GroupLength(k))
                 {
                     end_group = k;
                     break;
                 }
 
                 // adjust the end offset so it's relative to the ending group
-                endOffset -= groupLens[k];
+                endOffset -= measure.GroupLength(k);
             }
         }
 
@@ -2048,7 +2075,7 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
             int numSymbols = 0;
             double drawpos = startOffsetGroup;
             double gap = 0.0;
-            ComputeGroupDistribution(groupLens[k], startOffsetGroup, endOffsetGroup, repeat,
+            ComputeGroupDistribution(measure.GroupLength(k), startOffsetGroup, endOffsetGroup, repeat,
                                      rightEdge - leftEdge, drawpos, gap, numSymbols);
             if (numSymbols == 0)
                 continue;
@@ -2061,7 +2088,7 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
             double increment;
 
             // get start point of first segment in screen space
-            WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX0, segY0);
+            measure.GetScreenPoint(cur_seg, segX0, segY0);
 
             while (cur_seg < end_seg)
             {
@@ -2073,7 +2100,7 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
                     continue;
 
                 // get end point of current segment in screen space
-                WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX1, segY1);
+                measure.GetScreenPoint(cur_seg, segX1, segY1);
 
                 // if our draw position falls within this segment then process
                 if (drawpos <= len)
@@ -2133,13 +2160,13 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
                                 // aligning it with the left edge of the symbol
                                 // TODO: account for symbol rotation
                                 vertexLines.LineTo(symxf.x2 + dx_incr*leftEdge, symxf.y2 + dy_incr*leftEdge);
-                                DrawScreenPolyline(&vertexLines, NULL, dpLineStroke);
+                                DrawStylePolyline(&vertexLines, NULL, dpLineStroke);
                                 vertexLines.Reset();
                             }
 
                             // only draw symbols at the interior points
                             if (numDrawn > 0 && numDrawn < numSymbols-1)
-                                DrawSymbol(prims, symxf, angleRad, style->addToExclusionRegion);
+                                DrawPreparedSymbol(prepared, symxf, angleRad, style->addToExclusionRegion);
 
                             // handle the centerline path at the group's end - only
                             // need to do this if we have at least one interior symbol
@@ -2160,7 +2187,7 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
                                 vertexLines.LineTo(symxf.x2, symxf.y2);
                                 if (k == end_group)
                                 {
-                                    DrawScreenPolyline(&vertexLines, NULL, dpLineStroke);
+                                    DrawStylePolyline(&vertexLines, NULL, dpLineStroke);
                                     vertexLines.Reset();
                                 }
                             }
@@ -2219,8 +2246,10 @@ void SE_Renderer::ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyl
 //     then no symbols are drawn
 //   - if StartOffset and EndOffset are both unspecified (< 0) then no symbols
 //     are drawn
-void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineStyle* style)
+void SE_Renderer::ProcessLineOverlapDirect(SE_PathMeasure& measure, SE_RenderLineStyle* style)
 {
+    LineBuffer* geometry = measure.GetGeometry();
+
     _ASSERT(style->repeat > 0.0);
 
     // the style needs to contain at least one primitive
@@ -2228,6 +2257,10 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
     if (prims.size() == 0)
         return;
 
+    // the symbol is drawn many times along the line - prepare it once
+    SE_PreparedSymbol prepared;
+    PrepareSymbol(prims, prepared);
+
     SE_Matrix symxf;
     bool yUp = YPointsUp();
     double px2su = GetScreenUnitsPerPixel();
@@ -2259,12 +2292,7 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
     double segX0, segY0, segX1, segY1;
 
     // get segment lengths
-    double* segLens = (double*)alloca(sizeof(double)*geometry->point_count());
-    ComputeSegmentLengths(geometry, segLens);
-
-    // used for segment group calculations
-    int* segGroups = (int*)alloca(2*sizeof(int)*geometry->point_count());
-    double* groupLens = (double*)alloca(sizeof(double)*geometry->point_count());
+    const double* segLens = measure.SegmentLengths();
 
     // iterate over the contours
     for (int j=0; j<geometry->cntr_count(); ++j)
@@ -2307,12 +2335,11 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
             continue;
 
         // compute the segment groups for this contour based on the vertex angle limit
-        int numGroups = ComputeSegmentGroups(geometry, j, style->vertexAngleLimit, segLens, segGroups);
+        int numGroups = measure.ComputeSegmentGroups(j, style->vertexAngleLimit);
         if (numGroups == 0)
             continue;
 
-        // compute the group lengths
-        ComputeGroupLengths(segLens, numGroups, segGroups, groupLens);
+        const int* segGroups = measure.SegmentGroups();
 
         // compute the starting group based on the style's start offset
         int start_group = 0;
@@ -2320,14 +2347,14 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
         {
             for (int k=0; k<numGroups; ++k)
             {
-                if (startOffset < groupLens[k])
+                if (startOffset < measure.GroupLength(k))
                 {
                     start_group = k;
                     break;
                 }
 
                 // adjust the start offset so it's relative to the starting group
-                startOffset -= groupLens[k];
+                startOffset -= measure.GroupLength(k);
             }
         }
 
@@ -2337,14 +2364,14 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
         {
             for (int k=numGroups-1; k>=0; --k)
             {
-                if (endOffset < groupLens[k])
+                if (endOffset < measure.GroupLength(k))
                 {
                     end_group = k;
                     break;
                 }
 
                 // adjust the end offset so it's relative to the ending group
-                endOffset -= groupLens[k];
+                endOffset -= measure.GroupLength(k);
             }
         }
 
@@ -2384,7 +2411,7 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
             int numSymbols = 0;
             double drawpos = startOffsetGroup;
             double gap = 0.0;
-            ComputeGroupDistribution(groupLens[k], startOffsetGroup, endOffsetGroup, repeat, 0.0,
+            ComputeGroupDistribution(measure.GroupLength(k), startOffsetGroup, endOffsetGroup, repeat, 0.0,
                                      drawpos, gap, numSymbols);
             if (numSymbols == 0)
                 continue;
@@ -2397,7 +2424,7 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
             double increment;
 
             // get start point of first segment in screen space
-            WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX0, segY0);
+            measure.GetScreenPoint(cur_seg, segX0, segY0);
 
             while (cur_seg < end_seg)
             {
@@ -2409,7 +2436,7 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
                     continue;
 
                 // get end point of current segment in screen space
-                WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX1, segY1);
+                measure.GetScreenPoint(cur_seg, segX1, segY1);
 
                 // if our draw position falls within this segment then process
                 if (drawpos <= len)
@@ -2452,7 +2479,7 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
                             if (style->drawLast)
                                 AddLabel(geometry, style, symxf, angleRad);
                             else
-                                DrawSymbol(prims, symxf, angleRad, style->addToExclusionRegion);
+                                DrawPreparedSymbol(prepared, symxf, angleRad, style->addToExclusionRegion);
                         }
 
                         ++numDrawn;
@@ -2485,7 +2512,7 @@ void SE_Renderer::ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineSt
 
 ///////////////////////////////////////////////////////////////////////////////
 // Distributes feature labels along a polyline.
-void SE_Renderer::ProcessLineLabels(LineBuffer* geometry, SE_RenderLineStyle* style)
+void SE_Renderer::ProcessLineLabels(LineBuffer* geometry, SE_RenderLineStyle* style, SE_PathMeasure* measure)
 {
     // the style needs to contain at least one primitive
     SE_RenderPrimitiveList& prims = style->symbol;
@@ -2531,16 +2558,19 @@ void SE_Renderer::ProcessLineLabels(LineBuffer* geometry, SE_RenderLineStyle* st
     // next) plus the symbol width
     repeat += symWidth;
 
-    // get the segment lengths
-    double* segLens = (double*)alloca(sizeof(double)*geometry->point_count());
-    ComputeSegmentLengths(geometry, segLens);
+    // measure the geometry, unless the caller already has
+    SE_PathMeasure localMeasure;
+    if (!measure)
+        measure = &localMeasure;
+    measure->Build(geometry, this);
+
+    const double* segLens = measure->SegmentLengths();
 
     // iterate over the contours
     for (int j=0; j<geometry->cntr_count(); ++j)
     {
-        // get segment range for current contour
+        // get starting segment for current contour
         int start_seg = geometry->contour_start_point(j);
-        int   end_seg = geometry->contour_end_point(j);
 
         // skip contours shorter than the symbol width
         double contourLen = segLens[start_seg];
@@ -2559,240 +2589,53 @@ void SE_Renderer::ProcessLineLabels(LineBuffer* geometry, SE_RenderLineStyle* st
         // draw symbols along the contour
         //-------------------------------------------------------
 
-        int numDrawn = 0;
-        int cur_seg = start_seg;
-        double drawpos = startOffset;
-
-        // get start point of first segment in screen space
-        WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX0, segY0);
-
-        while (cur_seg < end_seg)
+        for (int numDrawn=0; numDrawn<numSymbols; ++numDrawn)
         {
-            ++cur_seg;
-
-            // skip zero-length segments - no need to update the start/end points
-            double len = segLens[cur_seg];
-            if (len == 0.0)
-                continue;
+            double dist = startOffset + numDrawn * repeat;
 
-            // get end point of current segment in screen space
-            WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX1, segY1);
+            // find the segment containing the draw position
+            int cur_seg = measure->FindSegment(j, dist);
+            if (cur_seg < 0)
+                break;
 
-            // if our draw position falls within this segment then process
-            if (drawpos <= len)
-            {
-                // compute linear deltas for x and y directions - we will use these
-                // to quickly move along the line without having to do too much math
-                double invlen = 1.0 / len;
-                double dx_incr = (segX1 - segX0) * invlen;
-                double dy_incr = (segY1 - segY0) * invlen;
-
-                if (style->angleControl == SE_AngleControl_FromGeometry)
-                {
-                    angleCos = dx_incr*baseAngleCos - dy_incr*baseAngleSin;
-                    angleSin = dy_incr*baseAngleCos + dx_incr*baseAngleSin;
-                    angleRad = atan2(dy_incr, dx_incr);
+            double len = segLens[cur_seg];
+            double drawpos = dist - measure->DistanceAlong(cur_seg-1);
 
-                    // since dy_incr and dx_incr are in renderer space we need to
-                    // negate the angle if y points down
-                    if (!yUp)
-                        angleRad = -angleRad;
+            // get the segment's end points in screen space
+            measure->GetScreenPoint(cur_seg-1, segX0, segY0);
+            measure->GetScreenPoint(cur_seg, segX1, segY1);
 
-                    angleRad += baseAngleRad;
-                }
-                double tx = segX0 + dx_incr * drawpos;
-                double ty = segY0 + dy_incr * drawpos;
+            // compute linear deltas for x and y directions
+            double invlen = 1.0 / len;
+            double dx_incr = (segX1 - segX0) * invlen;
+            double dy_incr = (segY1 - segY0) * invlen;
 
-                symxf.setIdentity();
-                symxf.rotate(angleSin, angleCos);
-                symxf.translate(tx, ty);
+            if (style->angleControl == SE_AngleControl_FromGeometry)
+            {
+                angleCos = dx_incr*baseAngleCos - dy_incr*baseAngleSin;
+                angleSin = dy_incr*baseAngleCos + dx_incr*baseAngleSin;
+                angleRad = atan2(dy_incr, dx_incr);
 
-                // loop-draw the symbol along the current segment, incrementing
-                // the draw position by the appropriate amount
-                while (drawpos <= len && numDrawn < numSymbols)
-                {
-                    AddLabel(geometry, style, symxf, angleRad);
-                    ++numDrawn;
+                // since dy_incr and dx_incr are in renderer space we need to
+                // negate the angle if y points down
+                if (!yUp)
+                    angleRad = -angleRad;
 
-                    // move forward
-                    symxf.translate(dx_incr*repeat, dy_incr*repeat);
-                    drawpos += repeat;
-                }
+                angleRad += baseAngleRad;
             }
+            double tx = segX0 + dx_incr * drawpos;
+            double ty = segY0 + dy_incr * drawpos;
 
-            drawpos -= len;
+            symxf.setIdentity();
+            symxf.rotate(angleSin, angleCos);
+            symxf.translate(tx, ty);
 
-            // start point for next segment is current end point
-            segX0 = segX1;
-            segY0 = segY1;
+            AddLabel(geometry, style, symxf, angleRad);
         }
     }
 }
 
 
-///////////////////////////////////////////////////////////////////////////////
-// This method computes the segment lengths for the geometry.  For a given
-// contour with N points starting at index M, the length for the entire
-// contour is stored at location M, while the segment lengths are stored at
-// locations M+n, n=[1, N-1].
-void SE_Renderer::ComputeSegmentLengths(LineBuffer* geometry, double* segLens)
-{
-    // screen coordinates of current line segment
-    double segX0, segY0, segX1, segY1;
-
-    // iterate over the contours
-    for (int j=0; j<geometry->cntr_count(); ++j)
-    {
-        // get segment range for current contour
-        int start_seg = geometry->contour_start_point(j);
-        int end_seg = geometry->contour_end_point(j);
-        int cur_seg = start_seg;
-
-        // compute lengths for the contour and all its segments
-        segLens[start_seg] = 0.0;
-
-        // get start point of first segment in screen space
-        WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX0, segY0);
-
-        while (cur_seg < end_seg)
-        {
-            ++cur_seg;
-
-            // get end point of current segment in screen space
-            WorldToScreenPoint(geometry->x_coord(cur_seg), geometry->y_coord(cur_seg), segX1, segY1);
-
-            // get segment length
-            double dx = segX1 - segX0;
-            double dy = segY1 - segY0;
-            double len = sqrt(dx*dx + dy*dy);
-
-            segLens[cur_seg] = len;
-            segLens[start_seg] += len;
-
-            // start point for next segment is current end point
-            segX0 = segX1;
-            segY0 = segY1;
-        }
-    }
-}
-
-
-///////////////////////////////////////////////////////////////////////////////
-// This method computes group lengths.  The segGroups array is the one
-// obtained from ComputeSegmentGroups.
-void SE_Renderer::ComputeGroupLengths(double* segLens, int numGroups, int* segGroups, double* groupLens)
-{
-    for (int j=0; j<numGroups; ++j)
-    {
-        // get segment range for group
-        int seg0 = segGroups[2*j];
-        int seg1 = segGroups[2*j+1];
-
-        // get the length of the group
-        groupLens[j] = 0.0;
-        for (int i=seg0+1; i<=seg1; ++i)
-            groupLens[j] += segLens[i];
-    }
-}
-
-
-///////////////////////////////////////////////////////////////////////////////
-// This method groups together segments for the specified contour based on
-// the supplied vertex angle limit.  Any pair of segments are part of the
-// same group if their relative angle is less then the vertex angle limit.
-// The integer array will contain the indices delineating the segments, i.e.
-// group 0 goes from index segGroups[0] to segGroups[1], group 1 goes from
-// segGroups[2] to segGroups[3], etc.  Each group is guranteed to start and
-// end with a non-generate segment.  The method returns the number of groups.
-int SE_Renderer::ComputeSegmentGroups(LineBuffer* geometry, int contour, double vertexAngleLimit, double* segLens, int* segGroups)
-{
-    // get segment range for specified contour
-    int start_seg = geometry->contour_start_point(contour);
-    int end_seg = geometry->contour_end_point(contour);
-
-    // skip zero-length contours
-    if (segLens[start_seg] == 0.0)
-        return 0;
-
-    // we have a non-degenerate contour - we'll get at least one group
-
-    // make sure vertex angle limit is positive and in the range [0, 180]
-    vertexAngleLimit = fabs(vertexAngleLimit);
-    vertexAngleLimit = rs_min(vertexAngleLimit, M_PI);
-    double cosLimit = cos(vertexAngleLimit);
-
-    // screen coordinates of current line segment
-    double segX0, segY0, segX1, segY1;
-
-    // keep track of number of groups
-    int numGroups = 0;
-
-    // find the initial group's starting segment (the first non-degenerate segment)
-    int cur_seg = start_seg + 1;
-    while (cur_seg <= end_seg && segLens[cur_seg] == 0.0)
-        ++cur_seg;
-
-    int group_min = cur_seg - 1;
-    int group_max = cur_seg;
-
-    // get the normalized vector for the segment
-    WorldToScreenPoint(geometry->x_coord(cur_seg-1), geometry->y_coord(cur_seg-1), segX0, segY0);
-    WorldToScreenPoint(geometry->x_coord(cur_seg  ), geometry->y_coord(cur_seg  ), segX1, segY1);
-    double dx0 = (segX1 - segX0) / segLens[cur_seg];
-    double dy0 = (segY1 - segY0) / segLens[cur_seg];
-
-    // iterate over the rest of the contour, adding groups as we find them
-    while (cur_seg < end_seg)
-    {
-        ++cur_seg;
-
-        // find next non-degenerate segment
-        while (cur_seg <= end_seg && segLens[cur_seg] == 0.0)
-            ++cur_seg;
-
-        // no more non-degenerate segments left - done processing the contour
-        if (cur_seg > end_seg)
-            break;
-
-        // get the normalized vector for the segment
-        WorldToScreenPoint(geometry->x_coord(cur_seg-1), geometry->y_coord(cur_seg-1), segX0, segY0);
-        WorldToScreenPoint(geometry->x_coord(cur_seg  ), geometry->y_coord(cur_seg  ), segX1, segY1);
-        double dx1 = (segX1 - segX0) / segLens[cur_seg];
-        double dy1 = (segY1 - segY0) / segLens[cur_seg];
-
-        // compare relative angles between current and previous segments
-        double cosAngle = dx0*dx1 + dy0*dy1;
-        if (cosAngle < cosLimit)
-        {
-            // vertex limit exceeded - record the existing group
-            segGroups[2*numGroups  ] = group_min;
-            segGroups[2*numGroups+1] = group_max;
-            ++numGroups;
-
-            // initialize the next group
-            group_min = cur_seg - 1;
-            group_max = cur_seg;
-        }
-        else
-        {
-            // vertex limit not exceeded - extend current group to this segment
-            group_max = cur_seg;
-        }
-
-        // current normalized vector becomes the old one
-        dx0 = dx1;
-        dy0 = dy1;
-    }
-
-    // record the final group
-    segGroups[2*numGroups  ] = group_min;
-    segGroups[2*numGroups+1] = group_max;
-    ++numGroups;
-
-    return numGroups;
-}
-
-
 ///////////////////////////////////////////////////////////////////////////////
 // Computes the point distribution for a group, given its start offset, end
 // end offset, and repeat.
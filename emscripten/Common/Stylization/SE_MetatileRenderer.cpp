@@ -0,0 +1,112 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_MetatileRenderer.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_MetatileRenderer::SE_MetatileRenderer(int tileWidth, int tileHeight, int metatileSize,
+                                         RS_Color& bgColor, double tileExtentOffset)
+: SE_ImageRenderer(tileWidth * rs_max(metatileSize, 1), tileHeight * rs_max(metatileSize, 1),
+                   bgColor, true, tileExtentOffset)
+, m_tileWidth(tileWidth)
+, m_tileHeight(tileHeight)
+, m_metatileSize(rs_max(metatileSize, 1))
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_MetatileRenderer::~SE_MetatileRenderer()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_Bounds SE_MetatileRenderer::GetMetatileExtents(const RS_Bounds& tileExtents, int col, int row,
+                                                  int metatileSize)
+{
+    double w = tileExtents.maxx - tileExtents.minx;
+    double h = tileExtents.maxy - tileExtents.miny;
+
+    // rows go down, so the block's top edge is above the tile's
+    double minx = tileExtents.minx - col * w;
+    double maxy = tileExtents.maxy + row * h;
+
+    return RS_Bounds(minx, maxy - metatileSize * h, minx + metatileSize * w, maxy);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_Bounds SE_MetatileRenderer::GetTileExtents(int col, int row)
+{
+    RS_Bounds& extents = GetBounds();
+    double w = extents.width() / m_metatileSize;
+    double h = extents.height() / m_metatileSize;
+
+    double minx = extents.minx + col * w;
+    double maxy = extents.maxy - row * h;
+
+    return RS_Bounds(minx, maxy - h, minx + w, maxy);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_MetatileRenderer::HasTile(int col, int row) const
+{
+    // a tile outside the image has no pixels
+    return col >= 0 && row >= 0
+        && (col + 1) * m_tileWidth <= GetImageWidth()
+        && (row + 1) * m_tileHeight <= GetImageHeight();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_MetatileRenderer::GetTile(int col, int row, std::vector<unsigned int>& pixels)
+{
+    if (!HasTile(col, row))
+    {
+        pixels.clear();
+        return;
+    }
+
+    pixels.resize((size_t)m_tileWidth * m_tileHeight);
+
+    const unsigned int* src = GetImage() + (size_t)row * m_tileHeight * GetImageWidth() + (size_t)col * m_tileWidth;
+    unsigned int* dst = &pixels[0];
+
+    for (int j=0; j<m_tileHeight; ++j)
+    {
+        memcpy(dst, src, m_tileWidth * sizeof(unsigned int));
+        src += GetImageWidth();
+        dst += m_tileWidth;
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_MetatileRenderer::GetTileRGBA(int col, int row, std::vector<unsigned char>& rgba)
+{
+    if (!HasTile(col, row))
+    {
+        rgba.clear();
+        return;
+    }
+
+    GetImageRGBA(col * m_tileWidth, row * m_tileHeight, m_tileWidth, m_tileHeight, rgba);
+}
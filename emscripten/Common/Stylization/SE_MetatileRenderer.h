@@ -0,0 +1,71 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_METATILERENDERER_H_
+#define SE_METATILERENDERER_H_
+
+#include "SE_ImageRenderer.h"
+
+
+//---------------------------------------------
+// Renders a block of N x N map tiles as one image, and then slices it into
+// the individual tiles.  The features in the buffer zone around a tile are
+// only read, stylized and labeled once per block instead of once per tile,
+// and labels are placed once over the whole block, so they never disagree
+// across the seams inside it.  Seams between blocks are handled by
+// LabelRendererLocal as for single tiles, with the block as the tile.
+//
+// Use it like a single tile renderer: call StartMap with the extents of the
+// whole block (see GetMetatileExtents), stylize the layers, call EndMap,
+// and then get the tiles.  Tile columns go left to right and rows top to
+// bottom.
+//---------------------------------------------
+
+class SE_MetatileRenderer : public SE_ImageRenderer
+{
+public:
+    STYLIZATION_API SE_MetatileRenderer(int tileWidth, int tileHeight, int metatileSize,
+                                        RS_Color& bgColor, double tileExtentOffset = 0.0);
+    STYLIZATION_API virtual ~SE_MetatileRenderer();
+
+    inline int GetMetatileSize() const { return m_metatileSize; }
+    inline int GetTileWidth() const { return m_tileWidth; }
+    inline int GetTileHeight() const { return m_tileHeight; }
+
+    // Returns the extents of the block which has the given tile at the given
+    // column and row.
+    STYLIZATION_API static RS_Bounds GetMetatileExtents(const RS_Bounds& tileExtents, int col, int row,
+                                                        int metatileSize);
+
+    // the map extents of one tile of the block - valid after StartMap
+    STYLIZATION_API RS_Bounds GetTileExtents(int col, int row);
+
+    // Copies one tile of the image, as premultiplied ARGB pixels or as
+    // non-premultiplied RGBA bytes - valid after EndMap.  Tiles outside the
+    // block are returned empty.
+    STYLIZATION_API void GetTile(int col, int row, std::vector<unsigned int>& pixels);
+    STYLIZATION_API void GetTileRGBA(int col, int row, std::vector<unsigned char>& rgba);
+
+private:
+    bool HasTile(int col, int row) const;
+
+    int m_tileWidth;
+    int m_tileHeight;
+    int m_metatileSize;
+};
+
+#endif
@@ -0,0 +1,195 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_PathMeasure.h"
+#include "SE_Renderer.h"
+
+#include <algorithm>
+
+
+SE_PathMeasure::SE_PathMeasure() :
+    m_geometry(NULL),
+    m_totalLen(0.0)
+{
+}
+
+
+void SE_PathMeasure::Reset()
+{
+    m_geometry = NULL;
+    m_totalLen = 0.0;
+}
+
+
+void SE_PathMeasure::Build(LineBuffer* geometry, SE_Renderer* renderer)
+{
+    if (geometry == m_geometry)
+        return;
+
+    m_geometry = geometry;
+    m_totalLen = 0.0;
+
+    // the buffers keep their capacity between features
+    int npts = geometry->point_count();
+    m_pts.resize(2*npts + 2);
+    m_segLens.resize(npts + 1);
+    m_cumLens.resize(npts + 1);
+    m_dirs.resize(2*npts + 2);
+    if (m_groups.size() < (size_t)(2*npts + 2))
+        m_groups.resize(2*npts + 2);
+
+    for (int i=0; i<npts; ++i)
+        renderer->WorldToScreenPoint(geometry->x_coord(i), geometry->y_coord(i), m_pts[2*i], m_pts[2*i+1]);
+
+    // iterate over the contours
+    for (int j=0; j<geometry->cntr_count(); ++j)
+    {
+        // get segment range for current contour
+        int start_seg = geometry->contour_start_point(j);
+        int end_seg = geometry->contour_end_point(j);
+
+        // compute lengths for the contour and all its segments
+        double contourLen = 0.0;
+        m_cumLens[start_seg] = 0.0;
+        m_dirs[2*start_seg] = m_dirs[2*start_seg+1] = 0.0;
+
+        for (int cur_seg=start_seg+1; cur_seg<=end_seg; ++cur_seg)
+        {
+            double dx = m_pts[2*cur_seg  ] - m_pts[2*cur_seg-2];
+            double dy = m_pts[2*cur_seg+1] - m_pts[2*cur_seg-1];
+            double len = sqrt(dx*dx + dy*dy);
+
+            m_segLens[cur_seg] = len;
+            contourLen += len;
+            m_cumLens[cur_seg] = contourLen;
+
+            if (len > 0.0)
+            {
+                m_dirs[2*cur_seg  ] = dx / len;
+                m_dirs[2*cur_seg+1] = dy / len;
+            }
+            else
+                m_dirs[2*cur_seg] = m_dirs[2*cur_seg+1] = 0.0;
+        }
+
+        m_segLens[start_seg] = contourLen;
+        m_totalLen += contourLen;
+    }
+}
+
+
+int SE_PathMeasure::ComputeSegmentGroups(int contour, double vertexAngleLimit)
+{
+    // get segment range for specified contour
+    int start_seg = m_geometry->contour_start_point(contour);
+    int end_seg = m_geometry->contour_end_point(contour);
+
+    // skip zero-length contours
+    if (m_segLens[start_seg] == 0.0)
+        return 0;
+
+    // we have a non-degenerate contour - we'll get at least one group
+
+    // make sure vertex angle limit is positive and in the range [0, 180]
+    vertexAngleLimit = fabs(vertexAngleLimit);
+    vertexAngleLimit = rs_min(vertexAngleLimit, M_PI);
+    double cosLimit = cos(vertexAngleLimit);
+
+    // keep track of number of groups
+    int numGroups = 0;
+
+    // find the initial group's starting segment (the first non-degenerate segment)
+    int cur_seg = start_seg + 1;
+    while (cur_seg <= end_seg && m_segLens[cur_seg] == 0.0)
+        ++cur_seg;
+
+    int group_min = cur_seg - 1;
+    int group_max = cur_seg;
+
+    // get the normalized vector for the segment
+    double dx0 = m_dirs[2*cur_seg];
+    double dy0 = m_dirs[2*cur_seg+1];
+
+    // iterate over the rest of the contour, adding groups as we find them
+    while (cur_seg < end_seg)
+    {
+        ++cur_seg;
+
+        // find next non-degenerate segment
+        while (cur_seg <= end_seg && m_segLens[cur_seg] == 0.0)
+            ++cur_seg;
+
+        // no more non-degenerate segments left - done processing the contour
+        if (cur_seg > end_seg)
+            break;
+
+        // get the normalized vector for the segment
+        double dx1 = m_dirs[2*cur_seg];
+        double dy1 = m_dirs[2*cur_seg+1];
+
+        // compare relative angles between current and previous segments
+        double cosAngle = dx0*dx1 + dy0*dy1;
+        if (cosAngle < cosLimit)
+        {
+            // vertex limit exceeded - record the existing group
+            m_groups[2*numGroups  ] = group_min;
+            m_groups[2*numGroups+1] = group_max;
+            ++numGroups;
+
+            // initialize the next group
+            group_min = cur_seg - 1;
+            group_max = cur_seg;
+        }
+        else
+        {
+            // vertex limit not exceeded - extend current group to this segment
+            group_max = cur_seg;
+        }
+
+        // current normalized vector becomes the old one
+        dx0 = dx1;
+        dy0 = dy1;
+    }
+
+    // record the final group
+    m_groups[2*numGroups  ] = group_min;
+    m_groups[2*numGroups+1] = group_max;
+    ++numGroups;
+
+    return numGroups;
+}
+
+
+int SE_PathMeasure::FindSegment(int contour, double dist) const
+{
+    int start_seg = m_geometry->contour_start_point(contour);
+    int end_seg = m_geometry->contour_end_point(contour);
+
+    // binary search the cumulative lengths for the first point at or beyond
+    // the distance - the segment ending at that point contains the distance
+    const double* first = &m_cumLens[start_seg+1];
+    const double* last = &m_cumLens[end_seg] + 1;
+    int cur_seg = start_seg + 1 + (int)(std::lower_bound(first, last, dist) - first);
+
+    // distances before the start of the contour resolve to the first
+    // non-degenerate segment
+    while (cur_seg <= end_seg && m_segLens[cur_seg] == 0.0)
+        ++cur_seg;
+
+    return (cur_seg <= end_seg)? cur_seg : -1;
+}
@@ -0,0 +1,98 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_PATHMEASURE_H_
+#define SE_PATHMEASURE_H_
+
+#include "StylizationAPI.h"
+#include <vector>
+
+class LineBuffer;
+class SE_Renderer;
+
+
+//---------------------------------------------
+// Screen space measurements of a feature's path
+//
+// Holds the screen position of each point, the segment lengths, the
+// cumulative length along each contour and the direction of each segment.
+// It is built once per feature geometry and shared by all line styles and
+// label positioning algorithms applied to that geometry.
+//
+// For a contour with N points starting at index M, the length of the
+// entire contour is stored in SegmentLengths() at location M, while the
+// segment lengths are stored at locations M+n, n=[1, N-1].
+//---------------------------------------------
+
+class SE_PathMeasure
+{
+public:
+    STYLIZATION_API SE_PathMeasure();
+
+    // Measures the supplied geometry, unless it's already been measured.
+    STYLIZATION_API void Build(LineBuffer* geometry, SE_Renderer* renderer);
+
+    // Forgets the measured geometry.  Must be called whenever the geometry
+    // buffer may have been reused for different data.
+    STYLIZATION_API void Reset();
+
+    inline LineBuffer* GetGeometry() const { return m_geometry; }
+
+    inline void GetScreenPoint(int point, double& x, double& y) const
+    {
+        x = m_pts[2*point];
+        y = m_pts[2*point+1];
+    }
+
+    inline const double* SegmentLengths() const { return &m_segLens[0]; }
+    inline double TotalLength() const { return m_totalLen; }
+
+    // distance along its contour to the point
+    inline double DistanceAlong(int point) const { return m_cumLens[point]; }
+
+    // Groups together the segments of the specified contour based on the
+    // supplied vertex angle limit.  Any pair of segments is part of the same
+    // group if their relative angle is less than the limit.  Group k goes
+    // from point SegmentGroups()[2k] to point SegmentGroups()[2k+1], and is
+    // guaranteed to start and end with a non-degenerate segment.  Returns
+    // the number of groups.
+    STYLIZATION_API int ComputeSegmentGroups(int contour, double vertexAngleLimit);
+
+    inline const int* SegmentGroups() const { return &m_groups[0]; }
+
+    inline double GroupLength(int group) const
+    {
+        return m_cumLens[m_groups[2*group+1]] - m_cumLens[m_groups[2*group]];
+    }
+
+    // Returns the index of the end point of the first non-degenerate segment
+    // of the contour reaching the supplied distance along the contour, or
+    // -1 if the distance is beyond the end of the contour.
+    STYLIZATION_API int FindSegment(int contour, double dist) const;
+
+private:
+    LineBuffer* m_geometry;
+    double m_totalLen;
+
+    std::vector<double> m_pts;      // screen x,y of each point
+    std::vector<double> m_segLens;
+    std::vector<double> m_cumLens;
+    std::vector<double> m_dirs;     // unit x,y direction of the segment ending at each point
+    std::vector<int> m_groups;
+};
+
+#endif
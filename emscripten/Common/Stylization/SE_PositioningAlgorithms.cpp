@@ -501,7 +501,7 @@ void SE_PositioningAlgorithms::PathLabels(SE_ApplyContext* applyCtx,
         return se_renderer->ProcessLabelGroup(&info, 1, rt->content, overpostType, rstyle->addToExclusionRegion, geometry, 0.5);
     }
 
-    se_renderer->ProcessLineLabels(geometry, (SE_RenderLineStyle*)rstyle);
+    se_renderer->ProcessLineLabels(geometry, (SE_RenderLineStyle*)rstyle, applyCtx->pathMeasure);
 }
 
 
@@ -548,25 +548,10 @@ void SE_PositioningAlgorithms::MultipleHighwaysShields(SE_ApplyContext*  applyCt
     double incrementS = rlStyle->endOffset;
 
     // calc the overall length of this geometry
-    double totalLen = 0.0;
-    for (int i=0; i<geometry->cntr_count(); ++i)
-    {
-        int pt = geometry->contour_start_point(i);
-        int last = geometry->contour_end_point(i);
-        while (pt < last)
-        {
-            // transform the point to screen space
-            double  cx1, cy1, cx2, cy2;
-            se_renderer->WorldToScreenPoint(geometry->x_coord(pt), geometry->y_coord(pt), cx1, cy1);
-            pt++;
-            se_renderer->WorldToScreenPoint(geometry->x_coord(pt), geometry->y_coord(pt), cx2, cy2);
-
-            // calc length
-            double dx = cx2 - cx1;
-            double dy = cy2 - cy1;
-            totalLen += sqrt(dx*dx + dy*dy);
-        }
-    }
+    SE_PathMeasure localMeasure;
+    SE_PathMeasure* measure = applyCtx->pathMeasure? applyCtx->pathMeasure : &localMeasure;
+    measure->Build(geometry, se_renderer);
+    double totalLen = measure->TotalLength();
 
     if (startOffset >= 0.0)
     {
@@ -0,0 +1,850 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_Rasterizer.h"
+#include "StylizationTrace.h"
+
+#include <algorithm>
+
+// threads are only available in Emscripten builds with pthread support
+#if !defined(EMSCRIPTEN) || defined(__EMSCRIPTEN_PTHREADS__)
+#define SE_RASTERIZER_THREADS
+#include <thread>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// number of sample rows per pixel row
+const int RASTER_SUBSAMPLES = 8;
+
+// number of pixel rows in a band
+const int RASTER_BAND_ROWS = 32;
+
+// maximum error, in pixels, when approximating circles
+const double RASTER_CIRCLE_TOLERANCE = 0.125;
+
+
+//////////////////////////////////////////////////////////////////////////////
+// multiplies each channel of a pixel by a value in [0, 255]
+static inline unsigned int ScalePixel(unsigned int p, unsigned int a)
+{
+    unsigned int rb = (p & 0x00ff00ff) * a + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+    unsigned int ag = ((p >> 8) & 0x00ff00ff) * a + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+    return rb | ag;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// composites a premultiplied pixel over another one
+static inline unsigned int Over(unsigned int src, unsigned int dst)
+{
+    return src + ScalePixel(dst, 255 - (src >> 24));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static inline unsigned int Premultiply(unsigned int argb)
+{
+    unsigned int a = argb >> 24;
+    return (ScalePixel(argb, a) & 0x00ffffff) | (a << 24);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static inline void AccumulateSpan(float* cov, float xa, float xb, float weight, int width)
+{
+    if (xa < 0.0f)
+        xa = 0.0f;
+    if (xb > (float)width)
+        xb = (float)width;
+    if (xb <= xa)
+        return;
+
+    int ia = (int)xa;
+    int ib = (int)xb;
+    if (ia == ib)
+    {
+        cov[ia] += (xb - xa) * weight;
+        return;
+    }
+
+    cov[ia] += ((float)(ia + 1) - xa) * weight;
+    for (int i=ia+1; i<ib; ++i)
+        cov[i] += weight;
+
+    // the coverage array has an extra element, so ib == width is fine
+    cov[ib] += (xb - (float)ib) * weight;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// composites a solid premultiplied color, scaled by per-pixel alpha
+static void BlendSolidSpan(unsigned int* dst, const unsigned char* alpha, int n, unsigned int color)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    // four pixels at a time, using 16 bits per channel
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i full = _mm_set1_epi16(255);
+    __m128i col = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)color), zero);
+    col = _mm_unpacklo_epi64(col, col);
+
+    for (; i+4<=n; i+=4)
+    {
+        int a4;
+        memcpy(&a4, alpha + i, sizeof(int));
+        if (a4 == 0)
+            continue;
+
+        __m128i a16 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(a4), zero);
+        __m128i a32 = _mm_unpacklo_epi16(a16, a16);
+        __m128i aLo = _mm_unpacklo_epi32(a32, a32);
+        __m128i aHi = _mm_unpackhi_epi32(a32, a32);
+
+        // source color scaled by coverage
+        __m128i sLo = _mm_add_epi16(_mm_mullo_epi16(col, aLo), bias);
+        sLo = _mm_srli_epi16(_mm_add_epi16(sLo, _mm_srli_epi16(sLo, 8)), 8);
+        __m128i sHi = _mm_add_epi16(_mm_mullo_epi16(col, aHi), bias);
+        sHi = _mm_srli_epi16(_mm_add_epi16(sHi, _mm_srli_epi16(sHi, 8)), 8);
+
+        // destination scaled by the inverse source alpha
+        __m128i d = _mm_loadu_si128((__m128i*)(dst + i));
+        __m128i dLo = _mm_unpacklo_epi8(d, zero);
+        __m128i dHi = _mm_unpackhi_epi8(d, zero);
+        __m128i iLo = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLo, 0xff), 0xff));
+        __m128i iHi = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHi, 0xff), 0xff));
+        dLo = _mm_add_epi16(_mm_mullo_epi16(dLo, iLo), bias);
+        dLo = _mm_srli_epi16(_mm_add_epi16(dLo, _mm_srli_epi16(dLo, 8)), 8);
+        dHi = _mm_add_epi16(_mm_mullo_epi16(dHi, iHi), bias);
+        dHi = _mm_srli_epi16(_mm_add_epi16(dHi, _mm_srli_epi16(dHi, 8)), 8);
+
+        __m128i res = _mm_packus_epi16(_mm_add_epi16(sLo, dLo), _mm_add_epi16(sHi, dHi));
+        _mm_storeu_si128((__m128i*)(dst + i), res);
+    }
+#endif
+
+    bool opaque = (color >> 24) == 255;
+    for (; i<n; ++i)
+    {
+        unsigned int a = alpha[i];
+        if (a == 0)
+            continue;
+
+        if (a == 255 && opaque)
+            dst[i] = color;
+        else
+            dst[i] = Over(ScalePixel(color, a), dst[i]);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_Rasterizer::SE_Rasterizer() :
+    m_width(0),
+    m_height(0),
+    m_pathStart(0),
+    m_startX(0.0),
+    m_startY(0.0),
+    m_lastX(0.0),
+    m_lastY(0.0),
+    m_inContour(false),
+    m_minX(+DBL_MAX),
+    m_minY(+DBL_MAX),
+    m_maxX(-DBL_MAX),
+    m_maxY(-DBL_MAX)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_Rasterizer::~SE_Rasterizer()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::Reset(int width, int height, unsigned int argb)
+{
+    m_width = rs_max(width, 0);
+    m_height = rs_max(height, 0);
+    m_pixels.assign((size_t)m_width * m_height, Premultiply(argb));
+
+    m_edges.clear();
+    m_paints.clear();
+    m_images.clear();
+
+    m_pathStart = 0;
+    m_inContour = false;
+    m_minX = m_minY = +DBL_MAX;
+    m_maxX = m_maxY = -DBL_MAX;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::AddEdge(double x0, double y0, double x1, double y1)
+{
+    // horizontal edges never cross a sample row
+    if (y0 == y1)
+        return;
+
+    // skip garbage coordinates
+    if (!(fabs(x0) < 1.0e7 && fabs(y0) < 1.0e7 && fabs(x1) < 1.0e7 && fabs(y1) < 1.0e7))
+        return;
+
+    Edge e;
+    e.dir = (y1 > y0)? 1 : -1;
+    if (y1 < y0)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    e.ytop = (float)y0;
+    e.ybot = (float)y1;
+    e.xtop = (float)x0;
+    e.dxdy = (float)((x1 - x0) / (y1 - y0));
+    m_edges.push_back(e);
+
+    m_minX = rs_min(m_minX, rs_min(x0, x1));
+    m_maxX = rs_max(m_maxX, rs_max(x0, x1));
+    m_minY = rs_min(m_minY, y0);
+    m_maxY = rs_max(m_maxY, y1);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::MoveTo(double x, double y)
+{
+    ClosePath();
+
+    m_startX = m_lastX = x;
+    m_startY = m_lastY = y;
+    m_inContour = true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::LineTo(double x, double y)
+{
+    if (!m_inContour)
+    {
+        MoveTo(x, y);
+        return;
+    }
+
+    AddEdge(m_lastX, m_lastY, x, y);
+    m_lastX = x;
+    m_lastY = y;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::ClosePath()
+{
+    if (m_inContour)
+        AddEdge(m_lastX, m_lastY, m_startX, m_startY);
+    m_inContour = false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds a closed contour with positive orientation.
+void SE_Rasterizer::AddPiece(const double* xy, int n)
+{
+    double area = 0.0;
+    for (int i=0, j=n-1; i<n; j=i++)
+        area += xy[2*j] * xy[2*i+1] - xy[2*i] * xy[2*j+1];
+
+    if (area == 0.0)
+        return;
+
+    if (area > 0.0)
+    {
+        MoveTo(xy[0], xy[1]);
+        for (int i=1; i<n; ++i)
+            LineTo(xy[2*i], xy[2*i+1]);
+    }
+    else
+    {
+        MoveTo(xy[2*n-2], xy[2*n-1]);
+        for (int i=n-2; i>=0; --i)
+            LineTo(xy[2*i], xy[2*i+1]);
+    }
+    ClosePath();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::AddCircle(double cx, double cy, double r)
+{
+    if (r <= 0.0)
+        return;
+
+    // choose the number of segments so that the error stays small
+    const int MAX_SEGS = 128;
+    int nsegs = MAX_SEGS;
+    if (r > RASTER_CIRCLE_TOLERANCE)
+        nsegs = (int)ceil(M_PI / acos(1.0 - RASTER_CIRCLE_TOLERANCE / r));
+    nsegs = rs_max(8, rs_min(nsegs, MAX_SEGS));
+
+    double xy[2*MAX_SEGS];
+    for (int i=0; i<nsegs; ++i)
+    {
+        double a = 2.0 * M_PI * i / nsegs;
+        xy[2*i  ] = cx + r * cos(a);
+        xy[2*i+1] = cy + r * sin(a);
+    }
+
+    AddPiece(xy, nsegs);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// The stroke outline is the union of a quad for each segment plus the
+// joins and caps, all with the same orientation.
+void SE_Rasterizer::AddStroke(const double* xy, int npts, double width,
+                              SE_LineCap cap, SE_LineJoin join, double miterLimit)
+{
+    if (npts <= 0 || width <= 0.0)
+        return;
+
+    double hw = 0.5 * width;
+
+    // remove repeated points
+    m_strokePts.clear();
+    for (int i=0; i<npts; ++i)
+    {
+        size_t n = m_strokePts.size();
+        if (n == 0 || xy[2*i] != m_strokePts[n-2] || xy[2*i+1] != m_strokePts[n-1])
+        {
+            m_strokePts.push_back(xy[2*i]);
+            m_strokePts.push_back(xy[2*i+1]);
+        }
+    }
+
+    const double* pts = &m_strokePts[0];
+    int n = (int)m_strokePts.size() / 2;
+
+    // a single point only shows its caps
+    if (n == 1)
+    {
+        if (cap == SE_LineCap_Round)
+            AddCircle(pts[0], pts[1], hw);
+        else if (cap == SE_LineCap_Square)
+        {
+            double sq[8] = { pts[0]-hw, pts[1]-hw, pts[0]+hw, pts[1]-hw,
+                             pts[0]+hw, pts[1]+hw, pts[0]-hw, pts[1]+hw };
+            AddPiece(sq, 4);
+        }
+        return;
+    }
+
+    // closed polylines get a join instead of caps at their start point
+    bool closed = (n > 3 && pts[0] == pts[2*n-2] && pts[1] == pts[2*n-1]);
+    if (closed)
+        --n;
+
+    int nsegs = closed? n : n-1;
+    double piece[8];
+    double dx0 = 0.0, dy0 = 0.0;
+    double firstdx = 0.0, firstdy = 0.0;
+
+    for (int i=0; i<nsegs; ++i)
+    {
+        int j = (i+1) % n;
+        double dx = pts[2*j] - pts[2*i];
+        double dy = pts[2*j+1] - pts[2*i+1];
+        double len = sqrt(dx*dx + dy*dy);
+        dx /= len;
+        dy /= len;
+
+        double nx = -dy * hw;
+        double ny =  dx * hw;
+        piece[0] = pts[2*i] + nx; piece[1] = pts[2*i+1] + ny;
+        piece[2] = pts[2*j] + nx; piece[3] = pts[2*j+1] + ny;
+        piece[4] = pts[2*j] - nx; piece[5] = pts[2*j+1] - ny;
+        piece[6] = pts[2*i] - nx; piece[7] = pts[2*i+1] - ny;
+        AddPiece(piece, 4);
+
+        if (i == 0)
+        {
+            firstdx = dx;
+            firstdy = dy;
+        }
+
+        // join with the previous segment (and the last one with the first
+        // for closed polylines)
+        for (int k=0; k<2; ++k)
+        {
+            double inx, iny, outx, outy;
+            int v;
+            if (k == 0)
+            {
+                if (i == 0)
+                    continue;
+                inx = dx0; iny = dy0; outx = dx; outy = dy; v = i;
+            }
+            else
+            {
+                if (!closed || i != nsegs-1)
+                    continue;
+                inx = dx; iny = dy; outx = firstdx; outy = firstdy; v = 0;
+            }
+
+            double px = pts[2*v];
+            double py = pts[2*v+1];
+            double cross = inx*outy - iny*outx;
+            double dot = inx*outx + iny*outy;
+
+            if (join == SE_LineJoin_None || (fabs(cross) < 1.0e-9 && dot > 0.0))
+                continue;
+
+            if (join == SE_LineJoin_Round)
+            {
+                AddCircle(px, py, hw);
+                continue;
+            }
+
+            // the join fills the gap on the outer side of the turn
+            double s = (cross > 0.0)? -hw : hw;
+            double ax = px - iny * s,  ay = py + inx * s;
+            double bx = px - outy * s, by = py + outx * s;
+
+            double mx = -iny - outy;
+            double my =  inx + outx;
+            double mlen2 = mx*mx + my*my;
+            if (join == SE_LineJoin_Miter && mlen2 > 1.0e-12 && 2.0 / sqrt(mlen2) <= miterLimit)
+            {
+                double f = 2.0 * s / mlen2;
+                piece[0] = px; piece[1] = py;
+                piece[2] = ax; piece[3] = ay;
+                piece[4] = px + mx * f; piece[5] = py + my * f;
+                piece[6] = bx; piece[7] = by;
+                AddPiece(piece, 4);
+            }
+            else
+            {
+                piece[0] = px; piece[1] = py;
+                piece[2] = ax; piece[3] = ay;
+                piece[4] = bx; piece[5] = by;
+                AddPiece(piece, 3);
+            }
+        }
+
+        dx0 = dx;
+        dy0 = dy;
+    }
+
+    if (closed || cap == SE_LineCap_None)
+        return;
+
+    // caps at both ends, facing outwards
+    for (int k=0; k<2; ++k)
+    {
+        double px = (k == 0)? pts[0] : pts[2*n-2];
+        double py = (k == 0)? pts[1] : pts[2*n-1];
+        double ox = (k == 0)? -firstdx : dx0;
+        double oy = (k == 0)? -firstdy : dy0;
+        double nx = -oy * hw;
+        double ny =  ox * hw;
+
+        if (cap == SE_LineCap_Round)
+            AddCircle(px, py, hw);
+        else if (cap == SE_LineCap_Square)
+        {
+            piece[0] = px + nx;           piece[1] = py + ny;
+            piece[2] = px + nx + ox * hw; piece[3] = py + ny + oy * hw;
+            piece[4] = px - nx + ox * hw; piece[5] = py - ny + oy * hw;
+            piece[6] = px - nx;           piece[7] = py - ny;
+            AddPiece(piece, 4);
+        }
+        else if (cap == SE_LineCap_Triangle)
+        {
+            piece[0] = px + nx;      piece[1] = py + ny;
+            piece[2] = px + ox * hw; piece[3] = py + oy * hw;
+            piece[4] = px - nx;      piece[5] = py - ny;
+            AddPiece(piece, 3);
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_Rasterizer::EdgeTopLess(const Edge& a, const Edge& b)
+{
+    return a.ytop < b.ytop;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds a paint for the current path, or discards the path if it's empty or
+// off the image.  Either way a new path is started.
+bool SE_Rasterizer::QueuePath(FillRule rule)
+{
+    ClosePath();
+
+    bool queued = false;
+    if (m_edges.size() > m_pathStart)
+    {
+        int ymin = rs_max(0, (int)floor(m_minY));
+        int ymax = rs_min(m_height - 1, (int)ceil(m_maxY) - 1);
+        int xmin = rs_max(0, (int)floor(m_minX));
+        int xmax = rs_min(m_width - 1, (int)floor(m_maxX));
+
+        if (ymin <= ymax && xmin <= xmax)
+        {
+            std::sort(m_edges.begin() + m_pathStart, m_edges.end(), EdgeTopLess);
+
+            Paint paint;
+            paint.firstEdge = m_pathStart;
+            paint.endEdge = m_edges.size();
+            paint.rule = rule;
+            paint.color = 0;
+            paint.image = -1;
+            paint.repeat = false;
+            paint.opacity = 256;
+            paint.ymin = ymin;
+            paint.ymax = ymax;
+            paint.xmin = xmin;
+            paint.xmax = xmax;
+            m_paints.push_back(paint);
+            queued = true;
+        }
+        else
+            m_edges.resize(m_pathStart);
+    }
+
+    m_pathStart = m_edges.size();
+    m_minX = m_minY = +DBL_MAX;
+    m_maxX = m_maxY = -DBL_MAX;
+    return queued;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::FillPath(unsigned int argb, FillRule rule)
+{
+    if ((argb >> 24) == 0)
+    {
+        // fully transparent - just discard the path
+        m_inContour = false;
+        m_edges.resize(m_pathStart);
+        m_minX = m_minY = +DBL_MAX;
+        m_maxX = m_maxY = -DBL_MAX;
+        return;
+    }
+
+    if (QueuePath(rule))
+        m_paints.back().color = Premultiply(argb);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int SE_Rasterizer::AddImage(const unsigned int* pixels, int width, int height)
+{
+    m_images.push_back(Image());
+    Image& image = m_images.back();
+    image.pixels.assign(pixels, pixels + (size_t)width * height);
+    image.width = width;
+    image.height = height;
+    return (int)m_images.size() - 1;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::FillPathImage(int image, const double* xform, double opacity, FillRule rule,
+                                  bool repeat)
+{
+    if (QueuePath(rule))
+    {
+        Paint& paint = m_paints.back();
+        paint.image = image;
+        paint.repeat = repeat;
+        memcpy(paint.xform, xform, sizeof(paint.xform));
+        paint.opacity = (unsigned int)(rs_max(0.0, rs_min(opacity, 1.0)) * 256.0 + 0.5);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::Render(int numThreads)
+{
+    ClosePath();
+    if (m_paints.empty())
+        return;
+
+    StylizationTraceScope trace("Rasterize", StylizationTrace::Layers);
+
+    int numBands = (m_height + RASTER_BAND_ROWS - 1) / RASTER_BAND_ROWS;
+    std::atomic<int> nextBand(0);
+
+#ifdef SE_RASTERIZER_THREADS
+    if (numThreads <= 0)
+        numThreads = (int)std::thread::hardware_concurrency();
+    numThreads = rs_min(numThreads, numBands);
+
+    // the bands don't overlap, so each thread can work on its own
+    std::vector<std::thread> threads;
+    for (int i=1; i<numThreads; ++i)
+        threads.push_back(std::thread(&SE_Rasterizer::RenderBands, this, &nextBand, numBands));
+#else
+    (void)numThreads;
+#endif
+
+    RenderBands(&nextBand, numBands);
+
+#ifdef SE_RASTERIZER_THREADS
+    for (size_t i=0; i<threads.size(); ++i)
+        threads[i].join();
+#endif
+
+    m_edges.clear();
+    m_paints.clear();
+    m_pathStart = 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::RenderBands(std::atomic<int>* nextBand, int numBands)
+{
+    Scratch scratch;
+    scratch.coverage.resize(m_width + 1);
+    scratch.alpha.resize(m_width);
+
+    for (int band = (*nextBand)++; band < numBands; band = (*nextBand)++)
+    {
+        int y0 = band * RASTER_BAND_ROWS;
+        int y1 = rs_min(y0 + RASTER_BAND_ROWS, m_height);
+
+        StylizationTraceScope trace("RasterizeBand", StylizationTrace::Layers);
+        RenderBand(y0, y1, scratch);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::RenderBand(int y0, int y1, Scratch& scratch)
+{
+    // paints are composited in the order they were added
+    for (size_t i=0; i<m_paints.size(); ++i)
+    {
+        const Paint& paint = m_paints[i];
+        if (paint.ymax >= y0 && paint.ymin < y1)
+            RenderPaint(paint, rs_max(y0, paint.ymin), rs_min(y1, paint.ymax + 1), scratch);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::RenderPaint(const Paint& paint, int y0, int y1, Scratch& scratch)
+{
+    const float step = 1.0f / RASTER_SUBSAMPLES;
+    const bool evenOdd = (paint.rule == FillRule_EvenOdd);
+    const int x0 = paint.xmin;
+    const int x1 = paint.xmax;
+
+    float* cov = &scratch.coverage[0];
+    unsigned char* alpha = &scratch.alpha[0];
+    std::vector<size_t>& active = scratch.active;
+    std::vector<Crossing>& crossings = scratch.crossings;
+
+    active.clear();
+    size_t next = paint.firstEdge;
+
+    for (int y=y0; y<y1; ++y)
+    {
+        memset(cov + x0, 0, (x1 - x0 + 2) * sizeof(float));
+        bool any = false;
+
+        for (int s=0; s<RASTER_SUBSAMPLES; ++s)
+        {
+            float sy = (float)y + ((float)s + 0.5f) * step;
+
+            // activate the edges starting above this sample row
+            while (next < paint.endEdge && m_edges[next].ytop <= sy)
+            {
+                if (m_edges[next].ybot > sy)
+                    active.push_back(next);
+                ++next;
+            }
+
+            // retire finished edges, and find where the others cross the row
+            crossings.clear();
+            size_t k = 0;
+            for (size_t i=0; i<active.size(); ++i)
+            {
+                const Edge& e = m_edges[active[i]];
+                if (e.ybot <= sy)
+                    continue;
+
+                active[k++] = active[i];
+                Crossing c;
+                c.x = e.xtop + (sy - e.ytop) * e.dxdy;
+                c.dir = e.dir;
+                crossings.push_back(c);
+            }
+            active.resize(k);
+
+            if (crossings.size() < 2)
+                continue;
+
+            // insertion sort - the crossings are nearly sorted from row to row
+            for (size_t i=1; i<crossings.size(); ++i)
+            {
+                Crossing c = crossings[i];
+                size_t j = i;
+                for (; j>0 && crossings[j-1].x > c.x; --j)
+                    crossings[j] = crossings[j-1];
+                crossings[j] = c;
+            }
+
+            // accumulate the spans inside the path
+            int wind = 0;
+            float xa = 0.0f;
+            for (size_t i=0; i<crossings.size(); ++i)
+            {
+                bool wasInside = evenOdd? (wind & 1) != 0 : wind != 0;
+                wind += crossings[i].dir;
+                bool isInside = evenOdd? (wind & 1) != 0 : wind != 0;
+
+                if (!wasInside && isInside)
+                    xa = crossings[i].x;
+                else if (wasInside && !isInside)
+                {
+                    AccumulateSpan(cov, xa, crossings[i].x, step, m_width);
+                    any = true;
+                }
+            }
+        }
+
+        if (!any)
+            continue;
+
+        for (int x=x0; x<=x1; ++x)
+        {
+            float c = cov[x];
+            alpha[x] = (c >= 1.0f)? 255 : (c <= 0.0f)? 0 : (unsigned char)(c * 255.0f + 0.5f);
+        }
+
+        unsigned int* row = &m_pixels[(size_t)y * m_width];
+        if (paint.image < 0)
+            BlendSolidSpan(row + x0, alpha + x0, x1 - x0 + 1, paint.color);
+        else
+            BlendImageSpan(paint, row, alpha, x0, x1, y);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_Rasterizer::BlendImageSpan(const Paint& paint, unsigned int* dst, const unsigned char* alpha, int x0, int x1, int y)
+{
+    const Image& image = m_images[paint.image];
+    const unsigned int* src = &image.pixels[0];
+    const int w = image.width;
+    const int h = image.height;
+    const double* xf = paint.xform;
+
+    // sample at the pixel centers, with texel centers at half integers
+    double px = (double)x0 + 0.5;
+    double py = (double)y + 0.5;
+    double su = xf[0]*px + xf[1]*py + xf[2] - 0.5;
+    double sv = xf[3]*px + xf[4]*py + xf[5] - 0.5;
+
+    // a repeated image is sampled within it, stepping across its edges
+    if (paint.repeat)
+    {
+        su -= floor(su / w) * w;
+        sv -= floor(sv / h) * h;
+    }
+
+    for (int x=x0; x<=x1; ++x)
+    {
+        double u = su;
+        double v = sv;
+        su += xf[0];
+        sv += xf[3];
+        if (paint.repeat)
+        {
+            while (su >= w)  su -= w;
+            while (su < 0.0) su += w;
+            while (sv >= h)  sv -= h;
+            while (sv < 0.0) sv += h;
+        }
+
+        if (alpha[x] == 0)
+            continue;
+
+        int u0, u1, v0, v1;
+        unsigned int fu, fv;
+        if (paint.repeat)
+        {
+            // the neighbouring texels wrap as well
+            int iu = rs_min((int)u, w - 1);
+            int iv = rs_min((int)v, h - 1);
+            fu = (unsigned int)((u - iu) * 256.0);
+            fv = (unsigned int)((v - iv) * 256.0);
+            u0 = iu; u1 = (iu + 1 < w)? iu + 1 : 0;
+            v0 = iv; v1 = (iv + 1 < h)? iv + 1 : 0;
+        }
+        else
+        {
+            if (u < -0.5 || v < -0.5 || u > w - 0.5 || v > h - 0.5)
+                continue;
+
+            int iu = (int)floor(u);
+            int iv = (int)floor(v);
+            fu = (unsigned int)((u - iu) * 256.0);
+            fv = (unsigned int)((v - iv) * 256.0);
+            u0 = rs_max(iu, 0); u1 = rs_min(iu + 1, w - 1);
+            v0 = rs_max(iv, 0); v1 = rs_min(iv + 1, h - 1);
+        }
+
+        unsigned int p00 = src[v0*w + u0];
+        unsigned int p10 = src[v0*w + u1];
+        unsigned int p01 = src[v1*w + u0];
+        unsigned int p11 = src[v1*w + u1];
+
+        // nothing to blend where the image is clear, which is most of a
+        // sparse pattern
+        if ((p00 | p10 | p01 | p11) == 0)
+            continue;
+
+        // bilinear interpolation of each channel
+        unsigned int res = 0;
+        for (int shift=0; shift<32; shift+=8)
+        {
+            unsigned int c00 = (p00 >> shift) & 0xff;
+            unsigned int c10 = (p10 >> shift) & 0xff;
+            unsigned int c01 = (p01 >> shift) & 0xff;
+            unsigned int c11 = (p11 >> shift) & 0xff;
+            unsigned int top = c00 * (256 - fu) + c10 * fu;
+            unsigned int bot = c01 * (256 - fu) + c11 * fu;
+            unsigned int c = (top * (256 - fv) + bot * fv + 32768) >> 16;
+            res |= rs_min(c, 255u) << shift;
+        }
+
+        unsigned int a = (alpha[x] * paint.opacity) >> 8;
+        dst[x] = Over(ScalePixel(res, a), dst[x]);
+    }
+}
@@ -0,0 +1,172 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_RASTERIZER_H_
+#define SE_RASTERIZER_H_
+
+#include "StylizationAPI.h"
+#include "SE_RendererStyles.h"
+#include <stddef.h>
+#include <vector>
+#include <atomic>
+
+
+//---------------------------------------------
+// Anti-aliased scanline rasterizer for a 32 bit premultiplied ARGB image.
+//
+// Paths are built in pixel coordinates using MoveTo / LineTo (contours are
+// closed implicitly) and queued together with their paint by the Fill
+// methods.  Nothing is drawn until Render is called, which composites the
+// queued paths in order.  The image is processed in horizontal bands, and
+// the bands are rendered in parallel when threads are available.
+//
+// Coverage is computed exactly in x and using several sample rows in y.
+//---------------------------------------------
+
+class SE_Rasterizer
+{
+public:
+    enum FillRule
+    {
+        FillRule_NonZero,
+        FillRule_EvenOdd
+    };
+
+    STYLIZATION_API SE_Rasterizer();
+    STYLIZATION_API ~SE_Rasterizer();
+
+    // Resizes the image, clears it to the supplied ARGB color, and
+    // discards any queued paths and images.
+    STYLIZATION_API void Reset(int width, int height, unsigned int argb);
+
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+
+    // the premultiplied ARGB pixels, top row first
+    inline const unsigned int* GetPixels() const { return m_pixels.empty()? NULL : &m_pixels[0]; }
+
+    // path building
+    STYLIZATION_API void MoveTo(double x, double y);
+    STYLIZATION_API void LineTo(double x, double y);
+
+    // Adds the outline of a stroked polyline to the path.  All the pieces
+    // of the outline have the same orientation, so the path must be filled
+    // using the non-zero rule.
+    STYLIZATION_API void AddStroke(const double* xy, int npts, double width,
+                                   SE_LineCap cap, SE_LineJoin join, double miterLimit);
+
+    // Queues the current path filled with a non-premultiplied ARGB color,
+    // and starts a new path.
+    STYLIZATION_API void FillPath(unsigned int argb, FillRule rule);
+
+    // Registers a copy of an image, which can then be used to fill paths.
+    // The pixels are in the same format as the rendered image.
+    STYLIZATION_API int AddImage(const unsigned int* pixels, int width, int height);
+
+    // Queues the current path filled with an image, and starts a new path.
+    // The transform maps pixel coordinates to image coordinates:
+    //   u = xform[0]*x + xform[1]*y + xform[2]
+    //   v = xform[3]*x + xform[4]*y + xform[5]
+    // The image is sampled bilinearly and scaled by the supplied opacity.
+    // With repeat, the image is tiled over the whole plane - otherwise
+    // nothing is drawn outside it.
+    STYLIZATION_API void FillPathImage(int image, const double* xform, double opacity, FillRule rule,
+                                       bool repeat = false);
+
+    // Composites all queued paths into the image, using up to the given
+    // number of threads (zero means one per hardware thread).
+    STYLIZATION_API void Render(int numThreads = 0);
+
+private:
+    struct Edge
+    {
+        float ytop;
+        float ybot;
+        float xtop;
+        float dxdy;
+        int dir;
+    };
+
+    struct Paint
+    {
+        size_t firstEdge;
+        size_t endEdge;
+        FillRule rule;
+        unsigned int color;     // premultiplied
+        int image;              // -1 for a solid color
+        bool repeat;            // whether the image is tiled
+        double xform[6];
+        unsigned int opacity;   // [0, 256]
+        int ymin;
+        int ymax;
+        int xmin;
+        int xmax;
+    };
+
+    struct Image
+    {
+        std::vector<unsigned int> pixels;
+        int width;
+        int height;
+    };
+
+    struct Crossing
+    {
+        float x;
+        int dir;
+    };
+
+    // per thread working storage
+    struct Scratch
+    {
+        std::vector<float> coverage;
+        std::vector<unsigned char> alpha;
+        std::vector<size_t> active;
+        std::vector<Crossing> crossings;
+    };
+
+    static bool EdgeTopLess(const Edge& a, const Edge& b);
+
+    void AddEdge(double x0, double y0, double x1, double y1);
+    void AddPiece(const double* xy, int n);
+    void AddCircle(double cx, double cy, double r);
+    void ClosePath();
+    bool QueuePath(FillRule rule);
+
+    void RenderBands(std::atomic<int>* nextBand, int numBands);
+    void RenderBand(int y0, int y1, Scratch& scratch);
+    void RenderPaint(const Paint& paint, int y0, int y1, Scratch& scratch);
+    void BlendImageSpan(const Paint& paint, unsigned int* dst, const unsigned char* alpha, int x0, int x1, int y);
+
+    int m_width;
+    int m_height;
+    std::vector<unsigned int> m_pixels;
+
+    std::vector<Edge> m_edges;
+    std::vector<Paint> m_paints;
+    std::vector<Image> m_images;
+    std::vector<double> m_strokePts;
+
+    // current path
+    size_t m_pathStart;
+    double m_startX, m_startY;
+    double m_lastX, m_lastY;
+    bool m_inContour;
+    double m_minX, m_minY, m_maxX, m_maxY;
+};
+
+#endif
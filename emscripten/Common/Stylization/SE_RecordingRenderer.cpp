@@ -0,0 +1,401 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_RecordingRenderer.h"
+#include "RS_FontEngine.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_RecordingRenderer::SE_RecordingRenderer(int width, int height, RS_FontEngine* fontEngine)
+: m_fontEngine(fontEngine)
+, m_width(width)
+, m_height(height)
+, m_mapInfo(NULL)
+, m_layerInfo(NULL)
+, m_fcInfo(NULL)
+, m_mapScale(1.0)
+, m_dpi(96.0)
+, m_metersPerUnit(1.0)
+, m_scale(1.0)
+{
+    // record coordinates to a sixteenth of a pixel
+    m_displayList.SetQuantum(GetScreenUnitsPerPixel() / 16.0);
+
+    if (m_fontEngine)
+        m_fontEngine->InitFontEngine(this);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_RecordingRenderer::~SE_RecordingRenderer()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::StartMap(RS_MapUIInfo*    mapInfo,
+                                    RS_Bounds&       extents,
+                                    double           mapScale,
+                                    double           dpi,
+                                    double           metersPerUnit,
+                                    CSysTransformer* /*xformToLL*/)
+{
+    m_mapInfo = mapInfo;
+    m_extents = extents;
+    m_mapScale = mapScale;
+    m_dpi = dpi;
+    m_metersPerUnit = metersPerUnit;
+
+    m_scale = (m_extents.width() > 0.0)? (double)m_width / m_extents.width() : 1.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::EndMap()
+{
+    FlushDrawBatch();
+
+    m_mapInfo = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::StartLayer(RS_LayerUIInfo* layerInfo, RS_FeatureClassInfo* classInfo)
+{
+    m_layerInfo = layerInfo;
+    m_fcInfo = classInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::EndLayer()
+{
+    m_layerInfo = NULL;
+    m_fcInfo = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::StartFeature(RS_FeatureReader* /*feature*/,
+                                        bool              /*initialPass*/,
+                                        const RS_String*  /*tooltip*/,
+                                        const RS_String*  /*url*/,
+                                        const RS_String*  /*theme*/,
+                                        double            /*zOffset*/,
+                                        double            /*zExtrusion*/,
+                                        RS_ElevationType  /*zOffsetType*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::ProcessPolygon(LineBuffer* lb, RS_FillStyle& fill)
+{
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+
+    // only the solid fill and outline are recorded
+    if (fill.color().alpha() != 0)
+        m_displayList.AddPolygon(lb, &w2s, fill.color().argb());
+
+    RS_LineStroke& outline = fill.outline();
+    if (outline.color().alpha() != 0)
+        ProcessPolyline(lb, outline);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::ProcessPolyline(LineBuffer* lb, RS_LineStroke& lsym)
+{
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+
+    // the width is in meters - line patterns aren't recorded
+    double mm2su = (lsym.units() == RS_Units_Device)? GetScreenUnitsPerMillimeterDevice() : GetScreenUnitsPerMillimeterWorld();
+    SE_LineStroke lineStroke(lsym.color().argb(), lsym.width() * 1000.0 * mm2su);
+
+    m_displayList.AddPolyline(lb, &w2s, lineStroke);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::ProcessRaster(unsigned char* /*data*/,
+                                         int            /*length*/,
+                                         RS_ImageFormat /*format*/,
+                                         int            /*width*/,
+                                         int            /*height*/,
+                                         RS_Bounds&     /*extents*/,
+                                         TransformMesh* /*xformMesh*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::ProcessMarker(LineBuffer*   /*lb*/,
+                                         RS_MarkerDef& /*mdef*/,
+                                         bool          /*allowOverpost*/,
+                                         RS_Bounds*    /*bounds*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::ProcessLabelGroup(RS_LabelInfo*    /*labels*/,
+                                             int              /*nlabels*/,
+                                             const RS_String& /*text*/,
+                                             RS_OverpostType  /*type*/,
+                                             bool             /*exclude*/,
+                                             LineBuffer*      /*path*/,
+                                             double           /*scaleLimit*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::AddDWFContent(RS_InputStream*  /*in*/,
+                                         CSysTransformer* /*xformer*/,
+                                         const RS_String& /*section*/,
+                                         const RS_String& /*passwd*/,
+                                         const RS_String& /*w2dfilter*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::SetSymbolManager(RS_SymbolManager* /*manager*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MapUIInfo* SE_RecordingRenderer::GetMapInfo()
+{
+    return m_mapInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_LayerUIInfo* SE_RecordingRenderer::GetLayerInfo()
+{
+    return m_layerInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_FeatureClassInfo* SE_RecordingRenderer::GetFeatureClassInfo()
+{
+    return m_fcInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_RecordingRenderer::GetMapScale()
+{
+    return m_mapScale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_RecordingRenderer::GetDrawingScale()
+{
+    // mapping units per pixel
+    return 1.0 / m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_RecordingRenderer::GetMetersPerUnit()
+{
+    return m_metersPerUnit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_RecordingRenderer::GetDpi()
+{
+    return m_dpi;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_Bounds& SE_RecordingRenderer::GetBounds()
+{
+    return m_extents;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_RecordingRenderer::RequiresClipping()
+{
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_RecordingRenderer::RequiresLabelClipping()
+{
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_RecordingRenderer::SupportsZ()
+{
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::DrawScreenPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke)
+{
+    if (m_bSelectionMode)
+        m_displayList.AddPolyline(polyline, xform, m_selLineStroke);
+    else
+        m_displayList.AddPolyline(polyline, xform, lineStroke);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::DrawScreenPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill)
+{
+    m_displayList.AddPolygon(polygon, xform, m_bSelectionMode? m_selFillColor : fill);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::DrawScreenRaster(unsigned char* data, int length,
+                                            RS_ImageFormat format, int native_width, int native_height,
+                                            double x, double y, double w, double h, double angleDeg)
+{
+    m_displayList.AddRaster(data, length, format, native_width, native_height, x, y, w, h, angleDeg, 1.0);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::DrawScreenRaster(unsigned char* data, int length,
+                                            RS_ImageFormat format, int native_width, int native_height,
+                                            double x, double y, double w, double h, double angleDeg,
+                                            double alpha)
+{
+    m_displayList.AddRaster(data, length, format, native_width, native_height, x, y, w, h, angleDeg, alpha);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::DrawScreenText(const RS_TextMetrics& tm, RS_TextDef& tdef, double insx, double insy,
+                                          RS_F_Point* path, int npts, double param_position)
+{
+    m_displayList.AddText(tm, tdef, insx, insy, path, npts, param_position);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_RecordingRenderer::DrawScreenPatternFill(LineBuffer* polygon, SE_PreparedSymbol& cell, const SE_Matrix& cellXform,
+                                                 double cellAngleRad, double repeatX, double repeatY, double angleRad,
+                                                 unsigned int cellId)
+{
+    // selected symbols are recorded one by one in the selection colors
+    if (m_bSelectionMode)
+        return false;
+
+    m_displayList.AddPatternFill(polygon, *cell.symbol, cellXform, cellAngleRad, repeatX, repeatY, angleRad, cellId, this);
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_RecordingRenderer::YPointsUp()
+{
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::GetWorldToScreenTransform(SE_Matrix& xform)
+{
+    xform.x0 = m_scale;
+    xform.x1 = 0.0;
+    xform.x2 = -m_extents.minx * m_scale;
+    xform.y0 = 0.0;
+    xform.y1 = -m_scale;
+    xform.y2 = m_height + m_extents.miny * m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::WorldToScreenPoint(double& inx, double& iny, double& ox, double& oy)
+{
+    ox = (inx - m_extents.minx) * m_scale;
+    oy = m_height - (iny - m_extents.miny) * m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::ScreenToWorldPoint(double& inx, double& iny, double& ox, double& oy)
+{
+    ox = inx / m_scale + m_extents.minx;
+    oy = (m_height - iny) / m_scale + m_extents.miny;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_RecordingRenderer::GetScreenUnitsPerMillimeterDevice()
+{
+    return m_dpi / MILLIMETERS_PER_INCH;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_RecordingRenderer::GetScreenUnitsPerMillimeterWorld()
+{
+    return m_scale * 0.001 / m_metersPerUnit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_RecordingRenderer::GetScreenUnitsPerPixel()
+{
+    return 1.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_FontEngine* SE_RecordingRenderer::GetRSFontEngine()
+{
+    return m_fontEngine;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::ProcessSELabelGroup(SE_LabelInfo*   labels,
+                                               int             nlabels,
+                                               RS_OverpostType type,
+                                               bool            exclude,
+                                               LineBuffer*     path)
+{
+    // labels are recorded unplaced - placement happens when the display
+    // list is replayed into a renderer with a label manager
+    m_displayList.AddLabelGroup(labels, nlabels, type, exclude, path);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_RecordingRenderer::AddExclusionRegion(RS_F_Point* fpts, int npts)
+{
+    m_displayList.AddExclusionRegion(fpts, npts);
+}
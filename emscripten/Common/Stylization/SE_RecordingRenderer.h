@@ -0,0 +1,148 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_RECORDINGRENDERER_H_
+#define SE_RECORDINGRENDERER_H_
+
+#include "SE_Renderer.h"
+#include "SE_DisplayList.h"
+
+
+//---------------------------------------------
+// A renderer which doesn't draw anything, but records the screen space
+// draw calls into a display list instead.  The list can then be replayed
+// into another renderer, cached, or used to time stylization separately
+// from rasterization.
+//
+// The map extents are mapped to a device of the given size in pixels,
+// with y pointing down.  The font engine is only used for measuring text,
+// and is initialized to work in the screen space of this renderer.
+//
+// Only the SE_Renderer draw calls and labels are recorded.  Legacy
+// polygons and polylines are converted to their solid fill and outline,
+// while legacy markers, rasters, labels and DWF content are ignored.
+//---------------------------------------------
+
+class SE_RecordingRenderer : public SE_Renderer
+{
+public:
+    STYLIZATION_API SE_RecordingRenderer(int width, int height, RS_FontEngine* fontEngine);
+    STYLIZATION_API virtual ~SE_RecordingRenderer();
+
+    inline SE_DisplayList& GetDisplayList() { return m_displayList; }
+
+    ///////////////////////////////////
+    // Renderer implementation
+
+    STYLIZATION_API virtual void StartMap(RS_MapUIInfo* mapInfo, RS_Bounds& extents, double mapScale,
+                                          double dpi, double metersPerUnit, CSysTransformer* xformToLL);
+    STYLIZATION_API virtual void EndMap();
+
+    STYLIZATION_API virtual void StartLayer(RS_LayerUIInfo* layerInfo, RS_FeatureClassInfo* classInfo);
+    STYLIZATION_API virtual void EndLayer();
+
+    STYLIZATION_API virtual void StartFeature(RS_FeatureReader* feature, bool initialPass,
+                                              const RS_String* tooltip = NULL, const RS_String* url = NULL,
+                                              const RS_String* theme = NULL, double zOffset = 0.0,
+                                              double zExtrusion = 0.0,
+                                              RS_ElevationType zOffsetType = RS_ElevationType_RelativeToGround);
+
+    STYLIZATION_API virtual void ProcessPolygon(LineBuffer* lb, RS_FillStyle& fill);
+    STYLIZATION_API virtual void ProcessPolyline(LineBuffer* lb, RS_LineStroke& lsym);
+    STYLIZATION_API virtual void ProcessRaster(unsigned char* data, int length, RS_ImageFormat format,
+                                               int width, int height, RS_Bounds& extents,
+                                               TransformMesh* xformMesh = NULL);
+    STYLIZATION_API virtual void ProcessMarker(LineBuffer* lb, RS_MarkerDef& mdef, bool allowOverpost,
+                                               RS_Bounds* bounds = NULL);
+    STYLIZATION_API virtual void ProcessLabelGroup(RS_LabelInfo* labels, int nlabels, const RS_String& text,
+                                                   RS_OverpostType type, bool exclude, LineBuffer* path,
+                                                   double scaleLimit);
+    STYLIZATION_API virtual void AddDWFContent(RS_InputStream* in, CSysTransformer* xformer,
+                                               const RS_String& section, const RS_String& passwd,
+                                               const RS_String& w2dfilter);
+
+    STYLIZATION_API virtual void SetSymbolManager(RS_SymbolManager* manager);
+
+    STYLIZATION_API virtual RS_MapUIInfo* GetMapInfo();
+    STYLIZATION_API virtual RS_LayerUIInfo* GetLayerInfo();
+    STYLIZATION_API virtual RS_FeatureClassInfo* GetFeatureClassInfo();
+
+    STYLIZATION_API virtual double GetMapScale();
+    STYLIZATION_API virtual double GetDrawingScale();
+    STYLIZATION_API virtual double GetMetersPerUnit();
+    STYLIZATION_API virtual double GetDpi();
+    STYLIZATION_API virtual RS_Bounds& GetBounds();
+
+    STYLIZATION_API virtual bool RequiresClipping();
+    STYLIZATION_API virtual bool RequiresLabelClipping();
+    STYLIZATION_API virtual bool SupportsZ();
+
+    ///////////////////////////////////
+    // SE_Renderer implementation
+
+    STYLIZATION_API virtual void DrawScreenPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke);
+    STYLIZATION_API virtual void DrawScreenPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill);
+    STYLIZATION_API virtual void DrawScreenRaster(unsigned char* data, int length,
+                                                  RS_ImageFormat format, int native_width, int native_height,
+                                                  double x, double y, double w, double h, double angleDeg);
+    STYLIZATION_API virtual void DrawScreenRaster(unsigned char* data, int length,
+                                                  RS_ImageFormat format, int native_width, int native_height,
+                                                  double x, double y, double w, double h, double angleDeg,
+                                                  double alpha);
+    STYLIZATION_API virtual void DrawScreenText(const RS_TextMetrics& tm, RS_TextDef& tdef, double insx, double insy,
+                                                RS_F_Point* path, int npts, double param_position);
+    STYLIZATION_API virtual bool DrawScreenPatternFill(LineBuffer* polygon, SE_PreparedSymbol& cell, const SE_Matrix& cellXform,
+                                                       double cellAngleRad, double repeatX, double repeatY, double angleRad,
+                                                       unsigned int cellId);
+
+    STYLIZATION_API virtual bool YPointsUp();
+    STYLIZATION_API virtual void GetWorldToScreenTransform(SE_Matrix& xform);
+    STYLIZATION_API virtual void WorldToScreenPoint(double& inx, double& iny, double& ox, double& oy);
+    STYLIZATION_API virtual void ScreenToWorldPoint(double& inx, double& iny, double& ox, double& oy);
+
+    STYLIZATION_API virtual double GetScreenUnitsPerMillimeterDevice();
+    STYLIZATION_API virtual double GetScreenUnitsPerMillimeterWorld();
+    STYLIZATION_API virtual double GetScreenUnitsPerPixel();
+
+    STYLIZATION_API virtual RS_FontEngine* GetRSFontEngine();
+
+    STYLIZATION_API virtual void ProcessSELabelGroup(SE_LabelInfo* labels, int nlabels, RS_OverpostType type,
+                                                     bool exclude, LineBuffer* path = NULL);
+
+    STYLIZATION_API virtual void AddExclusionRegion(RS_F_Point* fpts, int npts);
+
+private:
+    SE_DisplayList m_displayList;
+    RS_FontEngine* m_fontEngine;
+
+    int m_width;
+    int m_height;
+
+    RS_MapUIInfo* m_mapInfo;
+    RS_LayerUIInfo* m_layerInfo;
+    RS_FeatureClassInfo* m_fcInfo;
+
+    RS_Bounds m_extents;
+    double m_mapScale;
+    double m_dpi;
+    double m_metersPerUnit;
+
+    // world to screen scale, in pixels per mapping unit
+    double m_scale;
+};
+
+#endif
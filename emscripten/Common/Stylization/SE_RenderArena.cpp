@@ -0,0 +1,109 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_RenderArena.h"
+#include <cstdlib>
+
+// all allocations are aligned to this boundary
+static const size_t ARENA_ALIGN = 16;
+
+#define ARENA_ROUNDUP(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+
+SE_RenderArena::SE_RenderArena(size_t blockSize) :
+    m_head(NULL),
+    m_cur(NULL),
+    m_ptr(NULL),
+    m_end(NULL),
+    m_blockSize(blockSize)
+{
+}
+
+
+SE_RenderArena::~SE_RenderArena()
+{
+    while (m_head)
+    {
+        Block* next = m_head->next;
+        free(m_head);
+        m_head = next;
+    }
+}
+
+
+SE_RenderArena::Block* SE_RenderArena::NewBlock(size_t minSize)
+{
+    size_t size = ARENA_ROUNDUP(minSize) + ARENA_ROUNDUP(sizeof(Block));
+    if (size < m_blockSize)
+        size = m_blockSize;
+
+    Block* block = (Block*)malloc(size);
+    if (!block)
+        throw std::bad_alloc();
+
+    block->next = NULL;
+    block->size = size;
+    return block;
+}
+
+
+void* SE_RenderArena::Alloc(size_t size)
+{
+    size = ARENA_ROUNDUP(size);
+
+    while (m_ptr == NULL || (size_t)(m_end - m_ptr) < size)
+    {
+        // move on to the next block in the chain, appending a new one
+        // if we've reached the end or the next one is too small
+        Block* next = m_cur? m_cur->next : m_head;
+        if (next && next->size - ARENA_ROUNDUP(sizeof(Block)) < size)
+            next = NULL;
+
+        if (!next)
+        {
+            next = NewBlock(size);
+            if (m_cur)
+            {
+                next->next = m_cur->next;
+                m_cur->next = next;
+            }
+            else
+            {
+                next->next = m_head;
+                m_head = next;
+            }
+        }
+
+        m_cur = next;
+        m_ptr = (char*)m_cur + ARENA_ROUNDUP(sizeof(Block));
+        m_end = (char*)m_cur + m_cur->size;
+    }
+
+    void* ret = m_ptr;
+    m_ptr += size;
+    return ret;
+}
+
+
+void SE_RenderArena::Reset()
+{
+    // keep the blocks around - the next feature will reuse them
+    m_cur = NULL;
+    m_ptr = NULL;
+    m_end = NULL;
+}
@@ -0,0 +1,78 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_RENDERARENA_H_
+#define SE_RENDERARENA_H_
+
+#include "StylizationAPI.h"
+#include <new>
+
+
+//---------------------------------------------
+// Bump allocator for short-lived render objects
+//
+// Render styles and primitives evaluated for a single feature are carved
+// out of large blocks and the whole lot is released with one call to
+// Reset.  The arena never runs destructors - objects placed in it must be
+// destroyed by their owner (see SE_Style::reset) before the arena is reset.
+//---------------------------------------------
+
+class SE_RenderArena
+{
+public:
+    STYLIZATION_API SE_RenderArena(size_t blockSize = 16384);
+    STYLIZATION_API ~SE_RenderArena();
+
+    STYLIZATION_API void* Alloc(size_t size);
+    STYLIZATION_API void Reset();
+
+    // constructs an object in the arena, or on the heap if no arena is supplied
+    template <class T> static T* New(SE_RenderArena* arena)
+    {
+        if (arena)
+            return new (arena->Alloc(sizeof(T))) T();
+
+        return new T();
+    }
+
+    // destroys an object obtained from New - the memory itself is only
+    // reclaimed once the arena is reset
+    template <class T> static void Delete(SE_RenderArena* arena, T* obj)
+    {
+        if (arena)
+            obj->~T();
+        else
+            delete obj;
+    }
+
+private:
+    struct Block
+    {
+        Block* next;
+        size_t size;
+    };
+
+    Block* NewBlock(size_t minSize);
+
+    Block* m_head;      // first block in the chain
+    Block* m_cur;       // block currently being allocated from
+    char* m_ptr;        // next free byte in the current block
+    char* m_end;        // end of the current block
+    size_t m_blockSize;
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include "SE_LineBuffer.h"
 #include "SE_SymbolManager.h"
 #include "RS_TextMetrics.h"
+#include "SE_RenderArena.h"
 
 
 enum SE_RenderPrimitiveType
@@ -176,7 +177,9 @@ struct SE_RenderStyle
           renderPass(0),
           drawLast(false),
           checkExclusionRegion(false),
-          addToExclusionRegion(false)
+          addToExclusionRegion(false),
+          arena(NULL),
+          cacheId(0)
     {
         bounds[0].x = bounds[3].x = +DBL_MAX;
         bounds[1].x = bounds[2].x = -DBL_MAX;
@@ -192,19 +195,19 @@ struct SE_RenderStyle
             switch ((*iter)->type)
             {
                 case SE_RenderPrimitive_Polyline:
-                    delete (SE_RenderPolyline*)(*iter);
+                    SE_RenderArena::Delete(arena, (SE_RenderPolyline*)(*iter));
                     break;
 
                 case SE_RenderPrimitive_Polygon:
-                    delete (SE_RenderPolygon*)(*iter);
+                    SE_RenderArena::Delete(arena, (SE_RenderPolygon*)(*iter));
                     break;
 
                 case SE_RenderPrimitive_Raster:
-                    delete (SE_RenderRaster*)(*iter);
+                    SE_RenderArena::Delete(arena, (SE_RenderRaster*)(*iter));
                     break;
 
                 case SE_RenderPrimitive_Text:
-                    delete (SE_RenderText*)(*iter);
+                    SE_RenderArena::Delete(arena, (SE_RenderText*)(*iter));
                     break;
 
                 default:
@@ -223,6 +226,15 @@ struct SE_RenderStyle
     bool drawLast;
     bool checkExclusionRegion;
     bool addToExclusionRegion;
+
+    // the arena this style and its primitives were allocated from, or
+    // NULL if they live on the heap (e.g. cached styles and labels)
+    SE_RenderArena* arena;
+
+    // nonzero, and unique, for a constant style which is evaluated once and
+    // then drawn for every feature - renderers can key what they derive
+    // from the style on it
+    unsigned int cacheId;
 };
 
 
@@ -20,6 +20,7 @@
 #include "SE_AreaPositioning.h"
 #include "RS_FontEngine.h"
 #include "SE_SymbolDefProxies.h"
+#include "StylizationTrace.h"
 
 using namespace MDFMODEL_NAMESPACE;
 
@@ -27,6 +28,7 @@ using namespace MDFMODEL_NAMESPACE;
 ///////////////////////////////////////////////////////////////////////////////
 SE_Renderer::SE_Renderer()
 : m_pPool(NULL)
+, m_profiler(NULL)
 , m_bSelectionMode(false)
 , m_selFillColor(0)
 , m_textForeColor(0)
@@ -34,6 +36,8 @@ SE_Renderer::SE_Renderer()
 , m_rasterGridSize(100)
 , m_minRasterGridSize(10)
 , m_rasterGridSizeOverrideRatio(0.25)
+, m_batcher(NULL)
+, m_batchSuspended(false)
 {
 }
 
@@ -41,6 +45,7 @@ SE_Renderer::SE_Renderer()
 ///////////////////////////////////////////////////////////////////////////////
 SE_Renderer::~SE_Renderer()
 {
+    delete m_batcher;
 }
 
 
@@ -147,6 +152,36 @@ void SE_Renderer::SetBufferPool(SE_BufferPool* pool)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void SE_Renderer::SetDrawBatching(SE_DrawBatchMode mode, double maxSpread)
+{
+    if (m_batcher)
+    {
+        m_batcher->Flush();
+        delete m_batcher;
+        m_batcher = NULL;
+    }
+
+    if (mode != SE_DrawBatchMode_None)
+        m_batcher = new SE_DrawBatcher(this, mode, maxSpread);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void SE_Renderer::SuspendDrawBatching(bool suspend)
+{
+    FlushDrawBatch();
+    m_batchSuspended = suspend;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_DrawBatchStats SE_Renderer::GetDrawBatchStats()
+{
+    return m_batcher? m_batcher->GetStats() : SE_DrawBatchStats();
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 void SE_Renderer::SetRenderSelectionMode(bool mode)
 {
@@ -222,8 +257,11 @@ void SE_Renderer::ProcessPoint(SE_ApplyContext* ctx, SE_RenderPointStyle* style,
     xformbase.rotate(yUp? angleRad : -angleRad);
     xformbase.premultiply(*ctx->xform);
 
-    // render the points
-    for (int i=0; i<featGeom->point_count(); ++i)
+    // render the points - the symbols of multi-point geometry share one
+    // preparation and are drawn as a batch
+    int npts = featGeom->point_count();
+    std::vector<SE_Matrix> xforms;
+    for (int i=0; i<npts; ++i)
     {
         double x, y;
         featGeom->get_point(i, x, y);
@@ -236,8 +274,17 @@ void SE_Renderer::ProcessPoint(SE_ApplyContext* ctx, SE_RenderPointStyle* style,
 
         if (style->drawLast)
             AddLabel(featGeom, style, xform, angleRad);
-        else
+        else if (npts == 1)
             DrawSymbol(style->symbol, xform, angleRad, style->addToExclusionRegion);
+        else
+            xforms.push_back(xform);
+    }
+
+    if (!xforms.empty())
+    {
+        SE_PreparedSymbol prepared;
+        PrepareSymbol(style->symbol, prepared);
+        DrawSymbolInstances(prepared, &xforms[0], (int)xforms.size(), angleRad, style->addToExclusionRegion);
     }
 
     if (bounds)
@@ -255,6 +302,76 @@ void SE_Renderer::ProcessPoint(SE_ApplyContext* ctx, SE_RenderPointStyle* style,
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Draws a point style at every node of a regular screen-space grid as a single
+// pattern fill.  The geometry holds the grid nodes in mapping space, starting
+// with the grid origin and ending with the opposite corner.  Returns false if
+// the style can't be drawn as a pattern, or the renderer doesn't support
+// pattern fills - the caller must then apply the style as usual.
+bool SE_Renderer::ProcessPointGrid(SE_ApplyContext* ctx, SE_RenderPointStyle* style, double repeatX, double repeatY)
+{
+    LineBuffer* featGeom = ctx->geometry;
+
+    // labels and exclusion regions need the individual placements
+    if (style->drawLast || style->addToExclusionRegion || featGeom->point_count() == 0)
+        return false;
+
+    // the same transform as ProcessPoint - grid geometry has no angle
+    double angleRad = style->angleRad + GetWorldToScreenRotation();
+
+    SE_Matrix xformbase;
+    xformbase.translate(style->offset[0], style->offset[1]);
+    xformbase.rotate(YPointsUp()? angleRad : -angleRad);
+    xformbase.premultiply(*ctx->xform);
+
+    // the extent of one placement relative to its grid node
+    RS_Bounds extents(+DBL_MAX, +DBL_MAX, -DBL_MAX, -DBL_MAX);
+    for (int i=0; i<4; ++i)
+    {
+        RS_F_Point xfpt;
+        xformbase.transform(style->bounds[i].x, style->bounds[i].y, xfpt.x, xfpt.y);
+        extents.add_point(xfpt);
+    }
+
+    // a placement which spills into its neighbouring cells would also show
+    // in the cells around the grid, so it can't be drawn as a pattern
+    if (extents.width() > fabs(repeatX) || extents.height() > fabs(repeatY))
+        return false;
+
+    double x0, y0, x1, y1;
+    featGeom->get_point(0, x0, y0);
+    featGeom->get_point(featGeom->point_count()-1, x1, y1);
+    WorldToScreenPoint(x0, y0, x0, y0);
+    WorldToScreenPoint(x1, y1, x1, y1);
+
+    // the pattern covers the placements at the grid nodes
+    double minx = rs_min(x0, x1) + extents.minx;
+    double maxx = rs_max(x0, x1) + extents.maxx;
+    double miny = rs_min(y0, y1) + extents.miny;
+    double maxy = rs_max(y0, y1) + extents.maxy;
+
+    LineBuffer* polygon = LineBufferPool::NewLineBuffer(m_pPool, 5);
+    std::auto_ptr<LineBuffer> spLB(polygon);
+    polygon->SetGeometryType(GeometryType_Polygon);
+    polygon->MoveTo(minx, miny);
+    polygon->LineTo(maxx, miny);
+    polygon->LineTo(maxx, maxy);
+    polygon->LineTo(minx, maxy);
+    polygon->Close();
+
+    SE_Matrix xform = xformbase;
+    xform.translate(x0, y0);
+
+    SE_PreparedSymbol prepared;
+    PrepareSymbol(style->symbol, prepared);
+    FlushDrawBatch();
+    bool drawn = DrawScreenPatternFill(polygon, prepared, xform, angleRad, repeatX, repeatY, 0.0, style->cacheId);
+
+    LineBufferPool::FreeLineBuffer(m_pPool, spLB.release());
+    return drawn;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Called when applying a line style on a feature geometry.  Line styles can
 // only be applied to linestring and polygon feature geometry types.
@@ -287,13 +404,19 @@ void SE_Renderer::ProcessLine(SE_ApplyContext* ctx, SE_RenderLineStyle* style)
             m_selLineStroke.cap        = rp->lineStroke.cap;
             m_selLineStroke.join       = rp->lineStroke.join;
             m_selLineStroke.miterLimit = rp->lineStroke.miterLimit;
-            DrawScreenPolyline(featGeom, &w2s, m_selLineStroke);
+            DrawStylePolyline(featGeom, &w2s, m_selLineStroke);
         }
         else
-            DrawScreenPolyline(featGeom, &w2s, rp->lineStroke);
+            DrawStylePolyline(featGeom, &w2s, rp->lineStroke);
         return;
     }
 
+    // measure the feature geometry - the measure is shared by all the line
+    // styles applied to the feature, if the caller supplied one
+    SE_PathMeasure localMeasure;
+    SE_PathMeasure& measure = ctx->pathMeasure? *ctx->pathMeasure : localMeasure;
+    measure.Build(featGeom, this);
+
     //--------------------------------------------------------------
     // handle the case repeat <= 0 - here we ignore vertex control
     //--------------------------------------------------------------
@@ -308,7 +431,7 @@ void SE_Renderer::ProcessLine(SE_ApplyContext* ctx, SE_RenderLineStyle* style)
         style->vertexAngleLimit = M_PI + 1.0;   // any value greater than M_PI
         style->repeat = DBL_MAX;
 
-        ProcessLineOverlapDirect(featGeom, style);
+        ProcessLineOverlapDirect(measure, style);
 
         style->vertexAngleLimit = old_val;
         style->repeat = old_rep;
@@ -320,11 +443,11 @@ void SE_Renderer::ProcessLine(SE_ApplyContext* ctx, SE_RenderLineStyle* style)
     //--------------------------------------------------------------
 
     if (style->vertexControl == SE_VertexControl_OverlapNone)
-        ProcessLineOverlapNone(featGeom, style);
+        ProcessLineOverlapNone(measure, style);
     else if (style->vertexControl == SE_VertexControl_OverlapDirect)
-        ProcessLineOverlapDirect(featGeom, style);
+        ProcessLineOverlapDirect(measure, style);
     else
-        ProcessLineOverlapWrap(featGeom, style);
+        ProcessLineOverlapWrap(measure, style);
 }
 
 
@@ -361,9 +484,9 @@ void SE_Renderer::ProcessArea(SE_ApplyContext* ctx, SE_RenderAreaStyle* style)
         SE_RenderPolygon* rp = (SE_RenderPolygon*)style->symbol[0];
 
         if (m_bSelectionMode)
-            DrawScreenPolygon(featGeom, &w2s, m_selFillColor);
+            DrawStylePolygon(featGeom, &w2s, m_selFillColor);
         else
-            DrawScreenPolygon(featGeom, &w2s, rp->fill);
+            DrawStylePolygon(featGeom, &w2s, rp->fill);
         return;
     }
 
@@ -390,13 +513,47 @@ void SE_Renderer::ProcessArea(SE_ApplyContext* ctx, SE_RenderAreaStyle* style)
     SE_Matrix xformbase = *ctx->xform;
     xformbase.rotate(baserot);
 
+    // all locations share the same rotation, so prepare the symbol once
+    SE_PreparedSymbol prepared;
+    PrepareSymbol(style->symbol, prepared);
+
+    // If the symbols are clipped to the polygon then the whole fill is just
+    // a pattern - let the renderer stamp it as a tile if it can.  This isn't
+    // possible if each symbol must be added to the exclusion region, and
+    // only pays off for constant styles, whose tile the renderer can keep.
+    // A symbol which varies per feature is drawn at each location.
+    if (style->clippingControl == SE_ClippingControl_Clip && !style->addToExclusionRegion && style->cacheId != 0)
+    {
+        double repeatX = fabs(style->repeat[0]);
+        double repeatY = fabs(style->repeat[1]);
+        if (repeatX > 0.0 && repeatY > 0.0)
+        {
+            const Point2D& origin = ap.PatternOrigin();
+            xform = xformbase;
+            xform.translate(origin.x, origin.y);
+
+            FlushDrawBatch();
+            if (DrawScreenPatternFill(xfgeom, prepared, xform, baserot, repeatX, repeatY, baserot, style->cacheId))
+            {
+                LineBufferPool::FreeLineBuffer(m_pPool, spLB.release());
+                return;
+            }
+        }
+    }
+
+    // otherwise hand the individual placements to the renderer as one batch
+
+    std::vector<SE_Matrix> xforms;
     for (const Point2D* pos = ap.NextLocation(); pos != NULL; pos = ap.NextLocation())
     {
         xform = xformbase;
         xform.translate(pos->x, pos->y);
-        DrawSymbol(style->symbol, xform, baserot, style->addToExclusionRegion);
+        xforms.push_back(xform);
     }
 
+    if (!xforms.empty())
+        DrawSymbolInstances(prepared, &xforms[0], (int)xforms.size(), baserot, style->addToExclusionRegion);
+
     LineBufferPool::FreeLineBuffer(m_pPool, spLB.release());
 }
 
@@ -406,10 +563,49 @@ void SE_Renderer::DrawSymbol(SE_RenderPrimitiveList& symbol,
                              const SE_Matrix& xform,
                              double angleRad,
                              bool excludeRegion)
+{
+    SE_PreparedSymbol prepared;
+    PrepareSymbol(symbol, prepared);
+    DrawPreparedSymbol(prepared, xform, angleRad, excludeRegion);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void SE_Renderer::DrawSymbolInstances(SE_PreparedSymbol& symbol,
+                                      const SE_Matrix* xforms,
+                                      int count,
+                                      double angleRad,
+                                      bool excludeRegion)
+{
+    for (int i=0; i<count; ++i)
+        DrawPreparedSymbol(symbol, xforms[i], angleRad, excludeRegion);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool SE_Renderer::DrawScreenPatternFill(LineBuffer* /*polygon*/,
+                                        SE_PreparedSymbol& /*cell*/,
+                                        const SE_Matrix& /*cellXform*/,
+                                        double /*cellAngleRad*/,
+                                        double /*repeatX*/,
+                                        double /*repeatY*/,
+                                        double /*angleRad*/,
+                                        unsigned int /*cellId*/)
+{
+    return false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void SE_Renderer::PrepareSymbol(SE_RenderPrimitiveList& symbol, SE_PreparedSymbol& prepared)
 {
     RS_Bounds extents(DBL_MAX, DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX, -DBL_MAX);
     unsigned int nprims = symbol.size();
 
+    prepared.symbol = &symbol;
+    prepared.textMetrics.clear();
+    prepared.textMetrics.resize(nprims);
+
     for (unsigned int i=0; i<nprims; ++i)
     {
         SE_RenderPrimitive* primitive = symbol[i];
@@ -418,39 +614,91 @@ void SE_Renderer::DrawSymbol(SE_RenderPrimitiveList& symbol,
         {
             SE_RenderPolyline* rp = (SE_RenderPolyline*)primitive;
 
-            LineBuffer* lb = rp->geometry->xf_buffer();
-
             // update the extents with this primitive
             RS_Bounds lbnds;
-            lb->ComputeBounds(lbnds);
+            rp->geometry->xf_buffer()->ComputeBounds(lbnds);
             extents.add_bounds(lbnds);
+        }
+        else if (primitive->type == SE_RenderPrimitive_Text)
+        {
+            SE_RenderText* tp = (SE_RenderText*)primitive;
+
+            // update the extents with this primitive's bounds
+            for (int j=0; j<4; ++j)
+                extents.add_point(primitive->bounds[j]);
+
+            // The metrics stored in the SE_RenderText can't be used since the
+            // primitive may have been resized after they were computed.  The
+            // metrics of plain text don't depend on the placement's rotation
+            // or the selection colors, so for those we compute them once here.
+            // Formatted text is measured for each placement.
+            const RS_String& markup = tp->tdef.markup();
+            if (markup.empty() || _wcsicmp(markup.c_str(), L"plain") == 0)
+            {
+                RS_TextMetrics& tm = prepared.textMetrics[i];
+                if (!this->GetRSFontEngine()->GetTextMetrics(tp->content, tp->tdef, tm, false))
+                    tm.font = NULL;
+            }
+        }
+        else if (primitive->type == SE_RenderPrimitive_Raster)
+        {
+            // selected rasters only draw their mask, which isn't included in the extents
+            if (!m_bSelectionMode && ((SE_RenderRaster*)primitive)->imageData.data != NULL)
+            {
+                // update the extents with this primitive's bounds
+                for (int j=0; j<4; ++j)
+                    extents.add_point(primitive->bounds[j]);
+            }
+        }
+    }
+
+    prepared.extents = extents;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void SE_Renderer::DrawPreparedSymbol(SE_PreparedSymbol& prepared,
+                                     const SE_Matrix& xform,
+                                     double angleRad,
+                                     bool excludeRegion)
+{
+    StylizationTraceScope trace("DrawSymbol", StylizationTrace::Features);
+
+    SE_RenderPrimitiveList& symbol = *prepared.symbol;
+    unsigned int nprims = symbol.size();
+
+    for (unsigned int i=0; i<nprims; ++i)
+    {
+        SE_RenderPrimitive* primitive = symbol[i];
+
+        if (primitive->type == SE_RenderPrimitive_Polygon || primitive->type == SE_RenderPrimitive_Polyline)
+        {
+            SE_RenderPolyline* rp = (SE_RenderPolyline*)primitive;
+
+            LineBuffer* lb = rp->geometry->xf_buffer();
 
             if (m_bSelectionMode)
             {
                 if (primitive->type == SE_RenderPrimitive_Polygon)
-                    DrawScreenPolygon(lb, &xform, m_selFillColor);
+                    DrawStylePolygon(lb, &xform, m_selFillColor);
 
                 m_selLineStroke.cap        = rp->lineStroke.cap;
                 m_selLineStroke.join       = rp->lineStroke.join;
                 m_selLineStroke.miterLimit = rp->lineStroke.miterLimit;
-                DrawScreenPolyline(lb, &xform, m_selLineStroke);
+                DrawStylePolyline(lb, &xform, m_selLineStroke);
             }
             else
             {
                 if (primitive->type == SE_RenderPrimitive_Polygon)
-                    DrawScreenPolygon(lb, &xform, ((SE_RenderPolygon*)primitive)->fill);
+                    DrawStylePolygon(lb, &xform, ((SE_RenderPolygon*)primitive)->fill);
 
-                DrawScreenPolyline(lb, &xform, rp->lineStroke);
+                DrawStylePolyline(lb, &xform, rp->lineStroke);
             }
         }
         else if (primitive->type == SE_RenderPrimitive_Text)
         {
             SE_RenderText* tp = (SE_RenderText*)primitive;
 
-            // update the extents with this primitive's bounds
-            for (int j=0; j<4; ++j)
-                extents.add_point(primitive->bounds[j]);
-
             // get position and angle to use
             double x, y;
             xform.transform(tp->position[0], tp->position[1], x, y);
@@ -465,11 +713,21 @@ void SE_Renderer::DrawSymbol(SE_RenderPrimitiveList& symbol,
 //              tdef.opaquecolor() = m_textBackColor;
             }
 
-            // Here we cannot use the cached RS_TextMetrics in the SE_RenderText object.
-            // We must recalculate the text metrics with the new tdef before we can call DrawScreenText.
-            RS_TextMetrics tm;
-            if (this->GetRSFontEngine()->GetTextMetrics(tp->content, tdef, tm, false))
-                DrawScreenText(tm, tdef, x, y, NULL, 0, 0.0);
+            // batched draws go first - text and rasters aren't batched
+            FlushDrawBatch();
+
+            RS_TextMetrics& ptm = prepared.textMetrics[i];
+            if (ptm.font)
+            {
+                DrawScreenText(ptm, tdef, x, y, NULL, 0, 0.0);
+            }
+            else
+            {
+                // We must recalculate the text metrics with the new tdef before we can call DrawScreenText.
+                RS_TextMetrics tm;
+                if (this->GetRSFontEngine()->GetTextMetrics(tp->content, tdef, tm, false))
+                    DrawScreenText(tm, tdef, x, y, NULL, 0, 0.0);
+            }
         }
         else if (primitive->type == SE_RenderPrimitive_Raster)
         {
@@ -487,8 +745,8 @@ void SE_Renderer::DrawSymbol(SE_RenderPrimitiveList& symbol,
                     lb->LineTo(rp->bounds[i].x, rp->bounds[i].y);
                 }
                 
-                DrawScreenPolygon(lb, &xform, m_selFillColor);
-                DrawScreenPolyline(lb, &xform, m_selLineStroke);
+                DrawStylePolygon(lb, &xform, m_selFillColor);
+                DrawStylePolyline(lb, &xform, m_selLineStroke);
 
                 LineBufferPool::FreeLineBuffer(m_pPool, spLB.release());
             }
@@ -497,15 +755,12 @@ void SE_Renderer::DrawSymbol(SE_RenderPrimitiveList& symbol,
                 ImageData& imgData = rp->imageData;
                 if (imgData.data != NULL)
                 {
-                    // update the extents with this primitive's bounds
-                    for (int j=0; j<4; ++j)
-                        extents.add_point(primitive->bounds[j]);
-
                     // get position and angle to use
                     double x, y;
                     xform.transform(rp->position[0], rp->position[1], x, y);
                     double angleDeg = (rp->angleRad + angleRad) * M_180PI;
 
+                    FlushDrawBatch();
                     DrawScreenRaster(imgData.data, imgData.size, imgData.format, imgData.width, imgData.height, x, y, rp->extent[0], rp->extent[1], angleDeg, rp->opacity);
                 }
             }
@@ -515,6 +770,7 @@ void SE_Renderer::DrawSymbol(SE_RenderPrimitiveList& symbol,
     if (nprims > 0)
     {
         // always compute the last symbol extent
+        const RS_Bounds& extents = prepared.extents;
         xform.transform(extents.minx, extents.miny, m_lastSymbolExtent[0].x, m_lastSymbolExtent[0].y);
         xform.transform(extents.maxx, extents.miny, m_lastSymbolExtent[1].x, m_lastSymbolExtent[1].y);
         xform.transform(extents.maxx, extents.maxy, m_lastSymbolExtent[2].x, m_lastSymbolExtent[2].y);
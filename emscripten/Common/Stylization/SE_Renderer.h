@@ -21,11 +21,32 @@
 #include "Renderer.h"
 #include "SE_BufferPool.h"
 #include "SE_RenderProxies.h"
+#include "SE_PathMeasure.h"
+#include "SE_DrawBatcher.h"
 
 // forward declare
 class RS_FontEngine;
 struct HotSpot;
 class SE_ApplyContext;
+class StylizationProfiler;
+
+
+// A symbol which has been prepared for drawing at many placements.  The
+// symbol's primitives are already tessellated in symbol space when they are
+// evaluated, so all that varies between placements is the transform.  The
+// remaining placement-invariant work - the symbol extents and the metrics
+// of plain text primitives - is done once by SE_Renderer::PrepareSymbol.
+struct SE_PreparedSymbol
+{
+    SE_PreparedSymbol() : symbol(NULL) {}
+
+    SE_RenderPrimitiveList* symbol;
+    RS_Bounds extents;
+
+    // one entry per primitive - only valid (font != NULL) for text
+    // primitives whose metrics don't depend on the placement
+    std::vector<RS_TextMetrics> textMetrics;
+};
 
 
 class SE_Renderer : public Renderer
@@ -60,6 +81,29 @@ public:
     STYLIZATION_API virtual SE_BufferPool* GetBufferPool();
     STYLIZATION_API virtual void SetBufferPool(SE_BufferPool* pool);
 
+    // the profiler the stylizers report to - NULL when not profiling
+    inline StylizationProfiler* GetProfiler() { return m_profiler; }
+    inline void SetProfiler(StylizationProfiler* profiler) { m_profiler = profiler; }
+
+    // Batches the polylines and polygons drawn by the styles into fewer
+    // draw calls (see SE_DrawBatcher).  The bounds of a batch may grow to
+    // maxSpread times the total area of its primitives - renderers which
+    // work over the bounds of each draw, like SE_ImageRenderer, want a
+    // small spread, while those whose cost is per call can pass zero for no
+    // limit.  Batches span features, so renderers which attribute draws to
+    // the current feature should leave batching off, which is the default.
+    STYLIZATION_API void SetDrawBatching(SE_DrawBatchMode mode, double maxSpread = 2.0);
+    STYLIZATION_API SE_DrawBatchStats GetDrawBatchStats();
+
+    // Draws the batched polylines and polygons - called by the stylizers at
+    // the end of each rendering pass.
+    inline void FlushDrawBatch() { if (m_batcher) m_batcher->Flush(); }
+
+    // Draws the batched polylines and polygons, and draws the styles'
+    // unbatched until batching is resumed.  The label renderers draw their
+    // labels this way, since their text goes straight to the renderer.
+    STYLIZATION_API void SuspendDrawBatching(bool suspend);
+
     ///////////////////////////////////
     // SE_Renderer specific
 
@@ -70,6 +114,13 @@ public:
     STYLIZATION_API virtual void ProcessLine(SE_ApplyContext* ctx, SE_RenderLineStyle* style);
     STYLIZATION_API virtual void ProcessArea(SE_ApplyContext* ctx, SE_RenderAreaStyle* style);
 
+    // Draws a point style at the nodes of a regular grid, given in the
+    // context's geometry from the grid origin to the opposite corner, as one
+    // pattern fill with the given screen unit repeats (see
+    // DrawScreenPatternFill).  Returns false if the style or the renderer
+    // doesn't allow it, and the style must then be applied at each node.
+    STYLIZATION_API bool ProcessPointGrid(SE_ApplyContext* ctx, SE_RenderPointStyle* style, double repeatX, double repeatY);
+
     // Draws the specified symbol using the given transform.  The supplied angle
     // is in radians CCW, and should correspond to the rotation encoded in the
     // transform.  Note that since the transform converts to renderer space, its
@@ -77,6 +128,35 @@ public:
     STYLIZATION_API virtual void DrawSymbol(SE_RenderPrimitiveList& symbol, const SE_Matrix& xform,
                                             double angleRad, bool excludeRegion = false);
 
+    // Draws many placements of a prepared symbol which all share the same
+    // rotation.  The default implementation draws each placement in turn;
+    // renderers which support instancing can override this to draw the whole
+    // batch at once.  The last symbol extent is that of the last placement.
+    STYLIZATION_API virtual void DrawSymbolInstances(SE_PreparedSymbol& symbol, const SE_Matrix* xforms, int count,
+                                                     double angleRad, bool excludeRegion = false);
+
+    // Fills a polygon with a pattern made of copies of a prepared symbol,
+    // clipped to the polygon.  The copy in grid cell (i, j) is drawn like
+    // DrawPreparedSymbol draws it with cellXform and cellAngleRad, followed
+    // by a translation of (i*repeatX, j*repeatY) rotated by angleRad
+    // (radians CCW).  The polygon, repeats and transform are all in screen
+    // units.  A nonzero cellId is the cacheId of a constant style, so other
+    // calls with the same id and cell transform draw the same cell, and a
+    // renderer may keep the tile it renders for it.  Renderers which can
+    // render the symbol once into a tile and fill the polygon with it
+    // should override this and return true.  The default returns false, and
+    // the symbol is then drawn at each grid location instead.
+    STYLIZATION_API virtual bool DrawScreenPatternFill(LineBuffer* polygon, SE_PreparedSymbol& cell, const SE_Matrix& cellXform,
+                                                       double cellAngleRad, double repeatX, double repeatY, double angleRad,
+                                                       unsigned int cellId);
+
+    // Prepares a symbol for drawing at many placements.
+    STYLIZATION_API void PrepareSymbol(SE_RenderPrimitiveList& symbol, SE_PreparedSymbol& prepared);
+
+    // Draws a single placement of a prepared symbol.
+    STYLIZATION_API void DrawPreparedSymbol(SE_PreparedSymbol& symbol, const SE_Matrix& xform,
+                                            double angleRad, bool excludeRegion = false);
+
     // Turns selection mode rendering on/off.
     STYLIZATION_API virtual void SetRenderSelectionMode(bool mode);
     STYLIZATION_API virtual void SetRenderSelectionMode(bool mode, int rgba);
@@ -126,8 +206,8 @@ public:
     // angles are in radians CCW
     void AddLabel(LineBuffer* geom, SE_RenderStyle* style, const SE_Matrix& xform, double angleRad);
 
-    // helper method
-    void ProcessLineLabels(LineBuffer* geometry, SE_RenderLineStyle* style);
+    // helper method - the measure is built for the geometry if it's not supplied
+    void ProcessLineLabels(LineBuffer* geometry, SE_RenderLineStyle* style, SE_PathMeasure* measure = NULL);
 
     // Indicates whether rendering optimization is used by this renderer.  For
     // example, if we are rendering text and optimization is turned on, then
@@ -137,26 +217,42 @@ public:
     STYLIZATION_API virtual bool OptimizeGeometry();
 
 private:
-    void ProcessLineOverlapWrap(LineBuffer* geometry, SE_RenderLineStyle* style);
-    void ProcessLineOverlapNone(LineBuffer* geometry, SE_RenderLineStyle* style);
-    void ProcessLineOverlapDirect(LineBuffer* geometry, SE_RenderLineStyle* style);
+    void ProcessLineOverlapWrap(SE_PathMeasure& measure, SE_RenderLineStyle* style);
+    void ProcessLineOverlapNone(SE_PathMeasure& measure, SE_RenderLineStyle* style);
+    void ProcessLineOverlapDirect(SE_PathMeasure& measure, SE_RenderLineStyle* style);
 
-    int ConfigureHotSpots(LineBuffer* geometry, int cur_contour, SE_RenderLineStyle* style, RS_Bounds& styleBounds, HotSpot* hotspots);
-    int ComputePoints(LineBuffer* geometry, int cur_contour, HotSpot* hotspots);
+    int ConfigureHotSpots(SE_PathMeasure& measure, int cur_contour, SE_RenderLineStyle* style, RS_Bounds& styleBounds, HotSpot* hotspots);
+    int ComputePoints(SE_PathMeasure& measure, int cur_contour, HotSpot* hotspots);
     void ChopLineBuffer(LineBuffer* inBuffer, LineBuffer* outBuffer);
     LineBuffer* ClipPolyline(LineBufferPool* lbp, LineBuffer& geometry, double zMin, double zMax);
     LineBuffer* ClipPolygon(LineBufferPool* lbp, LineBuffer& geometry, double zMin, double zMax);
     int ClipLine(double zMin, double zMax, double* line, double* ret);
     int ClipCode(double zMin, double zMax, double z);
 
-    void ComputeSegmentLengths(LineBuffer* geometry, double* segLens);
-    void ComputeGroupLengths(double* segLens, int numGroups, int* segGroups, double* groupLens);
-    int ComputeSegmentGroups(LineBuffer* geometry, int contour, double vertexAngleLimit, double* segLens, int* segGroups);
     void ComputeGroupDistribution(double groupLen, double startOffset, double endOffset, double repeat, double symWidth,
                                   double& startPos, double& gap, int& numSymbols);
 
 protected:
+    // the polyline and polygon draws of the styles, which are batched when
+    // batching is on
+    inline void DrawStylePolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke)
+    {
+        if (m_batcher && !m_batchSuspended)
+            m_batcher->AddPolyline(polyline, xform, lineStroke);
+        else
+            DrawScreenPolyline(polyline, xform, lineStroke);
+    }
+
+    inline void DrawStylePolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill)
+    {
+        if (m_batcher && !m_batchSuspended)
+            m_batcher->AddPolygon(polygon, xform, fill);
+        else
+            DrawScreenPolygon(polygon, xform, fill);
+    }
+
     SE_BufferPool* m_pPool;
+    StylizationProfiler* m_profiler;
     bool m_bSelectionMode;
 
     SE_LineStroke m_selLineStroke;
@@ -171,6 +267,8 @@ protected:
 
 private:
     RS_F_Point m_lastSymbolExtent[4];
+    SE_DrawBatcher* m_batcher;
+    bool m_batchSuspended;
 };
 
 #endif
@@ -49,16 +49,16 @@ SE_StyleVisitor::SE_StyleVisitor(SE_SymbolManager* resources, SE_BufferPool* bp)
 SE_PointStyle* SE_StyleVisitor::ProcessPointUsage(PointUsage& pointUsage)
 {
     SE_PointStyle* style = new SE_PointStyle();
-    ParseStringExpression(pointUsage.GetAngleControl(), style->angleControl, PointUsage::sAngleControlDefault, PointUsage::sAngleControlValues);
+    ParseEnumExpression(pointUsage.GetAngleControl(), style->angleControl, PointUsage::sAngleControlDefault, PointUsage::sAngleControlValues);
     ParseDoubleExpression(pointUsage.GetAngle(), style->angleDeg, 0.0);
     ParseDoubleExpression(pointUsage.GetOriginOffsetX(), style->originOffset[0], 0.0);
     ParseDoubleExpression(pointUsage.GetOriginOffsetY(), style->originOffset[1], 0.0);
 
     // set flag if all properties are constant
-    style->cacheable = (!style->angleDeg.expression.empty()
-                     && !style->angleControl.expression.empty()
-                     && !style->originOffset[0].expression.empty()
-                     && !style->originOffset[1].expression.empty());
+    style->cacheable = (style->angleDeg.expression.empty()
+                     && style->angleControl.expression.empty()
+                     && style->originOffset[0].expression.empty()
+                     && style->originOffset[1].expression.empty());
 
     return style;
 }
@@ -67,15 +67,15 @@ SE_PointStyle* SE_StyleVisitor::ProcessPointUsage(PointUsage& pointUsage)
 SE_LineStyle* SE_StyleVisitor::ProcessLineUsage(LineUsage& lineUsage)
 {
     SE_LineStyle* style = new SE_LineStyle();
-    ParseStringExpression(lineUsage.GetAngleControl(), style->angleControl, LineUsage::sAngleControlDefault, LineUsage::sAngleControlValues);
-    ParseStringExpression(lineUsage.GetUnitsControl(), style->unitsControl, LineUsage::sUnitsControlDefault, LineUsage::sUnitsControlValues);
-    ParseStringExpression(lineUsage.GetVertexControl(), style->vertexControl, LineUsage::sVertexControlDefault, LineUsage::sVertexControlValues);
+    ParseEnumExpression(lineUsage.GetAngleControl(), style->angleControl, LineUsage::sAngleControlDefault, LineUsage::sAngleControlValues);
+    ParseEnumExpression(lineUsage.GetUnitsControl(), style->unitsControl, LineUsage::sUnitsControlDefault, LineUsage::sUnitsControlValues);
+    ParseEnumExpression(lineUsage.GetVertexControl(), style->vertexControl, LineUsage::sVertexControlDefault, LineUsage::sVertexControlValues);
     ParseDoubleExpression(lineUsage.GetAngle(), style->angleDeg, 0.0);
     ParseDoubleExpression(lineUsage.GetStartOffset(), style->startOffset, -1.0);
     ParseDoubleExpression(lineUsage.GetEndOffset(), style->endOffset, -1.0);
     ParseDoubleExpression(lineUsage.GetRepeat(), style->repeat, 0.0);
     ParseDoubleExpression(lineUsage.GetVertexAngleLimit(), style->vertexAngleLimit, 0.0);
-    ParseStringExpression(lineUsage.GetVertexJoin(), style->vertexJoin, LineUsage::sVertexJoinDefault, LineUsage::sVertexJoinValues);
+    ParseEnumExpression(lineUsage.GetVertexJoin(), style->vertexJoin, LineUsage::sVertexJoinDefault, LineUsage::sVertexJoinValues);
     ParseDoubleExpression(lineUsage.GetVertexMiterLimit(), style->vertexMiterLimit, 5.0);
 
     Path* defaultPath = lineUsage.GetDefaultPath();
@@ -84,8 +84,8 @@ SE_LineStyle* SE_StyleVisitor::ProcessLineUsage(LineUsage& lineUsage)
         ParseDoubleExpression(defaultPath->GetLineWeight(), style->dpWeight, 0.0);
         ParseColorExpression(defaultPath->GetLineColor(), style->dpColor, 0);
         ParseBooleanExpression(defaultPath->GetLineWeightScalable(), style->dpWeightScalable, true);
-        ParseStringExpression(defaultPath->GetLineCap(), style->dpCap, Path::sLineCapDefault, Path::sLineCapValues);
-        ParseStringExpression(defaultPath->GetLineJoin(), style->dpJoin, Path::sLineJoinDefault, Path::sLineJoinValues);
+        ParseEnumExpression(defaultPath->GetLineCap(), style->dpCap, Path::sLineCapDefault, Path::sLineCapValues);
+        ParseEnumExpression(defaultPath->GetLineJoin(), style->dpJoin, Path::sLineJoinDefault, Path::sLineJoinValues);
         ParseDoubleExpression(defaultPath->GetLineMiterLimit(), style->dpMiterLimit, 5.0);
 
         // if the color is transparent there's no point in drawing this
@@ -95,22 +95,22 @@ SE_LineStyle* SE_StyleVisitor::ProcessLineUsage(LineUsage& lineUsage)
     }
 
     // set flag if all properties are constant
-    style->cacheable = (!style->angleDeg.expression.empty()
-                     && !style->angleControl.expression.empty()
-                     && !style->unitsControl.expression.empty()
-                     && !style->vertexControl.expression.empty()
-                     && !style->startOffset.expression.empty()
-                     && !style->endOffset.expression.empty()
-                     && !style->repeat.expression.empty()
-                     && !style->vertexAngleLimit.expression.empty()
-                     && !style->vertexJoin.expression.empty()
-                     && !style->vertexMiterLimit.expression.empty()
-                     && !style->dpWeight.expression.empty()
-                     && !style->dpColor.expression.empty()
-                     && !style->dpWeightScalable.expression.empty()
-                     && !style->dpCap.expression.empty()
-                     && !style->dpJoin.expression.empty()
-                     && !style->dpMiterLimit.expression.empty());
+    style->cacheable = (style->angleDeg.expression.empty()
+                     && style->angleControl.expression.empty()
+                     && style->unitsControl.expression.empty()
+                     && style->vertexControl.expression.empty()
+                     && style->startOffset.expression.empty()
+                     && style->endOffset.expression.empty()
+                     && style->repeat.expression.empty()
+                     && style->vertexAngleLimit.expression.empty()
+                     && style->vertexJoin.expression.empty()
+                     && style->vertexMiterLimit.expression.empty()
+                     && style->dpWeight.expression.empty()
+                     && style->dpColor.expression.empty()
+                     && style->dpWeightScalable.expression.empty()
+                     && style->dpCap.expression.empty()
+                     && style->dpJoin.expression.empty()
+                     && style->dpMiterLimit.expression.empty());
 
     return style;
 }
@@ -119,9 +119,9 @@ SE_LineStyle* SE_StyleVisitor::ProcessLineUsage(LineUsage& lineUsage)
 SE_AreaStyle* SE_StyleVisitor::ProcessAreaUsage(AreaUsage& areaUsage)
 {
     SE_AreaStyle* style = new SE_AreaStyle();
-    ParseStringExpression(areaUsage.GetAngleControl(), style->angleControl, AreaUsage::sAngleControlDefault, AreaUsage::sAngleControlValues);
-    ParseStringExpression(areaUsage.GetOriginControl(), style->originControl, AreaUsage::sOriginControlDefault, AreaUsage::sOriginControlValues);
-    ParseStringExpression(areaUsage.GetClippingControl(), style->clippingControl, AreaUsage::sClippingControlDefault, AreaUsage::sClippingControlValues);
+    ParseEnumExpression(areaUsage.GetAngleControl(), style->angleControl, AreaUsage::sAngleControlDefault, AreaUsage::sAngleControlValues);
+    ParseEnumExpression(areaUsage.GetOriginControl(), style->originControl, AreaUsage::sOriginControlDefault, AreaUsage::sOriginControlValues);
+    ParseEnumExpression(areaUsage.GetClippingControl(), style->clippingControl, AreaUsage::sClippingControlDefault, AreaUsage::sClippingControlValues);
     ParseDoubleExpression(areaUsage.GetAngle(), style->angleDeg, 0.0);
     ParseDoubleExpression(areaUsage.GetOriginX(), style->origin[0], 0.0);
     ParseDoubleExpression(areaUsage.GetOriginY(), style->origin[1], 0.0);
@@ -130,15 +130,15 @@ SE_AreaStyle* SE_StyleVisitor::ProcessAreaUsage(AreaUsage& areaUsage)
     ParseDoubleExpression(areaUsage.GetBufferWidth(), style->bufferWidth, 0.0);
 
     // set flag if all properties are constant
-    style->cacheable =  (!style->angleDeg.expression.empty()
-                      && !style->angleControl.expression.empty()
-                      && !style->originControl.expression.empty()
-                      && !style->clippingControl.expression.empty()
-                      && !style->origin[0].expression.empty()
-                      && !style->origin[1].expression.empty()
-                      && !style->repeat[0].expression.empty()
-                      && !style->repeat[1].expression.empty()
-                      && !style->bufferWidth.expression.empty());
+    style->cacheable =  (style->angleDeg.expression.empty()
+                      && style->angleControl.expression.empty()
+                      && style->originControl.expression.empty()
+                      && style->clippingControl.expression.empty()
+                      && style->origin[0].expression.empty()
+                      && style->origin[1].expression.empty()
+                      && style->repeat[0].expression.empty()
+                      && style->repeat[1].expression.empty()
+                      && style->bufferWidth.expression.empty());
 
     return style;
 }
@@ -655,27 +655,27 @@ void SE_StyleVisitor::VisitPath(Path& path)
         ParseDoubleExpression(path.GetLineWeight(), primitive->weight, 0.0);
         ParseColorExpression(path.GetLineColor(), primitive->color, 0);
         ParseBooleanExpression(path.GetLineWeightScalable(), primitive->weightScalable, true);
-        ParseStringExpression(path.GetLineCap(), primitive->cap, Path::sLineCapDefault, Path::sLineCapValues);
-        ParseStringExpression(path.GetLineJoin(), primitive->join, Path::sLineJoinDefault, Path::sLineJoinValues);
+        ParseEnumExpression(path.GetLineCap(), primitive->cap, Path::sLineCapDefault, Path::sLineCapValues);
+        ParseEnumExpression(path.GetLineJoin(), primitive->join, Path::sLineJoinDefault, Path::sLineJoinValues);
         ParseDoubleExpression(path.GetLineMiterLimit(), primitive->miterLimit, 5.0);
         ParseDoubleExpression(path.GetScaleX(), primitive->scaleX, 1.0);
         ParseDoubleExpression(path.GetScaleY(), primitive->scaleY, 1.0);
-        ParseStringExpression(path.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
+        ParseEnumExpression(path.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
 
         // if the color is transparent there's no point in drawing this
         // path, so change it to black
         if (primitive->color.value.argb == 0)
             primitive->color.value.comps.a = 255;
 
-        primitive->cacheable = (!primitive->weight.expression.empty()
-                             && !primitive->color.expression.empty()
-                             && !primitive->weightScalable.expression.empty()
-                             && !primitive->cap.expression.empty()
-                             && !primitive->join.expression.empty()
-                             && !primitive->miterLimit.expression.empty()
-                             && !primitive->resizeControl.expression.empty()
-                             && !primitive->scaleX.expression.empty()
-                             && !primitive->scaleY.expression.empty());
+        primitive->cacheable = (primitive->weight.expression.empty()
+                             && primitive->color.expression.empty()
+                             && primitive->weightScalable.expression.empty()
+                             && primitive->cap.expression.empty()
+                             && primitive->join.expression.empty()
+                             && primitive->miterLimit.expression.empty()
+                             && primitive->resizeControl.expression.empty()
+                             && primitive->scaleX.expression.empty()
+                             && primitive->scaleY.expression.empty());
     }
     else
     {
@@ -687,23 +687,23 @@ void SE_StyleVisitor::VisitPath(Path& path)
         ParseDoubleExpression(path.GetLineWeight(), primitive->weight, 0.0);
         ParseColorExpression(path.GetLineColor(), primitive->color, 0);
         ParseBooleanExpression(path.GetLineWeightScalable(), primitive->weightScalable, true);
-        ParseStringExpression(path.GetLineCap(), primitive->cap, Path::sLineCapDefault, Path::sLineCapValues);
-        ParseStringExpression(path.GetLineJoin(), primitive->join, Path::sLineJoinDefault, Path::sLineJoinValues);
+        ParseEnumExpression(path.GetLineCap(), primitive->cap, Path::sLineCapDefault, Path::sLineCapValues);
+        ParseEnumExpression(path.GetLineJoin(), primitive->join, Path::sLineJoinDefault, Path::sLineJoinValues);
         ParseDoubleExpression(path.GetLineMiterLimit(), primitive->miterLimit, 5.0);
         ParseDoubleExpression(path.GetScaleX(), primitive->scaleX, 1.0);
         ParseDoubleExpression(path.GetScaleY(), primitive->scaleY, 1.0);
-        ParseStringExpression(path.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
-
-        primitive->cacheable =  (!primitive->weight.expression.empty()
-                              && !primitive->color.expression.empty()
-                              && !primitive->fill.expression.empty()
-                              && !primitive->weightScalable.expression.empty()
-                              && !primitive->cap.expression.empty()
-                              && !primitive->join.expression.empty()
-                              && !primitive->miterLimit.expression.empty()
-                              && !primitive->resizeControl.expression.empty()
-                              && !primitive->scaleX.expression.empty()
-                              && !primitive->scaleY.expression.empty());
+        ParseEnumExpression(path.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
+
+        primitive->cacheable =  (primitive->weight.expression.empty()
+                              && primitive->color.expression.empty()
+                              && primitive->fill.expression.empty()
+                              && primitive->weightScalable.expression.empty()
+                              && primitive->cap.expression.empty()
+                              && primitive->join.expression.empty()
+                              && primitive->miterLimit.expression.empty()
+                              && primitive->resizeControl.expression.empty()
+                              && primitive->scaleX.expression.empty()
+                              && primitive->scaleY.expression.empty());
     }
 }
 
@@ -769,15 +769,15 @@ void SE_StyleVisitor::VisitImage(Image& image)
     ParseDoubleExpression(image.GetSizeY(), primitive->extent[1], 1.0);
     ParseDoubleExpression(image.GetAngle(), primitive->angleDeg, 0.0);
     ParseBooleanExpression(image.GetSizeScalable(), primitive->sizeScalable, true);
-    ParseStringExpression(image.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
-
-    primitive->cacheable =  (!primitive->position[0].expression.empty()
-                          && !primitive->position[1].expression.empty()
-                          && !primitive->extent[0].expression.empty()
-                          && !primitive->extent[1].expression.empty()
-                          && !primitive->angleDeg.expression.empty()
-                          && !primitive->sizeScalable.expression.empty()
-                          && !primitive->resizeControl.expression.empty())
+    ParseEnumExpression(image.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
+
+    primitive->cacheable =  (primitive->position[0].expression.empty()
+                          && primitive->position[1].expression.empty()
+                          && primitive->extent[0].expression.empty()
+                          && primitive->extent[1].expression.empty()
+                          && primitive->angleDeg.expression.empty()
+                          && primitive->sizeScalable.expression.empty()
+                          && primitive->resizeControl.expression.empty())
                           && primitive->imageData.data;
 }
 
@@ -804,13 +804,13 @@ void SE_StyleVisitor::VisitText(Text& text)
     ParseBooleanExpression(text.GetOverlined(), primitive->overlined, false);
     ParseDoubleExpression(text.GetObliqueAngle(), primitive->obliqueAngle, 0.0);
     ParseDoubleExpression(text.GetTrackSpacing(), primitive->trackSpacing, 1.0);
-    ParseStringExpression(text.GetHorizontalAlignment(), primitive->hAlignment, Text::sHAlignmentDefault, Text::sHAlignmentValues);
-    ParseStringExpression(text.GetVerticalAlignment(), primitive->vAlignment, Text::sVAlignmentDefault, Text::sVAlignmentValues);
-    ParseStringExpression(text.GetJustification(), primitive->justification, Text::sJustificationDefault, Text::sJustificationValues);
+    ParseEnumExpression(text.GetHorizontalAlignment(), primitive->hAlignment, Text::sHAlignmentDefault, Text::sHAlignmentValues);
+    ParseEnumExpression(text.GetVerticalAlignment(), primitive->vAlignment, Text::sVAlignmentDefault, Text::sVAlignmentValues);
+    ParseEnumExpression(text.GetJustification(), primitive->justification, Text::sJustificationDefault, Text::sJustificationValues);
     ParseColorExpression(text.GetTextColor(), primitive->textColor, 0xff000000);
     ParseColorExpression(text.GetGhostColor(), primitive->ghostColor, 0);
     ParseStringExpression(text.GetMarkup(), primitive->markup, Text::sMarkupDefault);
-    ParseStringExpression(text.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
+    ParseEnumExpression(text.GetResizeControl(), primitive->resizeControl, GraphicElement::sResizeControlDefault, GraphicElement::sResizeControlValues);
 
     TextFrame* frame = text.GetFrame();
     if (frame)
@@ -821,31 +821,33 @@ void SE_StyleVisitor::VisitText(Text& text)
         ParseDoubleExpression(frame->GetOffsetY(), primitive->frameOffset[1], 0.0);
     }
 
-    primitive->cacheable =  (!primitive->content.expression.empty()
-                          && !primitive->fontName.expression.empty()
-                          && !primitive->height.expression.empty()
-                          && !primitive->angleDeg.expression.empty()
-                          && !primitive->position[0].expression.empty()
-                          && !primitive->position[1].expression.empty()
-                          && !primitive->lineSpacing.expression.empty()
-                          && !primitive->heightScalable.expression.empty()
-                          && !primitive->bold.expression.empty()
-                          && !primitive->italic.expression.empty()
-                          && !primitive->underlined.expression.empty()
-                          && !primitive->overlined.expression.empty()
-                          && !primitive->obliqueAngle.expression.empty()
-                          && !primitive->trackSpacing.expression.empty()
-                          && !primitive->hAlignment.expression.empty()
-                          && !primitive->vAlignment.expression.empty()
-                          && !primitive->justification.expression.empty()
-                          && !primitive->textColor.expression.empty()
-                          && !primitive->ghostColor.expression.empty()
-                          && !primitive->frameLineColor.expression.empty()
-                          && !primitive->frameFillColor.expression.empty()
-                          && !primitive->frameOffset[0].expression.empty()
-                          && !primitive->frameOffset[1].expression.empty()
-                          && !primitive->markup.expression.empty()
-                          && !primitive->resizeControl.expression.empty());
+    primitive->cacheable =  (primitive->content.expression.empty()
+                          && primitive->fontName.expression.empty()
+                          && primitive->height.expression.empty()
+                          && primitive->angleDeg.expression.empty()
+                          && primitive->position[0].expression.empty()
+                          && primitive->position[1].expression.empty()
+                          && primitive->lineSpacing.expression.empty()
+                          && primitive->heightScalable.expression.empty()
+                          && primitive->bold.expression.empty()
+                          && primitive->italic.expression.empty()
+                          && primitive->underlined.expression.empty()
+                          && primitive->overlined.expression.empty()
+                          && primitive->obliqueAngle.expression.empty()
+                          && primitive->trackSpacing.expression.empty()
+                          && primitive->hAlignment.expression.empty()
+                          && primitive->vAlignment.expression.empty()
+                          && primitive->justification.expression.empty()
+                          && primitive->textColor.expression.empty()
+                          && primitive->ghostColor.expression.empty()
+                          && primitive->frameLineColor.expression.empty()
+                          && primitive->frameFillColor.expression.empty()
+                          && primitive->frameOffset[0].expression.empty()
+                          && primitive->frameOffset[1].expression.empty()
+                          && primitive->markup.expression.empty()
+                          && primitive->resizeControl.expression.empty());
+
+    primitive->foldTextDef();
 }
 
 
@@ -923,18 +925,18 @@ void SE_StyleVisitor::VisitSimpleSymbolDefinition(MdfModel::SimpleSymbolDefiniti
         ParseDoubleExpression(box->GetSizeY(), m_style->resizeSize[1], 1.0);
         ParseDoubleExpression(box->GetPositionX(), m_style->resizePosition[0], 0.0);
         ParseDoubleExpression(box->GetPositionY(), m_style->resizePosition[1], 0.0);
-        ParseStringExpression(box->GetGrowControl(), m_style->growControl, ResizeBox::sGrowControlDefault, ResizeBox::sGrowControlValues);
+        ParseEnumExpression(box->GetGrowControl(), m_style->growControl, ResizeBox::sGrowControlDefault, ResizeBox::sGrowControlValues);
 
-        m_style->cacheable &=  (!m_style->resizeSize[0].expression.empty()
-                             && !m_style->resizeSize[1].expression.empty()
-                             && !m_style->resizePosition[0].expression.empty()
-                             && !m_style->resizePosition[1].expression.empty()
-                             && !m_style->growControl.expression.empty());
+        m_style->cacheable &=  (m_style->resizeSize[0].expression.empty()
+                             && m_style->resizeSize[1].expression.empty()
+                             && m_style->resizePosition[0].expression.empty()
+                             && m_style->resizePosition[1].expression.empty()
+                             && m_style->growControl.expression.empty());
     }
 
     // the symbol instance scales also affect the evaluated style
-    m_style->cacheable &=  (!m_symbolInstance->scale[0].expression.empty()
-                         && !m_symbolInstance->scale[1].expression.empty());
+    m_style->cacheable &=  (m_symbolInstance->scale[0].expression.empty()
+                         && m_symbolInstance->scale[1].expression.empty());
 
     m_symbolInstance->styles.push_back(m_style);
 }
@@ -1023,7 +1025,7 @@ void SE_StyleVisitor::Convert(std::vector<SE_SymbolInstance*>& result, MdfModel:
 
         m_usageContext = instance->GetUsageContext();
 
-        ParseStringExpression(instance->GetPositioningAlgorithm(), m_symbolInstance->positioningAlgorithm, SymbolInstance::sPositioningAlgorithmDefault, SymbolInstance::sPositioningAlgorithmValues);
+        ParseEnumExpression(instance->GetPositioningAlgorithm(), m_symbolInstance->positioningAlgorithm, SymbolInstance::sPositioningAlgorithmDefault, SymbolInstance::sPositioningAlgorithmValues);
 
         ParseBooleanExpression(instance->GetDrawLast(), m_symbolInstance->drawLast, false);
         ParseBooleanExpression(instance->GetAddToExclusionRegion(), m_symbolInstance->addToExclusionRegion, false);
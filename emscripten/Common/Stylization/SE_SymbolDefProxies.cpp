@@ -21,6 +21,10 @@
 #include "SE_Bounds.h"
 #include "SE_SymbolManager.h"
 #include "RS_FontEngine.h"
+#include <atomic>
+
+// the last id given to a constant render style
+static std::atomic<unsigned int> s_lastCacheId(0);
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -62,13 +66,218 @@ static double GetHalfWeightMargin(const SE_LineStroke& lineStroke)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+SE_ResizeControlType ResizeControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"AddToResizeBox") == 0)
+        return SE_ResizeControl_AddToResizeBox;
+    if (wcscmp(str, L"AdjustToResizeBox") == 0)
+        return SE_ResizeControl_AdjustToResizeBox;
+
+    // default is ResizeNone
+    return SE_ResizeControl_ResizeNone;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_LineCap LineCapFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"Round") == 0)     // check this first since it's the most common
+        return SE_LineCap_Round;
+    if (wcscmp(str, L"None") == 0)
+        return SE_LineCap_None;
+    if (wcscmp(str, L"Square") == 0)
+        return SE_LineCap_Square;
+    if (wcscmp(str, L"Triangle") == 0)
+        return SE_LineCap_Triangle;
+
+    // default is Round
+    return SE_LineCap_Round;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_LineJoin LineJoinFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"Round") == 0)     // check this first since it's the most common
+        return SE_LineJoin_Round;
+    if (wcscmp(str, L"None") == 0)
+        return SE_LineJoin_None;
+    if (wcscmp(str, L"Bevel") == 0)
+        return SE_LineJoin_Bevel;
+    if (wcscmp(str, L"Miter") == 0)
+        return SE_LineJoin_Miter;
+
+    // default is Round
+    return SE_LineJoin_Round;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+RS_HAlignment HAlignmentFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"Center") == 0)    // check this first since it's the most common
+        return RS_HAlignment_Center;
+    if (wcscmp(str, L"Left") == 0)
+        return RS_HAlignment_Left;
+    if (wcscmp(str, L"Right") == 0)
+        return RS_HAlignment_Right;
+
+    // default is Center
+    return RS_HAlignment_Center;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+RS_VAlignment VAlignmentFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"Halfline") == 0)  // check this first since it's the most common
+        return RS_VAlignment_Half;
+    if (wcscmp(str, L"Bottom") == 0)
+        return RS_VAlignment_Descent;
+    if (wcscmp(str, L"Baseline") == 0)
+        return RS_VAlignment_Base;
+    if (wcscmp(str, L"Capline") == 0)
+        return RS_VAlignment_Cap;
+    if (wcscmp(str, L"Top") == 0)
+        return RS_VAlignment_Ascent;
+
+    // default is Halfline
+    return RS_VAlignment_Half;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_JustificationType JustificationFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"FromAlignment") == 0) // check this first since it's the most common
+        return SE_Justification_FromAlignment;
+    if (wcscmp(str, L"Right") == 0)
+        return SE_Justification_Right;
+    if (wcscmp(str, L"Center") == 0)
+        return SE_Justification_Center;
+    if (wcscmp(str, L"Justified") == 0)
+        return SE_Justification_Justified;
+
+    // anything else leaves the text left justified
+    return SE_Justification_Left;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_GrowControlType GrowControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"GrowInX") == 0)
+        return SE_GrowControl_GrowInX;
+    if (wcscmp(str, L"GrowInY") == 0)
+        return SE_GrowControl_GrowInY;
+    if (wcscmp(str, L"GrowInXY") == 0)
+        return SE_GrowControl_GrowInXY;
+
+    // default is GrowInXYMaintainAspect
+    return SE_GrowControl_GrowInXYMaintainAspect;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// used by point and area usages
+SE_AngleControlType AngleControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"FromGeometry") == 0)
+        return SE_AngleControl_FromGeometry;
+
+    // default is FromAngle
+    return SE_AngleControl_FromAngle;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_AngleControlType LineAngleControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"FromAngle") == 0)
+        return SE_AngleControl_FromAngle;
+
+    // default is FromGeometry
+    return SE_AngleControl_FromGeometry;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_UnitsControlType UnitsControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"Parametric") == 0)
+        return SE_UnitsControl_Parametric;
+
+    // default is Absolute
+    return SE_UnitsControl_Absolute;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_VertexControlType VertexControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"OverlapNone") == 0)
+        return SE_VertexControl_OverlapNone;
+    if (wcscmp(str, L"OverlapDirect") == 0)
+        return SE_VertexControl_OverlapDirect;
+    if (wcscmp(str, L"OverlapNoWrap") == 0)
+        return SE_VertexControl_OverlapNone;    // this deprecated option is treated as OverlapNone
+
+    // default is OverlapWrap
+    return SE_VertexControl_OverlapWrap;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_OriginControlType OriginControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"Centroid") == 0)
+        return SE_OriginControl_Centroid;
+    if (wcscmp(str, L"Local") == 0)
+        return SE_OriginControl_Local;
+
+    // default is Global
+    return SE_OriginControl_Global;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_ClippingControlType ClippingControlFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"Inside") == 0)
+        return SE_ClippingControl_Inside;
+    if (wcscmp(str, L"Overlap") == 0)
+        return SE_ClippingControl_Overlap;
+
+    // default is Clip
+    return SE_ClippingControl_Clip;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_PositioningAlgorithmType PositioningAlgorithmFromString(const wchar_t* str)
+{
+    if (wcscmp(str, L"EightSurrounding") == 0)
+        return SE_PositioningAlgorithm_EightSurrounding;
+    if (wcscmp(str, L"PathLabels") == 0)
+        return SE_PositioningAlgorithm_PathLabels;
+    if (wcscmp(str, L"MultipleHighwayShields") == 0)
+        return SE_PositioningAlgorithm_MultipleHighwayShields;
+    if (wcscmp(str, L"Default") == 0)
+        return SE_PositioningAlgorithm_Default;
+
+    // an empty or unknown algorithm means the style is applied directly
+    return SE_PositioningAlgorithm_None;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 SE_Style::~SE_Style()
 {
     for (SE_PrimitiveList::iterator iter = symbol.begin(); iter != symbol.end(); ++iter)
         delete *iter;
 
-    delete rstyle;
+    reset();
 }
 
 
@@ -96,15 +305,9 @@ SE_RenderPrimitive* SE_Polyline::evaluate(SE_EvalContext* ctx)
     if (geometry->Empty())
         return NULL;
 
-    SE_RenderPolyline* ret = new SE_RenderPolyline();
+    SE_RenderPolyline* ret = SE_RenderArena::New<SE_RenderPolyline>(ctx->arena);
 
-    const wchar_t* sResizeCtrl = resizeControl.evaluate(ctx->eval);
-    if (wcscmp(sResizeCtrl, L"AddToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AddToResizeBox;
-    else if (wcscmp(sResizeCtrl, L"AdjustToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AdjustToResizeBox;
-    else // default is ResizeNone
-        ret->resizeControl = SE_ResizeControl_ResizeNone;
+    ret->resizeControl = resizeControl.evaluateEnum(ctx->eval);
 
     ret->geometry = geometry->Clone();
 
@@ -122,32 +325,10 @@ SE_RenderPrimitive* SE_Polyline::evaluate(SE_EvalContext* ctx)
     else if (devWeightInMM < 0.0)
         ret->lineStroke.weight = 0.0;
 
-    const wchar_t* sCap = cap.evaluate(ctx->eval);
-    if (wcscmp(sCap, L"Round") == 0)    // check this first since it's the most common
-        ret->lineStroke.cap = SE_LineCap_Round;
-    else if (wcscmp(sCap, L"None") == 0)
-        ret->lineStroke.cap = SE_LineCap_None;
-    else if (wcscmp(sCap, L"Square") == 0)
-        ret->lineStroke.cap = SE_LineCap_Square;
-    else if (wcscmp(sCap, L"Triangle") == 0)
-        ret->lineStroke.cap = SE_LineCap_Triangle;
-    else // default is Round
-        ret->lineStroke.cap = SE_LineCap_Round;
-
-    const wchar_t* sJoin = join.evaluate(ctx->eval);
-    if (wcscmp(sJoin, L"Round") == 0)   // check this first since it's the most common
-        ret->lineStroke.join = SE_LineJoin_Round;
-    else if (wcscmp(sJoin, L"None") == 0)
-        ret->lineStroke.join = SE_LineJoin_None;
-    else if (wcscmp(sJoin, L"Bevel") == 0)
-    {
-        ret->lineStroke.join = SE_LineJoin_Bevel;
+    ret->lineStroke.cap  = cap.evaluateEnum(ctx->eval);
+    ret->lineStroke.join = join.evaluateEnum(ctx->eval);
+    if (ret->lineStroke.join == SE_LineJoin_Bevel)
         ret->lineStroke.miterLimit = 0.0;
-    }
-    else if (wcscmp(sJoin, L"Miter") == 0)
-        ret->lineStroke.join = SE_LineJoin_Miter;
-    else // default is Round
-        ret->lineStroke.join = SE_LineJoin_Round;
 
     double dScaleX = scaleX.evaluate(ctx->eval);
     double dScaleY = scaleY.evaluate(ctx->eval);
@@ -197,7 +378,7 @@ SE_RenderPrimitive* SE_Polyline::evaluate(SE_EvalContext* ctx)
     if (seb == NULL)
     {
         // we failed for some reason - return NULL
-        delete ret;
+        SE_RenderArena::Delete(ctx->arena, ret);
         return NULL;
     }
 
@@ -224,15 +405,9 @@ SE_RenderPrimitive* SE_Polygon::evaluate(SE_EvalContext* ctx)
     if (geometry->Empty())
         return NULL;
 
-    SE_RenderPolygon* ret = new SE_RenderPolygon();
+    SE_RenderPolygon* ret = SE_RenderArena::New<SE_RenderPolygon>(ctx->arena);
 
-    const wchar_t* sResizeCtrl = resizeControl.evaluate(ctx->eval);
-    if (wcscmp(sResizeCtrl, L"AddToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AddToResizeBox;
-    else if (wcscmp(sResizeCtrl, L"AdjustToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AdjustToResizeBox;
-    else // default is ResizeNone
-        ret->resizeControl = SE_ResizeControl_ResizeNone;
+    ret->resizeControl = resizeControl.evaluateEnum(ctx->eval);
 
     ret->geometry = geometry->Clone();
     ret->fill     = fill.evaluate(ctx->eval);
@@ -251,32 +426,10 @@ SE_RenderPrimitive* SE_Polygon::evaluate(SE_EvalContext* ctx)
     else if (devWeightInMM < 0.0)
         ret->lineStroke.weight = 0.0;
 
-    const wchar_t* sCap = cap.evaluate(ctx->eval);
-    if (wcscmp(sCap, L"Round") == 0)    // check this first since it's the most common
-        ret->lineStroke.cap = SE_LineCap_Round;
-    else if (wcscmp(sCap, L"None") == 0)
-        ret->lineStroke.cap = SE_LineCap_None;
-    else if (wcscmp(sCap, L"Square") == 0)
-        ret->lineStroke.cap = SE_LineCap_Square;
-    else if (wcscmp(sCap, L"Triangle") == 0)
-        ret->lineStroke.cap = SE_LineCap_Triangle;
-    else // default is Round
-        ret->lineStroke.cap = SE_LineCap_Round;
-
-    const wchar_t* sJoin = join.evaluate(ctx->eval);
-    if (wcscmp(sJoin, L"Round") == 0)   // check this first since it's the most common
-        ret->lineStroke.join = SE_LineJoin_Round;
-    else if (wcscmp(sJoin, L"None") == 0)
-        ret->lineStroke.join = SE_LineJoin_None;
-    else if (wcscmp(sJoin, L"Bevel") == 0)
-    {
-        ret->lineStroke.join = SE_LineJoin_Bevel;
+    ret->lineStroke.cap  = cap.evaluateEnum(ctx->eval);
+    ret->lineStroke.join = join.evaluateEnum(ctx->eval);
+    if (ret->lineStroke.join == SE_LineJoin_Bevel)
         ret->lineStroke.miterLimit = 0.0;
-    }
-    else if (wcscmp(sJoin, L"Miter") == 0)
-        ret->lineStroke.join = SE_LineJoin_Miter;
-    else // default is Round
-        ret->lineStroke.join = SE_LineJoin_Round;
 
     // populate the line buffer
     double dScaleX = scaleX.evaluate(ctx->eval);
@@ -300,7 +453,7 @@ SE_RenderPrimitive* SE_Polygon::evaluate(SE_EvalContext* ctx)
     if (seb == NULL)
     {
         // we failed for some reason - return NULL
-        delete ret;
+        SE_RenderArena::Delete(ctx->arena, ret);
         return NULL;
     }
 
@@ -321,126 +474,147 @@ SE_RenderPrimitive* SE_Polygon::evaluate(SE_EvalContext* ctx)
 
 
 ///////////////////////////////////////////////////////////////////////////////
-SE_RenderPrimitive* SE_Text::evaluate(SE_EvalContext* ctx)
+// Evaluates the text definition properties which don't depend on the symbol
+// transform.  The height and frame offsets are set separately by evaluate.
+void SE_Text::evaluateTextDef(SE_Evaluator* eval, RS_TextDef& textDef)
 {
-    if (ctx->fonte == NULL)
-        return NULL;
-
-    // don't bother creating a primitive if there's no content
-    const wchar_t* contentStr = content.evaluate(ctx->eval);
-    if (wcslen(contentStr) == 0)
-        return NULL;
-
-    SE_RenderText* ret = new SE_RenderText();
-
-    const wchar_t* sResizeCtrl = resizeControl.evaluate(ctx->eval);
-    if (wcscmp(sResizeCtrl, L"AddToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AddToResizeBox;
-    else if (wcscmp(sResizeCtrl, L"AdjustToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AdjustToResizeBox;
-    else // default is ResizeNone
-        ret->resizeControl = SE_ResizeControl_ResizeNone;
-    if(!content.expression.empty())
-        ret->expression  = content.expression;
-    ret->content     = contentStr;
-    ret->position[0] = position[0].evaluate(ctx->eval);
-    ret->position[1] = position[1].evaluate(ctx->eval);
-
-    ctx->xform->transform(ret->position[0], ret->position[1]);
-
-    RS_TextDef& textDef = ret->tdef;
     RS_FontDef& fontDef = textDef.font();
 
-    textDef.rotation() = fmod(angleDeg.evaluate(ctx->eval), 360.0);   // in degrees
+    textDef.rotation() = fmod(angleDeg.evaluate(eval), 360.0);   // in degrees
 
     int style = RS_FontStyle_Regular;
-    if (bold.evaluate(ctx->eval))
+    if (bold.evaluate(eval))
         style |= RS_FontStyle_Bold;
-    if (italic.evaluate(ctx->eval))
+    if (italic.evaluate(eval))
         style |= RS_FontStyle_Italic;
-    if (underlined.evaluate(ctx->eval))
+    if (underlined.evaluate(eval))
         style |= RS_FontStyle_Underline;
-    if (overlined.evaluate(ctx->eval))
+    if (overlined.evaluate(eval))
         style |= RS_FontStyle_Overline;
 
     fontDef.style() = (RS_FontStyle_Mask)style;
-    fontDef.name()  = fontName.evaluate(ctx->eval);
+    fontDef.name()  = fontName.evaluate(eval);
 
-    // RS_TextDef expects font height to be in meters - convert it from mm
-    double wy              = heightScalable.evaluate(ctx->eval)? 0.001 * fabs(ctx->xform->y1) / ctx->mm2sud : 0.001;
-    fontDef.height()       = height.evaluate(ctx->eval) * wy;
-    textDef.obliqueAngle() = obliqueAngle.evaluate(ctx->eval);
-    textDef.trackSpacing() = trackSpacing.evaluate(ctx->eval);
-    textDef.linespace()    = lineSpacing.evaluate(ctx->eval);
-    textDef.textcolor()    = RS_Color::FromARGB(textColor.evaluate(ctx->eval));
-    textDef.markup()       = markup.evaluate(ctx->eval);
+    textDef.obliqueAngle() = obliqueAngle.evaluate(eval);
+    textDef.trackSpacing() = trackSpacing.evaluate(eval);
+    textDef.linespace()    = lineSpacing.evaluate(eval);
+    textDef.textcolor()    = RS_Color::FromARGB(textColor.evaluate(eval));
+    textDef.markup()       = markup.evaluate(eval);
 
     if (!ghostColor.empty())
     {
-        textDef.ghostcolor() = RS_Color::FromARGB(ghostColor.evaluate(ctx->eval));
+        textDef.ghostcolor() = RS_Color::FromARGB(ghostColor.evaluate(eval));
         textDef.textbg() |= RS_TextBackground_Ghosted;
     }
     if (!frameLineColor.empty())
     {
-        textDef.framecolor() = RS_Color::FromARGB(frameLineColor.evaluate(ctx->eval));
+        textDef.framecolor() = RS_Color::FromARGB(frameLineColor.evaluate(eval));
         textDef.textbg() |= RS_TextBackground_Framed;
     }
     if (!frameFillColor.empty())
     {
-        textDef.opaquecolor() = RS_Color::FromARGB(frameFillColor.evaluate(ctx->eval));
+        textDef.opaquecolor() = RS_Color::FromARGB(frameFillColor.evaluate(eval));
         textDef.textbg() |= RS_TextBackground_Opaque;
     }
-    textDef.frameoffsetx() = frameOffset[0].evaluate(ctx->eval) * fabs(ctx->xform->x0);
-    textDef.frameoffsety() = frameOffset[1].evaluate(ctx->eval) * fabs(ctx->xform->y1);
-
-    const wchar_t* hAlign = hAlignment.evaluate(ctx->eval);
-    if (wcscmp(hAlign, L"Center") == 0)     // check this first since it's the most common
-        textDef.halign() = RS_HAlignment_Center;
-    else if (wcscmp(hAlign, L"Left") == 0)
-        textDef.halign() = RS_HAlignment_Left;
-    else if (wcscmp(hAlign, L"Right") == 0)
-        textDef.halign() = RS_HAlignment_Right;
-    else // default is Center
-        textDef.halign() = RS_HAlignment_Center;
-
-    const wchar_t* vAlign = vAlignment.evaluate(ctx->eval);
-    if (wcscmp(vAlign, L"Halfline") == 0)   // check this first since it's the most common
-        textDef.valign() = RS_VAlignment_Half;
-    else if (wcscmp(vAlign, L"Bottom") == 0)
-        textDef.valign() = RS_VAlignment_Descent;
-    else if (wcscmp(vAlign, L"Baseline") == 0)
-        textDef.valign() = RS_VAlignment_Base;
-    else if (wcscmp(vAlign, L"Capline") == 0)
-        textDef.valign() = RS_VAlignment_Cap;
-    else if (wcscmp(vAlign, L"Top") == 0)
-        textDef.valign() = RS_VAlignment_Ascent;
-    else // default is Halfline
-        textDef.valign() = RS_VAlignment_Half;
-
-    const wchar_t* justification = this->justification.evaluate(ctx->eval);
-    if (wcscmp(justification, L"FromAlignment") == 0)   // check this first since it's the most common
+
+    textDef.halign() = hAlignment.evaluateEnum(eval);
+    textDef.valign() = vAlignment.evaluateEnum(eval);
+
+    switch (justification.evaluateEnum(eval))
     {
-        switch (textDef.halign())
-        {
-            case RS_HAlignment_Center:
-                textDef.justify() = RS_Justify_Center;
-                break;
-            case RS_HAlignment_Left:
-                textDef.justify() = RS_Justify_Left;
-                break;
-            case RS_HAlignment_Right:
-                textDef.justify() = RS_Justify_Right;
-                break;
-        }
+        case SE_Justification_FromAlignment:
+            switch (textDef.halign())
+            {
+                case RS_HAlignment_Center:
+                    textDef.justify() = RS_Justify_Center;
+                    break;
+                case RS_HAlignment_Left:
+                    textDef.justify() = RS_Justify_Left;
+                    break;
+                case RS_HAlignment_Right:
+                    textDef.justify() = RS_Justify_Right;
+                    break;
+            }
+            break;
+        case SE_Justification_Left:
+            textDef.justify() = RS_Justify_Left;
+            break;
+        case SE_Justification_Right:
+            textDef.justify() = RS_Justify_Right;
+            break;
+        case SE_Justification_Center:
+            textDef.justify() = RS_Justify_Center;
+            break;
+        case SE_Justification_Justified:
+            textDef.justify() = RS_Justify_Justify;
+            break;
     }
-    else if (wcscmp(justification, L"Left") == 0)
-        textDef.justify() = RS_Justify_Left;
-    else if (wcscmp(justification, L"Right") == 0)
-        textDef.justify() = RS_Justify_Right;
-    else if (wcscmp(justification, L"Center") == 0)
-        textDef.justify() = RS_Justify_Center;
-    else if (wcscmp(justification, L"Justified") == 0)
-        textDef.justify() = RS_Justify_Justify;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Folds the text definition into a template if none of the properties used
+// by evaluateTextDef are driven by expressions.
+void SE_Text::foldTextDef()
+{
+    tdefConstant = (angleDeg.expression.empty()
+                 && bold.expression.empty()
+                 && italic.expression.empty()
+                 && underlined.expression.empty()
+                 && overlined.expression.empty()
+                 && fontName.expression.empty()
+                 && obliqueAngle.expression.empty()
+                 && trackSpacing.expression.empty()
+                 && lineSpacing.expression.empty()
+                 && textColor.expression.empty()
+                 && markup.expression.empty()
+                 && ghostColor.expression.empty()
+                 && frameLineColor.expression.empty()
+                 && frameFillColor.expression.empty()
+                 && hAlignment.expression.empty()
+                 && vAlignment.expression.empty()
+                 && justification.expression.empty());
+
+    // all the values are constant, so no evaluator is needed
+    tdefTemplate = RS_TextDef();
+    if (tdefConstant)
+        evaluateTextDef(NULL, tdefTemplate);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SE_RenderPrimitive* SE_Text::evaluate(SE_EvalContext* ctx)
+{
+    if (ctx->fonte == NULL)
+        return NULL;
+
+    // don't bother creating a primitive if there's no content
+    const wchar_t* contentStr = content.evaluate(ctx->eval);
+    if (wcslen(contentStr) == 0)
+        return NULL;
+
+    SE_RenderText* ret = SE_RenderArena::New<SE_RenderText>(ctx->arena);
+
+    ret->resizeControl = resizeControl.evaluateEnum(ctx->eval);
+    if(!content.expression.empty())
+        ret->expression  = content.expression;
+    ret->content     = contentStr;
+    ret->position[0] = position[0].evaluate(ctx->eval);
+    ret->position[1] = position[1].evaluate(ctx->eval);
+
+    ctx->xform->transform(ret->position[0], ret->position[1]);
+
+    RS_TextDef& textDef = ret->tdef;
+    if (tdefConstant)
+        textDef = tdefTemplate;
+    else
+        evaluateTextDef(ctx->eval, textDef);
+
+    // RS_TextDef expects font height to be in meters - convert it from mm
+    double wy               = heightScalable.evaluate(ctx->eval)? 0.001 * fabs(ctx->xform->y1) / ctx->mm2sud : 0.001;
+    textDef.font().height() = height.evaluate(ctx->eval) * wy;
+    textDef.frameoffsetx()  = frameOffset[0].evaluate(ctx->eval) * fabs(ctx->xform->x0);
+    textDef.frameoffsety()  = frameOffset[1].evaluate(ctx->eval) * fabs(ctx->xform->y1);
 
     RS_TextMetrics& tm = ret->tm;
     if (!ctx->fonte->GetTextMetrics(ret->content, textDef, tm, false))  // mark this RS_TextMetrics as invalid
@@ -512,15 +686,9 @@ SE_RenderPrimitive* SE_Text::evaluate(SE_EvalContext* ctx)
 ///////////////////////////////////////////////////////////////////////////////
 SE_RenderPrimitive* SE_Raster::evaluate(SE_EvalContext* ctx)
 {
-    SE_RenderRaster* ret = new SE_RenderRaster();
+    SE_RenderRaster* ret = SE_RenderArena::New<SE_RenderRaster>(ctx->arena);
 
-    const wchar_t* sResizeCtrl = resizeControl.evaluate(ctx->eval);
-    if (wcscmp(sResizeCtrl, L"AddToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AddToResizeBox;
-    else if (wcscmp(sResizeCtrl, L"AdjustToResizeBox") == 0)
-        ret->resizeControl = SE_ResizeControl_AdjustToResizeBox;
-    else // default is ResizeNone
-        ret->resizeControl = SE_ResizeControl_ResizeNone;
+    ret->resizeControl = resizeControl.evaluateEnum(ctx->eval);
 
     if (!imageData.data)
     {
@@ -578,7 +746,8 @@ SE_RenderPrimitive* SE_Raster::evaluate(SE_EvalContext* ctx)
 ///////////////////////////////////////////////////////////////////////////////
 void SE_Style::reset()
 {
-    delete rstyle;
+    if (rstyle)
+        SE_RenderArena::Delete(rstyle->arena, rstyle);
     rstyle = NULL;
 }
 
@@ -589,6 +758,12 @@ void SE_Style::evaluate(SE_EvalContext* ctx)
     // evaluate values that are common to all styles
     rstyle->renderPass = renderPass.evaluate(ctx->eval);
 
+    // constant styles are only evaluated again once they're reset - zero
+    // is skipped when the ids wrap around
+    rstyle->cacheId = 0;
+    while (cacheable && rstyle->cacheId == 0)
+        rstyle->cacheId = ++s_lastCacheId;
+
     //
     // evaluation of all primitives and also resize box stuff
     //
@@ -616,6 +791,10 @@ void SE_Style::evaluate(SE_EvalContext* ctx)
         maxy0 = maxy1 = rs_max(ptAy, ptBy);
     }
 
+    // the primitives are allocated from the same place as their style
+    SE_RenderArena* ctxArena = ctx->arena;
+    ctx->arena = rstyle->arena;
+
     for (SE_PrimitiveList::const_iterator src = symbol.begin(); src != symbol.end(); ++src)
     {
         SE_Primitive* sym = *src;
@@ -645,6 +824,8 @@ void SE_Style::evaluate(SE_EvalContext* ctx)
         }
     }
 
+    ctx->arena = ctxArena;
+
     // update all primitives which need to adjust to the resize box
     if (useBox)
     {
@@ -656,8 +837,8 @@ void SE_Style::evaluate(SE_EvalContext* ctx)
         double transy0 = 0.0;
         double transx1 = 0.0;
         double transy1 = 0.0;
-        const wchar_t* sGrowCtrl = growControl.evaluate(ctx->eval);
-        if (wcscmp(sGrowCtrl, L"GrowInX") == 0)
+        SE_GrowControlType growCtrl = growControl.evaluateEnum(ctx->eval);
+        if (growCtrl == SE_GrowControl_GrowInX)
         {
             if (sx0 != 0.0)
             {
@@ -666,7 +847,7 @@ void SE_Style::evaluate(SE_EvalContext* ctx)
                 transx1 = 0.5*(minx1 + maxx1);
             }
         }
-        else if (wcscmp(sGrowCtrl, L"GrowInY") == 0)
+        else if (growCtrl == SE_GrowControl_GrowInY)
         {
             if (sy0 != 0.0)
             {
@@ -675,7 +856,7 @@ void SE_Style::evaluate(SE_EvalContext* ctx)
                 transy1 = 0.5*(miny1 + maxy1);
             }
         }
-        else if (wcscmp(sGrowCtrl, L"GrowInXY") == 0)
+        else if (growCtrl == SE_GrowControl_GrowInXY)
         {
             if (sx0 != 0.0 && sy0 != 0.0)
             {
@@ -775,15 +956,16 @@ void SE_PointStyle::evaluate(SE_EvalContext* ctx)
     if (cacheable && rstyle)
         return;
 
-    SE_RenderPointStyle* style = new SE_RenderPointStyle();
-    delete rstyle;
+    reset();
+
+    // styles which can be cached must outlive the feature, so they never
+    // come from the per-feature arena
+    SE_RenderArena* arena = cacheable? NULL : ctx->arena;
+    SE_RenderPointStyle* style = SE_RenderArena::New<SE_RenderPointStyle>(arena);
+    style->arena = arena;
     rstyle = style;
 
-    const wchar_t* sAngleControl = angleControl.evaluate(ctx->eval);
-    if (wcscmp(sAngleControl, L"FromGeometry") == 0)
-        style->angleControl = SE_AngleControl_FromGeometry;
-    else // default is FromAngle
-        style->angleControl = SE_AngleControl_FromAngle;
+    style->angleControl = angleControl.evaluateEnum(ctx->eval);
 
     style->angleRad = fmod(angleDeg.evaluate(ctx->eval), 360.0) * M_PI180;
 
@@ -804,32 +986,18 @@ void SE_LineStyle::evaluate(SE_EvalContext* ctx)
     if (cacheable && rstyle)
         return;
 
-    SE_RenderLineStyle* style = new SE_RenderLineStyle();
-    delete rstyle;
+    reset();
+
+    // styles which can be cached must outlive the feature, so they never
+    // come from the per-feature arena
+    SE_RenderArena* arena = cacheable? NULL : ctx->arena;
+    SE_RenderLineStyle* style = SE_RenderArena::New<SE_RenderLineStyle>(arena);
+    style->arena = arena;
     rstyle = style;
 
-    const wchar_t* sAngleControl = angleControl.evaluate(ctx->eval);
-    if (wcscmp(sAngleControl, L"FromAngle") == 0)
-        style->angleControl = SE_AngleControl_FromAngle;
-    else // default is FromGeometry
-        style->angleControl = SE_AngleControl_FromGeometry;
-
-    const wchar_t* sUnitsControl = unitsControl.evaluate(ctx->eval);
-    if (wcscmp(sUnitsControl, L"Parametric") == 0)
-        style->unitsControl = SE_UnitsControl_Parametric;
-    else // default is Absolute
-        style->unitsControl = SE_UnitsControl_Absolute;
-
-    const wchar_t* sVertexControl = vertexControl.evaluate(ctx->eval);
-    if (wcscmp(sVertexControl, L"OverlapNone") == 0)
-        style->vertexControl = SE_VertexControl_OverlapNone;
-    else if (wcscmp(sVertexControl, L"OverlapDirect") == 0)
-        style->vertexControl = SE_VertexControl_OverlapDirect;
-    else if (wcscmp(sVertexControl, L"OverlapNoWrap") == 0)
-        // this deprecated option is treated as OverlapNone
-        style->vertexControl = SE_VertexControl_OverlapNone;
-    else // default is OverlapWrap
-        style->vertexControl = SE_VertexControl_OverlapWrap;
+    style->angleControl  = angleControl.evaluateEnum(ctx->eval);
+    style->unitsControl  = unitsControl.evaluateEnum(ctx->eval);
+    style->vertexControl = vertexControl.evaluateEnum(ctx->eval);
 
     style->angleRad = fmod(angleDeg.evaluate(ctx->eval), 360.0) * M_PI180;
 
@@ -870,20 +1038,9 @@ void SE_LineStyle::evaluate(SE_EvalContext* ctx)
     if (style->vertexMiterLimit < 0.0)
         style->vertexMiterLimit = 0.0;
 
-    const wchar_t* sJoin = vertexJoin.evaluate(ctx->eval);
-    if (wcscmp(sJoin, L"Round") == 0)       // check this first since it's the most common
-        style->vertexJoin = SE_LineJoin_Round;
-    else if (wcscmp(sJoin, L"None") == 0)
-        style->vertexJoin = SE_LineJoin_None;
-    else if (wcscmp(sJoin, L"Bevel") == 0)
-    {
-        style->vertexJoin = SE_LineJoin_Bevel;
+    style->vertexJoin = vertexJoin.evaluateEnum(ctx->eval);
+    if (style->vertexJoin == SE_LineJoin_Bevel)
         style->vertexMiterLimit = 0.0;
-    }
-    else if (wcscmp(sJoin, L"Miter") == 0)
-        style->vertexJoin = SE_LineJoin_Miter;
-    else // default is Round
-        style->vertexJoin = SE_LineJoin_Round;
 
     double wx                      = dpWeightScalable.evaluate(ctx->eval)? fabs(ctx->xform->x0) : ctx->mm2su;
     style->dpLineStroke.weight     = dpWeight.evaluate(ctx->eval) * wx;
@@ -899,32 +1056,10 @@ void SE_LineStyle::evaluate(SE_EvalContext* ctx)
     else if (devWeightInMM < 0.0)
         style->dpLineStroke.weight = 0.0;
 
-    const wchar_t* sdpCap = dpCap.evaluate(ctx->eval);
-    if (wcscmp(sdpCap, L"Round") == 0)      // check this first since it's the most common
-        style->dpLineStroke.cap = SE_LineCap_Round;
-    else if (wcscmp(sdpCap, L"None") == 0)
-        style->dpLineStroke.cap = SE_LineCap_None;
-    else if (wcscmp(sdpCap, L"Square") == 0)
-        style->dpLineStroke.cap = SE_LineCap_Square;
-    else if (wcscmp(sdpCap, L"Triangle") == 0)
-        style->dpLineStroke.cap = SE_LineCap_Triangle;
-    else // default is Round
-        style->dpLineStroke.cap = SE_LineCap_Round;
-
-    const wchar_t* sdpJoin = dpJoin.evaluate(ctx->eval);
-    if (wcscmp(sdpJoin, L"Round") == 0)     // check this first since it's the most common
-        style->dpLineStroke.join = SE_LineJoin_Round;
-    else if (wcscmp(sdpJoin, L"None") == 0)
-        style->dpLineStroke.join = SE_LineJoin_None;
-    else if (wcscmp(sdpJoin, L"Bevel") == 0)
-    {
-        style->dpLineStroke.join = SE_LineJoin_Bevel;
+    style->dpLineStroke.cap  = dpCap.evaluateEnum(ctx->eval);
+    style->dpLineStroke.join = dpJoin.evaluateEnum(ctx->eval);
+    if (style->dpLineStroke.join == SE_LineJoin_Bevel)
         style->dpLineStroke.miterLimit = 0.0;
-    }
-    else if (wcscmp(sdpJoin, L"Miter") == 0)
-        style->dpLineStroke.join = SE_LineJoin_Miter;
-    else // default is Round
-        style->dpLineStroke.join = SE_LineJoin_Round;
 
     // evaluate all the primitives too
     SE_Style::evaluate(ctx);
@@ -970,31 +1105,19 @@ void SE_AreaStyle::evaluate(SE_EvalContext* ctx)
     if (cacheable && rstyle)
         return;
 
-    SE_RenderAreaStyle* style = new SE_RenderAreaStyle();
-    delete rstyle;
+    reset();
+
+    // styles which can be cached must outlive the feature, so they never
+    // come from the per-feature arena
+    SE_RenderArena* arena = cacheable? NULL : ctx->arena;
+    SE_RenderAreaStyle* style = SE_RenderArena::New<SE_RenderAreaStyle>(arena);
+    style->arena = arena;
     rstyle = style;
 
-    const wchar_t* sAngleControl = angleControl.evaluate(ctx->eval);
-    if (wcscmp(sAngleControl, L"FromGeometry") == 0)
-        style->angleControl = SE_AngleControl_FromGeometry;
-    else // default is FromAngle
-        style->angleControl = SE_AngleControl_FromAngle;
-
-    const wchar_t* sOriginControl = originControl.evaluate(ctx->eval);
-    if (wcscmp(sOriginControl, L"Centroid") == 0)
-        style->originControl = SE_OriginControl_Centroid;
-    else if (wcscmp(sOriginControl, L"Local") == 0)
-        style->originControl = SE_OriginControl_Local;
-    else // default is Global
-        style->originControl = SE_OriginControl_Global;
-
-    const wchar_t* sClippingControl = clippingControl.evaluate(ctx->eval);
-    if (wcscmp(sClippingControl, L"Inside") == 0)
-        style->clippingControl = SE_ClippingControl_Inside;
-    else if (wcscmp(sClippingControl, L"Overlap") == 0)
-        style->clippingControl = SE_ClippingControl_Overlap;
-    else // default is Clip
-        style->clippingControl = SE_ClippingControl_Clip;
+    style->angleControl = angleControl.evaluateEnum(ctx->eval);
+
+    style->originControl   = originControl.evaluateEnum(ctx->eval);
+    style->clippingControl = clippingControl.evaluateEnum(ctx->eval);
 
     style->angleRad = fmod(angleDeg.evaluate(ctx->eval), 360.0) * M_PI180;
 
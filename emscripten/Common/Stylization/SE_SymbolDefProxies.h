@@ -22,13 +22,78 @@
 #include "SE_BufferPool.h"
 #include "SE_ExpressionBase.h"
 #include "SE_SymbolManager.h"
+#include "SE_RenderProxies.h"
 
 using namespace MDFMODEL_NAMESPACE;
 
 class RS_FontEngine;
 class SE_Renderer;
-struct SE_RenderPrimitive;
-struct SE_RenderStyle;
+class SE_PathMeasure;
+
+
+enum SE_JustificationType
+{
+    SE_Justification_FromAlignment,
+    SE_Justification_Left,
+    SE_Justification_Center,
+    SE_Justification_Right,
+    SE_Justification_Justified
+};
+
+
+enum SE_GrowControlType
+{
+    SE_GrowControl_GrowInX,
+    SE_GrowControl_GrowInY,
+    SE_GrowControl_GrowInXY,
+    SE_GrowControl_GrowInXYMaintainAspect
+};
+
+
+enum SE_PositioningAlgorithmType
+{
+    SE_PositioningAlgorithm_None,
+    SE_PositioningAlgorithm_Default,
+    SE_PositioningAlgorithm_EightSurrounding,
+    SE_PositioningAlgorithm_PathLabels,
+    SE_PositioningAlgorithm_MultipleHighwayShields
+};
+
+
+//----------------------------------------------------------------------------
+// Conversion of enumerated string properties.  Unrecognized strings map to
+// the default value for the property.
+//----------------------------------------------------------------------------
+
+SE_ResizeControlType ResizeControlFromString(const wchar_t* str);
+SE_LineCap LineCapFromString(const wchar_t* str);
+SE_LineJoin LineJoinFromString(const wchar_t* str);
+RS_HAlignment HAlignmentFromString(const wchar_t* str);
+RS_VAlignment VAlignmentFromString(const wchar_t* str);
+SE_JustificationType JustificationFromString(const wchar_t* str);
+SE_GrowControlType GrowControlFromString(const wchar_t* str);
+SE_AngleControlType AngleControlFromString(const wchar_t* str);
+SE_AngleControlType LineAngleControlFromString(const wchar_t* str);
+SE_UnitsControlType UnitsControlFromString(const wchar_t* str);
+SE_VertexControlType VertexControlFromString(const wchar_t* str);
+SE_OriginControlType OriginControlFromString(const wchar_t* str);
+SE_ClippingControlType ClippingControlFromString(const wchar_t* str);
+SE_PositioningAlgorithmType PositioningAlgorithmFromString(const wchar_t* str);
+
+typedef SE_Enum<SE_ResizeControlType, ResizeControlFromString> SE_ResizeControlEnum;
+typedef SE_Enum<SE_LineCap, LineCapFromString> SE_LineCapEnum;
+typedef SE_Enum<SE_LineJoin, LineJoinFromString> SE_LineJoinEnum;
+typedef SE_Enum<RS_HAlignment, HAlignmentFromString> SE_HAlignmentEnum;
+typedef SE_Enum<RS_VAlignment, VAlignmentFromString> SE_VAlignmentEnum;
+typedef SE_Enum<SE_JustificationType, JustificationFromString> SE_JustificationEnum;
+typedef SE_Enum<SE_GrowControlType, GrowControlFromString> SE_GrowControlEnum;
+typedef SE_Enum<SE_AngleControlType, AngleControlFromString> SE_AngleControlEnum;
+typedef SE_Enum<SE_AngleControlType, LineAngleControlFromString> SE_LineAngleControlEnum;
+typedef SE_Enum<SE_UnitsControlType, UnitsControlFromString> SE_UnitsControlEnum;
+typedef SE_Enum<SE_VertexControlType, VertexControlFromString> SE_VertexControlEnum;
+typedef SE_Enum<SE_OriginControlType, OriginControlFromString> SE_OriginControlEnum;
+typedef SE_Enum<SE_ClippingControlType, ClippingControlFromString> SE_ClippingControlEnum;
+typedef SE_Enum<SE_PositioningAlgorithmType, PositioningAlgorithmFromString> SE_PositioningAlgorithmEnum;
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -44,6 +109,7 @@ public:
     double mm2suw;      // number of screen units per mm world
     double px2su;       // number of screen units per pixel
     SE_BufferPool* pool;
+    SE_RenderArena* arena;  // per-feature storage for render styles, or NULL
 };
 
 
@@ -52,6 +118,7 @@ class SE_ApplyContext
 {
 public:
     LineBuffer* geometry;
+    SE_PathMeasure* pathMeasure;    // shared measure of the geometry, or NULL
     SE_Renderer* renderer;
     SE_Matrix* xform;
     MdfModel::SizeContext sizeContext;
@@ -64,7 +131,7 @@ public:
 
 struct SE_Primitive
 {
-    SE_String resizeControl;
+    SE_ResizeControlEnum resizeControl;
     bool cacheable;
 
     virtual ~SE_Primitive()
@@ -83,8 +150,8 @@ struct SE_Polyline : public SE_Primitive
     SE_Double weight;
     SE_Color color;
     SE_Boolean weightScalable;
-    SE_String join;
-    SE_String cap;
+    SE_LineJoinEnum join;
+    SE_LineCapEnum cap;
     SE_Double miterLimit;
     SE_Double scaleX;
     SE_Double scaleY;
@@ -127,9 +194,9 @@ struct SE_Text : public SE_Primitive
     SE_Double obliqueAngle;
     SE_Double trackSpacing;
     SE_Double lineSpacing;
-    SE_String hAlignment;
-    SE_String vAlignment;
-    SE_String justification;
+    SE_HAlignmentEnum hAlignment;
+    SE_VAlignmentEnum vAlignment;
+    SE_JustificationEnum justification;
     SE_Color textColor;
     SE_Color ghostColor;
     SE_Color frameLineColor;
@@ -137,7 +204,21 @@ struct SE_Text : public SE_Primitive
     SE_Double frameOffset[2];
     SE_String markup;
 
+    // text definition folded at parse time - only valid if tdefConstant
+    // is set, and excludes the properties which depend on the transform
+    RS_TextDef tdefTemplate;
+    bool tdefConstant;
+
+    SE_INLINE SE_Text() : tdefConstant(false)
+    {}
+
+    // must be called again if any of the constant values are changed
+    void foldTextDef();
+
     virtual SE_RenderPrimitive* evaluate(SE_EvalContext*);
+
+private:
+    void evaluateTextDef(SE_Evaluator* eval, RS_TextDef& textDef);
 };
 
 
@@ -182,7 +263,7 @@ struct SE_Style
     bool useBox;
     SE_Double resizePosition[2];
     SE_Double resizeSize[2];
-    SE_String growControl;
+    SE_GrowControlEnum growControl;
 
     SE_INLINE SE_Style() : rstyle(NULL), cacheable(false)
     {}
@@ -196,7 +277,7 @@ struct SE_Style
 //////////////////////////////////////////////////////////////////////////////
 struct SE_PointStyle : public SE_Style
 {
-    SE_String angleControl;
+    SE_AngleControlEnum angleControl;
     SE_Double angleDeg; // degrees CCW
     SE_Double originOffset[2];
 
@@ -210,24 +291,24 @@ struct SE_PointStyle : public SE_Style
 //////////////////////////////////////////////////////////////////////////////
 struct SE_LineStyle : public SE_Style
 {
-    SE_String angleControl;
-    SE_String unitsControl;
-    SE_String vertexControl;
+    SE_LineAngleControlEnum angleControl;
+    SE_UnitsControlEnum unitsControl;
+    SE_VertexControlEnum vertexControl;
 
     SE_Double angleDeg; // degrees CCW
     SE_Double startOffset;
     SE_Double endOffset;
     SE_Double repeat;
     SE_Double vertexAngleLimit; // degrees
-    SE_String vertexJoin;
+    SE_LineJoinEnum vertexJoin;
     SE_Double vertexMiterLimit;
 
     // default path
     SE_Double dpWeight;
     SE_Color dpColor;
     SE_Boolean dpWeightScalable;
-    SE_String dpJoin;
-    SE_String dpCap;
+    SE_LineJoinEnum dpJoin;
+    SE_LineCapEnum dpCap;
     SE_Double dpMiterLimit;
 
     SE_INLINE SE_LineStyle()
@@ -240,9 +321,9 @@ struct SE_LineStyle : public SE_Style
 //////////////////////////////////////////////////////////////////////////////
 struct SE_AreaStyle : public SE_Style
 {
-    SE_String angleControl;
-    SE_String originControl;
-    SE_String clippingControl;
+    SE_AngleControlEnum angleControl;
+    SE_OriginControlEnum originControl;
+    SE_ClippingControlEnum clippingControl;
 
     SE_Double angleDeg; // degrees CCW
     SE_Double origin[2];
@@ -268,7 +349,7 @@ struct SE_SymbolInstance
     SE_Boolean drawLast;
     SE_Boolean checkExclusionRegion;
     SE_Boolean addToExclusionRegion;
-    SE_String positioningAlgorithm;
+    SE_PositioningAlgorithmEnum positioningAlgorithm;
     SE_Integer renderPass;
 
     ~SE_SymbolInstance()
@@ -0,0 +1,1092 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "SE_VectorTileRenderer.h"
+#include "RS_FontEngine.h"
+#include "RS_FeatureReader.h"
+
+
+// the protocol buffer wire types used by the format
+#define VT_WIRE_VARINT   0
+#define VT_WIRE_FIXED64  1
+#define VT_WIRE_LENGTH   2
+#define VT_WIRE_FIXED32  5
+
+// the geometry commands
+#define VT_CMD_MOVETO    1
+#define VT_CMD_LINETO    2
+#define VT_CMD_CLOSEPATH 7
+
+
+//////////////////////////////////////////////////////////////////////////////
+// encoding helpers - these work with both byte vectors and strings
+template <class T> static void WriteVarint(T& buf, unsigned long long v)
+{
+    while (v >= 0x80)
+    {
+        buf.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back((unsigned char)v);
+}
+
+
+template <class T> static void WriteTag(T& buf, unsigned int field, unsigned int wireType)
+{
+    WriteVarint(buf, (field << 3) | wireType);
+}
+
+
+template <class T> static void WriteBytes(T& buf, unsigned int field, const void* data, size_t length)
+{
+    WriteTag(buf, field, VT_WIRE_LENGTH);
+    WriteVarint(buf, length);
+    const unsigned char* bytes = (const unsigned char*)data;
+    buf.insert(buf.end(), bytes, bytes + length);
+}
+
+
+template <class T> static void WriteFixed(T& buf, unsigned long long v, int nbytes)
+{
+    // little-endian, regardless of the platform
+    for (int i=0; i<nbytes; ++i)
+        buf.push_back((unsigned char)(v >> (8*i)));
+}
+
+
+static inline unsigned int ZigZag(int v)
+{
+    return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31);
+}
+
+
+static inline unsigned long long ZigZag64(long long v)
+{
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+
+static inline unsigned int Command(unsigned int id, unsigned int count)
+{
+    return (id & 0x7) | (count << 3);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// converts a wide string to UTF-8 - wchar_t holds UTF-16 on some platforms
+// and UTF-32 on others
+static void ToUtf8(const wchar_t* str, std::string& out)
+{
+    out.clear();
+    if (!str)
+        return;
+
+    for (const wchar_t* p = str; *p; ++p)
+    {
+        unsigned int c = (unsigned int)*p;
+        if (c >= 0xD800 && c < 0xDC00)
+        {
+            unsigned int c2 = (unsigned int)p[1];
+            if (c2 >= 0xDC00 && c2 < 0xE000)
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+                ++p;
+            }
+        }
+
+        if (c < 0x80)
+            out.push_back((char)c);
+        else if (c < 0x800)
+        {
+            out.push_back((char)(0xC0 | (c >> 6)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        }
+        else if (c < 0x10000)
+        {
+            out.push_back((char)(0xE0 | (c >> 12)));
+            out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        }
+        else
+        {
+            out.push_back((char)(0xF0 | (c >> 18)));
+            out.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+            out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_VectorTileRenderer::SE_VectorTileRenderer(int width, int height, RS_FontEngine* fontEngine, int extent)
+: m_fontEngine(fontEngine)
+, m_width(width)
+, m_height(height)
+, m_extent(extent)
+, m_includeAttributes(true)
+, m_mapInfo(NULL)
+, m_layerInfo(NULL)
+, m_fcInfo(NULL)
+, m_mapScale(1.0)
+, m_dpi(96.0)
+, m_metersPerUnit(1.0)
+, m_scale(1.0)
+, m_layerCount(0)
+, m_layer(NULL)
+, m_labelLayer(NULL)
+, m_featureCount(0)
+, m_feature(NULL)
+, m_hasId(false)
+, m_id(0)
+{
+    if (m_fontEngine)
+        m_fontEngine->InitFontEngine(this);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+SE_VectorTileRenderer::~SE_VectorTileRenderer()
+{
+    for (size_t i=0; i<m_layers.size(); ++i)
+        delete m_layers[i];
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::GetTile(std::vector<unsigned char>& tile)
+{
+    tile.clear();
+
+    for (int i=0; i<m_layerCount; ++i)
+    {
+        TileLayer* layer = m_layers[i];
+        if (layer->featureCount == 0)
+            continue;
+
+        m_message.clear();
+        WriteBytes(m_message, 1, layer->name.data(), layer->name.size());
+        m_message.insert(m_message.end(), layer->features.begin(), layer->features.end());
+        m_message.insert(m_message.end(), layer->keys.begin(), layer->keys.end());
+        m_message.insert(m_message.end(), layer->values.begin(), layer->values.end());
+        WriteTag(m_message, 5, VT_WIRE_VARINT);
+        WriteVarint(m_message, m_extent);
+        WriteTag(m_message, 15, VT_WIRE_VARINT);
+        WriteVarint(m_message, 2);
+
+        WriteBytes(tile, 3, &m_message[0], m_message.size());
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::StartMap(RS_MapUIInfo*    mapInfo,
+                                     RS_Bounds&       extents,
+                                     double           mapScale,
+                                     double           dpi,
+                                     double           metersPerUnit,
+                                     CSysTransformer* /*xformToLL*/)
+{
+    m_mapInfo = mapInfo;
+    m_extents = extents;
+    m_mapScale = mapScale;
+    m_dpi = dpi;
+    m_metersPerUnit = metersPerUnit;
+
+    m_scale = (m_extents.width() > 0.0)? (double)m_width / m_extents.width() : 1.0;
+
+    // the layers of the previous tile are cleared as they're reused
+    m_layerCount = 0;
+    m_featureCount = 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::EndMap()
+{
+    m_mapInfo = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::StartLayer(RS_LayerUIInfo* layerInfo, RS_FeatureClassInfo* classInfo)
+{
+    m_layerInfo = layerInfo;
+    m_fcInfo = classInfo;
+
+    m_layerName.clear();
+    if (m_layerInfo)
+        ToUtf8(m_layerInfo->name().c_str(), m_layerName);
+    if (m_layerName.empty())
+        m_layerName = "layer";
+
+    m_layer = GetTileLayer(m_layerName);
+    m_labelLayer = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::EndLayer()
+{
+    EndFeature();
+
+    m_layerInfo = NULL;
+    m_fcInfo = NULL;
+    m_layer = NULL;
+    m_labelLayer = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::StartFeature(RS_FeatureReader* feature,
+                                         bool              /*initialPass*/,
+                                         const RS_String*  /*tooltip*/,
+                                         const RS_String*  /*url*/,
+                                         const RS_String*  /*theme*/,
+                                         double            /*zOffset*/,
+                                         double            /*zExtrusion*/,
+                                         RS_ElevationType  /*zOffsetType*/)
+{
+    EndFeature();
+
+    m_feature = feature;
+    m_hasId = false;
+
+    // the feature id is written if the feature has a single integer
+    // identity property
+    if (m_feature)
+    {
+        int count = 0;
+        const wchar_t* const* idNames = m_feature->GetIdentPropNames(count);
+        if (count == 1 && idNames && !m_feature->IsNull(idNames[0]))
+        {
+            long long id = -1;
+            switch (m_feature->GetPropertyType(idNames[0]))
+            {
+                case FdoDataType_Byte:  id = m_feature->GetByte(idNames[0]);  break;
+                case FdoDataType_Int16: id = m_feature->GetInt16(idNames[0]); break;
+                case FdoDataType_Int32: id = m_feature->GetInt32(idNames[0]); break;
+                case FdoDataType_Int64: id = m_feature->GetInt64(idNames[0]); break;
+            }
+
+            if (id >= 0)
+            {
+                m_hasId = true;
+                m_id = (unsigned long long)id;
+            }
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Writes the geometry collected for the current feature, one feature of the
+// format for each geometry type.
+void SE_VectorTileRenderer::EndFeature()
+{
+    if (m_layer)
+    {
+        if (m_points.count > 0)
+            WriteFeature(m_layer, GeomType_Point, m_points, m_tags);
+        if (!m_lines.commands.empty())
+            WriteFeature(m_layer, GeomType_LineString, m_lines, m_tags);
+        if (!m_polygons.commands.empty())
+            WriteFeature(m_layer, GeomType_Polygon, m_polygons, m_tags);
+    }
+
+    m_points.Clear();
+    m_lines.Clear();
+    m_polygons.Clear();
+    m_featureGeoms.clear();
+    m_feature = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::ProcessPolygon(LineBuffer* lb, RS_FillStyle& /*fill*/)
+{
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+    AddGeometry(lb, &w2s);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::ProcessPolyline(LineBuffer* lb, RS_LineStroke& /*lsym*/)
+{
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+    AddGeometry(lb, &w2s);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::ProcessRaster(unsigned char* /*data*/,
+                                          int            /*length*/,
+                                          RS_ImageFormat /*format*/,
+                                          int            /*width*/,
+                                          int            /*height*/,
+                                          RS_Bounds&     /*extents*/,
+                                          TransformMesh* /*xformMesh*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::ProcessMarker(LineBuffer*   lb,
+                                          RS_MarkerDef& /*mdef*/,
+                                          bool          /*allowOverpost*/,
+                                          RS_Bounds*    bounds)
+{
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+    AddGeometry(lb, &w2s);
+
+    // markers have no extent in the tile
+    if (bounds)
+        *bounds = RS_Bounds(0.0, 0.0, 0.0, 0.0);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::ProcessLabelGroup(RS_LabelInfo*    labels,
+                                              int              nlabels,
+                                              const RS_String& text,
+                                              RS_OverpostType  /*type*/,
+                                              bool             /*exclude*/,
+                                              LineBuffer*      path,
+                                              double           /*scaleLimit*/)
+{
+    // the first candidate position is written - path labels are written at
+    // the middle of their path
+    double x, y;
+    if (nlabels > 0)
+    {
+        x = labels[0].x();
+        y = labels[0].y();
+    }
+    else if (path && path->point_count() > 0)
+    {
+        double slope;
+        path->Centroid(LineBuffer::ctLine, &x, &y, &slope);
+    }
+    else
+        return;
+
+    WorldToScreenPoint(x, y, x, y);
+    AddLabel(x, y, text.c_str());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::AddDWFContent(RS_InputStream*  /*in*/,
+                                          CSysTransformer* /*xformer*/,
+                                          const RS_String& /*section*/,
+                                          const RS_String& /*passwd*/,
+                                          const RS_String& /*w2dfilter*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::SetSymbolManager(RS_SymbolManager* /*manager*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_MapUIInfo* SE_VectorTileRenderer::GetMapInfo()
+{
+    return m_mapInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_LayerUIInfo* SE_VectorTileRenderer::GetLayerInfo()
+{
+    return m_layerInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_FeatureClassInfo* SE_VectorTileRenderer::GetFeatureClassInfo()
+{
+    return m_fcInfo;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_VectorTileRenderer::GetMapScale()
+{
+    return m_mapScale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_VectorTileRenderer::GetDrawingScale()
+{
+    // mapping units per pixel
+    return 1.0 / m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_VectorTileRenderer::GetMetersPerUnit()
+{
+    return m_metersPerUnit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_VectorTileRenderer::GetDpi()
+{
+    return m_dpi;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_Bounds& SE_VectorTileRenderer::GetBounds()
+{
+    return m_extents;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_VectorTileRenderer::RequiresClipping()
+{
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_VectorTileRenderer::RequiresLabelClipping()
+{
+    return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_VectorTileRenderer::SupportsZ()
+{
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Point styles write the feature geometry rather than the symbol, except
+// for labels.
+void SE_VectorTileRenderer::ProcessPoint(SE_ApplyContext* ctx, SE_RenderPointStyle* style, RS_Bounds* bounds)
+{
+    if (style->drawLast)
+    {
+        SE_Renderer::ProcessPoint(ctx, style, bounds);
+        return;
+    }
+
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+    AddGeometry(ctx->geometry, &w2s);
+
+    if (bounds)
+        *bounds = RS_Bounds(0.0, 0.0, 0.0, 0.0);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Line styles write the feature geometry rather than the symbols laid out
+// along it.  Line labels are still laid out, since they're written as
+// labels.
+void SE_VectorTileRenderer::ProcessLine(SE_ApplyContext* ctx, SE_RenderLineStyle* style)
+{
+    if (style->drawLast)
+    {
+        SE_Renderer::ProcessLine(ctx, style);
+        return;
+    }
+
+    switch (ctx->geometry->geom_type())
+    {
+        case GeometryType_Point:
+        case GeometryType_MultiPoint:
+            return;
+    }
+
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+    AddGeometry(ctx->geometry, &w2s);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Area styles write the feature geometry rather than the fill.
+void SE_VectorTileRenderer::ProcessArea(SE_ApplyContext* ctx, SE_RenderAreaStyle* /*style*/)
+{
+    switch (ctx->geometry->geom_type())
+    {
+        case GeometryType_Polygon:
+        case GeometryType_MultiPolygon:
+        case GeometryType_CurvePolygon:
+        case GeometryType_MultiCurvePolygon:
+            break;
+
+        default:
+            return;
+    }
+
+    SE_Matrix w2s;
+    GetWorldToScreenTransform(w2s);
+    AddGeometry(ctx->geometry, &w2s);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::DrawScreenPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& /*lineStroke*/)
+{
+    AddGeometry(polyline, xform);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::DrawScreenPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int /*fill*/)
+{
+    AddGeometry(polygon, xform);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::DrawScreenRaster(unsigned char* /*data*/, int /*length*/,
+                                             RS_ImageFormat /*format*/, int /*native_width*/, int /*native_height*/,
+                                             double /*x*/, double /*y*/, double /*w*/, double /*h*/, double /*angleDeg*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::DrawScreenRaster(unsigned char* /*data*/, int /*length*/,
+                                             RS_ImageFormat /*format*/, int /*native_width*/, int /*native_height*/,
+                                             double /*x*/, double /*y*/, double /*w*/, double /*h*/, double /*angleDeg*/,
+                                             double /*alpha*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::DrawScreenText(const RS_TextMetrics& /*tm*/, RS_TextDef& /*tdef*/, double /*insx*/, double /*insy*/,
+                                           RS_F_Point* /*path*/, int /*npts*/, double /*param_position*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+bool SE_VectorTileRenderer::YPointsUp()
+{
+    return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::GetWorldToScreenTransform(SE_Matrix& xform)
+{
+    xform.x0 = m_scale;
+    xform.x1 = 0.0;
+    xform.x2 = -m_extents.minx * m_scale;
+    xform.y0 = 0.0;
+    xform.y1 = -m_scale;
+    xform.y2 = m_height + m_extents.miny * m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::WorldToScreenPoint(double& inx, double& iny, double& ox, double& oy)
+{
+    ox = (inx - m_extents.minx) * m_scale;
+    oy = m_height - (iny - m_extents.miny) * m_scale;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::ScreenToWorldPoint(double& inx, double& iny, double& ox, double& oy)
+{
+    ox = inx / m_scale + m_extents.minx;
+    oy = (m_height - iny) / m_scale + m_extents.miny;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_VectorTileRenderer::GetScreenUnitsPerMillimeterDevice()
+{
+    return m_dpi / MILLIMETERS_PER_INCH;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_VectorTileRenderer::GetScreenUnitsPerMillimeterWorld()
+{
+    return m_scale * 0.001 / m_metersPerUnit;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double SE_VectorTileRenderer::GetScreenUnitsPerPixel()
+{
+    return 1.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+RS_FontEngine* SE_VectorTileRenderer::GetRSFontEngine()
+{
+    return m_fontEngine;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::ProcessSELabelGroup(SE_LabelInfo*   labels,
+                                                int             nlabels,
+                                                RS_OverpostType /*type*/,
+                                                bool            /*exclude*/,
+                                                LineBuffer*     /*path*/)
+{
+    if (nlabels <= 0)
+        return;
+
+    // the first candidate position is written, with the text of the first
+    // text primitive of its symbol
+    const wchar_t* text = NULL;
+    SE_RenderStyle* style = labels[0].style;
+    if (style)
+    {
+        for (SE_RenderPrimitiveList::iterator iter = style->symbol.begin(); iter != style->symbol.end(); ++iter)
+        {
+            if ((*iter)->type == SE_RenderPrimitive_Text)
+            {
+                text = ((SE_RenderText*)(*iter))->content.c_str();
+                break;
+            }
+        }
+    }
+
+    AddLabel(labels[0].x, labels[0].y, text);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::AddExclusionRegion(RS_F_Point* /*fpts*/, int /*npts*/)
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Gets the tile layer with the supplied name, reusing the layers of the
+// previous tile.
+SE_VectorTileRenderer::TileLayer* SE_VectorTileRenderer::GetTileLayer(const std::string& name)
+{
+    for (int i=0; i<m_layerCount; ++i)
+    {
+        if (m_layers[i]->name == name)
+            return m_layers[i];
+    }
+
+    if (m_layerCount == (int)m_layers.size())
+        m_layers.push_back(new TileLayer());
+
+    // clearing keeps the capacity of the buffers
+    TileLayer* layer = m_layers[m_layerCount++];
+    layer->name = name;
+    layer->features.clear();
+    layer->keys.clear();
+    layer->values.clear();
+    layer->keyIndex.clear();
+    layer->valueIndex.clear();
+    layer->featureCount = 0;
+    return layer;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+unsigned int SE_VectorTileRenderer::GetKey(TileLayer* layer, const std::string& key)
+{
+    std::map<std::string, unsigned int>::iterator iter = layer->keyIndex.find(key);
+    if (iter != layer->keyIndex.end())
+        return iter->second;
+
+    unsigned int index = (unsigned int)layer->keyIndex.size();
+    layer->keyIndex[key] = index;
+    WriteBytes(layer->keys, 3, key.data(), key.size());
+    return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Gets the index of an encoded value message, adding it to the layer's
+// values if it isn't there yet.
+unsigned int SE_VectorTileRenderer::GetValue(TileLayer* layer, const std::string& value)
+{
+    std::map<std::string, unsigned int>::iterator iter = layer->valueIndex.find(value);
+    if (iter != layer->valueIndex.end())
+        return iter->second;
+
+    unsigned int index = (unsigned int)layer->valueIndex.size();
+    layer->valueIndex[value] = index;
+    WriteBytes(layer->values, 4, value.data(), value.size());
+    return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Builds the tags of the current feature - pairs of key and value indices -
+// from its properties.  This is done while the feature is current, since
+// its geometry is only written once the reader has moved on.
+void SE_VectorTileRenderer::GetAttributes(TileLayer* layer)
+{
+    m_tags.clear();
+    if (!m_includeAttributes || !m_feature)
+        return;
+
+    const wchar_t* geomName = m_feature->GetGeomPropName();
+    const wchar_t* rasterName = m_feature->GetRasterPropName();
+
+    int count = 0;
+    const wchar_t* const* names = m_feature->GetPropNames(count);
+    for (int i=0; i<count; ++i)
+    {
+        const wchar_t* name = names[i];
+        if ((geomName && wcscmp(name, geomName) == 0) || (rasterName && wcscmp(name, rasterName) == 0))
+            continue;
+        if (m_feature->IsNull(name))
+            continue;
+
+        // encode the value message
+        m_value.clear();
+        switch (m_feature->GetPropertyType(name))
+        {
+            case FdoDataType_Boolean:
+                WriteTag(m_value, 7, VT_WIRE_VARINT);
+                WriteVarint(m_value, m_feature->GetBoolean(name)? 1 : 0);
+                break;
+
+            case FdoDataType_Byte:
+                WriteTag(m_value, 6, VT_WIRE_VARINT);
+                WriteVarint(m_value, ZigZag64(m_feature->GetByte(name)));
+                break;
+
+            case FdoDataType_Int16:
+                WriteTag(m_value, 6, VT_WIRE_VARINT);
+                WriteVarint(m_value, ZigZag64(m_feature->GetInt16(name)));
+                break;
+
+            case FdoDataType_Int32:
+                WriteTag(m_value, 6, VT_WIRE_VARINT);
+                WriteVarint(m_value, ZigZag64(m_feature->GetInt32(name)));
+                break;
+
+            case FdoDataType_Int64:
+                WriteTag(m_value, 6, VT_WIRE_VARINT);
+                WriteVarint(m_value, ZigZag64(m_feature->GetInt64(name)));
+                break;
+
+            case FdoDataType_Single:
+            {
+                float f = m_feature->GetSingle(name);
+                unsigned int bits;
+                memcpy(&bits, &f, sizeof(bits));
+                WriteTag(m_value, 2, VT_WIRE_FIXED32);
+                WriteFixed(m_value, bits, 4);
+                break;
+            }
+
+            case FdoDataType_Double:
+            case FdoDataType_Decimal:
+            {
+                double d = m_feature->GetDouble(name);
+                unsigned long long bits;
+                memcpy(&bits, &d, sizeof(bits));
+                WriteTag(m_value, 3, VT_WIRE_FIXED64);
+                WriteFixed(m_value, bits, 8);
+                break;
+            }
+
+            case FdoDataType_String:
+                ToUtf8(m_feature->GetString(name), m_string);
+                WriteBytes(m_value, 1, m_string.data(), m_string.size());
+                break;
+
+            case FdoDataType_DateTime:
+            {
+                // tiles have no date type - dates are written as strings
+                const wchar_t* str = m_feature->GetAsString(name);
+                if (!str)
+                    continue;
+                ToUtf8(str, m_string);
+                WriteBytes(m_value, 1, m_string.data(), m_string.size());
+                break;
+            }
+
+            default:
+                // geometries and large objects aren't attributes
+                continue;
+        }
+
+        ToUtf8(name, m_string);
+        m_tags.push_back(GetKey(layer, m_string));
+        m_tags.push_back(GetValue(layer, m_value));
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::WriteFeature(TileLayer* layer, GeomType type, const Geometry& geom, const std::vector<unsigned int>& tags)
+{
+    m_message.clear();
+
+    if (m_hasId)
+    {
+        WriteTag(m_message, 1, VT_WIRE_VARINT);
+        WriteVarint(m_message, m_id);
+    }
+
+    if (!tags.empty())
+    {
+        m_packed.clear();
+        for (size_t i=0; i<tags.size(); ++i)
+            WriteVarint(m_packed, tags[i]);
+        WriteBytes(m_message, 2, &m_packed[0], m_packed.size());
+    }
+
+    WriteTag(m_message, 3, VT_WIRE_VARINT);
+    WriteVarint(m_message, type);
+
+    // points are a single move with all their positions
+    m_packed.clear();
+    if (type == GeomType_Point)
+        WriteVarint(m_packed, Command(VT_CMD_MOVETO, geom.count));
+    for (size_t i=0; i<geom.commands.size(); ++i)
+        WriteVarint(m_packed, geom.commands[i]);
+    WriteBytes(m_message, 4, &m_packed[0], m_packed.size());
+
+    WriteBytes(layer->features, 2, &m_message[0], m_message.size());
+    ++layer->featureCount;
+    ++m_featureCount;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Writes a label as a point feature in the label layer of the current
+// layer, with its text as the only attribute.
+void SE_VectorTileRenderer::AddLabel(double x, double y, const wchar_t* text)
+{
+    if (!m_layer)
+        return;
+
+    if (!m_labelLayer)
+        m_labelLayer = GetTileLayer(m_layerName + "_labels");
+
+    m_labelTags.clear();
+    if (text && *text)
+    {
+        ToUtf8(text, m_string);
+        m_value.clear();
+        WriteBytes(m_value, 1, m_string.data(), m_string.size());
+
+        m_labelTags.push_back(GetKey(m_labelLayer, "text"));
+        m_labelTags.push_back(GetValue(m_labelLayer, m_value));
+    }
+
+    int qx, qy;
+    Quantize(NULL, x, y, qx, qy);
+    m_label.Clear();
+    m_label.commands.push_back(ZigZag(qx));
+    m_label.commands.push_back(ZigZag(qy));
+    m_label.count = 1;
+
+    WriteFeature(m_labelLayer, GeomType_Point, m_label, m_labelTags);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void SE_VectorTileRenderer::Quantize(const SE_Matrix* xform, double x, double y, int& qx, int& qy)
+{
+    if (xform)
+        xform->transform(x, y);
+
+    qx = (int)floor(x * m_extent / m_width + 0.5);
+    qy = (int)floor(y * m_extent / m_height + 0.5);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Quantizes a contour into m_ring, dropping repeated positions.  Returns
+// the number of positions.
+int SE_VectorTileRenderer::QuantizeContour(LineBuffer* geom, const SE_Matrix* xform, int cntr)
+{
+    m_ring.clear();
+
+    int start = geom->contour_start_point(cntr);
+    int end = geom->contour_end_point(cntr);
+    for (int i=start; i<=end; ++i)
+    {
+        int qx, qy;
+        Quantize(xform, geom->x_coord(i), geom->y_coord(i), qx, qy);
+
+        size_t n = m_ring.size();
+        if (n > 0 && m_ring[n-2] == qx && m_ring[n-1] == qy)
+            continue;
+
+        m_ring.push_back(qx);
+        m_ring.push_back(qy);
+    }
+
+    return (int)m_ring.size() / 2;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds the positions in m_ring to a geometry as a move to the first one and
+// a line through the rest.
+void SE_VectorTileRenderer::AddPath(Geometry& geom, int npts)
+{
+    geom.commands.push_back(Command(VT_CMD_MOVETO, 1));
+    geom.commands.push_back(ZigZag(m_ring[0] - geom.x));
+    geom.commands.push_back(ZigZag(m_ring[1] - geom.y));
+
+    geom.commands.push_back(Command(VT_CMD_LINETO, npts - 1));
+    for (int i=1; i<npts; ++i)
+    {
+        geom.commands.push_back(ZigZag(m_ring[2*i  ] - m_ring[2*i-2]));
+        geom.commands.push_back(ZigZag(m_ring[2*i+1] - m_ring[2*i-1]));
+    }
+
+    geom.x = m_ring[2*npts-2];
+    geom.y = m_ring[2*npts-1];
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Adds a geometry to the current feature.  Each geometry is added once, no
+// matter how many styles are applied to it.
+void SE_VectorTileRenderer::AddGeometry(LineBuffer* geom, const SE_Matrix* xform)
+{
+    if (!m_layer || !geom || geom->point_count() == 0)
+        return;
+
+    for (size_t i=0; i<m_featureGeoms.size(); ++i)
+    {
+        if (m_featureGeoms[i] == geom)
+            return;
+    }
+
+    // the tags are shared by each geometry type of the feature
+    if (m_featureGeoms.empty())
+        GetAttributes(m_layer);
+    m_featureGeoms.push_back(geom);
+
+    switch (geom->geom_type())
+    {
+        case GeometryType_Point:
+        case GeometryType_MultiPoint:
+        {
+            for (int i=0; i<geom->point_count(); ++i)
+            {
+                int qx, qy;
+                Quantize(xform, geom->x_coord(i), geom->y_coord(i), qx, qy);
+                m_points.commands.push_back(ZigZag(qx - m_points.x));
+                m_points.commands.push_back(ZigZag(qy - m_points.y));
+                m_points.x = qx;
+                m_points.y = qy;
+                ++m_points.count;
+            }
+            break;
+        }
+
+        case GeometryType_LineString:
+        case GeometryType_MultiLineString:
+        case GeometryType_CurveString:
+        case GeometryType_MultiCurveString:
+        {
+            for (int i=0; i<geom->cntr_count(); ++i)
+            {
+                int npts = QuantizeContour(geom, xform, i);
+                if (npts >= 2)
+                    AddPath(m_lines, npts);
+            }
+            break;
+        }
+
+        case GeometryType_Polygon:
+        case GeometryType_MultiPolygon:
+        case GeometryType_CurvePolygon:
+        case GeometryType_MultiCurvePolygon:
+        {
+            // the first contour of each polygon is its outer ring, the rest
+            // are holes - without polygon sizes they're all outer rings
+            int ngeoms = geom->geom_count();
+            int nsum = 0;
+            for (int g=0; g<ngeoms; ++g)
+                nsum += geom->geom_size(g);
+            bool useGeoms = (ngeoms > 0 && nsum == geom->cntr_count());
+
+            int cntr = 0;
+            for (int g=0; cntr<geom->cntr_count(); ++g)
+            {
+                int ncntrs = useGeoms? geom->geom_size(g) : 1;
+                bool outerWritten = false;
+                for (int j=0; j<ncntrs; ++j, ++cntr)
+                {
+                    // holes of a degenerate outer ring are dropped with it
+                    if (j > 0 && !outerWritten)
+                        continue;
+
+                    int npts = QuantizeContour(geom, xform, cntr);
+                    if (npts > 1 && m_ring[0] == m_ring[2*npts-2] && m_ring[1] == m_ring[2*npts-1])
+                        --npts;
+                    if (npts < 3)
+                        continue;
+
+                    // outer rings are clockwise in tile coordinates - with
+                    // y down this is a positive area - and holes counter-
+                    // clockwise
+                    double area = 0.0;
+                    for (int k=0; k<npts; ++k)
+                    {
+                        int k1 = (k+1 == npts)? 0 : k+1;
+                        area += (double)m_ring[2*k] * m_ring[2*k1+1] - (double)m_ring[2*k1] * m_ring[2*k+1];
+                    }
+                    if (area == 0.0)
+                        continue;
+
+                    if ((j == 0) != (area > 0.0))
+                    {
+                        for (int a=0, b=npts-1; a<b; ++a, --b)
+                        {
+                            std::swap(m_ring[2*a  ], m_ring[2*b  ]);
+                            std::swap(m_ring[2*a+1], m_ring[2*b+1]);
+                        }
+                    }
+
+                    m_ring.resize(2*npts);
+                    AddPath(m_polygons, npts);
+                    m_polygons.commands.push_back(Command(VT_CMD_CLOSEPATH, 1));
+
+                    if (j == 0)
+                        outerWritten = true;
+                }
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,237 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SE_VECTORTILERENDERER_H_
+#define SE_VECTORTILERENDERER_H_
+
+#include "SE_Renderer.h"
+#include <vector>
+#include <map>
+#include <string>
+
+
+//---------------------------------------------
+// An SE_Renderer which encodes the stylized features of a tile in the
+// Mapbox Vector Tile format (version 2), for clients which style and draw
+// the tile themselves.  Rather than the decorations of the symbols, each
+// feature which a style applies to is written once with its geometry and
+// attributes, in the tile layer named after its map layer.  Labels are
+// written unplaced, as points with a "text" attribute, in a second tile
+// layer whose name is the map layer's with a "_labels" suffix.
+//
+// Coordinates are quantized to a grid of extent units across the tile and
+// written as command streams of zigzag encoded deltas.  Each layer's keys
+// and values are written once and referenced by index from its features.
+// Features are encoded as they are stylized, into per-layer buffers which
+// are reused from one tile to the next.
+//---------------------------------------------
+
+class SE_VectorTileRenderer : public SE_Renderer
+{
+public:
+    STYLIZATION_API SE_VectorTileRenderer(int width, int height, RS_FontEngine* fontEngine, int extent = 4096);
+    STYLIZATION_API virtual ~SE_VectorTileRenderer();
+
+    // whether to write the properties of the features as attributes - the
+    // default is true
+    inline void SetIncludeAttributes(bool include) { m_includeAttributes = include; }
+
+    // Gets the encoded tile for the last map stylized.  Empty layers are
+    // left out.
+    STYLIZATION_API void GetTile(std::vector<unsigned char>& tile);
+
+    // the number of features written, including labels
+    inline int GetFeatureCount() const { return m_featureCount; }
+
+    ///////////////////////////////////
+    // Renderer implementation
+
+    STYLIZATION_API virtual void StartMap(RS_MapUIInfo* mapInfo, RS_Bounds& extents, double mapScale,
+                                          double dpi, double metersPerUnit, CSysTransformer* xformToLL);
+    STYLIZATION_API virtual void EndMap();
+
+    STYLIZATION_API virtual void StartLayer(RS_LayerUIInfo* layerInfo, RS_FeatureClassInfo* classInfo);
+    STYLIZATION_API virtual void EndLayer();
+
+    STYLIZATION_API virtual void StartFeature(RS_FeatureReader* feature, bool initialPass,
+                                              const RS_String* tooltip = NULL, const RS_String* url = NULL,
+                                              const RS_String* theme = NULL, double zOffset = 0.0,
+                                              double zExtrusion = 0.0,
+                                              RS_ElevationType zOffsetType = RS_ElevationType_RelativeToGround);
+
+    STYLIZATION_API virtual void ProcessPolygon(LineBuffer* lb, RS_FillStyle& fill);
+    STYLIZATION_API virtual void ProcessPolyline(LineBuffer* lb, RS_LineStroke& lsym);
+    STYLIZATION_API virtual void ProcessRaster(unsigned char* data, int length, RS_ImageFormat format,
+                                               int width, int height, RS_Bounds& extents,
+                                               TransformMesh* xformMesh = NULL);
+    STYLIZATION_API virtual void ProcessMarker(LineBuffer* lb, RS_MarkerDef& mdef, bool allowOverpost,
+                                               RS_Bounds* bounds = NULL);
+    STYLIZATION_API virtual void ProcessLabelGroup(RS_LabelInfo* labels, int nlabels, const RS_String& text,
+                                                   RS_OverpostType type, bool exclude, LineBuffer* path,
+                                                   double scaleLimit);
+    STYLIZATION_API virtual void AddDWFContent(RS_InputStream* in, CSysTransformer* xformer,
+                                               const RS_String& section, const RS_String& passwd,
+                                               const RS_String& w2dfilter);
+
+    STYLIZATION_API virtual void SetSymbolManager(RS_SymbolManager* manager);
+
+    STYLIZATION_API virtual RS_MapUIInfo* GetMapInfo();
+    STYLIZATION_API virtual RS_LayerUIInfo* GetLayerInfo();
+    STYLIZATION_API virtual RS_FeatureClassInfo* GetFeatureClassInfo();
+
+    STYLIZATION_API virtual double GetMapScale();
+    STYLIZATION_API virtual double GetDrawingScale();
+    STYLIZATION_API virtual double GetMetersPerUnit();
+    STYLIZATION_API virtual double GetDpi();
+    STYLIZATION_API virtual RS_Bounds& GetBounds();
+
+    STYLIZATION_API virtual bool RequiresClipping();
+    STYLIZATION_API virtual bool RequiresLabelClipping();
+    STYLIZATION_API virtual bool SupportsZ();
+
+    ///////////////////////////////////
+    // SE_Renderer implementation
+
+    STYLIZATION_API virtual void ProcessPoint(SE_ApplyContext* ctx, SE_RenderPointStyle* style, RS_Bounds* bounds = NULL);
+    STYLIZATION_API virtual void ProcessLine(SE_ApplyContext* ctx, SE_RenderLineStyle* style);
+    STYLIZATION_API virtual void ProcessArea(SE_ApplyContext* ctx, SE_RenderAreaStyle* style);
+
+    STYLIZATION_API virtual void DrawScreenPolyline(LineBuffer* polyline, const SE_Matrix* xform, const SE_LineStroke& lineStroke);
+    STYLIZATION_API virtual void DrawScreenPolygon(LineBuffer* polygon, const SE_Matrix* xform, unsigned int fill);
+    STYLIZATION_API virtual void DrawScreenRaster(unsigned char* data, int length,
+                                                  RS_ImageFormat format, int native_width, int native_height,
+                                                  double x, double y, double w, double h, double angleDeg);
+    STYLIZATION_API virtual void DrawScreenRaster(unsigned char* data, int length,
+                                                  RS_ImageFormat format, int native_width, int native_height,
+                                                  double x, double y, double w, double h, double angleDeg,
+                                                  double alpha);
+    STYLIZATION_API virtual void DrawScreenText(const RS_TextMetrics& tm, RS_TextDef& tdef, double insx, double insy,
+                                                RS_F_Point* path, int npts, double param_position);
+
+    STYLIZATION_API virtual bool YPointsUp();
+    STYLIZATION_API virtual void GetWorldToScreenTransform(SE_Matrix& xform);
+    STYLIZATION_API virtual void WorldToScreenPoint(double& inx, double& iny, double& ox, double& oy);
+    STYLIZATION_API virtual void ScreenToWorldPoint(double& inx, double& iny, double& ox, double& oy);
+
+    STYLIZATION_API virtual double GetScreenUnitsPerMillimeterDevice();
+    STYLIZATION_API virtual double GetScreenUnitsPerMillimeterWorld();
+    STYLIZATION_API virtual double GetScreenUnitsPerPixel();
+
+    STYLIZATION_API virtual RS_FontEngine* GetRSFontEngine();
+
+    STYLIZATION_API virtual void ProcessSELabelGroup(SE_LabelInfo* labels, int nlabels, RS_OverpostType type,
+                                                     bool exclude, LineBuffer* path = NULL);
+
+    STYLIZATION_API virtual void AddExclusionRegion(RS_F_Point* fpts, int npts);
+
+private:
+    // the feature geometry types of the format
+    enum GeomType
+    {
+        GeomType_Point      = 1,
+        GeomType_LineString = 2,
+        GeomType_Polygon    = 3
+    };
+
+    struct TileLayer
+    {
+        std::string name;                       // UTF-8
+        std::vector<unsigned char> features;    // encoded feature fields
+        std::vector<unsigned char> keys;        // encoded key fields
+        std::vector<unsigned char> values;      // encoded value fields
+        std::map<std::string, unsigned int> keyIndex;
+        std::map<std::string, unsigned int> valueIndex;
+        int featureCount;
+    };
+
+    // the command stream of one geometry type of a feature, with the cursor
+    // the deltas are relative to
+    struct Geometry
+    {
+        Geometry() : x(0), y(0), count(0) {}
+        inline void Clear() { commands.clear(); x = y = count = 0; }
+
+        std::vector<unsigned int> commands;
+        int x;
+        int y;
+        int count;      // points only - they're written as one move
+    };
+
+    void EndFeature();
+
+    TileLayer* GetTileLayer(const std::string& name);
+    unsigned int GetKey(TileLayer* layer, const std::string& key);
+    unsigned int GetValue(TileLayer* layer, const std::string& value);
+    void GetAttributes(TileLayer* layer);
+    void WriteFeature(TileLayer* layer, GeomType type, const Geometry& geom, const std::vector<unsigned int>& tags);
+
+    void AddGeometry(LineBuffer* geom, const SE_Matrix* xform);
+    void AddLabel(double x, double y, const wchar_t* text);
+    void Quantize(const SE_Matrix* xform, double x, double y, int& qx, int& qy);
+    int QuantizeContour(LineBuffer* geom, const SE_Matrix* xform, int cntr);
+    void AddPath(Geometry& geom, int npts);
+
+    RS_FontEngine* m_fontEngine;
+
+    int m_width;
+    int m_height;
+    int m_extent;
+    bool m_includeAttributes;
+
+    RS_MapUIInfo* m_mapInfo;
+    RS_LayerUIInfo* m_layerInfo;
+    RS_FeatureClassInfo* m_fcInfo;
+
+    RS_Bounds m_extents;
+    double m_mapScale;
+    double m_dpi;
+    double m_metersPerUnit;
+
+    // world to screen scale, in pixels per mapping unit
+    double m_scale;
+
+    // the tile layers, in the order they were started - layers are kept
+    // from tile to tile so that their buffers are reused
+    std::vector<TileLayer*> m_layers;
+    int m_layerCount;
+    std::string m_layerName;
+    TileLayer* m_layer;
+    TileLayer* m_labelLayer;
+    int m_featureCount;
+
+    // the current feature, whose geometry of each type is collected until
+    // the next feature starts
+    RS_FeatureReader* m_feature;
+    bool m_hasId;
+    unsigned long long m_id;
+    std::vector<LineBuffer*> m_featureGeoms;
+    std::vector<unsigned int> m_tags;
+    Geometry m_points;
+    Geometry m_lines;
+    Geometry m_polygons;
+
+    // scratch buffers
+    Geometry m_label;
+    std::vector<int> m_ring;
+    std::vector<unsigned int> m_labelTags;
+    std::vector<unsigned char> m_message;
+    std::vector<unsigned char> m_packed;
+    std::string m_string;
+    std::string m_value;
+};
+
+#endif
@@ -0,0 +1,130 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef SIZECLASSSTACK_H_
+#define SIZECLASSSTACK_H_
+
+#include "DataValueStack.h"
+
+// the number of capacity classes - class i holds capacities [2^i, 2^(i+1))
+#define SIZE_CLASS_COUNT 32
+
+//---------------------------------------------
+// A stack of pooled buffers, kept in power of two classes by capacity, so
+// that a request can be given the best-fitting buffer rather than whichever
+// was freed last.  Like DataValueStack it doesn't own the buffers.
+//---------------------------------------------
+
+template <class T> class SizeClassStack
+{
+public:
+    SizeClassStack()
+    {
+        m_count = 0;
+    }
+
+    inline void push(T* buf, int capacity)
+    {
+        m_classes[class_of(capacity)].push(buf);
+        ++m_count;
+    }
+
+    // Pops a buffer for the requested capacity - the smallest one which
+    // can hold it if there is one, otherwise the largest smaller one (which
+    // the caller grows as needed).  Returns NULL if the stack is empty.
+    inline T* pop(int capacity)
+    {
+        if (m_count == 0)
+            return NULL;
+
+        // the first class all of whose buffers hold the request
+        int cls = (capacity > 1)? class_of(capacity - 1) + 1 : 0;
+        if (cls > SIZE_CLASS_COUNT)
+            cls = SIZE_CLASS_COUNT;
+
+        for (int i=cls; i<SIZE_CLASS_COUNT; ++i)
+        {
+            if (!m_classes[i].empty())
+                return take(i);
+        }
+
+        for (int i=cls-1; i>=0; --i)
+        {
+            if (!m_classes[i].empty())
+                return take(i);
+        }
+
+        return NULL;
+    }
+
+    // a buffer from the largest non-empty class, or NULL if the stack is empty
+    inline T* top_largest()
+    {
+        int i = largest();
+        return (i >= 0)? m_classes[i].top() : NULL;
+    }
+
+    inline T* pop_largest()
+    {
+        int i = largest();
+        return (i >= 0)? take(i) : NULL;
+    }
+
+    inline size_t size()
+    {
+        return m_count;
+    }
+
+    inline bool empty()
+    {
+        return m_count == 0;
+    }
+
+private:
+    static inline int class_of(int capacity)
+    {
+        int cls = 0;
+        for (unsigned int n = (unsigned int)capacity; n > 1; n >>= 1)
+            ++cls;
+        return (cls < SIZE_CLASS_COUNT)? cls : SIZE_CLASS_COUNT - 1;
+    }
+
+    inline int largest()
+    {
+        if (m_count > 0)
+        {
+            for (int i=SIZE_CLASS_COUNT-1; i>=0; --i)
+            {
+                if (!m_classes[i].empty())
+                    return i;
+            }
+        }
+
+        return -1;
+    }
+
+    inline T* take(int cls)
+    {
+        --m_count;
+        return m_classes[cls].pop();
+    }
+
+    DataValueStack<T> m_classes[SIZE_CLASS_COUNT];
+    size_t m_count;
+};
+
+#endif
@@ -0,0 +1,353 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "StylePreviewSheet.h"
+#include "StylizationUtil.h"
+#include "SE_ImageRenderer.h"
+#include "SE_StyleVisitor.h"
+#include "FeatureTypeStyleVisitor.h"
+#ifndef EMSCRIPTEN
+#include "FdoEvaluator.h"
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+StylePreviewSheet::StylePreviewSheet(int iconWidth, int iconHeight, int columns, int spacing)
+: m_iconWidth(rs_max(iconWidth, 1))
+, m_iconHeight(rs_max(iconHeight, 1))
+, m_columns(rs_max(columns, 1))
+, m_spacing(rs_max(spacing, 0))
+, m_layerCount(0)
+, m_currentLayer(-1)
+, m_symbolManager(NULL)
+, m_converted(false)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+StylePreviewSheet::~StylePreviewSheet()
+{
+    ClearSymbolInstances();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int StylePreviewSheet::AddLayer(VectorLayerDefinition* layer)
+{
+    int ordinal = m_layerCount++;
+
+    if (!layer)
+        return ordinal;
+
+    m_currentLayer = ordinal;
+
+    VectorScaleRangeCollection* ranges = layer->GetScaleRanges();
+    for (int i=0; i<ranges->GetCount(); ++i)
+    {
+        FeatureTypeStyleCollection* styles = ranges->GetAt(i)->GetFeatureTypeStyles();
+        for (int j=0; j<styles->GetCount(); ++j)
+        {
+            FeatureTypeStyle* fts = styles->GetAt(j);
+            if (fts->IsShowInLegend())
+                AddStyle(fts);
+        }
+    }
+
+    m_currentLayer = -1;
+
+    return ordinal;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void StylePreviewSheet::AddStyle(FeatureTypeStyle* fts)
+{
+    if (!fts)
+        return;
+
+    RuleCollection* rules = fts->GetRules();
+    if (!rules || rules->GetCount() == 0)
+        return;
+
+    StyleEntry entry;
+    entry.fts = fts;
+    entry.composite = (FeatureTypeStyleVisitor::DetermineFeatureTypeStyle(fts) == FeatureTypeStyleVisitor::ftsComposite);
+    m_styles.push_back(entry);
+
+    for (int i=0; i<rules->GetCount(); ++i)
+    {
+        int cell = (int)m_icons.size();
+
+        StylePreviewIcon icon;
+        icon.layer = m_currentLayer;
+        icon.style = (int)m_styles.size() - 1;
+        icon.themeCategory = i;
+        icon.x = m_spacing + (cell % m_columns) * (m_iconWidth + m_spacing);
+        icon.y = m_spacing + (cell / m_columns) * (m_iconHeight + m_spacing);
+        icon.width = m_iconWidth;
+        icon.height = m_iconHeight;
+        icon.legendLabel = rules->GetAt(i)->GetLegendLabel();
+        m_icons.push_back(icon);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int StylePreviewSheet::GetWidth() const
+{
+    int count = (int)m_icons.size();
+    if (count == 0)
+        return 0;
+
+    int columns = rs_min(count, m_columns);
+    return m_spacing + columns * (m_iconWidth + m_spacing);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int StylePreviewSheet::GetHeight() const
+{
+    int count = (int)m_icons.size();
+    if (count == 0)
+        return 0;
+
+    int rows = (count + m_columns - 1) / m_columns;
+    return m_spacing + rows * (m_iconHeight + m_spacing);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int StylePreviewSheet::GetIconCount() const
+{
+    return (int)m_icons.size();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+const StylePreviewIcon& StylePreviewSheet::GetIcon(int index) const
+{
+    return m_icons[index];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void StylePreviewSheet::Draw(SE_Renderer* pSERenderer, SE_SymbolManager* sman)
+{
+    int sheetWidth = GetWidth();
+    int sheetHeight = GetHeight();
+    if (sheetWidth == 0 || sheetHeight == 0 || m_styles.empty())
+        return;
+
+    // the converted symbols reference the symbol manager's resources
+    if (!m_converted || m_symbolManager != sman)
+    {
+        ClearSymbolInstances();
+
+        SE_StyleVisitor visitor(sman, &m_pool);
+        for (std::vector<StyleEntry>::iterator iter = m_styles.begin(); iter != m_styles.end(); ++iter)
+        {
+            if (!iter->composite)
+                continue;
+
+            RuleCollection* rules = iter->fts->GetRules();
+            iter->instances.resize(rules->GetCount());
+            for (int i=0; i<rules->GetCount(); ++i)
+            {
+                CompositeRule* rule = (CompositeRule*)rules->GetAt(i);
+                visitor.Convert(iter->instances[i], rule->GetSymbolization());
+            }
+        }
+
+        m_symbolManager = sman;
+        m_converted = true;
+    }
+
+    // same map setup as StylizationUtil::DrawStylePreview, but covering the
+    // whole sheet
+    RS_Bounds bounds(0.0, 0.0, sheetWidth, sheetHeight);
+
+    RS_MapUIInfo info(L"", L"name", L"guid", L"", L"", RS_Color(255, 255, 255, 0));
+
+    double pixelsPerInch = STANDARD_DISPLAY_DPI;
+    double metersPerPixel = METERS_PER_INCH / pixelsPerInch;
+
+    pSERenderer->StartMap(&info, bounds, 1.0, pixelsPerInch, metersPerPixel, NULL);
+    pSERenderer->StartLayer(NULL, NULL);
+
+    for (std::vector<StylePreviewIcon>::const_iterator iter = m_icons.begin(); iter != m_icons.end(); ++iter)
+    {
+        StyleEntry& entry = m_styles[iter->style];
+
+        // mapping space has y pointing up
+        double x = iter->x;
+        double y = sheetHeight - iter->y - iter->height;
+
+        STYLIZATION_TRY()
+
+            if (entry.composite)
+                StylizationUtil::RenderCompositeSymbolInstances(entry.instances[iter->themeCategory], pSERenderer, sman, x, y, iter->width, iter->height);
+            else
+                StylizationUtil::RenderStylePreview(entry.fts, iter->themeCategory, pSERenderer, sman, x, y, iter->width, iter->height);
+
+        STYLIZATION_CATCH(L"StylePreviewSheet.Draw")
+    }
+
+    pSERenderer->EndLayer();
+    pSERenderer->EndMap();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void StylePreviewSheet::Render(SE_SymbolManager* sman)
+{
+    int sheetWidth = GetWidth();
+    int sheetHeight = GetHeight();
+    if (sheetWidth == 0 || sheetHeight == 0)
+    {
+        m_image.clear();
+        return;
+    }
+
+    RS_Color bgColor(255, 255, 255, 0);
+    SE_ImageRenderer renderer(sheetWidth, sheetHeight, bgColor);
+    Draw(&renderer, sman);
+    renderer.GetImageRGBA(m_image);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+const std::vector<unsigned char>& StylePreviewSheet::GetImage() const
+{
+    return m_image;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void StylePreviewSheet::ReleaseStyles()
+{
+    ClearSymbolInstances();
+    m_styles.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void StylePreviewSheet::ClearSymbolInstances()
+{
+    for (std::vector<StyleEntry>::iterator iter = m_styles.begin(); iter != m_styles.end(); ++iter)
+    {
+        for (size_t i=0; i<iter->instances.size(); ++i)
+        {
+            std::vector<SE_SymbolInstance*>& instances = iter->instances[i];
+            for (std::vector<SE_SymbolInstance*>::iterator siter = instances.begin(); siter != instances.end(); ++siter)
+                delete *siter;
+        }
+
+        iter->instances.clear();
+    }
+
+    m_symbolManager = NULL;
+    m_converted = false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+StylePreviewCache::StylePreviewCache(size_t maxSheets)
+: m_maxSheets(rs_max(maxSheets, (size_t)1))
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+StylePreviewCache::~StylePreviewCache()
+{
+    Clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+const StylePreviewSheet* StylePreviewCache::GetSheet(const MdfString& contentKey,
+                                                     VectorLayerDefinition* layer,
+                                                     SE_SymbolManager* sman,
+                                                     int iconWidth, int iconHeight, int columns)
+{
+    std::vector<VectorLayerDefinition*> layers(1, layer);
+    return GetSheet(contentKey, layers, sman, iconWidth, iconHeight, columns);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+const StylePreviewSheet* StylePreviewCache::GetSheet(const MdfString& contentKey,
+                                                     std::vector<VectorLayerDefinition*>& layers,
+                                                     SE_SymbolManager* sman,
+                                                     int iconWidth, int iconHeight, int columns)
+{
+    // the same content can be requested with different layouts
+    wchar_t layout[64];
+    swprintf(layout, 64, L"|%d|%d|%d", iconWidth, iconHeight, columns);
+    MdfString key = contentKey + layout;
+
+    SheetMap::iterator found = m_sheets.find(key);
+    if (found != m_sheets.end())
+    {
+        m_uses.splice(m_uses.begin(), m_uses, found->second.use);
+        return found->second.sheet;
+    }
+
+    StylePreviewSheet* sheet = new StylePreviewSheet(iconWidth, iconHeight, columns);
+    for (size_t i=0; i<layers.size(); ++i)
+        sheet->AddLayer(layers[i]);
+
+    sheet->Render(sman);
+    sheet->ReleaseStyles();
+
+    // make room for the new sheet
+    while (m_sheets.size() >= m_maxSheets)
+    {
+        SheetMap::iterator oldest = m_sheets.find(m_uses.back());
+        delete oldest->second.sheet;
+        m_sheets.erase(oldest);
+        m_uses.pop_back();
+    }
+
+    m_uses.push_front(key);
+
+    Entry& entry = m_sheets[key];
+    entry.sheet = sheet;
+    entry.use = m_uses.begin();
+
+    return sheet;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t StylePreviewCache::GetCount() const
+{
+    return m_sheets.size();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void StylePreviewCache::Clear()
+{
+    for (SheetMap::iterator iter = m_sheets.begin(); iter != m_sheets.end(); ++iter)
+        delete iter->second.sheet;
+
+    m_sheets.clear();
+    m_uses.clear();
+}
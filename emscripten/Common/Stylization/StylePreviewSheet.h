@@ -0,0 +1,173 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef STYLEPREVIEWSHEET_H_
+#define STYLEPREVIEWSHEET_H_
+
+#include "Stylization.h"
+#include "SE_BufferPool.h"
+#include <vector>
+#include <map>
+#include <list>
+using namespace MdfModel;
+
+class SE_Renderer;
+class SE_SymbolManager;
+struct SE_SymbolInstance;
+
+
+// One icon of a preview sheet - which rule it shows and where it is in the
+// sheet image.  The position is in image pixels, with the origin at the top
+// left corner.
+struct StylePreviewIcon
+{
+    int layer;              // ordinal of the layer added to the sheet, or -1
+                            // for styles added on their own
+    int style;              // ordinal of the feature type style added to the sheet
+    int themeCategory;      // rule index within the feature type style
+    int x;
+    int y;
+    int width;
+    int height;
+    MdfString legendLabel;
+};
+
+
+//---------------------------------------------
+// Draws the preview icons of many theme rules - all the rules of a layer, or
+// of all the layers in a map - into a single sprite sheet image, and keeps an
+// index of where each icon is.  Drawing the sheet sets up the renderer once,
+// so the font state is shared by all its icons, and composite symbolizations
+// are converted once and kept for later draws.
+//
+// Icons are laid out in a grid with a gap between them, so that symbols which
+// slightly overflow their preview (e.g. wide area edges) don't run into the
+// neighbouring icons.
+//---------------------------------------------
+class StylePreviewSheet
+{
+public:
+    STYLIZATION_API StylePreviewSheet(int iconWidth, int iconHeight, int columns, int spacing = 2);
+    STYLIZATION_API ~StylePreviewSheet();
+
+    // Adds icons for the rules of all feature type styles in the layer which
+    // are shown in the legend.  Returns the layer's ordinal in the sheet.
+    STYLIZATION_API int AddLayer(VectorLayerDefinition* layer);
+
+    // Adds icons for all the rules of a feature type style.  The style must
+    // stay alive until the sheet has been drawn.
+    STYLIZATION_API void AddStyle(FeatureTypeStyle* fts);
+
+    // the size of the sheet image, in pixels
+    STYLIZATION_API int GetWidth() const;
+    STYLIZATION_API int GetHeight() const;
+
+    STYLIZATION_API int GetIconCount() const;
+    STYLIZATION_API const StylePreviewIcon& GetIcon(int index) const;
+
+    // Draws all the icons using the supplied renderer, whose image must be the
+    // size of the sheet.  This does the StartMap / EndMap calls.
+    STYLIZATION_API void Draw(SE_Renderer* pSERenderer, SE_SymbolManager* sman);
+
+    // Draws the sheet into an image and keeps it as RGBA pixels.
+    STYLIZATION_API void Render(SE_SymbolManager* sman);
+    STYLIZATION_API const std::vector<unsigned char>& GetImage() const;
+
+    // Forgets the feature type styles and their converted symbols, keeping
+    // only the index and the rendered image.  After this the layer definitions
+    // can be freed, but the sheet can't be drawn again.
+    STYLIZATION_API void ReleaseStyles();
+
+private:
+    void ClearSymbolInstances();
+
+    struct StyleEntry
+    {
+        FeatureTypeStyle* fts;
+        bool composite;
+        std::vector< std::vector<SE_SymbolInstance*> > instances;   // per rule, when composite
+    };
+
+    int m_iconWidth;
+    int m_iconHeight;
+    int m_columns;
+    int m_spacing;
+    int m_layerCount;
+    int m_currentLayer;
+
+    std::vector<StylePreviewIcon> m_icons;
+    std::vector<StyleEntry> m_styles;
+    std::vector<unsigned char> m_image;
+
+    // the composite symbols are converted with our own pool so that they can
+    // outlive the renderer, and are only valid for the symbol manager used
+    SE_BufferPool m_pool;
+    SE_SymbolManager* m_symbolManager;
+    bool m_converted;
+};
+
+
+//---------------------------------------------
+// Keeps rendered preview sheets keyed by the content of the layer
+// definitions they show, so that opening the same legend again doesn't draw
+// it again.  Since the layer definitions arrive here already parsed, the
+// caller supplies the content key - typically the layer definition XML, or a
+// digest of it.  When the cache is full the least recently used sheet is
+// dropped.
+//
+// The cache isn't synchronized - callers rendering concurrently should each
+// use their own, or serialize access to a shared one.
+//---------------------------------------------
+class StylePreviewCache
+{
+public:
+    STYLIZATION_API StylePreviewCache(size_t maxSheets = 32);
+    STYLIZATION_API ~StylePreviewCache();
+
+    // Returns the sheet for the layers, rendering and caching it if the key
+    // isn't already cached.  The returned sheet has released its styles, and
+    // stays valid until it is evicted or the cache is cleared.
+    STYLIZATION_API const StylePreviewSheet* GetSheet(const MdfString& contentKey,
+                                                      std::vector<VectorLayerDefinition*>& layers,
+                                                      SE_SymbolManager* sman,
+                                                      int iconWidth, int iconHeight, int columns);
+
+    STYLIZATION_API const StylePreviewSheet* GetSheet(const MdfString& contentKey,
+                                                      VectorLayerDefinition* layer,
+                                                      SE_SymbolManager* sman,
+                                                      int iconWidth, int iconHeight, int columns);
+
+    STYLIZATION_API size_t GetCount() const;
+    STYLIZATION_API void Clear();
+
+private:
+    typedef std::list<MdfString> UseList;
+
+    struct Entry
+    {
+        StylePreviewSheet* sheet;
+        UseList::iterator use;
+    };
+
+    typedef std::map<MdfString, Entry> SheetMap;
+
+    size_t m_maxSheets;
+    SheetMap m_sheets;
+    UseList m_uses;     // most recently used first
+};
+
+#endif
@@ -0,0 +1,1084 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "StylizationBenchmark.h"
+#include "RS_WorkloadGenerator.h"
+#include "SE_RecordingRenderer.h"
+#include "SE_MetatileRenderer.h"
+#include "SE_StyleVisitor.h"
+#include "SE_SymbolDefProxies.h"
+#include "SE_AreaPositioning.h"
+#include "LabelRendererLocal.h"
+#include "BIDIConverter.h"
+#include "RichTextEngine.h"
+#include "DefaultStylizer.h"
+#include "VectorLayerDefinition.h"
+#include "CompositeTypeStyle.h"
+#include "CompositeRule.h"
+#include "CompositeSymbolization.h"
+#include "SimpleSymbolDefinition.h"
+#include "Path.h"
+#include "Text.h"
+#ifndef EMSCRIPTEN
+#include "FdoEvaluator.h"
+typedef FdoEvaluator BenchmarkEvaluator;
+#else
+#include "../Emscripten/EmEvaluator.h"
+typedef EmEvaluator BenchmarkEvaluator;
+#endif
+#include <chrono>
+#include <cstdio>
+#include <atomic>
+
+// threads are only available in Emscripten builds with pthread support
+#if !defined(EMSCRIPTEN) || defined(__EMSCRIPTEN_PTHREADS__)
+#define STYLIZATION_BENCHMARK_THREADS
+#include <thread>
+#endif
+
+using namespace MDFMODEL_NAMESPACE;
+
+// the rendered image size, in pixels
+static const int BENCHMARK_IMAGE_SIZE = 1024;
+
+// the workload extents, in meters
+static const double BENCHMARK_EXTENT = 10000.0;
+
+// the tiled map benchmark tile size, in pixels, the number of tiles along
+// each side of the workload extents, and the request extent offset around
+// each tile or metatile, as a fraction of the tile size
+static const int BENCHMARK_TILE_SIZE = 256;
+static const int BENCHMARK_TILE_GRID = 8;
+static const double BENCHMARK_TILE_OFFSET = 0.35;
+
+// the stress test image size, in pixels, and features per layer
+static const int STRESS_IMAGE_SIZE = 256;
+static const int STRESS_FEATURES = 500;
+
+static const wchar_t* VERTEX_CONTROLS[] =
+{
+    L"'OverlapWrap'", L"'OverlapNone'", L"'OverlapDirect'", L"'OverlapNoWrap'"
+};
+
+static const wchar_t* BIDI_STRINGS[] =
+{
+    L"Main Street",
+    L"\x05e8\x05d7\x05d5\x05d1 \x05d4\x05e8\x05e6\x05dc",                                 // Hebrew
+    L"\x0634\x0627\x0631\x0639 \x0627\x0644\x0645\x0644\x0643 123",                         // Arabic with digits
+    L"Route 66 \x05d3\x05e8\x05da \x05d4\x05d9\x05dd",                                      // mixed
+    L"\x0645\x062f\x064a\x0646\x0629 (Old Town) \x0627\x0644\x0642\x062f\x064a\x0645\x0629" // mixed with brackets
+};
+
+static const wchar_t* MTEXT_STRINGS[] =
+{
+    L"Plain label",
+    L"{\\fArial|b1;Bold} and {\\fArial|i1;italic}",
+    L"First line\\PSecond line\\PThird line",
+    L"{\\C1;Red} {\\C3;Green} {\\C5;Blue} {\\H2x;Big}",
+    L"Sub\\S2^3; and {\\LUnderlined\\l} {\\OOverlined\\o}"
+};
+
+#define COUNTOF(a) ((int)(sizeof(a) / sizeof(a[0])))
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationBenchmark::StylizationBenchmark()
+: m_minTime(0.5)
+, m_allocCounter(NULL)
+, m_metatileSize(4)
+, m_filter(NULL)
+, m_size(0)
+, m_roads(NULL)
+, m_parcels(NULL)
+, m_points(NULL)
+, m_roadVertices(0.0)
+, m_parcelVertices(0.0)
+, m_mapScale(1.0)
+, m_renderer(NULL)
+, m_eval(NULL)
+, m_stylizer(NULL)
+, m_style(NULL)
+, m_reader(NULL)
+, m_layer(NULL)
+, m_labelLayer(NULL)
+{
+    m_sizes.push_back(1000);
+    m_sizes.push_back(10000);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationBenchmark::~StylizationBenchmark()
+{
+    Teardown();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::SetSizes(const std::vector<int>& sizes)
+{
+    m_sizes = sizes;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::Run(const char* filter)
+{
+    m_filter = filter;
+
+    for (size_t s=0; s<m_sizes.size(); ++s)
+    {
+        Setup(m_sizes[s]);
+
+        // geometry
+        Measure("LineBuffer.LoadFromAgf", &StylizationBenchmark::BenchLoadFromAgf);
+        Measure("LineBuffer.Clip", &StylizationBenchmark::BenchClip);
+        Measure("LineBuffer.Optimize", &StylizationBenchmark::BenchOptimize);
+        Measure("LineBuffer.Centroid", &StylizationBenchmark::BenchCentroid);
+        Measure("SE_LineBuffer.Transform", &StylizationBenchmark::BenchTransform);
+
+        // style evaluation
+        std::vector<SE_SymbolInstance*> instances;
+
+        m_style = ConvertStyle(CreatePointSymbolization(false), instances);
+        Measure("SE_Style.Evaluate.Point", &StylizationBenchmark::BenchEvaluate);
+        m_style = ConvertStyle(CreateLineSymbolization(VERTEX_CONTROLS[0]), instances);
+        Measure("SE_Style.Evaluate.Line", &StylizationBenchmark::BenchEvaluate);
+        m_style = ConvertStyle(CreateAreaSymbolization(), instances);
+        Measure("SE_Style.Evaluate.Area", &StylizationBenchmark::BenchEvaluate);
+
+        // symbol layout
+        for (int i=0; i<COUNTOF(VERTEX_CONTROLS); ++i)
+        {
+            std::string name = "SE_Renderer.ProcessLine.";
+            for (const wchar_t* c = VERTEX_CONTROLS[i] + 1; *c != L'\''; ++c)
+                name += (char)*c;
+
+            m_style = ConvertStyle(CreateLineSymbolization(VERTEX_CONTROLS[i]), instances);
+            Measure(name.c_str(), &StylizationBenchmark::BenchProcessLine);
+        }
+
+        m_style = ConvertStyle(CreateAreaSymbolization(), instances);
+        Measure("SE_AreaPositioning", &StylizationBenchmark::BenchAreaPositioning);
+
+        // labels and text
+        m_style = ConvertStyle(CreatePointSymbolization(true), instances);
+        Measure("LabelRendererLocal.BlastLabels", &StylizationBenchmark::BenchBlastLabels);
+        Measure("BIDIConverter.ConvertString", &StylizationBenchmark::BenchBIDIConverter);
+        Measure("RichTextEngine.Parse", &StylizationBenchmark::BenchRichText);
+
+        m_style = NULL;
+        for (size_t i=0; i<instances.size(); ++i)
+            delete instances[i];
+        instances.clear();
+
+        // complete layers
+        m_reader = m_points;
+        m_layer = CreateLayer(CreatePointSymbolization(true));
+        Measure("StylizeVectorLayer.Point", &StylizationBenchmark::BenchStylizeLayer);
+        delete m_layer;
+
+        m_reader = m_roads;
+        m_layer = CreateLayer(CreateLineSymbolization(VERTEX_CONTROLS[0]));
+        Measure("StylizeVectorLayer.Line", &StylizationBenchmark::BenchStylizeLayer);
+        delete m_layer;
+
+        m_reader = m_parcels;
+        m_layer = CreateLayer(CreateAreaSymbolization());
+        Measure("StylizeVectorLayer.Area", &StylizationBenchmark::BenchStylizeLayer);
+        delete m_layer;
+
+        // a tiled street map, one tile at a time and in metatiles
+        m_layer = CreateLayer(CreateLineSymbolization(VERTEX_CONTROLS[0]));
+        m_labelLayer = CreateLayer(CreatePointSymbolization(true));
+        Measure("Tiles.Single", &StylizationBenchmark::BenchTiles);
+        Measure("Tiles.Metatile", &StylizationBenchmark::BenchMetatiles);
+        delete m_layer;
+        delete m_labelLayer;
+
+        m_layer = NULL;
+        m_labelLayer = NULL;
+        m_reader = NULL;
+
+        Teardown();
+    }
+
+    m_filter = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Runs a benchmark repeatedly until the minimum time has elapsed, and adds
+// its result.
+void StylizationBenchmark::Measure(const char* name, Body body)
+{
+    if (m_filter && strncmp(name, m_filter, strlen(m_filter)) != 0)
+        return;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // warm up the caches and pools
+    Counts counts;
+    (this->*body)(counts);
+
+    unsigned long long allocs = m_allocCounter? m_allocCounter() : 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    int iterations = 0;
+
+    do
+    {
+        (this->*body)(counts);
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    while (elapsed < m_minTime);
+
+    Result result;
+    result.name = name;
+    result.size = m_size;
+    result.iterations = iterations;
+    result.seconds = elapsed / iterations;
+    result.features = counts.features;
+    result.vertices = counts.vertices;
+    result.labels = counts.labels;
+    result.allocations = m_allocCounter? (double)(m_allocCounter() - allocs) / iterations : -1.0;
+    m_results.push_back(result);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::WriteJson(std::string& json) const
+{
+    char buf[512];
+
+    json = "[\n";
+    for (size_t i=0; i<m_results.size(); ++i)
+    {
+        const Result& r = m_results[i];
+        double rate = (r.seconds > 0.0)? 1.0 / r.seconds : 0.0;
+
+        int len = snprintf(buf, sizeof(buf),
+            "  {\"name\": \"%s\", \"size\": %d, \"iterations\": %d, \"seconds\": %.9g, "
+            "\"features_per_s\": %.6g, \"vertices_per_s\": %.6g, \"labels_per_s\": %.6g",
+            r.name.c_str(), r.size, r.iterations, r.seconds,
+            r.features * rate, r.vertices * rate, r.labels * rate);
+        json.append(buf, rs_min(len, (int)sizeof(buf) - 1));
+
+        // the text benchmarks count each label as a feature
+        double features = (r.features > 0.0)? r.features : r.labels;
+        if (r.allocations >= 0.0 && features > 0.0)
+        {
+            len = snprintf(buf, sizeof(buf), ", \"allocs_per_feature\": %.6g", r.allocations / features);
+            json.append(buf, rs_min(len, (int)sizeof(buf) - 1));
+        }
+
+        json += (i + 1 < m_results.size())? "},\n" : "}\n";
+    }
+    json += "]\n";
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+namespace
+{
+    // the state shared by the stress test threads
+    struct StressState
+    {
+        std::vector<VectorLayerDefinition*> layers;
+        std::vector<std::vector<unsigned int> > baseline;
+        std::atomic<int> mismatches;
+    };
+
+    // Renders one of the stress layers to an image with its own stylizer and
+    // renderer, and converts the BIDI strings.  Both go in the output.
+    void StressRender(VectorLayerDefinition* layer, int workload, std::vector<unsigned int>& output,
+                      SE_DrawBatchMode batchMode = SE_DrawBatchMode_None)
+    {
+        RS_Bounds extents(0.0, 0.0, BENCHMARK_EXTENT, BENCHMARK_EXTENT);
+        double dpi = 96.0;
+        double mapScale = BENCHMARK_EXTENT / (STRESS_IMAGE_SIZE * METERS_PER_INCH / dpi);
+
+        RS_WorkloadGenerator generator(extents, 12345);
+        std::auto_ptr<RS_MemoryFeatureReader> reader((workload == 0)? generator.CreateRoads(STRESS_FEATURES, 16) :
+                                                     (workload == 1)? generator.CreateParcels(STRESS_FEATURES) :
+                                                                      generator.CreatePoints(STRESS_FEATURES));
+
+        // the stress threads are the only concurrency
+        RS_Color bgColor(255, 255, 255, 255);
+        SE_ImageRenderer renderer(STRESS_IMAGE_SIZE, STRESS_IMAGE_SIZE, bgColor);
+        renderer.SetNumThreads(1);
+        renderer.SetDrawBatching(batchMode);
+
+        DefaultStylizer stylizer(NULL);
+
+        renderer.StartMap(NULL, extents, mapScale, dpi, 1.0, NULL);
+        renderer.StartLayer(NULL, NULL);
+        stylizer.StylizeVectorLayer(layer, &renderer, reader.get(), NULL, mapScale, NULL, NULL);
+        renderer.EndLayer();
+        renderer.EndMap();
+
+        const unsigned int* image = renderer.GetImage();
+        output.assign(image, image + STRESS_IMAGE_SIZE * STRESS_IMAGE_SIZE);
+
+        BIDIConverter converter;
+        for (int i=0; i<COUNTOF(BIDI_STRINGS); ++i)
+        {
+            // the result may refer to the source string, so keep it alive
+            DisplayStr source(BIDI_STRINGS[i]);
+            const DisplayStr& converted = converter.ConvertString(source);
+            output.insert(output.end(), converted.begin(), converted.end());
+        }
+    }
+
+    void StressWorker(StressState* state, int thread, int numRenders)
+    {
+        std::vector<unsigned int> output;
+        int numLayers = (int)state->layers.size();
+
+        for (int i=0; i<numRenders; ++i)
+        {
+            // start each thread on a different layer
+            int layer = (thread + i) % numLayers;
+            StressRender(state->layers[layer], layer, output);
+            if (output != state->baseline[layer])
+                ++state->mismatches;
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int StylizationBenchmark::RunStress(int numThreads, int rendersPerThread)
+{
+    StressState state;
+    state.mismatches = 0;
+
+    // the layers are shared by all the threads - one per workload
+    state.layers.push_back(CreateLayer(CreateLineSymbolization(VERTEX_CONTROLS[0])));
+    state.layers.push_back(CreateLayer(CreateAreaSymbolization()));
+    state.layers.push_back(CreateLayer(CreatePointSymbolization(true)));
+
+    state.baseline.resize(state.layers.size());
+    for (size_t i=0; i<state.layers.size(); ++i)
+        StressRender(state.layers[i], (int)i, state.baseline[i]);
+
+#ifdef STYLIZATION_BENCHMARK_THREADS
+    std::vector<std::thread> threads;
+    for (int i=0; i<numThreads; ++i)
+        threads.push_back(std::thread(StressWorker, &state, i, rendersPerThread));
+    for (size_t i=0; i<threads.size(); ++i)
+        threads[i].join();
+#else
+    for (int i=0; i<numThreads; ++i)
+        StressWorker(&state, i, rendersPerThread);
+#endif
+
+    for (size_t i=0; i<state.layers.size(); ++i)
+        delete state.layers[i];
+
+    return state.mismatches;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int StylizationBenchmark::RunBatchingCheck()
+{
+    // the workloads StressRender uses for the layers
+    VectorLayerDefinition* layers[2];
+    int workloads[2] = { 0, 2 };
+    layers[0] = CreateLayer(CreateLineSymbolization(VERTEX_CONTROLS[0]));
+    layers[1] = CreateLayer(CreatePointSymbolization(true, true));
+
+    int numDiffs = 0;
+    std::vector<unsigned int> baseline;
+    std::vector<unsigned int> output;
+    for (int i=0; i<2; ++i)
+    {
+        StressRender(layers[i], workloads[i], baseline);
+
+        for (int mode=SE_DrawBatchMode_Consecutive; mode<=SE_DrawBatchMode_Reorder; ++mode)
+        {
+            StressRender(layers[i], workloads[i], output, (SE_DrawBatchMode)mode);
+            for (int j=0; j<STRESS_IMAGE_SIZE*STRESS_IMAGE_SIZE; ++j)
+            {
+                if (output[j] != baseline[j])
+                    ++numDiffs;
+            }
+        }
+
+        delete layers[i];
+    }
+
+    return numDiffs;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::Setup(int size)
+{
+    Teardown();
+
+    m_size = size;
+    m_extents = RS_Bounds(0.0, 0.0, BENCHMARK_EXTENT, BENCHMARK_EXTENT);
+
+    // the same workload for a given size on every run
+    RS_WorkloadGenerator generator(m_extents, 12345);
+    m_roads = generator.CreateRoads(size, 16);
+    m_parcels = generator.CreateParcels(size);
+    m_points = generator.CreatePoints(size);
+
+    DecodeAll(m_roads, m_roadGeoms, m_roadVertices);
+    DecodeAll(m_parcels, m_parcelGeoms, m_parcelVertices);
+
+    double pointVertices;
+    DecodeAll(m_points, m_pointGeoms, pointVertices);
+
+    // the map fills the image at 96 dpi
+    double dpi = 96.0;
+    m_mapScale = BENCHMARK_EXTENT / (BENCHMARK_IMAGE_SIZE * METERS_PER_INCH / dpi);
+
+    m_renderer = new SE_RecordingRenderer(BENCHMARK_IMAGE_SIZE, BENCHMARK_IMAGE_SIZE, &m_fontEngine);
+    m_renderer->StartMap(NULL, m_extents, m_mapScale, dpi, 1.0, NULL);
+    m_renderer->SetBufferPool(&m_sePool);
+    m_renderer->GetWorldToScreenTransform(m_w2s);
+
+    m_eval = new BenchmarkEvaluator(m_renderer, m_points);
+
+    m_stylizer = new DefaultStylizer(NULL);
+
+    // symbols are in millimeters, with y pointing down on the screen
+    double mm2sud = m_renderer->GetScreenUnitsPerMillimeterDevice();
+    m_xformScale.setIdentity();
+    m_xformScale.scale(mm2sud, m_renderer->YPointsUp()? mm2sud : -mm2sud);
+
+    // parcels and points in screen space, for the layout benchmarks
+    for (size_t i=0; i<m_parcelGeoms.size(); ++i)
+    {
+        LineBuffer* src = m_parcelGeoms[i];
+        LineBuffer* dst = LineBufferPool::NewLineBuffer(&m_lbPool, src->point_count());
+        dst->SetGeometryType(src->geom_type());
+        for (int j=0; j<src->cntr_count(); ++j)
+        {
+            int start = src->contour_start_point(j);
+            int end = src->contour_end_point(j);
+            for (int k=start; k<=end; ++k)
+            {
+                double x, y;
+                m_w2s.transform(src->x_coord(k), src->y_coord(k), x, y);
+                if (k == start)
+                    dst->MoveTo(x, y);
+                else
+                    dst->LineTo(x, y);
+            }
+        }
+        m_screenParcels.push_back(dst);
+    }
+
+    LineBuffer lb(8);
+    m_points->Reset();
+    while (m_points->ReadNext())
+    {
+        lb.Reset();
+        if (m_points->GetGeometry(L"Geometry", &lb, NULL) && lb.point_count() > 0)
+        {
+            RS_F_Point pt;
+            m_w2s.transform(lb.x_coord(0), lb.y_coord(0), pt.x, pt.y);
+            m_screenPoints.push_back(pt);
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::Teardown()
+{
+    for (size_t i=0; i<m_roadGeoms.size(); ++i)
+        LineBufferPool::FreeLineBuffer(&m_lbPool, m_roadGeoms[i]);
+    for (size_t i=0; i<m_parcelGeoms.size(); ++i)
+        LineBufferPool::FreeLineBuffer(&m_lbPool, m_parcelGeoms[i]);
+    for (size_t i=0; i<m_pointGeoms.size(); ++i)
+        LineBufferPool::FreeLineBuffer(&m_lbPool, m_pointGeoms[i]);
+    for (size_t i=0; i<m_screenParcels.size(); ++i)
+        LineBufferPool::FreeLineBuffer(&m_lbPool, m_screenParcels[i]);
+    m_roadGeoms.clear();
+    m_parcelGeoms.clear();
+    m_pointGeoms.clear();
+    m_screenParcels.clear();
+    m_screenPoints.clear();
+
+    delete m_stylizer;
+    // SE_Evaluator has no virtual destructor
+    delete static_cast<BenchmarkEvaluator*>(m_eval);
+    delete m_renderer;
+    delete m_roads;
+    delete m_parcels;
+    delete m_points;
+
+    m_stylizer = NULL;
+    m_eval = NULL;
+    m_renderer = NULL;
+    m_roads = NULL;
+    m_parcels = NULL;
+    m_points = NULL;
+    m_size = 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::DecodeAll(RS_MemoryFeatureReader* reader, std::vector<LineBuffer*>& geoms, double& vertices)
+{
+    vertices = 0.0;
+
+    reader->Reset();
+    while (reader->ReadNext())
+    {
+        LineBuffer* lb = LineBufferPool::NewLineBuffer(&m_lbPool, 16);
+        reader->GetGeometry(L"Geometry", lb, NULL);
+        vertices += lb->point_count();
+        geoms.push_back(lb);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Returns a new reader with the geometries whose bounds intersect the
+// extents, and an identity property.
+RS_MemoryFeatureReader* StylizationBenchmark::CreateSubset(const std::vector<LineBuffer*>& geoms, const RS_Bounds& extents)
+{
+    RS_MemoryFeatureReader* reader = new RS_MemoryFeatureReader();
+    int idProp = reader->AddProperty(L"ID", RS_MemoryFeatureReader::PropertyType_Int32, true);
+    int geomProp = reader->AddProperty(L"Geometry", RS_MemoryFeatureReader::PropertyType_Geometry);
+
+    for (size_t i=0; i<geoms.size(); ++i)
+    {
+        const RS_Bounds& b = geoms[i]->bounds();
+        if (b.maxx < extents.minx || b.minx > extents.maxx || b.maxy < extents.miny || b.miny > extents.maxy)
+            continue;
+
+        reader->AddFeature();
+        reader->SetInt32(idProp, (int)i);
+        reader->SetGeometry(geomProp, geoms[i]);
+    }
+
+    return reader;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Converts the symbolization, which is deleted, and returns its first
+// style.  The converted instances are added to the supplied list.
+SE_Style* StylizationBenchmark::ConvertStyle(CompositeSymbolization* symbolization, std::vector<SE_SymbolInstance*>& instances)
+{
+    SE_StyleVisitor visitor(NULL, &m_sePool);
+
+    size_t first = instances.size();
+    visitor.Convert(instances, symbolization);
+    delete symbolization;
+
+    // the label instance, if there is one, comes last
+    SE_Style* style = NULL;
+    for (size_t i=instances.size(); i>first; --i)
+    {
+        if (!instances[i-1]->styles.empty())
+            style = instances[i-1]->styles[0];
+    }
+
+    if (style)
+        EvaluateStyle(style);
+
+    return style;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::EvaluateStyle(SE_Style* style)
+{
+    SE_EvalContext evalCtx;
+    evalCtx.fonte = &m_fontEngine;
+    evalCtx.xform = &m_xformScale;
+    evalCtx.eval = m_eval;
+    evalCtx.resources = NULL;
+    evalCtx.mm2su = m_renderer->GetScreenUnitsPerMillimeterDevice();
+    evalCtx.mm2sud = evalCtx.mm2su;
+    evalCtx.mm2suw = m_renderer->GetScreenUnitsPerMillimeterWorld();
+    evalCtx.px2su = m_renderer->GetScreenUnitsPerPixel();
+    evalCtx.pool = &m_sePool;
+    evalCtx.arena = NULL;
+
+    style->reset();
+    style->evaluate(&evalCtx);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// A 2mm square marker, optionally with a label drawn after the features
+// and, for the batching check, a frame and an underline around its text.
+CompositeSymbolization* StylizationBenchmark::CreatePointSymbolization(bool withLabel, bool framedLabel)
+{
+    CompositeSymbolization* symbolization = new CompositeSymbolization();
+
+    Path* path = new Path();
+    path->SetGeometry(L"M -1,-1 L 1,-1 L 1,1 L -1,1 Z");
+    path->SetFillColor(L"ff4080c0");
+    path->SetLineColor(L"ff000000");
+    path->SetLineWeight(L"0.25");
+
+    SimpleSymbolDefinition* marker = new SimpleSymbolDefinition();
+    marker->SetName(L"Marker");
+    marker->GetGraphics()->Adopt(path);
+    marker->AdoptPointUsage(new PointUsage());
+
+    SymbolInstance* instance = new SymbolInstance();
+    instance->AdoptSymbolDefinition(marker);
+    symbolization->GetSymbolCollection()->Adopt(instance);
+
+    if (withLabel)
+    {
+        Text* text = new Text();
+        text->SetContent(L"'Label'");
+        text->SetHeight(L"2.5");
+        text->SetPositionY(L"3");
+
+        SimpleSymbolDefinition* label = new SimpleSymbolDefinition();
+        label->SetName(L"Label");
+
+        // the frame is drawn under the text
+        if (framedLabel)
+        {
+            Path* frame = new Path();
+            frame->SetGeometry(L"M -6,1.5 L 6,1.5 L 6,4.5 L -6,4.5 Z");
+            frame->SetFillColor(L"ffffffe0");
+            frame->SetLineColor(L"ff606060");
+            frame->SetLineWeight(L"0.25");
+            label->GetGraphics()->Adopt(frame);
+        }
+
+        label->GetGraphics()->Adopt(text);
+
+        // and underlined
+        if (framedLabel)
+        {
+            Path* underline = new Path();
+            underline->SetGeometry(L"M -5,2 L 5,2");
+            underline->SetLineColor(L"ffc04040");
+            underline->SetLineWeight(L"0.35");
+            label->GetGraphics()->Adopt(underline);
+        }
+        label->AdoptPointUsage(new PointUsage());
+
+        instance = new SymbolInstance();
+        instance->AdoptSymbolDefinition(label);
+        instance->SetDrawLast(L"true");
+        instance->SetCheckExclusionRegion(L"true");
+        instance->SetAddToExclusionRegion(L"true");
+        symbolization->GetSymbolCollection()->Adopt(instance);
+    }
+
+    return symbolization;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// A 5mm dash repeated every 10mm.
+CompositeSymbolization* StylizationBenchmark::CreateLineSymbolization(const wchar_t* vertexControl)
+{
+    Path* path = new Path();
+    path->SetGeometry(L"M 0,0 L 5,0");
+    path->SetLineColor(L"ff202020");
+    path->SetLineWeight(L"0.5");
+
+    LineUsage* usage = new LineUsage();
+    usage->SetRepeat(L"10");
+    usage->SetVertexControl(vertexControl);
+
+    SimpleSymbolDefinition* dash = new SimpleSymbolDefinition();
+    dash->SetName(L"Dash");
+    dash->GetGraphics()->Adopt(path);
+    dash->AdoptLineUsage(usage);
+
+    SymbolInstance* instance = new SymbolInstance();
+    instance->AdoptSymbolDefinition(dash);
+
+    CompositeSymbolization* symbolization = new CompositeSymbolization();
+    symbolization->GetSymbolCollection()->Adopt(instance);
+    return symbolization;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// A 1mm square hatch on a 5mm grid.
+CompositeSymbolization* StylizationBenchmark::CreateAreaSymbolization()
+{
+    Path* path = new Path();
+    path->SetGeometry(L"M 0,0 L 1,0 L 1,1 L 0,1 Z");
+    path->SetFillColor(L"ff80a040");
+
+    AreaUsage* usage = new AreaUsage();
+    usage->SetRepeatX(L"5");
+    usage->SetRepeatY(L"5");
+
+    SimpleSymbolDefinition* hatch = new SimpleSymbolDefinition();
+    hatch->SetName(L"Hatch");
+    hatch->GetGraphics()->Adopt(path);
+    hatch->AdoptAreaUsage(usage);
+
+    SymbolInstance* instance = new SymbolInstance();
+    instance->AdoptSymbolDefinition(hatch);
+
+    CompositeSymbolization* symbolization = new CompositeSymbolization();
+    symbolization->GetSymbolCollection()->Adopt(instance);
+    return symbolization;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// A layer with a single composite style, which adopts the symbolization.
+VectorLayerDefinition* StylizationBenchmark::CreateLayer(CompositeSymbolization* symbolization)
+{
+    CompositeRule* rule = new CompositeRule();
+    rule->AdoptSymbolization(symbolization);
+
+    CompositeTypeStyle* style = new CompositeTypeStyle();
+    style->GetRules()->Adopt(rule);
+
+    VectorScaleRange* range = new VectorScaleRange();
+    range->GetFeatureTypeStyles()->Adopt(style);
+
+    VectorLayerDefinition* layer = new VectorLayerDefinition(L"Library://Benchmark.FeatureSource", L"Benchmark:Features");
+    layer->SetGeometry(L"Geometry");
+    layer->GetScaleRanges()->Adopt(range);
+    return layer;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchLoadFromAgf(Counts& counts)
+{
+    LineBuffer* lb = LineBufferPool::NewLineBuffer(&m_lbPool, 16);
+    RS_MemoryFeatureReader* readers[2] = { m_roads, m_parcels };
+
+    counts.features = counts.vertices = counts.labels = 0.0;
+    for (int i=0; i<2; ++i)
+    {
+        readers[i]->Reset();
+        while (readers[i]->ReadNext())
+        {
+            lb->Reset();
+            readers[i]->GetGeometry(L"Geometry", lb, NULL);
+            counts.features += 1.0;
+            counts.vertices += lb->point_count();
+        }
+    }
+
+    LineBufferPool::FreeLineBuffer(&m_lbPool, lb);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchClip(Counts& counts)
+{
+    // the central quarter of the map cuts through the towns
+    RS_Bounds clip(0.25 * BENCHMARK_EXTENT, 0.25 * BENCHMARK_EXTENT, 0.75 * BENCHMARK_EXTENT, 0.75 * BENCHMARK_EXTENT);
+
+    for (size_t i=0; i<m_parcelGeoms.size(); ++i)
+    {
+        LineBuffer* res = m_parcelGeoms[i]->Clip(clip, LineBuffer::ctArea, &m_lbPool);
+        if (res && res != m_parcelGeoms[i])
+            LineBufferPool::FreeLineBuffer(&m_lbPool, res);
+    }
+
+    for (size_t i=0; i<m_roadGeoms.size(); ++i)
+    {
+        LineBuffer* res = m_roadGeoms[i]->Clip(clip, LineBuffer::ctLine, &m_lbPool);
+        if (res && res != m_roadGeoms[i])
+            LineBufferPool::FreeLineBuffer(&m_lbPool, res);
+    }
+
+    counts.features = (double)(m_parcelGeoms.size() + m_roadGeoms.size());
+    counts.vertices = m_parcelVertices + m_roadVertices;
+    counts.labels = 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchOptimize(Counts& counts)
+{
+    double drawingScale = m_renderer->GetDrawingScale();
+
+    for (size_t i=0; i<m_roadGeoms.size(); ++i)
+    {
+        LineBuffer* res = m_roadGeoms[i]->Optimize(drawingScale, &m_lbPool);
+        if (res && res != m_roadGeoms[i])
+            LineBufferPool::FreeLineBuffer(&m_lbPool, res);
+    }
+
+    counts.features = (double)m_roadGeoms.size();
+    counts.vertices = m_roadVertices;
+    counts.labels = 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchCentroid(Counts& counts)
+{
+    double x, y, slope;
+
+    for (size_t i=0; i<m_parcelGeoms.size(); ++i)
+        m_parcelGeoms[i]->Centroid(LineBuffer::ctArea, &x, &y, &slope);
+
+    for (size_t i=0; i<m_roadGeoms.size(); ++i)
+        m_roadGeoms[i]->Centroid(LineBuffer::ctLine, &x, &y, &slope);
+
+    counts.features = (double)(m_parcelGeoms.size() + m_roadGeoms.size());
+    counts.vertices = m_parcelVertices + m_roadVertices;
+    counts.labels = 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchTransform(Counts& counts)
+{
+    SE_LineBuffer* selb = SE_BufferPool::NewSELineBuffer(&m_sePool, 16);
+
+    for (size_t i=0; i<m_roadGeoms.size(); ++i)
+    {
+        selb->Reset();
+        selb->SetGeometry(m_roadGeoms[i]);
+        selb->Transform(m_w2s, 0.25);
+    }
+
+    SE_BufferPool::FreeSELineBuffer(&m_sePool, selb);
+
+    counts.features = (double)m_roadGeoms.size();
+    counts.vertices = m_roadVertices;
+    counts.labels = 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchEvaluate(Counts& counts)
+{
+    // evaluate once per feature, as for a style that isn't cacheable
+    for (int i=0; i<m_size; ++i)
+        EvaluateStyle(m_style);
+
+    counts.features = (double)m_size;
+    counts.vertices = 0.0;
+    counts.labels = 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchProcessLine(Counts& counts)
+{
+    SE_ApplyContext applyCtx;
+    applyCtx.pathMeasure = NULL;
+    applyCtx.renderer = m_renderer;
+    applyCtx.xform = &m_w2s;
+    applyCtx.sizeContext = MdfModel::DeviceUnits;
+
+    SE_RenderLineStyle* style = (SE_RenderLineStyle*)m_style->rstyle;
+    for (size_t i=0; i<m_roadGeoms.size(); ++i)
+    {
+        applyCtx.geometry = m_roadGeoms[i];
+        m_renderer->ProcessLine(&applyCtx, style);
+    }
+
+    // don't let the recording grow across iterations
+    m_renderer->GetDisplayList().Clear();
+
+    counts.features = (double)m_roadGeoms.size();
+    counts.vertices = m_roadVertices;
+    counts.labels = 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchAreaPositioning(Counts& counts)
+{
+    SE_RenderAreaStyle* style = (SE_RenderAreaStyle*)m_style->rstyle;
+
+    for (size_t i=0; i<m_screenParcels.size(); ++i)
+    {
+        SE_AreaPositioning ap(m_screenParcels[i], style, 0.0);
+        while (ap.NextLocation() != NULL)
+            ;
+    }
+
+    counts.features = (double)m_screenParcels.size();
+    counts.vertices = m_parcelVertices;
+    counts.labels = 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchBlastLabels(Counts& counts)
+{
+    LabelRendererLocal labeler(m_renderer, 0.0);
+    labeler.StartLabels();
+
+    // the label groups take their feature bounds from the path
+    LineBuffer path(1);
+
+    for (size_t i=0; i<m_screenPoints.size(); ++i)
+    {
+        path.Reset();
+        path.MoveTo(m_screenPoints[i].x, m_screenPoints[i].y);
+
+        SE_RenderStyle* style = m_renderer->CloneRenderStyle(m_style->rstyle);
+        SE_LabelInfo info(m_screenPoints[i].x, m_screenPoints[i].y, RS_Units_Device, 0.0, style);
+        labeler.ProcessLabelGroup(&info, 1, RS_OverpostType_AllFit, true, &path);
+    }
+
+    labeler.BlastLabels();
+    m_renderer->GetDisplayList().Clear();
+
+    counts.features = 0.0;
+    counts.vertices = 0.0;
+    counts.labels = (double)m_screenPoints.size();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchBIDIConverter(Counts& counts)
+{
+    BIDIConverter converter;
+    std::vector<DisplayStr> strings(BIDI_STRINGS, BIDI_STRINGS + COUNTOF(BIDI_STRINGS));
+
+    for (int i=0; i<m_size; ++i)
+        converter.ConvertString(strings[i % strings.size()]);
+
+    counts.features = 0.0;
+    counts.vertices = 0.0;
+    counts.labels = (double)m_size;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchRichText(Counts& counts)
+{
+    RS_TextDef tdef;
+    tdef.markup() = L"MText";
+    tdef.font().name() = L"Arial";
+    tdef.font().height() = 0.003;
+    tdef.font().units() = RS_Units_Device;
+
+    std::vector<RS_String> strings(MTEXT_STRINGS, MTEXT_STRINGS + COUNTOF(MTEXT_STRINGS));
+
+    for (int i=0; i<m_size; ++i)
+    {
+        RS_TextMetrics tm;
+        RichTextEngine engine(m_renderer, &m_fontEngine, &tdef);
+        engine.Parse(strings[i % strings.size()], &tm);
+    }
+
+    counts.features = 0.0;
+    counts.vertices = 0.0;
+    counts.labels = (double)m_size;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchStylizeLayer(Counts& counts)
+{
+    m_reader->Reset();
+    m_stylizer->StylizeVectorLayer(m_layer, m_renderer, m_reader, NULL, m_mapScale, NULL, NULL);
+    m_renderer->GetDisplayList().Clear();
+
+    counts.features = (double)m_reader->GetFeatureCount();
+    counts.vertices = (m_reader == m_roads)? m_roadVertices : (m_reader == m_parcels)? m_parcelVertices : counts.features;
+    counts.labels = (m_reader == m_points)? counts.features : 0.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchTiles(Counts& counts)
+{
+    RenderTiles(1, counts);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationBenchmark::BenchMetatiles(Counts& counts)
+{
+    RenderTiles(m_metatileSize, counts);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Renders every tile of a street map covering the workload extents, with
+// roads and labeled points, in blocks of metatileSize x metatileSize tiles.
+// Each block reads the features in its extents plus the label buffer, as a
+// tile server would query them, and the tiles are then sliced from the
+// block's image.  The counts are the features and labels read, so the
+// buffer zones read more than once show up in them.
+void StylizationBenchmark::RenderTiles(int metatileSize, Counts& counts)
+{
+    metatileSize = rs_max(metatileSize, 1);
+
+    double dpi = 96.0;
+    double tileExtent = BENCHMARK_EXTENT / BENCHMARK_TILE_GRID;
+    double mapScale = tileExtent / (BENCHMARK_TILE_SIZE * METERS_PER_INCH / dpi);
+    double offset = BENCHMARK_TILE_OFFSET * tileExtent;
+    int blocks = (BENCHMARK_TILE_GRID + metatileSize - 1) / metatileSize;
+
+    counts.features = 0.0;
+    counts.vertices = 0.0;
+    counts.labels = 0.0;
+
+    RS_Color bgColor(255, 255, 255, 0);
+    std::vector<unsigned int> tile;
+
+    for (int by=0; by<blocks; ++by)
+    {
+        for (int bx=0; bx<blocks; ++bx)
+        {
+            // rows go down from the top of the extents
+            double minx = bx * metatileSize * tileExtent;
+            double maxy = BENCHMARK_EXTENT - by * metatileSize * tileExtent;
+            RS_Bounds extents(minx, maxy - metatileSize * tileExtent, minx + metatileSize * tileExtent, maxy);
+            RS_Bounds request(extents.minx - offset, extents.miny - offset, extents.maxx + offset, extents.maxy + offset);
+
+            std::auto_ptr<RS_MemoryFeatureReader> roads(CreateSubset(m_roadGeoms, request));
+            std::auto_ptr<RS_MemoryFeatureReader> points(CreateSubset(m_pointGeoms, request));
+
+            // rasterize on this thread, like the rest of the benchmarks
+            SE_MetatileRenderer renderer(BENCHMARK_TILE_SIZE, BENCHMARK_TILE_SIZE, metatileSize, bgColor, BENCHMARK_TILE_OFFSET);
+            renderer.SetNumThreads(1);
+
+            renderer.StartMap(NULL, extents, mapScale, dpi, 1.0, NULL);
+            renderer.StartLayer(NULL, NULL);
+            m_stylizer->StylizeVectorLayer(m_layer, &renderer, roads.get(), NULL, mapScale, NULL, NULL);
+            renderer.EndLayer();
+            renderer.StartLayer(NULL, NULL);
+            m_stylizer->StylizeVectorLayer(m_labelLayer, &renderer, points.get(), NULL, mapScale, NULL, NULL);
+            renderer.EndLayer();
+            renderer.EndMap();
+
+            for (int row=0; row<metatileSize && by*metatileSize + row < BENCHMARK_TILE_GRID; ++row)
+            {
+                for (int col=0; col<metatileSize && bx*metatileSize + col < BENCHMARK_TILE_GRID; ++col)
+                    renderer.GetTile(col, row, tile);
+            }
+
+            counts.features += roads->GetFeatureCount() + points->GetFeatureCount();
+            counts.labels += points->GetFeatureCount();
+        }
+    }
+}
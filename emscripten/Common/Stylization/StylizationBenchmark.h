@@ -0,0 +1,199 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef STYLIZATIONBENCHMARK_H_
+#define STYLIZATIONBENCHMARK_H_
+
+#include "LineBuffer.h"
+#include "SE_BufferPool.h"
+#include "SE_ImageRenderer.h"
+#include <vector>
+#include <string>
+
+class RS_MemoryFeatureReader;
+class SE_RecordingRenderer;
+class SE_Evaluator;
+class DefaultStylizer;
+struct SE_SymbolInstance;
+struct SE_Style;
+
+namespace MdfModel
+{
+    class CompositeSymbolization;
+    class VectorLayerDefinition;
+}
+
+
+//---------------------------------------------
+// Times the stylization hot paths against synthetic workloads from
+// RS_WorkloadGenerator, at several workload sizes.  The suite covers
+// geometry decoding and processing, style evaluation, line and area symbol
+// layout, label placement, text processing, complete composite layers
+// stylized into an SE_RecordingRenderer, and a tiled street map rendered
+// one tile at a time and in metatiles.
+//
+// Each benchmark is repeated until a minimum time has elapsed, and reports
+// its throughput in features, vertices and labels per second.  A host which
+// tracks allocations (e.g. by replacing operator new) can supply a counter
+// to have allocations per feature reported as well.
+//
+// The suite isn't part of the library - it is built into the
+// StylizationBenchmark program (see StylizationBenchmarkMain.cpp).
+//---------------------------------------------
+
+class StylizationBenchmark
+{
+public:
+    struct Result
+    {
+        std::string name;
+        int size;
+        int iterations;
+        double seconds;         // per iteration
+        double features;        // per iteration
+        double vertices;        // per iteration
+        double labels;          // per iteration
+        double allocations;     // per iteration, or -1 if not counted
+    };
+
+    // returns the number of allocations made so far
+    typedef unsigned long long (*AllocationCounter)();
+
+    StylizationBenchmark();
+    ~StylizationBenchmark();
+
+    // the workload sizes, in features - the default is 1000 and 10000
+    void SetSizes(const std::vector<int>& sizes);
+
+    // the minimum time to spend on each benchmark, in seconds
+    inline void SetMinTime(double seconds) { m_minTime = seconds; }
+
+    inline void SetAllocationCounter(AllocationCounter counter) { m_allocCounter = counter; }
+
+    // the metatile size used by the tiled map benchmark, in tiles per side -
+    // the default is 4
+    inline void SetMetatileSize(int size) { m_metatileSize = size; }
+
+    // Runs the benchmarks whose names start with the supplied filter, or
+    // all of them if it is NULL.  The results are added to any existing
+    // results.
+    void Run(const char* filter = NULL);
+
+    inline const std::vector<Result>& GetResults() const { return m_results; }
+    inline void ClearResults() { m_results.clear(); }
+
+    // Writes the results as a JSON array with one object per result.
+    void WriteJson(std::string& json) const;
+
+    // A concurrency stress test.  Renders a set of layers serially, then
+    // renders them again from numThreads threads at once, each render with
+    // its own stylizer and renderer but sharing the layer definitions, and
+    // compares every image with its serial one.  Returns the number of
+    // renders which didn't match.  Run under ThreadSanitizer to check the
+    // library for data races.  Without thread support the renders are
+    // repeated on the calling thread.
+    static int RunStress(int numThreads, int rendersPerThread);
+
+    // A draw batching check.  Renders a road layer and a layer of points
+    // with framed and underlined labels without batching, then with each
+    // batching mode (see SE_Renderer::SetDrawBatching).  Returns the number
+    // of pixels which differ from the unbatched images.
+    static int RunBatchingCheck();
+
+private:
+    struct Counts
+    {
+        double features;
+        double vertices;
+        double labels;
+    };
+
+    typedef void (StylizationBenchmark::*Body)(Counts& counts);
+
+    void Setup(int size);
+    void Teardown();
+    void Measure(const char* name, Body body);
+
+    void DecodeAll(RS_MemoryFeatureReader* reader, std::vector<LineBuffer*>& geoms, double& vertices);
+    SE_Style* ConvertStyle(MdfModel::CompositeSymbolization* symbolization, std::vector<SE_SymbolInstance*>& instances);
+    void EvaluateStyle(SE_Style* style);
+
+    static MdfModel::CompositeSymbolization* CreatePointSymbolization(bool withLabel, bool framedLabel = false);
+    static MdfModel::CompositeSymbolization* CreateLineSymbolization(const wchar_t* vertexControl);
+    static MdfModel::CompositeSymbolization* CreateAreaSymbolization();
+    static MdfModel::VectorLayerDefinition* CreateLayer(MdfModel::CompositeSymbolization* symbolization);
+    static RS_MemoryFeatureReader* CreateSubset(const std::vector<LineBuffer*>& geoms, const RS_Bounds& extents);
+    void RenderTiles(int metatileSize, Counts& counts);
+
+    // the benchmarks
+    void BenchLoadFromAgf(Counts& counts);
+    void BenchClip(Counts& counts);
+    void BenchOptimize(Counts& counts);
+    void BenchCentroid(Counts& counts);
+    void BenchTransform(Counts& counts);
+    void BenchEvaluate(Counts& counts);
+    void BenchProcessLine(Counts& counts);
+    void BenchAreaPositioning(Counts& counts);
+    void BenchBlastLabels(Counts& counts);
+    void BenchBIDIConverter(Counts& counts);
+    void BenchRichText(Counts& counts);
+    void BenchStylizeLayer(Counts& counts);
+    void BenchTiles(Counts& counts);
+    void BenchMetatiles(Counts& counts);
+
+    // settings
+    std::vector<int> m_sizes;
+    double m_minTime;
+    AllocationCounter m_allocCounter;
+    int m_metatileSize;
+    const char* m_filter;
+
+    // the current workload
+    int m_size;
+    RS_MemoryFeatureReader* m_roads;
+    RS_MemoryFeatureReader* m_parcels;
+    RS_MemoryFeatureReader* m_points;
+    std::vector<LineBuffer*> m_roadGeoms;
+    std::vector<LineBuffer*> m_parcelGeoms;
+    std::vector<LineBuffer*> m_pointGeoms;
+    std::vector<LineBuffer*> m_screenParcels;
+    std::vector<RS_F_Point> m_screenPoints;
+    double m_roadVertices;
+    double m_parcelVertices;
+    RS_Bounds m_extents;
+    double m_mapScale;
+
+    // rendering state
+    SE_ImageFontEngine m_fontEngine;
+    SE_RecordingRenderer* m_renderer;
+    SE_Evaluator* m_eval;
+    DefaultStylizer* m_stylizer;
+    LineBufferPool m_lbPool;
+    SE_BufferPool m_sePool;
+    SE_Matrix m_xformScale;
+    SE_Matrix m_w2s;
+
+    // the parameters of the benchmark being run
+    SE_Style* m_style;
+    RS_MemoryFeatureReader* m_reader;
+    MdfModel::VectorLayerDefinition* m_layer;
+    MdfModel::VectorLayerDefinition* m_labelLayer;
+
+    std::vector<Result> m_results;
+};
+
+#endif
@@ -0,0 +1,203 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+// The StylizationBenchmark program.  Runs the StylizationBenchmark suite at
+// several workload sizes and writes the results as JSON, with allocations
+// per feature counted by replacing the global operator new.
+//
+// Usage: StylizationBenchmark [options]
+//   -sizes n,n,...   the workload sizes, in features (1000,10000,100000)
+//   -filter prefix   only run the benchmarks whose names start with prefix
+//   -mintime s       the minimum time to spend on each benchmark (0.5)
+//   -metatile n      the metatile size, in tiles per side (4)
+//   -out file        write the JSON to file rather than stdout
+//   -stress n        also run the concurrency stress test on n threads
+//   -batching        also run the draw batching check
+
+#include "stdafx.h"
+#include "StylizationBenchmark.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// the number of allocations made so far
+static std::atomic<unsigned long long> s_allocations(0);
+
+
+//////////////////////////////////////////////////////////////////////////////
+// The replaced allocation functions.  The nothrow and sized forms call
+// these by default, so every allocation through new is counted.
+void* operator new(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* ptr = malloc(size? size : 1);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static unsigned long long GetAllocationCount()
+{
+    return s_allocations.load(std::memory_order_relaxed);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Parses a comma separated list of positive sizes.  Returns false if the
+// list is malformed.
+static bool ParseSizes(const char* str, std::vector<int>& sizes)
+{
+    sizes.clear();
+
+    while (*str)
+    {
+        char* end = NULL;
+        long size = strtol(str, &end, 10);
+        if (end == str || size <= 0 || (*end != ',' && *end != '\0'))
+            return false;
+
+        sizes.push_back((int)size);
+        str = (*end == ',')? end + 1 : end;
+    }
+
+    return !sizes.empty();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+static int Usage()
+{
+    fprintf(stderr,
+        "Usage: StylizationBenchmark [-sizes n,n,...] [-filter prefix] [-mintime s]\n"
+        "                            [-metatile n] [-out file] [-stress n] [-batching]\n");
+    return 2;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    std::vector<int> sizes;
+    sizes.push_back(1000);
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+
+    const char* filter = NULL;
+    const char* outFile = NULL;
+    double minTime = 0.5;
+    int metatileSize = 4;
+    int stressThreads = 0;
+    bool batching = false;
+
+    for (int i=1; i<argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc)? argv[i+1] : NULL;
+
+        if (strcmp(arg, "-batching") == 0)
+        {
+            batching = true;
+            continue;
+        }
+
+        // the remaining options all take a value
+        if (value == NULL)
+            return Usage();
+        ++i;
+
+        if (strcmp(arg, "-sizes") == 0)
+        {
+            if (!ParseSizes(value, sizes))
+                return Usage();
+        }
+        else if (strcmp(arg, "-filter") == 0)
+            filter = value;
+        else if (strcmp(arg, "-mintime") == 0)
+            minTime = atof(value);
+        else if (strcmp(arg, "-metatile") == 0)
+            metatileSize = rs_max(1, atoi(value));
+        else if (strcmp(arg, "-out") == 0)
+            outFile = value;
+        else if (strcmp(arg, "-stress") == 0)
+            stressThreads = rs_max(1, atoi(value));
+        else
+            return Usage();
+    }
+
+    int failures = 0;
+
+    if (stressThreads > 0)
+    {
+        int mismatches = StylizationBenchmark::RunStress(stressThreads, 4);
+        fprintf(stderr, "stress test: %d mismatched renders\n", mismatches);
+        failures += mismatches;
+    }
+
+    if (batching)
+    {
+        int diffs = StylizationBenchmark::RunBatchingCheck();
+        fprintf(stderr, "batching check: %d differing pixels\n", diffs);
+        failures += diffs;
+    }
+
+    StylizationBenchmark benchmark;
+    benchmark.SetSizes(sizes);
+    benchmark.SetMinTime(minTime);
+    benchmark.SetMetatileSize(metatileSize);
+    benchmark.SetAllocationCounter(GetAllocationCount);
+    benchmark.Run(filter);
+
+    std::string json;
+    benchmark.WriteJson(json);
+
+    FILE* out = outFile? fopen(outFile, "w") : stdout;
+    if (out == NULL)
+    {
+        fprintf(stderr, "can't write %s\n", outFile);
+        return 1;
+    }
+
+    fwrite(json.data(), 1, json.size(), out);
+    if (out != stdout)
+        fclose(out);
+
+    return (failures == 0)? 0 : 1;
+}
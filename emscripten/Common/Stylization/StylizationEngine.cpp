@@ -24,10 +24,15 @@
 #include "SE_PositioningAlgorithms.h"
 #include "SE_SymbolDefProxies.h"
 #include "FeatureTypeStyleVisitor.h"
+#include "StylizationProfiler.h"
+#include "StylizationTrace.h"
+#include "FeatureCuller.h"
 #ifndef EMSCRIPTEN
 #include "FdoEvaluator.h"
+typedef FdoEvaluator LayerEvaluator;
 #else
 #include "../Emscripten/EmEvaluator.h"
+typedef EmEvaluator LayerEvaluator;
 #endif
 
 #include <algorithm>
@@ -39,11 +44,17 @@
 
 using namespace MDFMODEL_NAMESPACE;
 
+// the number of converted watermarks kept across requests
+static const size_t MAX_CACHED_WATERMARKS = 16;
+
 StylizationEngine::StylizationEngine(SE_SymbolManager* resources, SE_BufferPool* pool) :
     m_resources(resources),
     m_pool(pool),
     m_serenderer(NULL),
-    m_reader(NULL)
+    m_reader(NULL),
+    m_culler(NULL),
+    m_targets(NULL),
+    m_ruleGroup(0)
 {
     m_visitor = new SE_StyleVisitor(resources, m_pool);
 }
@@ -52,6 +63,7 @@ StylizationEngine::StylizationEngine(SE_SymbolManager* resources, SE_BufferPool*
 StylizationEngine::~StylizationEngine()
 {
     ClearCache();
+    ClearWatermarkCache();
     delete m_visitor;
 }
 
@@ -66,10 +78,23 @@ void StylizationEngine::StylizeVectorLayer(MdfModel::VectorLayerDefinition* laye
                                            CancelStylization                cancel,
                                            void*                            userData)
 {
-    if (reader == NULL)
+    std::vector<MdfModel::VectorScaleRange*> ranges(1, range);
+    std::vector<SE_Renderer*> renderers(1, se_renderer);
+    StylizeVectorLayer(layer, ranges, renderers, reader, xformer, cancel, userData);
+}
+
+
+void StylizationEngine::StylizeVectorLayer(MdfModel::VectorLayerDefinition*               layer,
+                                           const std::vector<MdfModel::VectorScaleRange*>& ranges,
+                                           const std::vector<SE_Renderer*>&                renderers,
+                                           RS_FeatureReader*                               reader,
+                                           CSysTransformer*                                xformer,
+                                           CancelStylization                               cancel,
+                                           void*                                           userData)
+{
+    if (reader == NULL || renderers.empty())
         return;
 
-    m_serenderer = se_renderer;
     m_reader = reader;
 
     // get the geometry column name
@@ -77,72 +102,115 @@ void StylizationEngine::StylizeVectorLayer(MdfModel::VectorLayerDefinition* laye
     if (NULL == gpName)
         return;
 
-    double drawingScale = m_serenderer->GetDrawingScale();
+    // group the renderers which share a scale range and a scale - these
+    // select rules and evaluate styles together
+    std::vector<TargetGroup> groups;
+    bool supportsTooltips = false;
+    bool supportsHyperlinks = false;
+    bool ignoreZ = true;
+    for (size_t i=0; i<renderers.size(); ++i)
+    {
+        SE_Renderer* se_renderer = renderers[i];
+        supportsTooltips |= se_renderer->SupportsTooltips();
+        supportsHyperlinks |= se_renderer->SupportsHyperlinks();
+
+        // ignore Z values if no renderer needs them
+        ignoreZ &= !se_renderer->SupportsZ();
+
+        size_t g = 0;
+        for (; g<groups.size(); ++g)
+        {
+            if (groups[g].range == ranges[i] && SameScale(groups[g].renderers[0], se_renderer))
+                break;
+        }
+
+        if (g == groups.size())
+        {
+            TargetGroup group;
+            group.range = ranges[i];
+            groups.push_back(group);
+        }
+
+        groups[g].renderers.push_back(se_renderer);
+    }
+
+    // extract all the composite styles of each group once
+    for (size_t g=0; g<groups.size(); ++g)
+    {
+        TargetGroup& group = groups[g];
+
+        MdfModel::FeatureTypeStyleCollection* ftsc = group.range->GetFeatureTypeStyles();
+        for (int i=0; i<ftsc->GetCount(); ++i)
+        {
+            MdfModel::FeatureTypeStyle* fts = ftsc->GetAt(i);
+            if (FeatureTypeStyleVisitor::DetermineFeatureTypeStyle(fts) == FeatureTypeStyleVisitor::ftsComposite)
+                group.styles.push_back((CompositeTypeStyle*)fts);
+        }
+
+        _ASSERT(group.styles.size() > 0);
+
+        // we always start with rendering pass 0 - groups without styles
+        // have no passes
+        group.instanceRenderingPass = group.styles.empty()? -1 : 0;
+        group.symbolRenderingPass = 0;
+        group.nextInstanceRenderingPass = -1;
+        group.nextSymbolRenderingPass = -1;
+    }
 
     // get tooltip and url for the layer
     SE_String seTip;
     SE_String seUrl;
-    if (se_renderer->SupportsTooltips())
+    if (supportsTooltips)
         m_visitor->ParseStringExpression(layer->GetToolTip(), seTip, L"");
-    if (se_renderer->SupportsHyperlinks())
+    if (supportsHyperlinks)
         m_visitor->ParseStringExpression(layer->GetUrlData() ? layer->GetUrlData()->GetUrlContent(): L"", seUrl, L"");
 
-    // extract all the composite styles once
-    MdfModel::FeatureTypeStyleCollection* ftsc = range->GetFeatureTypeStyles();
-    std::vector<CompositeTypeStyle*> compTypeStyles;
-    for (int i=0; i<ftsc->GetCount(); ++i)
-    {
-        MdfModel::FeatureTypeStyle* fts = ftsc->GetAt(i);
-        if (FeatureTypeStyleVisitor::DetermineFeatureTypeStyle(fts) == FeatureTypeStyleVisitor::ftsComposite)
-            compTypeStyles.push_back((CompositeTypeStyle*)fts);
-    }
-
-    size_t numTypeStyles = compTypeStyles.size();
-    _ASSERT(numTypeStyles > 0);
-    if (numTypeStyles == 0)
-        return;
-
-    // ignore Z values if the renderer doesn't need them
-    bool ignoreZ = !se_renderer->SupportsZ();
-
-    // we always start with rendering pass 0
-    int instanceRenderingPass = 0;
-    int symbolRenderingPass = 0;
-    int nextInstanceRenderingPass = -1;
-    int nextSymbolRenderingPass = -1;
+    StylizationProfiler* profiler = renderers[0]->GetProfiler();
 
     #ifdef _DEBUG
     int nFeatures = 0;
     #endif
 
-    // main loop over feature data
+    // main loop over feature data - each group has its own rendering passes,
+    // and the features are read until all groups are done
     int numPasses = 0;
-    while (instanceRenderingPass >= 0 && symbolRenderingPass >= 0)
+    std::vector<LayerEvaluator*> evals(groups.size());
+    while (true)
     {
+        bool active = false;
+        for (size_t g=0; g<groups.size(); ++g)
+            active |= groups[g].IsActive();
+        if (!active)
+            break;
+
         ++numPasses;
 
         // for all but the first pass we need to reset the reader
         if (numPasses > 1)
             reader->Reset();
 
-    #ifndef EMSCRIPTEN
-        // create an expression engine with our custom functions
-        // NOTE: We must create a new engine with each rendering pass.  The engine
+        // create an expression engine with our custom functions for each
+        // group
+        // NOTE: We must create new engines with each rendering pass.  The engine
         //       stores a weak reference to the RS_FeatureReader's internal
         //       FdoIFeatureReader, and this internal reader is different for each
         //       pass.
-        FdoEvaluator eval(se_renderer, reader);
-    #else
-        EmEvaluator eval(se_renderer, reader);
-    #endif
+        for (size_t g=0; g<groups.size(); ++g)
+            evals[g] = groups[g].IsActive()? new LayerEvaluator(groups[g].renderers[0], reader) : NULL;
 
-        while (reader->ReadNext())
+        StylizationTraceBatch traceBatch(256);
+        while (StylizationTraceReadNext(reader))
         {
             #ifdef _DEBUG
             if (numPasses == 1)
                 nFeatures++;
             #endif
 
+            traceBatch.Next();
+
+            if (profiler && numPasses == 1)
+                profiler->CountFeature();
+
             LineBuffer* lb = LineBufferPool::NewLineBuffer(m_pool, 8, Dimensionality_Z, ignoreZ);
             if (!lb)
                 continue;
@@ -150,13 +218,20 @@ void StylizationEngine::StylizeVectorLayer(MdfModel::VectorLayerDefinition* laye
             std::auto_ptr<LineBuffer> spLB(lb);
 
             // tell line buffer the current drawing scale (used for arc tessellation)
-            lb->SetDrawingScale(drawingScale);
+            lb->SetDrawingScale(groups[0].renderers[0]->GetDrawingScale());
+
+            // keep arcs as curves - they're tessellated when the geometry is
+            // clipped in Stylize, and only where they reach into the map
+            lb->SetStoreCurves(true);
 
         #ifndef EMSCRIPTEN
             try
             {
                 if (!reader->IsNull(gpName))
+                {
+                    StylizationTraceScope trace("DecodeGeometry", StylizationTrace::Features);
                     reader->GetGeometry(gpName, lb, xformer);
+                }
                 else
                 {
                     // just move on to the next feature
@@ -175,7 +250,10 @@ void StylizationEngine::StylizeVectorLayer(MdfModel::VectorLayerDefinition* laye
             try
             {
                 if (!reader->IsNull(gpName))
+                {
+                    StylizationTraceScope trace("DecodeGeometry", StylizationTrace::Features);
                     reader->GetGeometry(gpName, lb, xformer);
+                }
                 else
                 {
                     // just move on to the next feature
@@ -191,13 +269,35 @@ void StylizationEngine::StylizeVectorLayer(MdfModel::VectorLayerDefinition* laye
             }
         #endif
 
-            // stylize once for each composite type style
-            for (size_t i=0; i<numTypeStyles; ++i)
+            // skip features too small to see - their coverage is accumulated
+            // in the first pass only
+            if (m_culler && m_culler->Cull(lb, numPasses == 1))
             {
-                bool initialPass = (i == 0 && instanceRenderingPass == 0 && symbolRenderingPass == 0);
-                Stylize(reader, &eval, lb, compTypeStyles[i], &seTip, &seUrl, NULL,
-                        initialPass, instanceRenderingPass, symbolRenderingPass,
-                        nextInstanceRenderingPass, nextSymbolRenderingPass);
+                LineBufferPool::FreeLineBuffer(m_pool, spLB.release());
+                continue;
+            }
+
+            for (size_t g=0; g<groups.size(); ++g)
+            {
+                TargetGroup& group = groups[g];
+                if (!group.IsActive())
+                    continue;
+
+                m_serenderer = group.renderers[0];
+                m_targets = &group.renderers;
+                m_ruleGroup = (int)g;
+
+                // curves are tessellated for the group's scale
+                lb->SetDrawingScale(m_serenderer->GetDrawingScale());
+
+                // stylize once for each composite type style
+                for (size_t i=0; i<group.styles.size(); ++i)
+                {
+                    bool initialPass = (i == 0 && group.instanceRenderingPass == 0 && group.symbolRenderingPass == 0);
+                    Stylize(reader, evals[g], lb, group.styles[i], &seTip, &seUrl, NULL,
+                            initialPass, group.instanceRenderingPass, group.symbolRenderingPass,
+                            group.nextInstanceRenderingPass, group.nextSymbolRenderingPass);
+                }
             }
 
             // free geometry when done stylizing
@@ -207,30 +307,61 @@ void StylizationEngine::StylizeVectorLayer(MdfModel::VectorLayerDefinition* laye
                 break;
         }
 
-        if (nextSymbolRenderingPass == -1)
+        for (size_t g=0; g<groups.size(); ++g)
         {
-            // no more symbol rendering passes for the current instance
-            // rendering pass - switch to the next instance rendering pass
-            instanceRenderingPass = nextInstanceRenderingPass;
-            nextInstanceRenderingPass = -1;
+            delete evals[g];
+            evals[g] = NULL;
 
-            // also reset the symbol rendering pass
-            symbolRenderingPass = 0;
-        }
-        else
-        {
-            // switch to the next symbol rendering pass
-            symbolRenderingPass = nextSymbolRenderingPass;
-            nextSymbolRenderingPass = -1;
+            TargetGroup& group = groups[g];
+            if (!group.IsActive())
+                continue;
+
+            // draw what was batched before the next pass starts
+            for (size_t r=0; r<group.renderers.size(); ++r)
+                group.renderers[r]->FlushDrawBatch();
+
+            if (group.nextSymbolRenderingPass == -1)
+            {
+                // no more symbol rendering passes for the current instance
+                // rendering pass - switch to the next instance rendering pass
+                group.instanceRenderingPass = group.nextInstanceRenderingPass;
+                group.nextInstanceRenderingPass = -1;
+
+                // also reset the symbol rendering pass
+                group.symbolRenderingPass = 0;
+            }
+            else
+            {
+                // switch to the next symbol rendering pass
+                group.symbolRenderingPass = group.nextSymbolRenderingPass;
+                group.nextSymbolRenderingPass = -1;
+            }
         }
     }
 
+    m_serenderer = renderers[0];
+    m_targets = NULL;
+    m_ruleGroup = 0;
+
     #ifdef _DEBUG
     printf("  StylizationEngine::StylizeVectorLayer() Layer: %S  Features: %d\n", layer->GetFeatureName().c_str(), nFeatures);
     #endif
 }
 
 
+// Whether styles evaluated for one renderer apply unchanged to the other.
+bool StylizationEngine::SameScale(SE_Renderer* a, SE_Renderer* b)
+{
+    return a->GetDrawingScale() == b->GetDrawingScale()
+        && a->GetScreenUnitsPerMillimeterDevice() == b->GetScreenUnitsPerMillimeterDevice()
+        && a->GetScreenUnitsPerMillimeterWorld() == b->GetScreenUnitsPerMillimeterWorld()
+        && a->GetScreenUnitsPerPixel() == b->GetScreenUnitsPerPixel()
+        && a->GetMetersPerUnit() == b->GetMetersPerUnit()
+        && a->YPointsUp() == b->YPointsUp()
+        && a->GetRSFontEngine() == b->GetRSFontEngine();
+}
+
+
 // opaque is a double between 0 and 1.
 // 0 means totally transparent, while 1 means totally opaque.
 // The caller should be responsible for validating opaque value.
@@ -270,7 +401,8 @@ inline double GetUnitPerMeter(WatermarkOffset::WatermarkOffsetUnit unit)
 void StylizationEngine::StylizeWatermark(SE_Renderer* se_renderer,
                                          WatermarkDefinition* watermark,
                                          int drawWidth, int drawHeight,
-                                         int saveWidth, int saveHeight)
+                                         int saveWidth, int saveHeight,
+                                         const MdfString& resourceId)
 {
     m_serenderer = se_renderer;
     m_reader = NULL;
@@ -295,68 +427,58 @@ void StylizationEngine::StylizeWatermark(SE_Renderer* se_renderer,
     double rotation = watermark->GetAppearance()->GetRotation();
     rotation = (rotation < 0.0)? 0.0 : ((rotation > 360.0)? 360.0 : rotation);
 
-    SE_Rule rule;
-
-    // Translate watermark source into SE_SymbolInstance list.
-    // As the source is adopted into symbol, we need to detach them after
-    // the rendering is done.
-    CompositeSymbolization symbols;
-
-    std::auto_ptr<SymbolInstance> instance(new SymbolInstance());
-    instance->AdoptSymbolDefinition(watermark->GetContent());
-    instance->SetUsageContext(SymbolInstance::ucPoint);
-    symbols.GetSymbolCollection()->Adopt(instance.release());
+    // prepare some rendering context variable
+    double mm2sud = m_serenderer->GetScreenUnitsPerMillimeterDevice();
+    double mm2suw = m_serenderer->GetScreenUnitsPerMillimeterWorld();
+    double px2su  = m_serenderer->GetScreenUnitsPerPixel();
+    bool yUp = m_serenderer->YPointsUp();
 
-    m_visitor->Convert(rule.symbolInstances, &symbols);
-    _ASSERT(rule.symbolInstances.size() == 1u);
+    // the factor to convert screen units to mapping units
+    double su2wu = 0.001 / (mm2suw * m_serenderer->GetMetersPerUnit());
 
-    // translate appearance (transparency / rotation) into symbol instance
-    SE_SymbolInstance* sym = rule.symbolInstances[0];
-    size_t nStyles = sym->styles.size();
-    for (size_t styleIx=0; styleIx<nStyles; ++styleIx)
+    // look up the converted watermark - a watermark without a resource id
+    // can't be told apart from others and is converted for this call only
+    SE_Rule* rule = NULL;
+    std::auto_ptr<SE_Rule> spRule;
+    if (resourceId.empty())
     {
-        SE_PointStyle* style = (SE_PointStyle*)(sym->styles[styleIx]);
-        style->angleDeg.value = style->angleDeg.defValue = style->angleDeg.defValue + rotation;
-        if (style->symbol.size() == 0)
-            continue;
+        rule = ConvertWatermark(watermark, opacity, rotation);
+        spRule.reset(rule);
+    }
+    else
+    {
+        wchar_t inputs[160];
+        swprintf(inputs, 160, L"|%.17g|%.17g|%.17g|%.17g|%.17g|%d",
+                 opacity, rotation, mm2sud, mm2suw, px2su, yUp? 1 : 0);
+        MdfString key = resourceId + inputs;
 
-        size_t nPrimitives = style->symbol.size();
-        for (size_t primitiveIx=0; primitiveIx<nPrimitives; ++primitiveIx)
+        WatermarkMap::iterator found = m_watermarks.find(key);
+        if (found != m_watermarks.end())
         {
-            SE_Primitive* primitive = style->symbol[primitiveIx];
-            SE_Text* textPri = dynamic_cast<SE_Text*>(primitive);
-            SE_Polygon* polygonPri = dynamic_cast<SE_Polygon*>(primitive);
-            SE_Polyline* linePri = dynamic_cast<SE_Polyline*>(primitive);
-            SE_Raster* rasterPri = dynamic_cast<SE_Raster*>(primitive);
-            if (textPri)
-            {
-                // text needs to change color
-                textPri->textColor.value.argb      = textPri->textColor.defValue.argb      = TransparentColor(textPri->textColor.value.argb, opacity);
-                textPri->ghostColor.value.argb     = textPri->ghostColor.defValue.argb     = TransparentColor(textPri->ghostColor.value.argb, opacity);
-                textPri->frameLineColor.value.argb = textPri->frameLineColor.defValue.argb = TransparentColor(textPri->frameLineColor.value.argb, opacity);
-                textPri->frameFillColor.value.argb = textPri->frameFillColor.defValue.argb = TransparentColor(textPri->frameFillColor.value.argb, opacity);
-            }
-            else if (linePri)
-            {
-                linePri->color.value.argb = linePri->color.defValue.argb = TransparentColor(linePri->color.value.argb, opacity);
-                if (polygonPri)
-                    polygonPri->fill.value.argb = polygonPri->fill.defValue.argb = TransparentColor(polygonPri->fill.value.argb, opacity);
-            }
-            else if (rasterPri)
+            m_watermarkUses.splice(m_watermarkUses.begin(), m_watermarkUses, found->second.use);
+            rule = found->second.rule;
+        }
+        else
+        {
+            // evict the least recently used watermarks to make room
+            while (m_watermarks.size() >= MAX_CACHED_WATERMARKS)
             {
-                rasterPri->opacity = opacity;
+                WatermarkMap::iterator oldest = m_watermarks.find(m_watermarkUses.back());
+                delete oldest->second.rule;
+                m_watermarks.erase(oldest);
+                m_watermarkUses.pop_back();
             }
+
+            rule = ConvertWatermark(watermark, opacity, rotation);
+            m_watermarkUses.push_front(key);
+            WatermarkStamp& stamp = m_watermarks[key];
+            stamp.rule = rule;
+            stamp.use = m_watermarkUses.begin();
         }
     }
 
-    // prepare some rendering context variable
-    double mm2sud = m_serenderer->GetScreenUnitsPerMillimeterDevice();
-    double mm2suw = m_serenderer->GetScreenUnitsPerMillimeterWorld();
-    double px2su  = m_serenderer->GetScreenUnitsPerPixel();
-    bool yUp = m_serenderer->YPointsUp();
-
-    // the factor to convert screen units to mapping units
-    double su2wu = 0.001 / (mm2suw * m_serenderer->GetMetersPerUnit());
+    SE_SymbolInstance* sym = rule->symbolInstances[0];
+    size_t nStyles = sym->styles.size();
 
     // prepare the position list
     XYWatermarkPosition* xyPosition = dynamic_cast<XYWatermarkPosition*>(watermark->GetPosition());
@@ -392,6 +514,8 @@ void StylizationEngine::StylizeWatermark(SE_Renderer* se_renderer,
     yOffset *= suPervUnit;      // in screen units
 
     std::vector<double> watermarkPosList;
+    double tileWidth = 0.0;
+    double tileHeight = 0.0;
     if (xyPosition)
     {
         switch (hAlignment)
@@ -428,8 +552,8 @@ void StylizationEngine::StylizeWatermark(SE_Renderer* se_renderer,
     }
     else if (tilePosition)
     {
-        double tileWidth  = tilePosition->GetTileWidth()*px2su;
-        double tileHeight = tilePosition->GetTileHeight()*px2su;
+        tileWidth  = tilePosition->GetTileWidth()*px2su;
+        tileHeight = tilePosition->GetTileHeight()*px2su;
 
         switch (hAlignment)
         {
@@ -472,6 +596,22 @@ void StylizationEngine::StylizeWatermark(SE_Renderer* se_renderer,
         }
     }
 
+    // All the positions go in one multi-point geometry, so each style is
+    // evaluated and applied once for the whole watermark.  Tiled positions
+    // form a regular grid, which renderers that support pattern fills can
+    // draw in one go.  The grid is only regular if the draw and save sizes
+    // match.
+    LineBuffer* positions = LineBufferPool::NewLineBuffer(m_pool, (int)watermarkPosList.size() / 2);
+    std::auto_ptr<LineBuffer> spPositions(positions);
+    positions->SetGeometryType(GeometryType_MultiPoint);
+    for (size_t posIx=0; posIx<watermarkPosList.size(); posIx+=2)
+        positions->MoveTo(watermarkPosList[posIx], watermarkPosList[posIx+1]);
+
+    // tell line buffer the current drawing scale (used for arc tessellation)
+    positions->SetDrawingScale(drawingScale);
+
+    bool grid = tilePosition && drawWidth == saveWidth && drawHeight == saveHeight;
+
     // we always start with rendering pass 0
     int symbolRenderingPass = 0;
     int nextSymbolRenderingPass = -1;
@@ -493,289 +633,378 @@ void StylizationEngine::StylizeWatermark(SE_Renderer* se_renderer,
         EmEvaluator eval(se_renderer, NULL);
     #endif
 
-        std::auto_ptr<LineBuffer> spLB;
-        size_t nPos = watermarkPosList.size();
-        for (size_t posIx=0; posIx<nPos; posIx+=2)
+        LineBuffer* lb = positions;
+        std::auto_ptr<LineBuffer> spClipLB;
+
+        // -------------------------------------------------------------------------
+        //
+        // Here's a description of how the transforms work for point symbols.
+        //
+        // =============
+        // Point Symbols
+        // =============
+        //
+        // For point symbols we have the following transform stack:
+        //
+        //   [T_fe] [S_mm] [T_si] [R_pu] [S_si] [T_pu] {Geom}
+        //
+        // where:
+        //   T_pu = point usage origin offset (a translation)
+        //   S_si = symbol instance scaling
+        //   R_pu = point usage rotation
+        //   T_si = symbol instance insertion offset
+        //   S_mm = scaling converting mm to screen units (also includes inverting y, if necessary)
+        //   T_fe = translation to the point feature
+        //
+        // This can be rewritten as:
+        //
+        //   [T_fe] [T_si*] [R_pu*] [T_pu*] [S_mm] [S_si] {Geom}
+        //
+        // where:
+        //   T_si* = symbol instance insertion offset, using offsets scaled by S_mm
+        //   R_pu* = point usage rotation, with angle accounting for y-up or y-down
+        //   T_pu* = point usage origin offset, using offsets scaled by S_mm and S_si
+        //
+        // We store [S_mm] [S_si] in xformScale below, and apply it to the symbol geometry
+        // during symbol evaluation.  The remaining transforms get applied in SE_Renderer::
+        // ProcessPoint.
+        // -------------------------------------------------------------------------
+
+        // TODO: Obey the indices - get rid of the indices altogther - single pass!
+
+        // For now always clip using the new stylization - the performance impact of not
+        // clipping is too high.  We also need a better approach to clipping.  Instead
+        // of clipping the feature geometry we need to calculate where to start/stop
+        // drawing symbols.
+        bool bClip = true;  //m_serenderer->RequiresClipping();
+        double clipOffsetSU = 0.0;
+
+        // Make a pass over all the instances.  During this pass we:
+        // - evaluate the active styles
+        // - compute the overall clip offset
+
+        SE_Matrix xformScale;
+        xformScale.scale(sym->scale[0].evaluate(&eval),
+                         sym->scale[1].evaluate(&eval));
+
+        // The symbol geometry needs to be inverted if the y coordinate in the renderer
+        // points down.  This is so that in symbol definitions y points up consistently
+        // no matter what the underlying renderer is doing.  Normally we could just apply
+        // the world to screen transform to everything, but in some cases we only apply
+        // it to the position of the symbol and then offset the symbol geometry from
+        // there - so the symbol geometry needs to be pre-inverted.
+        double mm2suX = (sym->sizeContext == MappingUnits)? mm2suw : mm2sud;
+        double mm2suY = yUp? mm2suX : -mm2suX;
+        xformScale.scale(mm2suX, mm2suY);
+
+        // initialize the style evaluation context
+        SE_EvalContext evalCtx;
+        evalCtx.eval = &eval;
+        evalCtx.mm2su = mm2suX;
+        evalCtx.mm2sud = mm2sud;
+        evalCtx.mm2suw = mm2suw;
+        evalCtx.px2su = px2su;
+        evalCtx.pool = m_pool;
+        evalCtx.arena = NULL;
+        evalCtx.fonte = m_serenderer->GetRSFontEngine();
+        evalCtx.xform = &xformScale;
+        evalCtx.resources = m_resources;
+
+        // iterate over all styles in the instance
+        for (size_t styIx=0; styIx<nStyles; ++styIx)
         {
-            //Get geometry
-            LineBuffer* lb = LineBufferPool::NewLineBuffer(m_pool, 8, Dimensionality_Z);
-            spLB.reset(lb);
-            lb->MoveTo(watermarkPosList[posIx], watermarkPosList[posIx+1]);
-            // tell line buffer the current drawing scale (used for arc tessellation)
-            lb->SetDrawingScale(drawingScale);
-
-            //Render line buffer
-
-            // -------------------------------------------------------------------------
-            //
-            // Here's a description of how the transforms work for point symbols.
-            //
-            // =============
-            // Point Symbols
-            // =============
-            //
-            // For point symbols we have the following transform stack:
-            //
-            //   [T_fe] [S_mm] [T_si] [R_pu] [S_si] [T_pu] {Geom}
-            //
-            // where:
-            //   T_pu = point usage origin offset (a translation)
-            //   S_si = symbol instance scaling
-            //   R_pu = point usage rotation
-            //   T_si = symbol instance insertion offset
-            //   S_mm = scaling converting mm to screen units (also includes inverting y, if necessary)
-            //   T_fe = translation to the point feature
-            //
-            // This can be rewritten as:
-            //
-            //   [T_fe] [T_si*] [R_pu*] [T_pu*] [S_mm] [S_si] {Geom}
-            //
-            // where:
-            //   T_si* = symbol instance insertion offset, using offsets scaled by S_mm
-            //   R_pu* = point usage rotation, with angle accounting for y-up or y-down
-            //   T_pu* = point usage origin offset, using offsets scaled by S_mm and S_si
-            //
-            // We store [S_mm] [S_si] in xformScale below, and apply it to the symbol geometry
-            // during symbol evaluation.  The remaining transforms get applied in SE_Renderer::
-            // ProcessPoint.
-            // -------------------------------------------------------------------------
-
-            // TODO: Obey the indices - get rid of the indices altogther - single pass!
-
-            // For now always clip using the new stylization - the performance impact of not
-            // clipping is too high.  We also need a better approach to clipping.  Instead
-            // of clipping the feature geometry we need to calculate where to start/stop
-            // drawing symbols.
-            bool bClip = true;  //m_serenderer->RequiresClipping();
-            double clipOffsetSU = 0.0;
-
-            // Make a pass over all the instances.  During this pass we:
-            // - evaluate the active styles
-            // - compute the overall clip offset
-
-            SE_Matrix xformScale;
-            xformScale.scale(sym->scale[0].evaluate(&eval),
-                             sym->scale[1].evaluate(&eval));
-
-            // The symbol geometry needs to be inverted if the y coordinate in the renderer
-            // points down.  This is so that in symbol definitions y points up consistently
-            // no matter what the underlying renderer is doing.  Normally we could just apply
-            // the world to screen transform to everything, but in some cases we only apply
-            // it to the position of the symbol and then offset the symbol geometry from
-            // there - so the symbol geometry needs to be pre-inverted.
-            double mm2suX = (sym->sizeContext == MappingUnits)? mm2suw : mm2sud;
-            double mm2suY = yUp? mm2suX : -mm2suX;
-            xformScale.scale(mm2suX, mm2suY);
-
-            // initialize the style evaluation context
-            SE_EvalContext evalCtx;
-            evalCtx.eval = &eval;
-            evalCtx.mm2su = mm2suX;
-            evalCtx.mm2sud = mm2sud;
-            evalCtx.mm2suw = mm2suw;
-            evalCtx.px2su = px2su;
-            evalCtx.pool = m_pool;
-            evalCtx.fonte = m_serenderer->GetRSFontEngine();
-            evalCtx.xform = &xformScale;
-            evalCtx.resources = m_resources;
-
-            // iterate over all styles in the instance
-            for (size_t styIx=0; styIx<nStyles; ++styIx)
-            {
-                SE_Style* style = sym->styles[styIx];
+            SE_Style* style = sym->styles[styIx];
 
-                // process the symbol rendering pass - negative rendering passes are
-                // rendered with pass 0
-                int symbolRenderPass = style->renderPass.evaluate(&eval);
-                if (symbolRenderPass < 0)
-                    symbolRenderPass = 0;
+            // process the symbol rendering pass - negative rendering passes are
+            // rendered with pass 0
+            int symbolRenderPass = style->renderPass.evaluate(&eval);
+            if (symbolRenderPass < 0)
+                symbolRenderPass = 0;
 
-                // if the rendering pass for the style doesn't match the current pass
-                // then don't render using it
-                if (symbolRenderPass != symbolRenderingPass)
-                    continue;
+            // if the rendering pass for the style doesn't match the current pass
+            // then don't render using it
+            if (symbolRenderPass != symbolRenderingPass)
+                continue;
 
-                // evaluate the style (all expressions inside it) and convert to a
-                // constant screen space render style
-                style->evaluate(&evalCtx);
-            }
+            // evaluate the style (all expressions inside it) and convert to a
+            // constant screen space render style
+            style->evaluate(&evalCtx);
+        }
 
-            // Adjust the offset according to watermark position
-            // For example, the watermark is on top/left, the original offset is enough.
-            // However, if the watermark is on bottom/right, the symbols has to be added
-            // an offset to make the bottom/right of their bounds to be the position.
-            RS_F_Point bounds[4];
-            bounds[0].x = bounds[3].x = +DBL_MAX;
-            bounds[1].x = bounds[2].x = -DBL_MAX;
-            bounds[0].y = bounds[1].y = +DBL_MAX;
-            bounds[2].y = bounds[3].y = -DBL_MAX;
-            for (size_t styIx=0; styIx<nStyles; ++styIx)
-            {
-                SE_RenderPointStyle* ptStyle = (SE_RenderPointStyle*)(
-                    sym->styles[styIx]->rstyle);
-                SE_Matrix xformStyle;
+        // Adjust the offset according to watermark position
+        // For example, the watermark is on top/left, the original offset is enough.
+        // However, if the watermark is on bottom/right, the symbols has to be added
+        // an offset to make the bottom/right of their bounds to be the position.
+        RS_F_Point bounds[4];
+        bounds[0].x = bounds[3].x = +DBL_MAX;
+        bounds[1].x = bounds[2].x = -DBL_MAX;
+        bounds[0].y = bounds[1].y = +DBL_MAX;
+        bounds[2].y = bounds[3].y = -DBL_MAX;
+        for (size_t styIx=0; styIx<nStyles; ++styIx)
+        {
+            SE_RenderPointStyle* ptStyle = (SE_RenderPointStyle*)(
+                sym->styles[styIx]->rstyle);
+            if (!ptStyle)
+                continue;
 
-                // point usage offset (already scaled)
-                xformStyle.translate(ptStyle->offset[0], ptStyle->offset[1]);
-                // point usage rotation - assume geometry angle is zero
-                xformStyle.rotate(ptStyle->angleRad);
-                // compute the offset
-                for (int i=0; i<4; ++i)
-                {
-                    // account for the style-specific transform
-                    RS_F_Point pt = ptStyle->bounds[i];
-                    xformStyle.transform(pt.x, pt.y);
-                    bounds[0].x = bounds[3].x = rs_min(bounds[0].x, pt.x);
-                    bounds[1].x = bounds[2].x = rs_max(bounds[2].x, pt.x);
-                    bounds[0].y = bounds[1].y = rs_min(bounds[0].y, pt.y);
-                    bounds[2].y = bounds[3].y = rs_max(bounds[2].y, pt.y);
-                }
-            }
+            SE_Matrix xformStyle;
 
-            // bounds[0].x is left, bounds[1].x is right
-            switch (hAlignment)
+            // point usage offset (already scaled)
+            xformStyle.translate(ptStyle->offset[0], ptStyle->offset[1]);
+            // point usage rotation - assume geometry angle is zero
+            xformStyle.rotate(ptStyle->angleRad);
+            // compute the offset
+            for (int i=0; i<4; ++i)
             {
-            case WatermarkXOffset::Right:
-                sym->absOffset[0].value = sym->absOffset[0].defValue = -bounds[1].x / mm2suX;
-                break;
-            case WatermarkXOffset::Left:
-                sym->absOffset[0].value = sym->absOffset[0].defValue = -bounds[0].x / mm2suX;
-                break;
-            default:
-                sym->absOffset[0].value = sym->absOffset[0].defValue = -0.5*(bounds[0].x + bounds[1].x) / mm2suX;
-                break;
+                // account for the style-specific transform
+                RS_F_Point pt = ptStyle->bounds[i];
+                xformStyle.transform(pt.x, pt.y);
+                bounds[0].x = bounds[3].x = rs_min(bounds[0].x, pt.x);
+                bounds[1].x = bounds[2].x = rs_max(bounds[2].x, pt.x);
+                bounds[0].y = bounds[1].y = rs_min(bounds[0].y, pt.y);
+                bounds[2].y = bounds[3].y = rs_max(bounds[2].y, pt.y);
             }
+        }
 
-            // bounds[1].y is bottom, bounds[2].y is top
-            switch (vAlignment)
-            {
-            case WatermarkYOffset::Bottom:
-                sym->absOffset[1].value = sym->absOffset[1].defValue = (yUp? -1.0: 1.0) * bounds[1].y / mm2suY;
-                break;
-            case WatermarkYOffset::Top:
-                sym->absOffset[1].value = sym->absOffset[1].defValue = (yUp? -1.0: 1.0) * bounds[2].y / mm2suY;
-                break;
-            default:
-                sym->absOffset[1].value = sym->absOffset[1].defValue = (yUp? -1.0: 1.0) * 0.5*(bounds[1].y + bounds[2].y) / mm2suY;
-                break;
-            }
+        // bounds[0].x is left, bounds[1].x is right
+        switch (hAlignment)
+        {
+        case WatermarkXOffset::Right:
+            sym->absOffset[0].value = sym->absOffset[0].defValue = -bounds[1].x / mm2suX;
+            break;
+        case WatermarkXOffset::Left:
+            sym->absOffset[0].value = sym->absOffset[0].defValue = -bounds[0].x / mm2suX;
+            break;
+        default:
+            sym->absOffset[0].value = sym->absOffset[0].defValue = -0.5*(bounds[0].x + bounds[1].x) / mm2suX;
+            break;
+        }
 
-            // prepare the geometry on which we will apply the styles
-            if (bClip)
+        // bounds[1].y is bottom, bounds[2].y is top
+        switch (vAlignment)
+        {
+        case WatermarkYOffset::Bottom:
+            sym->absOffset[1].value = sym->absOffset[1].defValue = (yUp? -1.0: 1.0) * bounds[1].y / mm2suY;
+            break;
+        case WatermarkYOffset::Top:
+            sym->absOffset[1].value = sym->absOffset[1].defValue = (yUp? -1.0: 1.0) * bounds[2].y / mm2suY;
+            break;
+        default:
+            sym->absOffset[1].value = sym->absOffset[1].defValue = (yUp? -1.0: 1.0) * 0.5*(bounds[1].y + bounds[2].y) / mm2suY;
+            break;
+        }
+
+        // prepare the geometry on which we will apply the styles
+        if (bClip)
+        {
+            // compute offset to apply to the clipping bounds
+            for (size_t styIx=0; styIx<nStyles; ++styIx)
             {
-                // compute offset to apply to the clipping bounds
-                for (size_t styIx=0; styIx<nStyles; ++styIx)
-                {
-                    SE_Style* style = sym->styles[styIx];
-                    double styleClipOffsetSU = GetClipOffset(sym, style, &eval, mm2suX, mm2suY);
-                    clipOffsetSU = rs_max(styleClipOffsetSU, clipOffsetSU);
-                }
+                SE_Style* style = sym->styles[styIx];
+                double styleClipOffsetSU = GetClipOffset(sym, style, &eval, mm2suX, mm2suY);
+                clipOffsetSU = rs_max(styleClipOffsetSU, clipOffsetSU);
+            }
 
-                // compute the clip region to use - start with the map request extents
-                RS_Bounds clip = m_serenderer->GetBounds();
+            // compute the clip region to use - start with the map request extents
+            RS_Bounds clip = m_serenderer->GetBounds();
 
-                // add one pixel's worth to handle any roundoff
-                clipOffsetSU += px2su;
+            // add one pixel's worth to handle any roundoff
+            clipOffsetSU += px2su;
 
-                // limit the offset to something reasonable
-                if (clipOffsetSU > MAX_CLIPOFFSET_IN_MM * mm2sud)
-                    clipOffsetSU = MAX_CLIPOFFSET_IN_MM * mm2sud;
+            // limit the offset to something reasonable
+            if (clipOffsetSU > MAX_CLIPOFFSET_IN_MM * mm2sud)
+                clipOffsetSU = MAX_CLIPOFFSET_IN_MM * mm2sud;
 
-                // expand clip region by the offset
-                double clipOffsetWU = clipOffsetSU * su2wu;
-                clip.minx -= clipOffsetWU;
-                clip.miny -= clipOffsetWU;
-                clip.maxx += clipOffsetWU;
-                clip.maxy += clipOffsetWU;
+            // expand clip region by the offset
+            double clipOffsetWU = clipOffsetSU * su2wu;
+            clip.minx -= clipOffsetWU;
+            clip.miny -= clipOffsetWU;
+            clip.maxx += clipOffsetWU;
+            clip.maxy += clipOffsetWU;
 
-                // clip geometry to given extents
-                LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_pool);
-                if (lbc != lb)
+            // clip geometry to given extents
+            LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_pool);
+            if (lbc != lb)
+            {
+                // if the clipped buffer is NULL (completely clipped) there's
+                // nothing to draw in this pass, but styles in a later pass
+                // may still reach the map
+                if (!lbc)
                 {
-                    // if the clipped buffer is NULL (completely clipped) just move on to
-                    // the next feature
-                    if (!lbc) continue;
+                    for (size_t styIx=0; styIx<nStyles; ++styIx)
+                    {
+                        int symbolRenderPass = sym->styles[styIx]->renderPass.evaluate(&eval);
+                        if (symbolRenderPass > symbolRenderingPass)
+                        {
+                            if (nextSymbolRenderingPass == -1 || symbolRenderPass < nextSymbolRenderingPass)
+                                nextSymbolRenderingPass = symbolRenderPass;
+                        }
+                    }
 
-                    // otherwise continue processing with the clipped buffer
-                    lb = lbc;
-                    spLB.reset(lb);
+                    symbolRenderingPass = nextSymbolRenderingPass;
+                    nextSymbolRenderingPass = -1;
+                    continue;
                 }
+
+                // otherwise continue processing with the clipped buffer
+                lb = lbc;
+                spClipLB.reset(lb);
             }
+        }
 
-            // Make another pass over all the instances.  During this pass we:
-            // - compute the next symbol rendering pass
-            // - apply the styles to the geometry (original or clipped)
+        // Make another pass over all the instances.  During this pass we:
+        // - compute the next symbol rendering pass
+        // - apply the styles to the geometry (original or clipped)
 
-            // initialize the style application context
-            SE_Matrix xformTrans;
-            xformTrans.translate(sym->absOffset[0].evaluate(&eval) * mm2suX,
-                                 sym->absOffset[1].evaluate(&eval) * mm2suY);
+        // initialize the style application context
+        SE_Matrix xformTrans;
+        xformTrans.translate(sym->absOffset[0].evaluate(&eval) * mm2suX,
+                             sym->absOffset[1].evaluate(&eval) * mm2suY);
 
-            SE_ApplyContext applyCtx;
-            applyCtx.geometry = lb;
-            applyCtx.renderer = m_serenderer;
-            applyCtx.xform = &xformTrans;
-            applyCtx.sizeContext = sym->sizeContext;
+        SE_ApplyContext applyCtx;
+        applyCtx.geometry = lb;
+        applyCtx.pathMeasure = NULL;
+        applyCtx.renderer = m_serenderer;
+        applyCtx.xform = &xformTrans;
+        applyCtx.sizeContext = sym->sizeContext;
 
-            for (size_t styIx=0; styIx<nStyles; ++styIx)
-            {
-                SE_Style* style = sym->styles[styIx];
+        for (size_t styIx=0; styIx<nStyles; ++styIx)
+        {
+            SE_Style* style = sym->styles[styIx];
 
-                // process the symbol rendering pass - negative rendering passes are
-                // rendered with pass 0
-                int symbolRenderPass = style->renderPass.evaluate(&eval);
-                if (symbolRenderPass < 0)
-                    symbolRenderPass = 0;
+            // process the symbol rendering pass - negative rendering passes are
+            // rendered with pass 0
+            int symbolRenderPass = style->renderPass.evaluate(&eval);
+            if (symbolRenderPass < 0)
+                symbolRenderPass = 0;
 
-                // If the rendering pass for the style doesn't match the current pass
-                // then don't render using it.
-                if (symbolRenderPass != symbolRenderingPass)
+            // If the rendering pass for the style doesn't match the current pass
+            // then don't render using it.
+            if (symbolRenderPass != symbolRenderingPass)
+            {
+                // if the style's rendering pass is greater than the current pass,
+                // then update nextRenderingPass to account for it
+                if (symbolRenderPass > symbolRenderingPass)
                 {
-                    // if the style's rendering pass is greater than the current pass,
-                    // then update nextRenderingPass to account for it
-                    if (symbolRenderPass > symbolRenderingPass)
-                    {
-                        // update nextRenderingPass if it hasn't yet been set, or if
-                        // the style's pass is less than the current next pass
-                        if (nextSymbolRenderingPass == -1 || symbolRenderPass < nextSymbolRenderingPass)
-                            nextSymbolRenderingPass = symbolRenderPass;
-                    }
-
-                    continue;
+                    // update nextRenderingPass if it hasn't yet been set, or if
+                    // the style's pass is less than the current next pass
+                    if (nextSymbolRenderingPass == -1 || symbolRenderPass < nextSymbolRenderingPass)
+                        nextSymbolRenderingPass = symbolRenderPass;
                 }
 
-                // TODO: why are these in the symbol instance?
-                style->rstyle->addToExclusionRegion = sym->addToExclusionRegion.evaluate(&eval);
-                style->rstyle->checkExclusionRegion = sym->checkExclusionRegion.evaluate(&eval);
-                style->rstyle->drawLast = sym->drawLast.evaluate(&eval);
+                continue;
+            }
 
-                const wchar_t* positioningAlgo = sym->positioningAlgorithm.evaluate(&eval);
-                if (wcslen(positioningAlgo) > 0)
+            // TODO: why are these in the symbol instance?
+            style->rstyle->addToExclusionRegion = sym->addToExclusionRegion.evaluate(&eval);
+            style->rstyle->checkExclusionRegion = sym->checkExclusionRegion.evaluate(&eval);
+            style->rstyle->drawLast = sym->drawLast.evaluate(&eval);
+
+            SE_PositioningAlgorithmType positioningAlgo = sym->positioningAlgorithm.evaluateEnum(&eval);
+            if (positioningAlgo != SE_PositioningAlgorithm_None)
+            {
+                LayoutCustomLabel(positioningAlgo, &applyCtx, style->rstyle, mm2suX);
+            }
+            else
+            {
+                // a tiled point style can be drawn as one pattern over the
+                // whole grid - renderers which support pattern fills render
+                // the watermark once into a tile and repeat it - otherwise
+                // apply the style to the geometry
+                bool drawn = false;
+                if (grid && style->rstyle->type == SE_RenderStyle_Point)
                 {
-                    LayoutCustomLabel(positioningAlgo, &applyCtx, style->rstyle, mm2suX);
+                    applyCtx.geometry = positions;
+                    drawn = m_serenderer->ProcessPointGrid(&applyCtx, (SE_RenderPointStyle*)style->rstyle, tileWidth, tileHeight);
+                    applyCtx.geometry = lb;
                 }
-                else
-                {
-                    // apply the style to the geometry using the renderer
+
+                if (!drawn)
                     style->apply(&applyCtx);
-                }
             }
+        }
 
+        if (spClipLB.get())
+            LineBufferPool::FreeLineBuffer(m_pool, spClipLB.release());
 
-            if(spLB.get())
-                LineBufferPool::FreeLineBuffer(m_pool, spLB.release());
-        }
+        m_serenderer->FlushDrawBatch();
 
         // switch to the next symbol rendering pass
         symbolRenderingPass = nextSymbolRenderingPass;
         nextSymbolRenderingPass = -1;
     }
 
+    LineBufferPool::FreeLineBuffer(m_pool, spPositions.release());
+}
+
+
+// Translates the watermark source into a rule with a single symbol instance,
+// and applies the watermark appearance (transparency / rotation) to it.
+SE_Rule* StylizationEngine::ConvertWatermark(WatermarkDefinition* watermark, double opacity, double rotation)
+{
+    SE_Rule* rule = new SE_Rule();
+
+    // As the source is adopted into symbol, we need to detach it once the
+    // conversion is done.
+    CompositeSymbolization symbols;
+
+    std::auto_ptr<SymbolInstance> instance(new SymbolInstance());
+    instance->AdoptSymbolDefinition(watermark->GetContent());
+    instance->SetUsageContext(SymbolInstance::ucPoint);
+    symbols.GetSymbolCollection()->Adopt(instance.release());
+
+    m_visitor->Convert(rule->symbolInstances, &symbols);
+    _ASSERT(rule->symbolInstances.size() == 1u);
+
+    // translate appearance (transparency / rotation) into symbol instance
+    SE_SymbolInstance* sym = rule->symbolInstances[0];
+    size_t nStyles = sym->styles.size();
+    for (size_t styleIx=0; styleIx<nStyles; ++styleIx)
+    {
+        SE_PointStyle* style = (SE_PointStyle*)(sym->styles[styleIx]);
+        style->angleDeg.value = style->angleDeg.defValue = style->angleDeg.defValue + rotation;
+        if (style->symbol.size() == 0)
+            continue;
+
+        size_t nPrimitives = style->symbol.size();
+        for (size_t primitiveIx=0; primitiveIx<nPrimitives; ++primitiveIx)
+        {
+            SE_Primitive* primitive = style->symbol[primitiveIx];
+            SE_Text* textPri = dynamic_cast<SE_Text*>(primitive);
+            SE_Polygon* polygonPri = dynamic_cast<SE_Polygon*>(primitive);
+            SE_Polyline* linePri = dynamic_cast<SE_Polyline*>(primitive);
+            SE_Raster* rasterPri = dynamic_cast<SE_Raster*>(primitive);
+            if (textPri)
+            {
+                // text needs to change color
+                textPri->textColor.value.argb      = textPri->textColor.defValue.argb      = TransparentColor(textPri->textColor.value.argb, opacity);
+                textPri->ghostColor.value.argb     = textPri->ghostColor.defValue.argb     = TransparentColor(textPri->ghostColor.value.argb, opacity);
+                textPri->frameLineColor.value.argb = textPri->frameLineColor.defValue.argb = TransparentColor(textPri->frameLineColor.value.argb, opacity);
+                textPri->frameFillColor.value.argb = textPri->frameFillColor.defValue.argb = TransparentColor(textPri->frameFillColor.value.argb, opacity);
+
+                // the colors are part of the folded text definition
+                textPri->foldTextDef();
+            }
+            else if (linePri)
+            {
+                linePri->color.value.argb = linePri->color.defValue.argb = TransparentColor(linePri->color.value.argb, opacity);
+                if (polygonPri)
+                    polygonPri->fill.value.argb = polygonPri->fill.defValue.argb = TransparentColor(polygonPri->fill.value.argb, opacity);
+            }
+            else if (rasterPri)
+            {
+                rasterPri->opacity = opacity;
+            }
+        }
+    }
+
     // Detach symbol definition from the created composite symbol so that
     // it will not be finalized when composite symbol is finalized.
     // The code is sure there is only one symbol instance.
     _ASSERT(symbols.GetSymbolCollection()->GetCount() == 1);
     symbols.GetSymbolCollection()->GetAt(0)->OrphanSymbolDefinition();
+
+    return rule;
 }
 
 
@@ -794,7 +1023,12 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
 {
     m_reader = reader;
 
-    SE_Rule*& rules = m_rules[style];
+    // the geometry buffer may hold a different feature than last time
+    m_pathMeasure.Reset();
+
+    StylizationProfiler* profiler = m_serenderer->GetProfiler();
+
+    SE_Rule*& rules = m_rules[std::make_pair(style, m_ruleGroup)];
     RuleCollection* rulecoll = style->GetRules();
     int nRules = rulecoll->GetCount();
 
@@ -827,6 +1061,10 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
 
         if (!match)
         {
+            if (profiler)
+                profiler->CountFilter();
+
+            StylizationTraceScope trace("RuleFilter", StylizationTrace::Features);
             STYLIZATION_TRY()
                 match = eval->ExecFilter(&rules[i].filter);
             STYLIZATION_CATCH(L"StylizationEngine.Stylize")
@@ -842,6 +1080,39 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
     if (rule == NULL)
         return;
 
+    double mm2sud = m_serenderer->GetScreenUnitsPerMillimeterDevice();
+    double mm2suw = m_serenderer->GetScreenUnitsPerMillimeterWorld();
+    double px2su  = m_serenderer->GetScreenUnitsPerPixel();
+    bool yUp = m_serenderer->YPointsUp();
+
+    // the factor to convert screen units to mapping units
+    double su2wu = 0.001 / (mm2suw * m_serenderer->GetMetersPerUnit());
+
+    // find the renderers whose extent the feature reaches - when stylizing
+    // for several the largest possible clip offset is allowed for
+    SE_Renderer* primary = m_serenderer;
+    m_routed.clear();
+    if (m_targets == NULL || m_targets->size() == 1)
+    {
+        m_routed.push_back(m_serenderer);
+    }
+    else
+    {
+        const RS_Bounds& fb = geometry->bounds();
+        double marginWU = (MAX_CLIPOFFSET_IN_MM * mm2sud + px2su) * su2wu;
+        for (size_t i=0; i<m_targets->size(); ++i)
+        {
+            SE_Renderer* target = (*m_targets)[i];
+            const RS_Bounds& tb = target->GetBounds();
+            if (fb.minx <= tb.maxx + marginWU && fb.maxx >= tb.minx - marginWU &&
+                fb.miny <= tb.maxy + marginWU && fb.maxy >= tb.miny - marginWU)
+                m_routed.push_back(target);
+        }
+
+        if (m_routed.empty())
+            return;
+    }
+
     // we found a valid rule - send a StartFeature notification
     RS_String rs_tip, rs_url;
     if (!seTip->expression.empty() || wcslen(seTip->getValue()) > 0)
@@ -849,7 +1120,8 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
     if (!seUrl->expression.empty() || wcslen(seUrl->getValue()) > 0)
         rs_url = seUrl->evaluate(eval);
     RS_String& rs_thm = rule->legendLabel;
-    m_serenderer->StartFeature(reader, initialPass, rs_tip.empty()? NULL : &rs_tip, rs_url.empty()? NULL : &rs_url, rs_thm.empty()? NULL : &rs_thm);
+    for (size_t i=0; i<m_routed.size(); ++i)
+        m_routed[i]->StartFeature(reader, initialPass, rs_tip.empty()? NULL : &rs_tip, rs_url.empty()? NULL : &rs_url, rs_thm.empty()? NULL : &rs_thm);
 
     // Get the symbol instances from the rule.  It's possible to end
     // up with no symbols - we're done in that case.
@@ -857,14 +1129,6 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
     if (symbolInstances->size() == 0)
         return;
 
-    double mm2sud = m_serenderer->GetScreenUnitsPerMillimeterDevice();
-    double mm2suw = m_serenderer->GetScreenUnitsPerMillimeterWorld();
-    double px2su  = m_serenderer->GetScreenUnitsPerPixel();
-    bool yUp = m_serenderer->YPointsUp();
-
-    // the factor to convert screen units to mapping units
-    double su2wu = 0.001 / (mm2suw * m_serenderer->GetMetersPerUnit());
-
     // -------------------------------------------------------------------------
     //
     // Here's a description of how the transforms work for point / line / area symbols.
@@ -1033,6 +1297,7 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
         evalCtx.mm2suw = mm2suw;
         evalCtx.px2su = px2su;
         evalCtx.pool = m_pool;
+        evalCtx.arena = &m_arena;
         evalCtx.fonte = m_serenderer->GetRSFontEngine();
         evalCtx.xform = &xformScale;
         evalCtx.resources = m_resources;
@@ -1056,7 +1321,10 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
 
             // evaluate the style (all expressions inside it) and convert to a
             // constant screen space render style
-            style->evaluate(&evalCtx);
+            {
+                StylizationTraceScope trace("Evaluate", StylizationTrace::Features);
+                style->evaluate(&evalCtx);
+            }
 
             // compute offset to apply to the clipping bounds
             if (bClip)
@@ -1067,176 +1335,219 @@ void StylizationEngine::Stylize(RS_FeatureReader* reader,
         }
     }
 
-    // prepare the geometry on which we will apply the styles
-    LineBuffer* lb = geometry;
-    std::auto_ptr<LineBuffer> spClipLB;
-
-    if (bClip)
-    {
-        // compute the clip region to use - start with the map request extents
-        RS_Bounds clip = m_serenderer->GetBounds();
-
-        // add one pixel's worth to handle any roundoff
-        clipOffsetSU += px2su;
-
-        // limit the offset to something reasonable
-        if (clipOffsetSU > MAX_CLIPOFFSET_IN_MM * mm2sud)
-            clipOffsetSU = MAX_CLIPOFFSET_IN_MM * mm2sud;
-
-        // expand clip region by the offset
-        double clipOffsetWU = clipOffsetSU * su2wu;
-        clip.minx -= clipOffsetWU;
-        clip.miny -= clipOffsetWU;
-        clip.maxx += clipOffsetWU;
-        clip.maxy += clipOffsetWU;
-
-        // clip geometry to given extents
-        LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_pool);
-        if (lbc != lb)
-        {
-            // if the clipped buffer is NULL (completely clipped) just move on to
-            // the next feature
-            if (!lbc)
-                return;
-
-            // otherwise continue processing with the clipped buffer
-            lb = lbc;
-            if (lb != geometry)
-                spClipLB.reset(lb);
-        }
-    }
-
-    // don't bother rendering empty feature geometry
-    if (lb->point_count())
+    // apply the styles for each renderer, to the geometry clipped to its
+    // extent
+    for (size_t tIx=0; tIx<m_routed.size(); ++tIx)
     {
-        // Make another pass over all the instances.  During this pass we:
-        // - compute the next instance / symbol rendering pass
-        // - apply the styles to the geometry (original or clipped)
-        for (size_t symIx=0; symIx<nSyms; ++symIx)
-        {
-            sym = (*symbolInstances)[symIx];
+        m_serenderer = m_routed[tIx];
 
-            // process the instance rendering pass - negative rendering passes are
-            // rendered with pass 0
-            int instanceRenderPass = sym->renderPass.evaluate(eval);
-            if (instanceRenderPass < 0)
-                instanceRenderPass = 0;
+        // the geometry was clipped differently for the last renderer
+        if (tIx > 0)
+            m_pathMeasure.Reset();
 
-            // If the rendering pass for the instance doesn't match the current
-            // instance pass then don't render using it.
-            if (instanceRenderPass != instanceRenderingPass)
-            {
-                // if the instance's rendering pass is greater than the current
-                // instance pass, then update nextInstanceRenderingPass to account
-                // for it
-                if (instanceRenderPass > instanceRenderingPass)
-                {
-                    // update nextInstanceRenderingPass if it hasn't yet been set,
-                    // or if the instance's pass is less than the current next pass
-                    if (nextInstanceRenderingPass == -1 || instanceRenderPass < nextInstanceRenderingPass)
-                        nextInstanceRenderingPass = instanceRenderPass;
-                }
+        // prepare the geometry on which we will apply the styles
+        LineBuffer* lb = geometry;
+        std::auto_ptr<LineBuffer> spClipLB;
 
-                continue;
-            }
-
-            // enforce the geometry context
-            if (sym->geomContext != SymbolInstance::gcUnspecified)
+        if (bClip)
+        {
+            // compute the clip region to use - start with the map request extents
+            RS_Bounds clip = m_serenderer->GetBounds();
+
+            // add one pixel's worth to handle any roundoff
+            double offsetSU = clipOffsetSU + px2su;
+
+            // limit the offset to something reasonable
+            if (offsetSU > MAX_CLIPOFFSET_IN_MM * mm2sud)
+                offsetSU = MAX_CLIPOFFSET_IN_MM * mm2sud;
+
+            // expand clip region by the offset
+            double clipOffsetWU = offsetSU * su2wu;
+            clip.minx -= clipOffsetWU;
+            clip.miny -= clipOffsetWU;
+            clip.maxx += clipOffsetWU;
+            clip.maxy += clipOffsetWU;
+
+            // clip geometry to given extents
+            LineBuffer* lbc = lb->Clip(clip, LineBuffer::ctAGF, m_pool);
+            if (profiler)
+                profiler->CountClip(lb, lbc);
+            if (lbc != lb)
             {
-                switch (geometry->geom_type())
-                {
-                case GeometryType_Point:
-                case GeometryType_MultiPoint:
-                    if (sym->geomContext != SymbolInstance::gcPoint)
-                        continue;
-                    break;
-
-                case GeometryType_LineString:
-                case GeometryType_MultiLineString:
-                case GeometryType_CurveString:
-                case GeometryType_MultiCurveString:
-                    if (sym->geomContext != SymbolInstance::gcLineString)
-                        continue;
-                    break;
-
-                case GeometryType_Polygon:
-                case GeometryType_MultiPolygon:
-                case GeometryType_CurvePolygon:
-                case GeometryType_MultiCurvePolygon:
-                    if (sym->geomContext != SymbolInstance::gcPolygon)
-                        continue;
-                    break;
+                // if the clipped buffer is NULL (completely clipped) just move on to
+                // the next renderer
+                if (!lbc)
+                    continue;
 
-//              case GeometryType_MultiGeometry:
-//                  continue;
-//                  break;
-                }
+                // otherwise continue processing with the clipped buffer
+                lb = lbc;
+                if (lb != geometry)
+                    spClipLB.reset(lb);
             }
+        }
 
-            double mm2suX = (sym->sizeContext == MappingUnits)? mm2suw : mm2sud;
-            double mm2suY = yUp? mm2suX : -mm2suX;
-
-            // initialize the style application context
-            SE_Matrix xformTrans;
-            xformTrans.translate(sym->absOffset[0].evaluate(eval) * mm2suX,
-                                 sym->absOffset[1].evaluate(eval) * mm2suY);
-
-            SE_ApplyContext applyCtx;
-            applyCtx.geometry = lb;
-            applyCtx.renderer = m_serenderer;
-            applyCtx.xform = &xformTrans;
-            applyCtx.sizeContext = sym->sizeContext;
+        // don't bother rendering empty feature geometry
+        if (lb->point_count())
+        {
+            StylizationTraceScope trace("Apply", StylizationTrace::Features);
 
-            size_t nStyles = sym->styles.size();
-            for (size_t styIx=0; styIx<nStyles; ++styIx)
+            // Make another pass over all the instances.  During this pass we:
+            // - compute the next instance / symbol rendering pass
+            // - apply the styles to the geometry (original or clipped)
+            for (size_t symIx=0; symIx<nSyms; ++symIx)
             {
-                SE_Style* style = sym->styles[styIx];
+                sym = (*symbolInstances)[symIx];
 
-                // process the symbol rendering pass - negative rendering passes are
+                // process the instance rendering pass - negative rendering passes are
                 // rendered with pass 0
-                int symbolRenderPass = style->renderPass.evaluate(eval);
-                if (symbolRenderPass < 0)
-                    symbolRenderPass = 0;
+                int instanceRenderPass = sym->renderPass.evaluate(eval);
+                if (instanceRenderPass < 0)
+                    instanceRenderPass = 0;
 
-                // If the rendering pass for the style doesn't match the current pass
-                // then don't render using it.
-                if (symbolRenderPass != symbolRenderingPass)
+                // If the rendering pass for the instance doesn't match the current
+                // instance pass then don't render using it.
+                if (instanceRenderPass != instanceRenderingPass)
                 {
-                    // if the style's rendering pass is greater than the current pass,
-                    // then update nextRenderingPass to account for it
-                    if (symbolRenderPass > symbolRenderingPass)
+                    // if the instance's rendering pass is greater than the current
+                    // instance pass, then update nextInstanceRenderingPass to account
+                    // for it
+                    if (instanceRenderPass > instanceRenderingPass)
                     {
-                        // update nextRenderingPass if it hasn't yet been set, or if
-                        // the style's pass is less than the current next pass
-                        if (nextSymbolRenderingPass == -1 || symbolRenderPass < nextSymbolRenderingPass)
-                            nextSymbolRenderingPass = symbolRenderPass;
+                        // update nextInstanceRenderingPass if it hasn't yet been set,
+                        // or if the instance's pass is less than the current next pass
+                        if (nextInstanceRenderingPass == -1 || instanceRenderPass < nextInstanceRenderingPass)
+                            nextInstanceRenderingPass = instanceRenderPass;
                     }
 
                     continue;
                 }
 
-                // TODO: why are these in the symbol instance?
-                style->rstyle->addToExclusionRegion = sym->addToExclusionRegion.evaluate(eval);
-                style->rstyle->checkExclusionRegion = sym->checkExclusionRegion.evaluate(eval);
-                style->rstyle->drawLast = sym->drawLast.evaluate(eval);
-
-                const wchar_t* positioningAlgo = sym->positioningAlgorithm.evaluate(eval);
-                if (wcslen(positioningAlgo) > 0)
+                // enforce the geometry context
+                if (sym->geomContext != SymbolInstance::gcUnspecified)
                 {
-                    LayoutCustomLabel(positioningAlgo, &applyCtx, style->rstyle, mm2suX);
+                    switch (geometry->geom_type())
+                    {
+                    case GeometryType_Point:
+                    case GeometryType_MultiPoint:
+                        if (sym->geomContext != SymbolInstance::gcPoint)
+                            continue;
+                        break;
+
+                    case GeometryType_LineString:
+                    case GeometryType_MultiLineString:
+                    case GeometryType_CurveString:
+                    case GeometryType_MultiCurveString:
+                        if (sym->geomContext != SymbolInstance::gcLineString)
+                            continue;
+                        break;
+
+                    case GeometryType_Polygon:
+                    case GeometryType_MultiPolygon:
+                    case GeometryType_CurvePolygon:
+                    case GeometryType_MultiCurvePolygon:
+                        if (sym->geomContext != SymbolInstance::gcPolygon)
+                            continue;
+                        break;
+
+    //              case GeometryType_MultiGeometry:
+    //                  continue;
+    //                  break;
+                    }
                 }
-                else
+
+                double mm2suX = (sym->sizeContext == MappingUnits)? mm2suw : mm2sud;
+                double mm2suY = yUp? mm2suX : -mm2suX;
+
+                // initialize the style application context
+                SE_Matrix xformTrans;
+                xformTrans.translate(sym->absOffset[0].evaluate(eval) * mm2suX,
+                                     sym->absOffset[1].evaluate(eval) * mm2suY);
+
+                SE_ApplyContext applyCtx;
+                applyCtx.geometry = lb;
+                applyCtx.pathMeasure = &m_pathMeasure;
+                applyCtx.renderer = m_serenderer;
+                applyCtx.xform = &xformTrans;
+                applyCtx.sizeContext = sym->sizeContext;
+
+                size_t nStyles = sym->styles.size();
+                for (size_t styIx=0; styIx<nStyles; ++styIx)
                 {
-                    // apply the style to the geometry using the renderer
-                    style->apply(&applyCtx);
+                    SE_Style* style = sym->styles[styIx];
+
+                    // process the symbol rendering pass - negative rendering passes are
+                    // rendered with pass 0
+                    int symbolRenderPass = style->renderPass.evaluate(eval);
+                    if (symbolRenderPass < 0)
+                        symbolRenderPass = 0;
+
+                    // If the rendering pass for the style doesn't match the current pass
+                    // then don't render using it.
+                    if (symbolRenderPass != symbolRenderingPass)
+                    {
+                        // if the style's rendering pass is greater than the current pass,
+                        // then update nextRenderingPass to account for it
+                        if (symbolRenderPass > symbolRenderingPass)
+                        {
+                            // update nextRenderingPass if it hasn't yet been set, or if
+                            // the style's pass is less than the current next pass
+                            if (nextSymbolRenderingPass == -1 || symbolRenderPass < nextSymbolRenderingPass)
+                                nextSymbolRenderingPass = symbolRenderPass;
+                        }
+
+                        continue;
+                    }
+
+                    // TODO: why are these in the symbol instance?
+                    style->rstyle->addToExclusionRegion = sym->addToExclusionRegion.evaluate(eval);
+                    style->rstyle->checkExclusionRegion = sym->checkExclusionRegion.evaluate(eval);
+                    style->rstyle->drawLast = sym->drawLast.evaluate(eval);
+
+                    SE_PositioningAlgorithmType positioningAlgo = sym->positioningAlgorithm.evaluateEnum(eval);
+                    if (positioningAlgo != SE_PositioningAlgorithm_None)
+                    {
+                        LayoutCustomLabel(positioningAlgo, &applyCtx, style->rstyle, mm2suX);
+                    }
+                    else
+                    {
+                        // apply the style to the geometry using the renderer
+                        style->apply(&applyCtx);
+                    }
                 }
             }
         }
+
+        // free clipped line buffer if the geometry was clipped
+        if (spClipLB.get())
+            LineBufferPool::FreeLineBuffer(m_pool, spClipLB.release());
+    }
+
+    m_serenderer = primary;
+
+
+    ReleaseRenderStyles(rule);
+}
+
+
+// Releases the render styles evaluated for the current feature.  Styles
+// which don't depend on the feature are kept on the heap and stay cached,
+// everything else lives in the arena and goes away in one reset.  Labels
+// never hold on to these - the renderer clones the styles it keeps.
+void StylizationEngine::ReleaseRenderStyles(SE_Rule* rule)
+{
+    std::vector<SE_SymbolInstance*>& symbolInstances = rule->symbolInstances;
+    for (size_t symIx=0; symIx<symbolInstances.size(); ++symIx)
+    {
+        SE_SymbolInstance* sym = symbolInstances[symIx];
+        for (size_t styIx=0; styIx<sym->styles.size(); ++styIx)
+        {
+            SE_Style* style = sym->styles[styIx];
+            if (style->rstyle && style->rstyle->arena)
+                style->reset();
+        }
     }
 
-    // free clipped line buffer if the geometry was clipped
-    if (spClipLB.get())
-        LineBufferPool::FreeLineBuffer(m_pool, spClipLB.release());
+    m_arena.Reset();
 }
 
 
@@ -1352,24 +1663,29 @@ double StylizationEngine::GetClipOffset(SE_SymbolInstance* sym, SE_Style* style,
 }
 
 
-void StylizationEngine::LayoutCustomLabel(const wchar_t* positioningAlgo, SE_ApplyContext* applyCtx, SE_RenderStyle* rstyle, double mm2su)
+void StylizationEngine::LayoutCustomLabel(SE_PositioningAlgorithmType positioningAlgo, SE_ApplyContext* applyCtx, SE_RenderStyle* rstyle, double mm2su)
 {
-    // call the appropriate positioning algorithm based on the name
-    if (wcscmp(positioningAlgo, L"EightSurrounding") == 0)
+    // call the appropriate positioning algorithm
+    switch (positioningAlgo)
     {
-        SE_PositioningAlgorithms::EightSurrounding(applyCtx, rstyle, mm2su);
-    }
-    else if (wcscmp(positioningAlgo, L"PathLabels") == 0)
-    {
-        SE_PositioningAlgorithms::PathLabels(applyCtx, rstyle);
-    }
-    else if (wcscmp(positioningAlgo, L"MultipleHighwayShields") == 0)
-    {
-        SE_PositioningAlgorithms::MultipleHighwaysShields(applyCtx, rstyle, mm2su, m_reader, m_resources);
-    }
-    else if (wcscmp(positioningAlgo, L"Default") == 0)
-    {
-        SE_PositioningAlgorithms::Default(applyCtx, rstyle);
+        case SE_PositioningAlgorithm_EightSurrounding:
+            SE_PositioningAlgorithms::EightSurrounding(applyCtx, rstyle, mm2su);
+            break;
+
+        case SE_PositioningAlgorithm_PathLabels:
+            SE_PositioningAlgorithms::PathLabels(applyCtx, rstyle);
+            break;
+
+        case SE_PositioningAlgorithm_MultipleHighwayShields:
+            SE_PositioningAlgorithms::MultipleHighwaysShields(applyCtx, rstyle, mm2su, m_reader, m_resources);
+            break;
+
+        case SE_PositioningAlgorithm_Default:
+            SE_PositioningAlgorithms::Default(applyCtx, rstyle);
+            break;
+
+        default:
+            break;
     }
 }
 
@@ -1377,10 +1693,22 @@ void StylizationEngine::LayoutCustomLabel(const wchar_t* positioningAlgo, SE_App
 //clears cached filters/styles/etc
 void StylizationEngine::ClearCache()
 {
-    std::map<CompositeTypeStyle*, SE_Rule*>::iterator iter = m_rules.begin();
+    std::map<std::pair<CompositeTypeStyle*, int>, SE_Rule*>::iterator iter = m_rules.begin();
 
     for (; iter != m_rules.end(); ++iter)
         delete [] iter->second;
 
     m_rules.clear();
 }
+
+
+void StylizationEngine::ClearWatermarkCache()
+{
+    WatermarkMap::iterator iter = m_watermarks.begin();
+
+    for (; iter != m_watermarks.end(); ++iter)
+        delete iter->second.rule;
+
+    m_watermarks.clear();
+    m_watermarkUses.clear();
+}
@@ -20,6 +20,9 @@
 
 #include "Stylizer.h"
 #include "SE_Matrix.h"
+#include "SE_SymbolDefProxies.h"
+#include "SE_PathMeasure.h"
+#include <list>
 
 
 // forward declare
@@ -34,6 +37,7 @@ class RS_FeatureReader;
 class RS_ElevationSettings;
 class LineBuffer;
 class LineBufferPool;
+class FeatureCuller;
 
 namespace MDFMODEL_NAMESPACE
 {
@@ -70,13 +74,28 @@ public:
                             CancelStylization                cancel,
                             void*                            userData);
 
-    //Stylize the supplied watermark
+    // Stylizes the supplied layer for several renderers, reading the features
+    // once.  Each renderer uses the scale range at the same index.  Renderers
+    // with the same scale range and scale select rules and evaluate styles
+    // together, using the first of them for expressions, and the styles are
+    // applied to each of them whose extent the feature reaches.
+    void StylizeVectorLayer(MdfModel::VectorLayerDefinition*               layer,
+                            const std::vector<MdfModel::VectorScaleRange*>& ranges,
+                            const std::vector<SE_Renderer*>&                renderers,
+                            RS_FeatureReader*                               reader,
+                            CSysTransformer*                                xformer,
+                            CancelStylization                               cancel,
+                            void*                                           userData);
+
+    //Stylize the supplied watermark.  Watermarks with a resource id are
+    //converted once and reused across requests, see ClearWatermarkCache.
     void StylizeWatermark(SE_Renderer* se_renderer,
                           WatermarkDefinition* watermark,
                           int drawWidth,
                           int drawHeight,
                           int saveWidth,
-                          int saveHeight);
+                          int saveHeight,
+                          const MdfString& resourceId = MdfString());
 
     // Stylizes the current feature on the reader using the supplied composite type style.
     void Stylize(RS_FeatureReader* reader,
@@ -94,17 +113,67 @@ public:
 
     void ClearCache();
 
+    // Discards the converted watermarks.  Unlike the style cache these are
+    // kept across requests, keyed on the watermark's resource id, appearance
+    // and the device scale, and only the most recently used ones are kept.
+    // A watermark resource that is changed needs this call.
+    void ClearWatermarkCache();
+
+    // Features the culler skips are not stylized.  The culler's layer is
+    // started and ended by the caller.
+    inline void SetFeatureCuller(FeatureCuller* culler) { m_culler = culler; }
+
 private:
-    void LayoutCustomLabel(const wchar_t* positioningAlgo, SE_ApplyContext* applyCtx, SE_RenderStyle* rstyle, double mm2su);
+    // Renderers stylized together, with the state of their rendering passes.
+    struct TargetGroup
+    {
+        inline bool IsActive() const { return instanceRenderingPass >= 0 && symbolRenderingPass >= 0; }
+
+        MdfModel::VectorScaleRange* range;
+        std::vector<CompositeTypeStyle*> styles;
+        std::vector<SE_Renderer*> renderers;
+        int instanceRenderingPass;
+        int symbolRenderingPass;
+        int nextInstanceRenderingPass;
+        int nextSymbolRenderingPass;
+    };
+
+    static bool SameScale(SE_Renderer* a, SE_Renderer* b);
+
+    // A watermark converted to a symbol instance with its appearance applied.
+    // Stamps are keyed on the resource id plus everything the evaluated
+    // styles depend on.
+    typedef std::list<MdfString> WatermarkUseList;
+    struct WatermarkStamp
+    {
+        SE_Rule* rule;
+        WatermarkUseList::iterator use;
+    };
+    typedef std::map<MdfString, WatermarkStamp> WatermarkMap;
+
+    SE_Rule* ConvertWatermark(WatermarkDefinition* watermark, double opacity, double rotation);
+
+    void LayoutCustomLabel(SE_PositioningAlgorithmType positioningAlgo, SE_ApplyContext* applyCtx, SE_RenderStyle* rstyle, double mm2su);
     double GetClipOffset(SE_SymbolInstance* sym, SE_Style* style, SE_Evaluator* eval, double mm2suX, double mm2suY);
+    void ReleaseRenderStyles(SE_Rule* rule);
 
 private:
     SE_Renderer* m_serenderer;
     SE_SymbolManager* m_resources;
     SE_BufferPool* m_pool;
+    SE_RenderArena m_arena;
+    SE_PathMeasure m_pathMeasure;
     SE_StyleVisitor* m_visitor;
-    std::map<CompositeTypeStyle*, SE_Rule*> m_rules;
+    std::map<std::pair<CompositeTypeStyle*, int>, SE_Rule*> m_rules;    // per style and target group
+    WatermarkMap m_watermarks;
+    WatermarkUseList m_watermarkUses;   // most recently used first
     RS_FeatureReader* m_reader;
+    FeatureCuller* m_culler;
+
+    // the renderers the current feature is stylized for, and their group
+    const std::vector<SE_Renderer*>* m_targets;
+    int m_ruleGroup;
+    std::vector<SE_Renderer*> m_routed;
 };
 
 #endif
@@ -0,0 +1,241 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "StylizationProfiler.h"
+#include "LineBuffer.h"
+#ifndef EMSCRIPTEN
+#include "ProfileRenderLayersResultBase.h"
+#include "ProfileRenderLabelsResult.h"
+#endif
+#include <chrono>
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationProfiler::Scope::Scope(StylizationProfiler* profiler, MdfModel::VectorLayerDefinition* layer, MdfModel::VectorScaleRange* range)
+: m_profiler(profiler)
+{
+    if (m_profiler)
+        m_profiler->BeginLayer(layer->GetResourceID(), L"Vector", layer->GetFeatureName(), layer->GetFilter(),
+                               range->GetMinScale(), range->GetMaxScale());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationProfiler::Scope::Scope(StylizationProfiler* profiler, MdfModel::GridLayerDefinition* layer, MdfModel::GridScaleRange* range)
+: m_profiler(profiler)
+{
+    if (m_profiler)
+        m_profiler->BeginLayer(layer->GetResourceID(), L"Raster", layer->GetFeatureName(), layer->GetFilter(),
+                               range->GetMinScale(), range->GetMaxScale());
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationProfiler::Scope::Scope(StylizationProfiler* profiler)
+: m_profiler(profiler)
+{
+    if (m_profiler)
+        m_profiler->BeginLabels();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationProfiler::Scope::~Scope()
+{
+    if (m_profiler)
+        m_profiler->End();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationProfiler::StylizationProfiler()
+{
+    Clear();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+StylizationProfiler::~StylizationProfiler()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationProfiler::Clear()
+{
+    _ASSERT(m_open.empty());
+
+    m_layers.clear();
+    m_labels.renderTime = 0.0;
+    memset(&m_labels.counts, 0, sizeof(Counts));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationProfiler::CountClip(LineBuffer* in, LineBuffer* out)
+{
+    Counts* counts = GetCounts();
+    if (counts)
+    {
+        counts->clipVerticesIn += in->point_count();
+        counts->clipVerticesOut += out? out->point_count() : 0;
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationProfiler::CountOptimize(LineBuffer* in, LineBuffer* out)
+{
+    Counts* counts = GetCounts();
+    if (counts)
+    {
+        counts->optimizeVerticesIn += in->point_count();
+        counts->optimizeVerticesOut += out? out->point_count() : 0;
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double StylizationProfiler::GetLayersRenderTime() const
+{
+    double total = 0.0;
+    for (size_t i=0; i<m_layers.size(); ++i)
+        total += m_layers[i].renderTime;
+    return total;
+}
+
+
+#ifndef EMSCRIPTEN
+//////////////////////////////////////////////////////////////////////////////
+void StylizationProfiler::GetResults(MdfModel::ProfileRenderLayersResultBase* layersResult,
+                                     MdfModel::ProfileRenderLabelsResult* labelsResult) const
+{
+    if (layersResult)
+    {
+        MdfModel::ProfileRenderLayerResultCollection* results = layersResult->GetProfileRenderLayerResults();
+        for (size_t i=0; i<m_layers.size(); ++i)
+        {
+            const LayerProfile& profile = m_layers[i];
+
+            MdfModel::ScaleRange* range = new MdfModel::ScaleRange();
+            range->SetMinScale(profile.minScale);
+            range->SetMaxScale(profile.maxScale);
+
+            MdfModel::ProfileRenderLayerResult* result = new MdfModel::ProfileRenderLayerResult();
+            result->SetResourceId(profile.resourceId);
+            result->SetLayerType(profile.layerType);
+            result->SetFeatureClassName(profile.featureClassName);
+            result->SetFilter(profile.filter);
+            result->AdoptScaleRange(range);
+            result->SetRenderTime(profile.renderTime);
+            result->SetFeatureCount(profile.counts.features);
+            result->SetFilterEvaluations(profile.counts.filterEvaluations);
+            result->SetClipVerticesIn(profile.counts.clipVerticesIn);
+            result->SetClipVerticesOut(profile.counts.clipVerticesOut);
+            result->SetOptimizeVerticesIn(profile.counts.optimizeVerticesIn);
+            result->SetOptimizeVerticesOut(profile.counts.optimizeVerticesOut);
+            results->Adopt(result);
+        }
+
+        layersResult->SetRenderTime(GetLayersRenderTime());
+    }
+
+    if (labelsResult)
+    {
+        labelsResult->SetRenderTime(m_labels.renderTime);
+        labelsResult->SetLabelsPlaced(m_labels.counts.labelsPlaced);
+        labelsResult->SetLabelsRejected(m_labels.counts.labelsRejected);
+    }
+}
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationProfiler::BeginLayer(const MdfModel::MdfString& resourceId, const wchar_t* layerType,
+                                     const MdfModel::MdfString& featureClassName, const MdfModel::MdfString& filter,
+                                     double minScale, double maxScale)
+{
+    LayerProfile profile;
+    profile.resourceId = resourceId;
+    profile.layerType = layerType;
+    profile.featureClassName = featureClassName;
+    profile.filter = filter;
+    profile.minScale = minScale;
+    profile.maxScale = maxScale;
+    profile.renderTime = 0.0;
+    memset(&profile.counts, 0, sizeof(Counts));
+    m_layers.push_back(profile);
+
+    OpenScope scope;
+    scope.layer = (int)m_layers.size() - 1;
+    m_open.push_back(scope);
+
+    // the push may have moved the open layers
+    Resolve();
+
+    m_open.back().start = Now();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationProfiler::BeginLabels()
+{
+    OpenScope scope;
+    scope.layer = -1;
+    scope.counts = &m_labels.counts;
+    scope.renderTime = &m_labels.renderTime;
+    m_open.push_back(scope);
+
+    m_open.back().start = Now();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationProfiler::End()
+{
+    _ASSERT(!m_open.empty());
+    if (m_open.empty())
+        return;
+
+    OpenScope& scope = m_open.back();
+    *scope.renderTime += Now() - scope.start;
+    m_open.pop_back();
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Updates the pointers of the open scopes into the layer profiles.
+void StylizationProfiler::Resolve()
+{
+    for (size_t i=0; i<m_open.size(); ++i)
+    {
+        OpenScope& scope = m_open[i];
+        if (scope.layer >= 0)
+        {
+            scope.counts = &m_layers[scope.layer].counts;
+            scope.renderTime = &m_layers[scope.layer].renderTime;
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+double StylizationProfiler::Now()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
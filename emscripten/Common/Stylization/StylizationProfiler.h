@@ -0,0 +1,150 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef STYLIZATIONPROFILER_H_
+#define STYLIZATIONPROFILER_H_
+
+#include "Stylization.h"
+#include <vector>
+
+class LineBuffer;
+
+namespace MdfModel
+{
+    class ProfileRenderLayersResultBase;
+    class ProfileRenderLabelsResult;
+}
+
+
+//---------------------------------------------
+// Collects timings and counts while a map is stylized, so that the slow
+// layers of a request can be diagnosed from the request itself.
+//
+// The caller attaches a profiler to the renderer (SE_Renderer::SetProfiler)
+// for the duration of the map.  The stylizers then open a scope for each
+// layer they stylize, with the scale range in effect, and the label
+// renderer opens one for the label pass.  While a scope is open the
+// stylization code adds its counts to the scope's Counts.  With no profiler
+// attached every probe comes down to a NULL check.
+//
+// The results can be copied into the MdfModel ProfileRender* objects.  The
+// Emscripten build doesn't include those, and so leaves out GetResults.
+//---------------------------------------------
+
+class StylizationProfiler
+{
+public:
+    struct Counts
+    {
+        int features;               // features (or rasters) read
+        int filterEvaluations;      // rule filters evaluated
+        int clipVerticesIn;         // vertices passed to clipping
+        int clipVerticesOut;        // vertices left after clipping
+        int optimizeVerticesIn;     // vertices passed to optimization
+        int optimizeVerticesOut;    // vertices left after optimization
+        int labelsPlaced;
+        int labelsRejected;
+    };
+
+    // one layer stylized in one scale range
+    struct LayerProfile
+    {
+        MdfModel::MdfString resourceId;
+        MdfModel::MdfString layerType;
+        MdfModel::MdfString featureClassName;
+        MdfModel::MdfString filter;
+        double minScale;
+        double maxScale;
+        double renderTime;          // milliseconds
+        Counts counts;
+    };
+
+    // the label pass, which may be run more than once per map
+    struct LabelsProfile
+    {
+        double renderTime;          // milliseconds
+        Counts counts;
+    };
+
+    // Opens a scope for its lifetime.  Does nothing if the profiler is NULL.
+    class Scope
+    {
+    public:
+        STYLIZATION_API Scope(StylizationProfiler* profiler, MdfModel::VectorLayerDefinition* layer, MdfModel::VectorScaleRange* range);
+        STYLIZATION_API Scope(StylizationProfiler* profiler, MdfModel::GridLayerDefinition* layer, MdfModel::GridScaleRange* range);
+        STYLIZATION_API Scope(StylizationProfiler* profiler);
+        STYLIZATION_API ~Scope();
+
+    private:
+        StylizationProfiler* m_profiler;
+    };
+
+    STYLIZATION_API StylizationProfiler();
+    STYLIZATION_API ~StylizationProfiler();
+
+    STYLIZATION_API void Clear();
+
+    // The counts of the innermost open scope, or NULL if there is none.
+    inline Counts* GetCounts() { return m_open.empty()? NULL : m_open.back().counts; }
+
+    // Counting probes for the innermost open scope.
+    inline void CountFeature() { Counts* counts = GetCounts(); if (counts) ++counts->features; }
+    inline void CountFilter() { Counts* counts = GetCounts(); if (counts) ++counts->filterEvaluations; }
+    inline void CountLabel(bool placed) { Counts* counts = GetCounts(); if (counts) ++(placed? counts->labelsPlaced : counts->labelsRejected); }
+
+    // Adds the vertex counts of a clip or optimize operation.  The output
+    // may be NULL (all clipped) or the input (nothing to do).
+    STYLIZATION_API void CountClip(LineBuffer* in, LineBuffer* out);
+    STYLIZATION_API void CountOptimize(LineBuffer* in, LineBuffer* out);
+
+    inline const std::vector<LayerProfile>& GetLayers() const { return m_layers; }
+    inline const LabelsProfile& GetLabels() const { return m_labels; }
+
+    // the total time spent in layer scopes, in milliseconds
+    STYLIZATION_API double GetLayersRenderTime() const;
+
+#ifndef EMSCRIPTEN
+    // Adds a ProfileRenderLayerResult per layer profile to the layers
+    // result, and sets the total render times.  Either result may be NULL.
+    STYLIZATION_API void GetResults(MdfModel::ProfileRenderLayersResultBase* layersResult,
+                                    MdfModel::ProfileRenderLabelsResult* labelsResult) const;
+#endif
+
+private:
+    struct OpenScope
+    {
+        Counts* counts;
+        double* renderTime;
+        double start;
+        int layer;                  // index into m_layers, or -1 for labels
+    };
+
+    void BeginLayer(const MdfModel::MdfString& resourceId, const wchar_t* layerType,
+                    const MdfModel::MdfString& featureClassName, const MdfModel::MdfString& filter,
+                    double minScale, double maxScale);
+    void BeginLabels();
+    void End();
+    void Resolve();
+
+    static double Now();
+
+    std::vector<LayerProfile> m_layers;
+    LabelsProfile m_labels;
+    std::vector<OpenScope> m_open;
+};
+
+#endif
@@ -0,0 +1,316 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "stdafx.h"
+#include "StylizationTrace.h"
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <map>
+#include <cstdio>
+
+// the maximum length of an event's detail string
+#define TRACE_DETAIL_SIZE 48
+
+namespace
+{
+    struct TraceEvent
+    {
+        double ts;                  // microseconds since Start
+        const char* name;
+        const char* category;       // NULL for end events
+        int tid;
+        char detail[TRACE_DETAIL_SIZE];
+    };
+
+    // A ring of events written by a single thread.  Only the writing thread
+    // advances the head, so recording needs no locks.
+    struct TraceBuffer
+    {
+        std::vector<TraceEvent> events;
+        std::atomic<unsigned long long> head;
+        bool inUse;
+    };
+
+    // All the buffers ever handed out.  A buffer is returned when its
+    // thread exits, and reused by the next new thread, so threads which
+    // come and go don't grow the list.
+    struct TraceRegistry
+    {
+        std::mutex mutex;
+        std::vector<TraceBuffer*> buffers;
+        int capacity;
+        int nextTid;
+        std::chrono::steady_clock::time_point epoch;
+
+        TraceRegistry()
+        : capacity(16384)
+        , nextTid(1)
+        , epoch(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~TraceRegistry()
+        {
+            for (size_t i=0; i<buffers.size(); ++i)
+                delete buffers[i];
+        }
+    };
+
+    TraceRegistry& GetRegistry()
+    {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    // the calling thread's buffer, acquired on its first event
+    struct TraceThread
+    {
+        TraceBuffer* buffer;
+        int tid;
+
+        TraceThread()
+        : buffer(NULL)
+        , tid(0)
+        {
+        }
+
+        ~TraceThread()
+        {
+            if (buffer)
+            {
+                TraceRegistry& registry = GetRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                buffer->inUse = false;
+            }
+        }
+
+        TraceBuffer* Acquire()
+        {
+            TraceRegistry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            tid = registry.nextTid++;
+
+            for (size_t i=0; i<registry.buffers.size(); ++i)
+            {
+                if (!registry.buffers[i]->inUse)
+                {
+                    buffer = registry.buffers[i];
+                    buffer->inUse = true;
+                    return buffer;
+                }
+            }
+
+            buffer = new TraceBuffer();
+            buffer->events.resize(registry.capacity);
+            buffer->head.store(0);
+            buffer->inUse = true;
+            registry.buffers.push_back(buffer);
+            return buffer;
+        }
+    };
+
+    thread_local TraceThread t_thread;
+
+    // appends a string to JSON output, escaping as needed
+    void AppendJsonString(std::string& json, const char* str)
+    {
+        json += '"';
+        for (const char* c = str; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                json += '\\';
+                json += *c;
+            }
+            else if ((unsigned char)*c < 0x20)
+                json += ' ';
+            else
+                json += *c;
+        }
+        json += '"';
+    }
+}
+
+
+std::atomic<int> StylizationTrace::s_level(StylizationTrace::Off);
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationTrace::Start(Level level, int eventsPerThread)
+{
+    TraceRegistry& registry = GetRegistry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        registry.capacity = rs_max(eventsPerThread, 16);
+        registry.epoch = std::chrono::steady_clock::now();
+        for (size_t i=0; i<registry.buffers.size(); ++i)
+        {
+            registry.buffers[i]->events.resize(registry.capacity);
+            registry.buffers[i]->head.store(0);
+        }
+    }
+
+    s_level.store(level);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationTrace::Stop()
+{
+    s_level.store(Off);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationTrace::Clear()
+{
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (size_t i=0; i<registry.buffers.size(); ++i)
+        registry.buffers[i]->head.store(0);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationTrace::Begin(const char* name, const char* category, const wchar_t* detail)
+{
+    TraceBuffer* buffer = t_thread.buffer? t_thread.buffer : t_thread.Acquire();
+
+    unsigned long long head = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent& evt = buffer->events[head % buffer->events.size()];
+
+    evt.ts = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - GetRegistry().epoch).count();
+    evt.name = name;
+    evt.category = category;
+    evt.tid = t_thread.tid;
+
+    // the detail is only for display, so keep it to ASCII
+    int len = 0;
+    if (detail)
+    {
+        for (; detail[len] && len < TRACE_DETAIL_SIZE - 1; ++len)
+            evt.detail[len] = (detail[len] < 0x80)? (char)detail[len] : '?';
+    }
+    evt.detail[len] = '\0';
+
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationTrace::End(const char* name)
+{
+    TraceBuffer* buffer = t_thread.buffer? t_thread.buffer : t_thread.Acquire();
+
+    unsigned long long head = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent& evt = buffer->events[head % buffer->events.size()];
+
+    evt.ts = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - GetRegistry().epoch).count();
+    evt.name = name;
+    evt.category = NULL;
+    evt.tid = t_thread.tid;
+    evt.detail[0] = '\0';
+
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationTrace::WriteJson(std::string& json)
+{
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    char buf[128];
+    bool first = true;
+
+    json = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+    for (size_t i=0; i<registry.buffers.size(); ++i)
+    {
+        TraceBuffer* buffer = registry.buffers[i];
+        unsigned long long head = buffer->head.load(std::memory_order_acquire);
+        unsigned long long size = buffer->events.size();
+        unsigned long long start = (head > size)? head - size : 0;
+
+        // The oldest events may have been overwritten, leaving end events
+        // without their begin event.  Drop those, tracking the open events
+        // for each thread which used the buffer.
+        std::map<int, int> depth;
+
+        for (unsigned long long j=start; j<head; ++j)
+        {
+            const TraceEvent& evt = buffer->events[j % size];
+
+            bool isBegin = (evt.category != NULL);
+            int& open = depth[evt.tid];
+            if (isBegin)
+                ++open;
+            else if (open > 0)
+                --open;
+            else
+                continue;
+
+            if (!first)
+                json += ",\n";
+            first = false;
+
+            json += "{\"name\": ";
+            AppendJsonString(json, evt.name);
+            if (isBegin)
+            {
+                json += ", \"cat\": ";
+                AppendJsonString(json, evt.category);
+            }
+
+            snprintf(buf, sizeof(buf), ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d",
+                     isBegin? 'B' : 'E', evt.ts, evt.tid);
+            json += buf;
+
+            if (evt.detail[0])
+            {
+                json += ", \"args\": {\"detail\": ";
+                AppendJsonString(json, evt.detail);
+                json += "}";
+            }
+
+            json += "}";
+        }
+    }
+
+    json += "\n]}\n";
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+void StylizationTraceBatch::Advance()
+{
+    if (m_count % m_batchSize == 0)
+    {
+        if (m_open)
+            StylizationTrace::End("FeatureBatch");
+
+        StylizationTrace::Begin("FeatureBatch", "layer");
+        m_open = true;
+    }
+
+    ++m_count;
+}
@@ -0,0 +1,153 @@
+//
+//  Copyright (C) 2007-2011 by Autodesk, Inc.
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of version 2.1 of the GNU Lesser
+//  General Public License as published by the Free Software Foundation.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#ifndef STYLIZATIONTRACE_H_
+#define STYLIZATIONTRACE_H_
+
+#include "StylizationAPI.h"
+#include <atomic>
+#include <string>
+
+
+//---------------------------------------------
+// Records begin / end events for the phases of stylization, for viewing
+// on a timeline in chrome://tracing or Perfetto.  Where StylizationProfiler
+// sums up each layer, the trace shows where the time went inside a single
+// request, and on which thread.
+//
+// Each thread records into its own fixed-size ring buffer, so recording
+// takes no locks, and a long session keeps only the most recent events.
+// The events are written out in the Chrome trace JSON format.
+//
+// Tracing is off by default, and the instrumentation then costs a single
+// branch on the trace level.  Start, Stop and WriteJson should be called
+// while no stylization is running.
+//---------------------------------------------
+
+class StylizationTrace
+{
+public:
+    // the detail levels - each level includes the ones before it
+    enum Level
+    {
+        Off = 0,
+        Layers = 1,     // layers, feature batches, label phases, rasterizer bands
+        Features = 2    // per-feature read, decode, filter, evaluate and layout, draw calls
+    };
+
+    // Starts recording events up to the given level, clearing any recorded
+    // so far.  Each thread keeps the last eventsPerThread events.
+    STYLIZATION_API static void Start(Level level, int eventsPerThread = 16384);
+
+    // Stops recording.  The recorded events are kept.
+    STYLIZATION_API static void Stop();
+
+    STYLIZATION_API static void Clear();
+
+    inline static bool IsEnabled(Level level)
+    {
+        return s_level.load(std::memory_order_relaxed) >= level;
+    }
+
+    // Records an event on the calling thread.  The name and category must
+    // be string literals.  The optional detail string is copied, and shown
+    // as an argument of the event.
+    STYLIZATION_API static void Begin(const char* name, const char* category, const wchar_t* detail = NULL);
+    STYLIZATION_API static void End(const char* name);
+
+    // Writes the recorded events as a Chrome trace JSON object.
+    STYLIZATION_API static void WriteJson(std::string& json);
+
+private:
+    STYLIZATION_API static std::atomic<int> s_level;
+};
+
+
+//---------------------------------------------
+// Traces a phase for the lifetime of the scope.
+//---------------------------------------------
+
+class StylizationTraceScope
+{
+public:
+    inline StylizationTraceScope(const char* name, StylizationTrace::Level level, const wchar_t* detail = NULL)
+    : m_name(NULL)
+    {
+        if (StylizationTrace::IsEnabled(level))
+        {
+            m_name = name;
+            StylizationTrace::Begin(name, level == StylizationTrace::Layers? "layer" : "feature", detail);
+        }
+    }
+
+    inline ~StylizationTraceScope()
+    {
+        if (m_name)
+            StylizationTrace::End(m_name);
+    }
+
+private:
+    const char* m_name;
+};
+
+
+// Reads the next feature from an RS_FeatureReader, tracing the read at
+// the Features level.
+template <class READER> inline bool StylizationTraceReadNext(READER* reader)
+{
+    StylizationTraceScope trace("ReadFeature", StylizationTrace::Features);
+    return reader->ReadNext();
+}
+
+
+//---------------------------------------------
+// Traces a loop over features in batches of a fixed size.  Next is called
+// for each feature, and ends the current batch event and begins a new one
+// as needed.
+//---------------------------------------------
+
+class StylizationTraceBatch
+{
+public:
+    inline StylizationTraceBatch(int batchSize)
+    : m_batchSize(batchSize)
+    , m_count(0)
+    , m_open(false)
+    {
+    }
+
+    inline ~StylizationTraceBatch()
+    {
+        if (m_open)
+            StylizationTrace::End("FeatureBatch");
+    }
+
+    inline void Next()
+    {
+        if (StylizationTrace::IsEnabled(StylizationTrace::Layers))
+            Advance();
+    }
+
+private:
+    STYLIZATION_API void Advance();
+
+    int m_batchSize;
+    int m_count;
+    bool m_open;
+};
+
+#endif
@@ -129,75 +129,95 @@ void StylizationUtil::DrawStylePreview(int imgWidth,
 
     STYLIZATION_TRY()
 
-        int type = FeatureTypeStyleVisitor::DetermineFeatureTypeStyle(fts);
-        switch (type)
-        {
-            case FeatureTypeStyleVisitor::ftsComposite:
-            {
-                // get correct theme rule
-                CompositeRule* rule = (CompositeRule*)rules->GetAt(themeCategory);
+        StylizationUtil::RenderStylePreview(fts, themeCategory, pSERenderer, sman, 0.0, 0.0, imgWidth, imgHeight);
 
-                // render the symbolization
-                CompositeSymbolization* csym = rule->GetSymbolization();
-                StylizationUtil::RenderCompositeSymbolization(csym, pSERenderer, sman, 0.0, 0.0, imgWidth, imgHeight);
+    STYLIZATION_CATCH(L"StylizationUtil.DrawStylePreview")
 
-                break;
-            }
+    pSERenderer->EndLayer();
+    pSERenderer->EndMap();
+}
 
-            case FeatureTypeStyleVisitor::ftsArea:
-            {
-                // get correct theme rule
-                AreaRule* rule = (AreaRule*)rules->GetAt(themeCategory);
 
-                // render the symbolization
-                AreaSymbolization2D* asym = rule->GetSymbolization();
-                StylizationUtil::RenderAreaSymbolization(asym, pSERenderer, 0.0, 0.0, imgWidth, imgHeight);
+///////////////////////////////////////////////////////////////////////////////
+// Draws a preview of one theme rule of a feature type style into the supplied
+// rectangle.  Calls to this method should be wrapped by the standard calls to
+// StartMap / StartLayer and EndMap / EndLayer.
+void StylizationUtil::RenderStylePreview(FeatureTypeStyle* fts,
+                                         int themeCategory,
+                                         SE_Renderer* pSERenderer,
+                                         SE_SymbolManager* sman,
+                                         double x, double y,
+                                         double width, double height)
+{
+    RuleCollection* rules = fts->GetRules();
+    if (!rules || themeCategory < 0 || themeCategory >= rules->GetCount())
+        return;
 
-                break;
-            }
+    int type = FeatureTypeStyleVisitor::DetermineFeatureTypeStyle(fts);
+    switch (type)
+    {
+        case FeatureTypeStyleVisitor::ftsComposite:
+        {
+            // get correct theme rule
+            CompositeRule* rule = (CompositeRule*)rules->GetAt(themeCategory);
 
-            case FeatureTypeStyleVisitor::ftsLine:
-            {
-                // determine the maximum line width used in this category
-                double maxLineWidth = StylizationUtil::GetMaxMappingSpaceLineWidth(fts, themeCategory);
+            // render the symbolization
+            CompositeSymbolization* csym = rule->GetSymbolization();
+            StylizationUtil::RenderCompositeSymbolization(csym, pSERenderer, sman, x, y, width, height);
 
-                // get correct theme rule
-                LineRule* rule = (LineRule*)rules->GetAt(themeCategory);
+            break;
+        }
 
-                // render the symbolizations
-                LineSymbolizationCollection* lsc = rule->GetSymbolizations();
-                for (int j=0; j<lsc->GetCount(); ++j)
-                {
-                    LineSymbolization2D* lsym = lsc->GetAt(j);
-                    StylizationUtil::RenderLineSymbolization(lsym, pSERenderer, 0.0, 0.0, imgWidth, imgHeight, maxLineWidth);
-                }
+        case FeatureTypeStyleVisitor::ftsArea:
+        {
+            // get correct theme rule
+            AreaRule* rule = (AreaRule*)rules->GetAt(themeCategory);
 
-                break;
-            }
+            // render the symbolization
+            AreaSymbolization2D* asym = rule->GetSymbolization();
+            StylizationUtil::RenderAreaSymbolization(asym, pSERenderer, x, y, width, height);
 
-            case FeatureTypeStyleVisitor::ftsPoint:
-            {
-                // get correct theme rule
-                PointRule* rule = (PointRule*)rules->GetAt(themeCategory);
+            break;
+        }
 
-                // render the symbolization
-                PointSymbolization2D* psym = rule->GetSymbolization();
-                StylizationUtil::RenderPointSymbolization(psym, pSERenderer, 0.0, 0.0, imgWidth, imgHeight);
+        case FeatureTypeStyleVisitor::ftsLine:
+        {
+            // determine the maximum line width used in this category
+            double maxLineWidth = StylizationUtil::GetMaxMappingSpaceLineWidth(fts, themeCategory);
 
-                break;
+            // get correct theme rule
+            LineRule* rule = (LineRule*)rules->GetAt(themeCategory);
+
+            // render the symbolizations
+            LineSymbolizationCollection* lsc = rule->GetSymbolizations();
+            for (int j=0; j<lsc->GetCount(); ++j)
+            {
+                LineSymbolization2D* lsym = lsc->GetAt(j);
+                StylizationUtil::RenderLineSymbolization(lsym, pSERenderer, x, y, width, height, maxLineWidth);
             }
 
-            default:
-                break;
+            break;
         }
 
-    STYLIZATION_CATCH(L"StylizationUtil.DrawStylePreview")
+        case FeatureTypeStyleVisitor::ftsPoint:
+        {
+            // get correct theme rule
+            PointRule* rule = (PointRule*)rules->GetAt(themeCategory);
 
-    pSERenderer->EndLayer();
-    pSERenderer->EndMap();
+            // render the symbolization
+            PointSymbolization2D* psym = rule->GetSymbolization();
+            StylizationUtil::RenderPointSymbolization(psym, pSERenderer, x, y, width, height);
+
+            break;
+        }
+
+        default:
+            break;
+    }
 }
 
 
+
 ///////////////////////////////////////////////////////////////////////////////
 // Draws a preview of the supplied point symbolization.  The preview is sized to
 // fill the renderer image.  Calls to this method should be wrapped by the standard
@@ -514,6 +534,28 @@ void StylizationUtil::RenderCompositeSymbolization(CompositeSymbolization* csym,
     std::vector<SE_SymbolInstance*> symbolInstances;
     visitor.Convert(symbolInstances, csym);
 
+    RenderCompositeSymbolInstances(symbolInstances, pSERenderer, sman, x, y, width, height);
+
+    for (std::vector<SE_SymbolInstance*>::iterator iter = symbolInstances.begin(); iter != symbolInstances.end(); ++iter)
+        delete *iter;
+
+    symbolInstances.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Draws a preview of an already converted composite symbolization.  This lets
+// callers drawing many previews convert each symbolization only once.  Calls
+// to this method should be wrapped by the standard calls to StartMap /
+// StartLayer and EndMap / EndLayer.
+void StylizationUtil::RenderCompositeSymbolInstances(std::vector<SE_SymbolInstance*>& symbolInstances,
+                                                     SE_Renderer* pSERenderer,
+                                                     SE_SymbolManager* sman,
+                                                     double x, double y,
+                                                     double width, double height)
+{
+    SE_BufferPool* pool = pSERenderer->GetBufferPool();
+
 #ifndef EMSCRIPTEN
     // create our FDO evaluator
     FdoEvaluator eval(pSERenderer, NULL);
@@ -656,6 +698,7 @@ void StylizationUtil::RenderCompositeSymbolization(CompositeSymbolization* csym,
         evalCtx.mm2suw = mm2suw;
         evalCtx.px2su = pSERenderer->GetScreenUnitsPerPixel();
         evalCtx.pool = pool;
+        evalCtx.arena = NULL;
         evalCtx.fonte = pSERenderer->GetRSFontEngine();
         evalCtx.xform = &xformScale;
         evalCtx.resources = sman;
@@ -664,6 +707,7 @@ void StylizationUtil::RenderCompositeSymbolization(CompositeSymbolization* csym,
         SE_Matrix xform;
         SE_ApplyContext applyCtx;
         applyCtx.geometry = NULL;   // gets set below
+        applyCtx.pathMeasure = NULL;
         applyCtx.renderer = pSERenderer;
         applyCtx.xform = &xform;
         applyCtx.sizeContext = sym->sizeContext;
@@ -790,15 +834,6 @@ void StylizationUtil::RenderCompositeSymbolization(CompositeSymbolization* csym,
             }
         }
     }
-
-    //-------------------------------------------------------
-    // step 5 - final clean up
-    //-------------------------------------------------------
-
-    for (std::vector<SE_SymbolInstance*>::iterator iter = symbolInstances.begin(); iter != symbolInstances.end(); ++iter)
-        delete *iter;
-
-    symbolInstances.clear();
 }
 
 
@@ -849,6 +884,7 @@ void StylizationUtil::GetCompositeSymbolizationPreviewBounds(std::vector<SE_Symb
         evalCtx.mm2suw = mm2suw;
         evalCtx.px2su = pSERenderer->GetScreenUnitsPerPixel();
         evalCtx.pool = pool;
+        evalCtx.arena = NULL;
         evalCtx.fonte = pSERenderer->GetRSFontEngine();
         evalCtx.xform = &xformScale;
         evalCtx.resources = sman;
@@ -1046,6 +1082,7 @@ void StylizationUtil::GetCompositeSymbolizationBoundsInternal(std::vector<SE_Sym
         evalCtx.mm2suw = mm2suw;
         evalCtx.px2su = pSERenderer->GetScreenUnitsPerPixel();
         evalCtx.pool = pool;
+        evalCtx.arena = NULL;
         evalCtx.fonte = pSERenderer->GetRSFontEngine();
         evalCtx.xform = &xformScale;
         evalCtx.resources = sman;
@@ -42,6 +42,11 @@ public:
     static void DrawStylePreview(int imgWidth, int imgHeight, int themeCategory, FeatureTypeStyle* fts,
                                  SE_Renderer* pSERenderer, SE_SymbolManager* sman);
 
+    static void RenderStylePreview(FeatureTypeStyle* fts, int themeCategory,
+                                   SE_Renderer* pSERenderer, SE_SymbolManager* sman,
+                                   double x, double y,
+                                   double width, double height);
+
     static void RenderPointSymbolization(PointSymbolization2D* psym,
                                          SE_Renderer* pSERenderer,
                                          double x, double y,
@@ -64,6 +69,12 @@ public:
                                              double x, double y,
                                              double width, double height);
 
+    static void RenderCompositeSymbolInstances(std::vector<SE_SymbolInstance*>& symbolInstances,
+                                               SE_Renderer* pSERenderer,
+                                               SE_SymbolManager* sman,
+                                               double x, double y,
+                                               double width, double height);
+
     static RS_Bounds GetCompositeSymbolizationBounds(CompositeSymbolization* csym,
                                                      SE_Renderer* pSERenderer,
                                                      SE_SymbolManager* sman);
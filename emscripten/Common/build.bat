@@ -1,4 +1,5 @@
 @echo off
 SET CC=emcc
 rem %CC% -DEMSCRIPTEN --bind -I. -IEmscripten -IMdfModel -IStylization -o mgstylization.js MgStylization.cpp
-%CC% -DEMSCRIPTEN -I. -IEmscripten -IMdfModel -IStylization -o mgstylization.js MgStylization.cpp
\ No newline at end of file
+%CC% -DEMSCRIPTEN -I. -IEmscripten -IMdfModel -IStylization -o mgstylization.js MgStylization.cpp
+%CC% -DEMSCRIPTEN -I. -IEmscripten -IMdfModel -IStylization -o mgstylizationbenchmark.js MgStylization.cpp MgStylizationBenchmark.cpp